@@ -45,7 +45,9 @@ install -m 600 debian/lhsmtool_tsm.default %{buildroot}/%{_etcdir}/default/lhsmt
 %doc script/ltsmsync.sh
 %{_mandir}/man1/lhsmtool_tsm.1.*
 %{_mandir}/man1/ltsmc.1.*
+%{_mandir}/man1/ltsmsync.1.*
 %{_bindir}/ltsmc
+%{_bindir}/ltsmsync
 %{_sbindir}/lhsmtool_tsm
 %{_unitdir}/%{name}.lhsmtool_tsm.service
 %{_etcdir}/default/lhsmtool_tsm
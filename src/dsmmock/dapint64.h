@@ -0,0 +1,25 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Copyright (c) 2026, GSI Helmholtz Centre for Heavy Ion Research
+ */
+
+#ifndef DAPINT64_H
+#define DAPINT64_H
+
+/* 64 bit integer helpers, libltsmapi converts dsStruct64_t itself. */
+#include "dsmapitd.h"
+
+#endif /* DAPINT64_H */
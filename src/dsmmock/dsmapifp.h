@@ -0,0 +1,67 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Copyright (c) 2026, GSI Helmholtz Centre for Heavy Ion Research
+ */
+
+/* Function prototypes of the subset of the TSM API used by libltsmapi,
+   implemented by libdsmmock. */
+
+#ifndef DSMAPIFP_H
+#define DSMAPIFP_H
+
+#include "dsmapitd.h"
+
+dsInt16_t dsmSetUp(dsBool_t mtFlag, envSetUp *envSetUpP);
+dsInt16_t dsmCleanUp(dsBool_t mtFlag);
+void dsmQueryApiVersionEx(dsmApiVersionEx *apiVersionP);
+dsInt16_t dsmInitEx(dsUint32_t *dsmHandleP, dsmInitExIn_t *dsmInitExInP,
+		    dsmInitExOut_t *dsmInitExOutP);
+dsInt16_t dsmTerminate(dsUint32_t dsmHandle);
+dsInt16_t dsmRCMsg(dsUint32_t dsmHandle, dsInt16_t dsmRC, char *msg);
+dsInt16_t dsmRegisterFS(dsUint32_t dsmHandle, regFSData *regFilespaceP);
+dsInt16_t dsmQuerySessOptions(dsUint32_t dsmHandle, optStruct *optstructP);
+dsInt16_t dsmQuerySessInfo(dsUint32_t dsmHandle, ApiSessInfo *SessInfoP);
+
+dsInt16_t dsmBeginQuery(dsUint32_t dsmHandle, dsmQueryType queryType,
+			dsmQueryBuff *queryBuffer);
+dsInt16_t dsmGetNextQObj(dsUint32_t dsmHandle, DataBlk *dataBlkPtr);
+dsInt16_t dsmEndQuery(dsUint32_t dsmHandle);
+
+dsInt16_t dsmBeginTxn(dsUint32_t dsmHandle);
+dsInt16_t dsmEndTxn(dsUint32_t dsmHandle, dsUint8_t vote,
+		    dsUint16_t *reason);
+dsInt16_t dsmBindMC(dsUint32_t dsmHandle, dsmObjName *objNameP,
+		    dsmSendType sendType, mcBindKey *mcBindKeyP);
+dsInt16_t dsmSendObj(dsUint32_t dsmHandle, dsmSendType sendType,
+		     void *sendBuff, dsmObjName *objNameP,
+		     ObjAttr *objAttrPtr, DataBlk *dataBlkPtr);
+dsInt16_t dsmSendData(dsUint32_t dsmHandle, DataBlk *dataBlkPtr);
+dsInt16_t dsmEndSendObj(dsUint32_t dsmHandle);
+dsInt16_t dsmUpdateObj(dsUint32_t dsmHandle, dsmSendType sendType,
+		       void *sendBuff, dsmObjName *objNameP,
+		       ObjAttr *objAttrPtr, dsUint32_t objUpdAct);
+dsInt16_t dsmDeleteObj(dsUint32_t dsmHandle, dsmDelType delType,
+		       dsmDelInfo delInfo);
+
+dsInt16_t dsmBeginGetData(dsUint32_t dsmHandle, dsBool_t mountWait,
+			  dsmGetType getType, dsmGetList *dsmGetObjListP);
+dsInt16_t dsmGetObj(dsUint32_t dsmHandle, ObjID *objIdP,
+		    DataBlk *dataBlkPtr);
+dsInt16_t dsmGetData(dsUint32_t dsmHandle, DataBlk *dataBlkPtr);
+dsInt16_t dsmEndGetObj(dsUint32_t dsmHandle);
+dsInt16_t dsmEndGetData(dsUint32_t dsmHandle);
+
+#endif /* DSMAPIFP_H */
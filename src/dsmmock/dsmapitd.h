@@ -0,0 +1,411 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Copyright (c) 2026, GSI Helmholtz Centre for Heavy Ion Research
+ */
+
+/* Type definitions of the subset of the TSM API used by libltsmapi.
+   Names follow IBM's dsmapitd.h, however the layout of the structures
+   is not binary compatible, code must be compiled against these headers
+   and linked with libdsmmock. */
+
+#ifndef DSMAPITD_H
+#define DSMAPITD_H
+
+#include <stdint.h>
+
+typedef char		dsChar_t;
+typedef int8_t		dsInt8_t;
+typedef uint8_t		dsUint8_t;
+typedef int16_t		dsInt16_t;
+typedef uint16_t	dsUint16_t;
+typedef int32_t		dsInt32_t;
+typedef uint32_t	dsUint32_t;
+typedef uint8_t		dsBool_t;
+
+typedef enum {
+	bFalse = 0,
+	bTrue  = 1
+} dsmBool_t;
+
+typedef struct {
+	dsUint32_t hi;
+	dsUint32_t lo;
+} dsStruct64_t;
+
+typedef dsStruct64_t ObjID;
+
+typedef struct {
+	dsUint32_t top;
+	dsUint32_t hi_hi;
+	dsUint32_t hi_lo;
+	dsUint32_t lo_hi;
+	dsUint32_t lo_lo;
+} dsUint160_t;
+
+#define DSM_MAX_HL_LENGTH		1024
+#define DSM_MAX_LL_LENGTH		256
+#define DSM_MAX_OBJINFO_LENGTH		255
+#define DSM_MAX_SERVERNAME_LENGTH	64
+#define DSM_MAX_MC_NAME_LENGTH		30
+#define DSM_MAX_RC_MSG_LENGTH		1024
+#define DSM_MAX_GET_OBJ			4080
+#define DSM_MAX_FSINFO_LENGTH		500
+#define DSM_MAX_DESCR_LENGTH		255
+#define DSM_MAX_FSNAME_LENGTH		1024
+#define DSM_MAX_FSTYPE_LENGTH		32
+#define DSM_MAX_OWNER_LENGTH		64
+#define DSM_MAX_VERIFIER_LENGTH		64
+#define DSM_MAX_NODE_LENGTH		64
+#define DSM_MAX_PLATFORM_LENGTH		16
+
+/* Object types. */
+#define DSM_OBJ_FILE		0x01
+#define DSM_OBJ_DIRECTORY	0x02
+#define DSM_OBJ_RESERVED1	0x04
+#define DSM_OBJ_RESERVED2	0x05
+#define DSM_OBJ_RESERVED3	0x06
+#define DSM_OBJ_WILDCARD	0xFE
+#define DSM_OBJ_ANY_TYPE	0xFF
+
+#define DSM_SINGLETHREAD	0
+#define DSM_MULTITHREAD		1
+
+#define DSM_VOTE_COMMIT		1
+#define DSM_VOTE_ABORT		2
+
+#define DATE_MINUS_INFINITE	0x0000
+#define DATE_PLUS_INFINITE	0xFFFF
+
+#define DS_LESSTHAN		-1
+#define DS_EQUAL		0
+#define DS_GREATERTHAN		1
+
+#define DSM_ARCHUPD_DESCRIPTION	0x0002
+#define DSM_ARCHUPD_OBJINFO	0x0004
+
+#define ARCHDEL_YES		1
+#define ARCHDEL_NO		0
+
+#define COMPRESS_YES		1
+#define COMPRESS_NO		0
+#define COMPRESS_CD		2
+
+#define DSM_API_VERSION		8
+#define DSM_API_RELEASE		1
+#define DSM_API_LEVEL		0
+#define DSM_API_SUBLEVEL	0
+
+/* Structure versions. */
+#define DataBlkVersion			3
+#define ObjAttrVersion			4
+#define mcBindKeyVersion		1
+#define sndArchiveDataVersion		1
+#define qryArchiveDataVersion		1
+#define qryRespArchiveDataVersion	6
+#define qryMCDataVersion		1
+#define qryRespMCDataVersion		1
+#define regFSDataVersion		1
+#define delArchVersion			1
+#define dsmGetListVersion		2
+#define dsmGetListPORVersion		3
+#define dsmInitExInVersion		5
+#define dsmInitExOutVersion		3
+#define appVersionVer			1
+#define apiVersionExVer			2
+#define ApiSessInfoVersion		6
+
+typedef struct {
+	dsUint16_t year;
+	dsUint8_t  month;
+	dsUint8_t  day;
+	dsUint8_t  hour;
+	dsUint8_t  minute;
+	dsUint8_t  second;
+} dsmDate;
+
+typedef struct {
+	char	  fs[DSM_MAX_FSNAME_LENGTH + 1];
+	char	  hl[DSM_MAX_HL_LENGTH + 1];
+	char	  ll[DSM_MAX_LL_LENGTH + 1];
+	dsUint8_t objType;
+} dsmObjName;
+
+typedef struct {
+	dsUint16_t stVersion;
+	dsUint32_t bufferLen;
+	dsUint32_t numBytes;
+	char	   *bufferPtr;
+	dsUint32_t numBytesCompressed;
+	dsUint16_t reserved;
+} DataBlk;
+
+typedef struct {
+	dsUint16_t   stVersion;
+	char	     owner[DSM_MAX_OWNER_LENGTH + 1];
+	dsStruct64_t sizeEstimate;
+	dsBool_t     objCompressed;
+	dsUint16_t   objInfoLength;
+	char	     *objInfo;
+	char	     *mcNameP;
+	dsBool_t     disableDeduplication;
+	dsBool_t     useExtObjInfo;
+} ObjAttr;
+
+typedef struct {
+	dsUint16_t stVersion;
+	char	   mcName[DSM_MAX_MC_NAME_LENGTH + 1];
+	dsBool_t   backup_cg_exists;
+	dsBool_t   archive_cg_exists;
+	char	   backup_copy_dest[DSM_MAX_MC_NAME_LENGTH + 1];
+	char	   archive_copy_dest[DSM_MAX_MC_NAME_LENGTH + 1];
+} mcBindKey;
+
+typedef struct {
+	dsUint16_t stVersion;
+	char	   *descr;
+} sndArchiveData;
+
+typedef struct {
+	dsUint16_t stVersion;
+	dsmObjName *objName;
+	char	   *owner;
+	dsmDate	   insDateLowerBound;
+	dsmDate	   insDateUpperBound;
+	dsmDate	   expDateLowerBound;
+	dsmDate	   expDateUpperBound;
+	char	   *descr;
+} qryArchiveData;
+
+typedef struct {
+	dsUint16_t   stVersion;
+	dsmObjName   objName;
+	dsUint32_t   copyGroup;
+	char	     mcName[DSM_MAX_MC_NAME_LENGTH + 1];
+	char	     owner[DSM_MAX_OWNER_LENGTH + 1];
+	ObjID	     objId;
+	dsStruct64_t reserved;
+	dsUint8_t    mediaClass;
+	dsmDate	     insDate;
+	dsmDate	     expDate;
+	char	     descr[DSM_MAX_DESCR_LENGTH + 1];
+	dsUint16_t   objInfolen;
+	char	     objInfo[DSM_MAX_OBJINFO_LENGTH + 1];
+	dsUint160_t  restoreOrderExt;
+	dsStruct64_t sizeEstimate;
+	dsUint8_t    compressType;
+	dsUint8_t    retentionInitiated;
+	dsUint8_t    objHeld;
+	dsUint8_t    encryptionType;
+	dsBool_t     clientDeduplicated;
+} qryRespArchiveData;
+
+typedef struct {
+	dsUint16_t stVersion;
+	char	   *mcName;
+	dsBool_t   mcDetail;
+} qryMCData;
+
+typedef struct {
+	dsUint16_t stVersion;
+	char	   mcName[DSM_MAX_MC_NAME_LENGTH + 1];
+	char	   mcDesc[DSM_MAX_DESCR_LENGTH + 1];
+} qryRespMCData;
+
+typedef struct {
+	dsUint16_t fsInfoLength;
+	char	   fsInfo[DSM_MAX_FSINFO_LENGTH];
+} dsmUnixFSAttrib;
+
+typedef union {
+	dsmUnixFSAttrib unixFSAttr;
+} dsmFSAttr;
+
+typedef struct {
+	dsUint16_t   stVersion;
+	char	     *fsName;
+	char	     *fsType;
+	dsStruct64_t occupancy;
+	dsStruct64_t capacity;
+	dsmFSAttr    fsAttr;
+} regFSData;
+
+typedef struct {
+	dsUint16_t stVersion;
+	ObjID	   objId;
+} delArch;
+
+typedef union {
+	delArch archInfo;
+} dsmDelInfo;
+
+typedef struct {
+	dsUint16_t stVersion;
+	dsUint32_t numObjId;
+	ObjID	   *objId;
+	void	   *partialObjData;
+} dsmGetList;
+
+typedef struct {
+	dsUint16_t stVersion;
+	dsUint16_t version;
+	dsUint16_t release;
+	dsUint16_t level;
+	dsUint16_t subLevel;
+	dsmBool_t  unicode;
+} dsmApiVersionEx;
+
+typedef struct {
+	dsUint16_t stVersion;
+	dsUint16_t applicationVersion;
+	dsUint16_t applicationRelease;
+	dsUint16_t applicationLevel;
+	dsUint16_t applicationSubLevel;
+} dsmAppVersion;
+
+typedef struct {
+	dsUint16_t	stVersion;
+	dsmApiVersionEx *apiVersionExP;
+	char		*clientNodeNameP;
+	char		*clientOwnerNameP;
+	char		*clientPasswordP;
+	char		*userNameP;
+	char		*userPasswordP;
+	char		*applicationTypeP;
+	char		*configfile;
+	char		*options;
+	char		dirDelimiter;
+	dsmBool_t	useUnicode;
+	dsmBool_t	bCrossPlatform;
+	dsmBool_t	bService;
+	dsmBool_t	bEncryptKeyEnabled;
+	char		*encryptionPasswordP;
+	dsmBool_t	useTsmBuffers;
+	dsUint8_t	numTsmBuffers;
+	dsmAppVersion	*appVersionP;
+} dsmInitExIn_t;
+
+typedef struct {
+	dsUint16_t stVersion;
+	dsInt16_t  userNameAuthorities;
+	dsInt16_t  infoRC;
+	char	   adsmServerName[DSM_MAX_SERVERNAME_LENGTH + 1];
+	dsUint16_t serverVer;
+	dsUint16_t serverRel;
+	dsUint16_t serverLev;
+	dsUint16_t serverSubLev;
+} dsmInitExOut_t;
+
+typedef struct {
+	char	  dsmiDir[DSM_MAX_FSNAME_LENGTH + 1];
+	char	  dsmiConfig[DSM_MAX_FSNAME_LENGTH + 1];
+	char	  serverName[DSM_MAX_SERVERNAME_LENGTH + 1];
+	dsInt16_t commMethod;
+	char	  serverAddress[DSM_MAX_FSNAME_LENGTH + 1];
+	char	  nodeName[DSM_MAX_NODE_LENGTH + 1];
+	dsBool_t  compression;
+	dsBool_t  compressalways;
+	dsBool_t  passwordAccess;
+} optStruct;
+
+typedef enum {
+	failOvrNotConfigured = 0,
+	failOvrConfigured,
+	failOvrConnectedToReplServer
+} dsmFailOvrCfgType;
+
+typedef enum {
+	dedupServerOnly = 0,
+	dedupClientOrServer
+} dsmDedupType;
+
+typedef struct {
+	dsUint16_t	  stVersion;
+	char		  serverHost[DSM_MAX_FSNAME_LENGTH + 1];
+	dsUint16_t	  serverPort;
+	dsmDate		  serverDate;
+	char		  serverType[DSM_MAX_PLATFORM_LENGTH * 2 + 1];
+	dsUint16_t	  serverVer;
+	dsUint16_t	  serverRel;
+	dsUint16_t	  serverLev;
+	dsUint16_t	  serverSubLev;
+	char		  nodeType[DSM_MAX_PLATFORM_LENGTH + 1];
+	char		  fsdelim;
+	char		  hldelim;
+	dsUint8_t	  compression;
+	dsUint8_t	  archDel;
+	dsUint8_t	  backDel;
+	dsUint32_t	  maxBytesPerTxn;
+	dsUint16_t	  maxObjPerTxn;
+	char		  id[DSM_MAX_NODE_LENGTH + 1];
+	char		  owner[DSM_MAX_OWNER_LENGTH + 1];
+	char		  confFile[DSM_MAX_FSNAME_LENGTH + 1];
+	dsUint8_t	  opNoTrace;
+	char		  domainName[DSM_MAX_MC_NAME_LENGTH + 1];
+	char		  policySetName[DSM_MAX_MC_NAME_LENGTH + 1];
+	dsmDate		  polActDate;
+	char		  dfltMCName[DSM_MAX_MC_NAME_LENGTH + 1];
+	dsUint16_t	  gpBackRetn;
+	dsUint16_t	  gpArchRetn;
+	char		  adsmServerName[DSM_MAX_SERVERNAME_LENGTH + 1];
+	dsmBool_t	  archiveRetentionProtection;
+	dsmBool_t	  lanFreeEnabled;
+	dsmDedupType	  dedupType;
+	char		  accessNode[DSM_MAX_NODE_LENGTH + 1];
+	dsmFailOvrCfgType failOverCfgType;
+	char		  replServerName[DSM_MAX_SERVERNAME_LENGTH + 1];
+	char		  homeServerName[DSM_MAX_SERVERNAME_LENGTH + 1];
+	char		  replServerHost[DSM_MAX_FSNAME_LENGTH + 1];
+	dsInt32_t	  replServerPort;
+} ApiSessInfo;
+
+typedef enum {
+	qtArchive = 0,
+	qtBackup,
+	qtActive,
+	qtFilespace,
+	qtMC
+} dsmQueryType;
+
+typedef enum {
+	stBackup = 0,
+	stArchive,
+	stBackupMountWait,
+	stArchiveMountWait
+} dsmSendType;
+
+typedef enum {
+	dtArchive = 0,
+	dtBackup,
+	dtBackupID
+} dsmDelType;
+
+typedef enum {
+	gtBackup = 0,
+	gtArchive
+} dsmGetType;
+
+typedef void dsmQueryBuff;
+
+typedef struct {
+	dsUint16_t stVersion;
+	char	   *dsmiDir;
+	char	   *dsmiConfig;
+	char	   *dsmiLog;
+	char	   **argv;
+	char	   logName[DSM_MAX_FSNAME_LENGTH + 1];
+} envSetUp;
+
+#endif /* DSMAPITD_H */
@@ -0,0 +1,1273 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Copyright (c) 2026, GSI Helmholtz Centre for Heavy Ion Research
+ */
+
+/*
+ * Offline stand-in for the TSM API library, which implements the dsm*
+ * calls used by libltsmapi on top of a local directory. Each node has its
+ * own directory DSMMOCK_DIR/<node>, objects are stored in one of
+ * DSMMOCK_SHARDS subdirectories selected by the hash of fs, hl and ll,
+ * such that queries without wildcards scan a single subdirectory. An
+ * object consists of file <id>.meta holding struct dsmmock_obj_t and
+ * file <id>.data holding the object data. Objects sent within a
+ * transaction become visible on commit by renaming their temporary files.
+ *
+ * Server characteristics are configured by environment variables read in
+ * dsmSetUp:
+ *
+ * DSMMOCK_DIR          Object store directory [default: /tmp/dsmmock].
+ * DSMMOCK_LATENCY_USEC Delay of each server round trip, i.e. dsmInitEx,
+ *                      dsmBeginQuery, dsmEndTxn, dsmBeginGetData and
+ *                      dsmUpdateObj [default: 0].
+ * DSMMOCK_BANDWIDTH    Bytes per second of each session for dsmSendData,
+ *                      dsmGetObj and dsmGetData, 0 is unlimited
+ *                      [default: 0].
+ * DSMMOCK_MAX_MOUNTS   Mount points of all sessions of the process, 0 is
+ *                      unlimited [default: 0]. A session claims a mount
+ *                      point on its first dsmSendObj or dsmBeginGetData
+ *                      and keeps it until dsmTerminate. A session which
+ *                      cannot claim a mount point fails the transaction
+ *                      with reason DSM_RS_ABORT_EXCEED_MAX_MP, or waits
+ *                      in dsmBeginGetData when mountWait is set.
+ * DSMMOCK_MOUNT_USEC   Delay of claiming a mount point and of each
+ *                      dsmBeginGetData, e.g. tape mount and positioning
+ *                      [default: 0].
+ * DSMMOCK_CONN_LOSS    Number of dsmSendData calls of the process after
+ *                      which the calling session loses its connection, 0
+ *                      is never [default: 0]. All further calls of the
+ *                      session except dsmTerminate fail with
+ *                      DSM_RC_TCPIP_FAILURE.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <fnmatch.h>
+#include <time.h>
+#include <pthread.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "dsmapitd.h"
+#include "dsmapifp.h"
+#include "dsmrc.h"
+
+#define DSMMOCK_DIR_DEFAULT	"/tmp/dsmmock"
+#define DSMMOCK_DIR_LEN		DSM_MAX_FSNAME_LENGTH
+#define DSMMOCK_SHARDS		256
+#define DSMMOCK_MAX_SESSIONS	1024
+#define DSMMOCK_MAGIC		0x4d4f434b	/* MOCK */
+#define DSMMOCK_MC_NAME		"STANDARD"
+#define DSMMOCK_SERVER_NAME	"DSMMOCK"
+
+/* Record of file <id>.meta. */
+struct dsmmock_obj_t {
+	uint32_t     magic;
+	dsmObjName   obj_name;
+	char	     owner[DSM_MAX_OWNER_LENGTH + 1];
+	char	     descr[DSM_MAX_DESCR_LENGTH + 1];
+	ObjID	     obj_id;
+	dsmDate	     ins_date;
+	dsStruct64_t size_estimate;
+	dsUint16_t   obj_info_len;
+	char	     obj_info[DSM_MAX_OBJINFO_LENGTH + 1];
+};
+
+struct dsmmock_session_t {
+	char	   node[DSM_MAX_NODE_LENGTH + 1];
+	char	   owner[DSM_MAX_OWNER_LENGTH + 1];
+	char	   root[DSMMOCK_DIR_LEN + DSM_MAX_NODE_LENGTH + 2];
+	bool	   mounted;
+	bool	   lost;
+	uint64_t   bw_due_ns;
+
+	/* Transaction. */
+	bool	   in_txn;
+	dsUint16_t txn_reason;
+	struct dsmmock_obj_t *sent;
+	size_t	   num_sent;
+	ObjID	   *deleted;
+	size_t	   num_deleted;
+	int	   send_fd;
+
+	/* Query. */
+	dsmQueryType q_type;
+	struct dsmmock_obj_t *q_objs;
+	size_t	   q_num;
+	size_t	   q_idx;
+
+	/* Retrieve. */
+	ObjID	   *get_ids;
+	size_t	   get_num;
+	int	   get_fd;
+	off_t	   get_left;
+};
+
+static struct {
+	char	 dir[DSMMOCK_DIR_LEN + 1];
+	uint64_t latency_usec;
+	uint64_t bandwidth;
+	uint32_t max_mounts;
+	uint64_t mount_usec;
+	uint64_t conn_loss;
+} conf;
+
+static struct dsmmock_session_t *sessions[DSMMOCK_MAX_SESSIONS];
+static pthread_mutex_t sessions_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t mounts = 0;
+static pthread_mutex_t mounts_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t mounts_cond = PTHREAD_COND_INITIALIZER;
+
+static pthread_mutex_t id_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t sends = 0;
+
+static uint64_t env_u64(const char *name, const uint64_t dflt)
+{
+	const char *val = getenv(name);
+
+	return val && val[0] ? strtoull(val, NULL, 0) : dflt;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void sleep_ns(const uint64_t ns)
+{
+	struct timespec ts = {.tv_sec = ns / 1000000000ULL,
+			      .tv_nsec = ns % 1000000000ULL};
+
+	while (nanosleep(&ts, &ts) && errno == EINTR)
+		;
+}
+
+static void round_trip(void)
+{
+	if (conf.latency_usec)
+		sleep_ns(conf.latency_usec * 1000);
+}
+
+/* Delay transfer of len bytes such that the session does not exceed
+   DSMMOCK_BANDWIDTH. */
+static void throttle(struct dsmmock_session_t *session, const uint64_t len)
+{
+	uint64_t now;
+
+	if (!conf.bandwidth || !len)
+		return;
+
+	now = now_ns();
+	if (session->bw_due_ns < now)
+		session->bw_due_ns = now;
+	session->bw_due_ns += len * 1000000000ULL / conf.bandwidth;
+	if (session->bw_due_ns > now)
+		sleep_ns(session->bw_due_ns - now);
+}
+
+static void date_now(dsmDate *date)
+{
+	struct tm tm;
+	const time_t t = time(NULL);
+
+	localtime_r(&t, &tm);
+	date->year = tm.tm_year + 1900;
+	date->month = tm.tm_mon + 1;
+	date->day = tm.tm_mday;
+	date->hour = tm.tm_hour;
+	date->minute = tm.tm_min;
+	date->second = tm.tm_sec;
+}
+
+static int date_cmp(const dsmDate *a, const dsmDate *b)
+{
+	const uint64_t x = (uint64_t)a->year << 40 | (uint64_t)a->month << 32 |
+		(uint64_t)a->day << 24 | a->hour << 16 | a->minute << 8 |
+		a->second;
+	const uint64_t y = (uint64_t)b->year << 40 | (uint64_t)b->month << 32 |
+		(uint64_t)b->day << 24 | b->hour << 16 | b->minute << 8 |
+		b->second;
+
+	return x < y ? DS_LESSTHAN : x > y ? DS_GREATERTHAN : DS_EQUAL;
+}
+
+static struct dsmmock_session_t *session_get(const dsUint32_t handle)
+{
+	struct dsmmock_session_t *session = NULL;
+
+	if (handle == 0 || handle > DSMMOCK_MAX_SESSIONS)
+		return NULL;
+
+	pthread_mutex_lock(&sessions_mutex);
+	session = sessions[handle - 1];
+	pthread_mutex_unlock(&sessions_mutex);
+
+	return session;
+}
+
+#define SESSION_GET(session, handle)				\
+do {								\
+	session = session_get(handle);				\
+	if (!session)						\
+		return DSM_RC_INVALID_DSMHANDLE;		\
+	if (session->lost)					\
+		return DSM_RC_TCPIP_FAILURE;			\
+} while (0)
+
+static uint32_t shard_of(const dsmObjName *obj_name)
+{
+	uint32_t hash = 2166136261U;	/* FNV-1a */
+	const char *str[] = {obj_name->fs, obj_name->hl, obj_name->ll};
+
+	for (uint8_t n = 0; n < 3; n++) {
+		for (const char *c = str[n]; *c; c++) {
+			hash ^= (unsigned char)*c;
+			hash *= 16777619U;
+		}
+		hash *= 16777619U;	/* Separator '\0'. */
+	}
+
+	return hash % DSMMOCK_SHARDS;
+}
+
+static void obj_path(const struct dsmmock_session_t *session,
+		     const ObjID *obj_id, const char *suffix, char *path)
+{
+	snprintf(path, PATH_MAX + 1, "%s/%02x/%08x.%s", session->root,
+		 obj_id->hi, obj_id->lo, suffix);
+}
+
+static int mkdir_ok(const char *path)
+{
+	if (mkdir(path, S_IRWXU | S_IRGRP | S_IXGRP | S_IROTH | S_IXOTH) &&
+	    errno != EEXIST)
+		return -errno;
+
+	return 0;
+}
+
+/* Allocate object id in shard, the sequence number is kept in file
+   DSMMOCK_DIR/<node>/objid and shared by all processes. */
+static int obj_id_alloc(const struct dsmmock_session_t *session,
+			const uint32_t shard, ObjID *obj_id)
+{
+	int rc = 0;
+	int fd;
+	char path[PATH_MAX + 1];
+	char buf[32] = {0};
+	uint32_t seq;
+	ssize_t len;
+
+	snprintf(path, sizeof(path), "%s/objid", session->root);
+
+	pthread_mutex_lock(&id_mutex);
+	fd = open(path, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+	if (fd < 0) {
+		rc = -errno;
+		goto out;
+	}
+	if (lockf(fd, F_LOCK, 0)) {
+		rc = -errno;
+		goto out_close;
+	}
+	len = pread(fd, buf, sizeof(buf) - 1, 0);
+	seq = len > 0 ? strtoul(buf, NULL, 10) + 1 : 1;
+	len = snprintf(buf, sizeof(buf), "%u\n", seq);
+	if (pwrite(fd, buf, len, 0) != len)
+		rc = -EIO;
+
+	obj_id->hi = shard;
+	obj_id->lo = seq;
+
+out_close:
+	close(fd);
+out:
+	pthread_mutex_unlock(&id_mutex);
+
+	return rc;
+}
+
+static int obj_load(const char *path, struct dsmmock_obj_t *obj)
+{
+	int rc = 0;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return -errno;
+	if (read(fd, obj, sizeof(*obj)) != sizeof(*obj) ||
+	    obj->magic != DSMMOCK_MAGIC)
+		rc = -EINVAL;
+	close(fd);
+
+	return rc;
+}
+
+/* Write <id>.meta atomically. */
+static int obj_store(const struct dsmmock_session_t *session,
+		     const struct dsmmock_obj_t *obj)
+{
+	int rc = 0;
+	int fd;
+	char path[PATH_MAX + 1];
+	char path_tmp[PATH_MAX + 1];
+
+	obj_path(session, &obj->obj_id, "meta", path);
+	obj_path(session, &obj->obj_id, "meta.tmp", path_tmp);
+
+	fd = open(path_tmp, O_WRONLY | O_CREAT | O_TRUNC,
+		  S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+	if (fd < 0)
+		return -errno;
+	if (write(fd, obj, sizeof(*obj)) != sizeof(*obj))
+		rc = -EIO;
+	close(fd);
+
+	if (!rc && rename(path_tmp, path))
+		rc = -errno;
+	if (rc)
+		unlink(path_tmp);
+
+	return rc;
+}
+
+static bool has_wildcard(const char *str)
+{
+	return strpbrk(str, "*?") != NULL;
+}
+
+static bool obj_match(const struct dsmmock_obj_t *obj,
+		      const qryArchiveData *qry)
+{
+	const dsmObjName *name = qry->objName;
+
+	if (name->objType != DSM_OBJ_ANY_TYPE &&
+	    name->objType != DSM_OBJ_WILDCARD &&
+	    name->objType != obj->obj_name.objType)
+		return false;
+
+	if (fnmatch(name->fs, obj->obj_name.fs, 0) ||
+	    fnmatch(name->hl, obj->obj_name.hl, 0) ||
+	    fnmatch(name->ll, obj->obj_name.ll, 0))
+		return false;
+
+	if (qry->owner && qry->owner[0] && strcmp(qry->owner, "*") &&
+	    strcmp(qry->owner, obj->owner))
+		return false;
+
+	if (qry->descr && qry->descr[0] && fnmatch(qry->descr, obj->descr, 0))
+		return false;
+
+	return date_cmp(&obj->ins_date, &qry->insDateLowerBound) >= 0 &&
+		date_cmp(&obj->ins_date, &qry->insDateUpperBound) <= 0;
+}
+
+static int obj_cmp(const void *a, const void *b)
+{
+	const struct dsmmock_obj_t *x = a;
+	const struct dsmmock_obj_t *y = b;
+
+	return x->obj_id.lo < y->obj_id.lo ? -1 : x->obj_id.lo > y->obj_id.lo;
+}
+
+static int query_shard(struct dsmmock_session_t *session, const uint32_t shard,
+		       const qryArchiveData *qry)
+{
+	DIR *dir;
+	struct dirent *entry;
+	char path[PATH_MAX + 1];
+	struct dsmmock_obj_t obj;
+
+	snprintf(path, sizeof(path), "%s/%02x", session->root, shard);
+	dir = opendir(path);
+	if (!dir)
+		return errno == ENOENT ? 0 : -errno;
+
+	while ((entry = readdir(dir))) {
+		const size_t len = strlen(entry->d_name);
+
+		if (len < 5 || strcmp(entry->d_name + len - 5, ".meta"))
+			continue;
+
+		snprintf(path, sizeof(path), "%s/%02x/%s", session->root,
+			 shard, entry->d_name);
+		if (obj_load(path, &obj) || !obj_match(&obj, qry))
+			continue;
+
+		if (session->q_num % 64 == 0) {
+			struct dsmmock_obj_t *objs;
+
+			objs = realloc(session->q_objs,
+				       (session->q_num + 64) * sizeof(obj));
+			if (!objs) {
+				closedir(dir);
+				return -ENOMEM;
+			}
+			session->q_objs = objs;
+		}
+		session->q_objs[session->q_num++] = obj;
+	}
+	closedir(dir);
+
+	return 0;
+}
+
+static void query_reset(struct dsmmock_session_t *session)
+{
+	free(session->q_objs);
+	session->q_objs = NULL;
+	session->q_num = 0;
+	session->q_idx = 0;
+}
+
+/* Claim a mount point for session, wait for a free one if wait is set. */
+static bool mount_claim(struct dsmmock_session_t *session, const bool wait)
+{
+	if (session->mounted)
+		return true;
+
+	pthread_mutex_lock(&mounts_mutex);
+	while (conf.max_mounts && mounts >= conf.max_mounts) {
+		if (!wait) {
+			pthread_mutex_unlock(&mounts_mutex);
+			return false;
+		}
+		pthread_cond_wait(&mounts_cond, &mounts_mutex);
+	}
+	mounts++;
+	pthread_mutex_unlock(&mounts_mutex);
+
+	session->mounted = true;
+	if (conf.mount_usec)
+		sleep_ns(conf.mount_usec * 1000);
+
+	return true;
+}
+
+static void mount_release(struct dsmmock_session_t *session)
+{
+	if (!session->mounted)
+		return;
+
+	pthread_mutex_lock(&mounts_mutex);
+	mounts--;
+	pthread_cond_signal(&mounts_cond);
+	pthread_mutex_unlock(&mounts_mutex);
+	session->mounted = false;
+}
+
+static void txn_reset(struct dsmmock_session_t *session)
+{
+	char path[PATH_MAX + 1];
+
+	if (session->send_fd >= 0) {
+		close(session->send_fd);
+		session->send_fd = -1;
+	}
+	/* Remove data of objects not committed. */
+	for (size_t n = 0; n < session->num_sent; n++) {
+		obj_path(session, &session->sent[n].obj_id, "data.tmp", path);
+		unlink(path);
+	}
+	free(session->sent);
+	free(session->deleted);
+	session->sent = NULL;
+	session->num_sent = 0;
+	session->deleted = NULL;
+	session->num_deleted = 0;
+	session->txn_reason = 0;
+	session->in_txn = false;
+}
+
+static int txn_commit(struct dsmmock_session_t *session)
+{
+	int rc;
+	char path[PATH_MAX + 1];
+	char path_tmp[PATH_MAX + 1];
+
+	for (size_t n = 0; n < session->num_sent; n++) {
+		const struct dsmmock_obj_t *obj = &session->sent[n];
+
+		obj_path(session, &obj->obj_id, "data.tmp", path_tmp);
+		obj_path(session, &obj->obj_id, "data", path);
+		if (rename(path_tmp, path))
+			return -errno;
+		rc = obj_store(session, obj);
+		if (rc)
+			return rc;
+	}
+	session->num_sent = 0;
+
+	for (size_t n = 0; n < session->num_deleted; n++) {
+		obj_path(session, &session->deleted[n], "meta", path);
+		unlink(path);
+		obj_path(session, &session->deleted[n], "data", path);
+		unlink(path);
+	}
+
+	return 0;
+}
+
+static void get_reset(struct dsmmock_session_t *session)
+{
+	if (session->get_fd >= 0) {
+		close(session->get_fd);
+		session->get_fd = -1;
+	}
+	free(session->get_ids);
+	session->get_ids = NULL;
+	session->get_num = 0;
+}
+
+dsInt16_t dsmSetUp(dsBool_t mtFlag, envSetUp *envSetUpP)
+{
+	const char *dir = getenv("DSMMOCK_DIR");
+
+	(void)mtFlag;
+	(void)envSetUpP;
+
+	strncpy(conf.dir, dir && dir[0] ? dir : DSMMOCK_DIR_DEFAULT,
+		DSMMOCK_DIR_LEN);
+	conf.latency_usec = env_u64("DSMMOCK_LATENCY_USEC", 0);
+	conf.bandwidth = env_u64("DSMMOCK_BANDWIDTH", 0);
+	conf.max_mounts = env_u64("DSMMOCK_MAX_MOUNTS", 0);
+	conf.mount_usec = env_u64("DSMMOCK_MOUNT_USEC", 0);
+	conf.conn_loss = env_u64("DSMMOCK_CONN_LOSS", 0);
+	__atomic_store_n(&sends, 0, __ATOMIC_RELAXED);
+
+	return mkdir_ok(conf.dir) ? DSM_RC_UNSUCCESSFUL : DSM_RC_OK;
+}
+
+dsInt16_t dsmCleanUp(dsBool_t mtFlag)
+{
+	(void)mtFlag;
+
+	return DSM_RC_OK;
+}
+
+void dsmQueryApiVersionEx(dsmApiVersionEx *apiVersionP)
+{
+	apiVersionP->stVersion = apiVersionExVer;
+	apiVersionP->version = DSM_API_VERSION;
+	apiVersionP->release = DSM_API_RELEASE;
+	apiVersionP->level = DSM_API_LEVEL;
+	apiVersionP->subLevel = DSM_API_SUBLEVEL;
+	apiVersionP->unicode = bFalse;
+}
+
+dsInt16_t dsmInitEx(dsUint32_t *dsmHandleP, dsmInitExIn_t *dsmInitExInP,
+		    dsmInitExOut_t *dsmInitExOutP)
+{
+	struct dsmmock_session_t *session;
+	const char *node = dsmInitExInP->clientNodeNameP;
+
+	*dsmHandleP = 0;
+	if (!conf.dir[0])
+		return DSM_RC_INVALID_CALL;	/* dsmSetUp not called. */
+
+	session = calloc(1, sizeof(struct dsmmock_session_t));
+	if (!session)
+		return DSM_RC_NO_MEMORY;
+	session->send_fd = -1;
+	session->get_fd = -1;
+
+	strncpy(session->node, node && node[0] ? node : "default",
+		DSM_MAX_NODE_LENGTH);
+	/* Node name must not introduce subdirectories. */
+	for (char *c = session->node; *c; c++) {
+		if (*c == '/')
+			*c = '_';
+	}
+	if (dsmInitExInP->clientOwnerNameP)
+		strncpy(session->owner, dsmInitExInP->clientOwnerNameP,
+			DSM_MAX_OWNER_LENGTH);
+	snprintf(session->root, sizeof(session->root), "%s/%s", conf.dir,
+		 session->node);
+	if (mkdir_ok(session->root)) {
+		free(session);
+		return DSM_RC_UNSUCCESSFUL;
+	}
+
+	pthread_mutex_lock(&sessions_mutex);
+	for (uint32_t n = 0; n < DSMMOCK_MAX_SESSIONS; n++) {
+		if (!sessions[n]) {
+			sessions[n] = session;
+			*dsmHandleP = n + 1;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&sessions_mutex);
+
+	if (*dsmHandleP == 0) {
+		free(session);
+		return DSM_RC_UNSUCCESSFUL;
+	}
+
+	if (dsmInitExOutP) {
+		dsmInitExOutP->infoRC = DSM_RC_OK;
+		strncpy(dsmInitExOutP->adsmServerName, DSMMOCK_SERVER_NAME,
+			DSM_MAX_SERVERNAME_LENGTH);
+		dsmInitExOutP->serverVer = DSM_API_VERSION;
+		dsmInitExOutP->serverRel = DSM_API_RELEASE;
+		dsmInitExOutP->serverLev = DSM_API_LEVEL;
+		dsmInitExOutP->serverSubLev = DSM_API_SUBLEVEL;
+	}
+	round_trip();
+
+	return DSM_RC_OK;
+}
+
+dsInt16_t dsmTerminate(dsUint32_t dsmHandle)
+{
+	struct dsmmock_session_t *session;
+
+	/* Sessions which lost their connection are terminated as well. */
+	session = session_get(dsmHandle);
+	if (!session)
+		return DSM_RC_INVALID_DSMHANDLE;
+
+	txn_reset(session);
+	query_reset(session);
+	get_reset(session);
+	mount_release(session);
+
+	pthread_mutex_lock(&sessions_mutex);
+	sessions[dsmHandle - 1] = NULL;
+	pthread_mutex_unlock(&sessions_mutex);
+	free(session);
+
+	return DSM_RC_OK;
+}
+
+dsInt16_t dsmRCMsg(dsUint32_t dsmHandle, dsInt16_t dsmRC, char *msg)
+{
+	const char *str;
+
+	(void)dsmHandle;
+
+	switch (dsmRC) {
+	case DSM_RC_OK:
+		str = "successful";
+		break;
+	case DSM_RC_UNSUCCESSFUL:
+		str = "unsuccessful";
+		break;
+	case DSM_RC_ABORT_NO_MATCH:
+		str = "no objects match the query";
+		break;
+	case DSM_RS_ABORT_BY_CLIENT:
+		str = "transaction aborted by client";
+		break;
+	case DSM_RS_ABORT_EXCEED_MAX_MP:
+		str = "number of mount points exceeded";
+		break;
+	case DSM_RC_TCPIP_FAILURE:
+		str = "TCP/IP communications failure";
+		break;
+	case DSM_RC_NO_MEMORY:
+		str = "out of memory";
+		break;
+	case DSM_RC_INVALID_PARM:
+		str = "invalid parameter";
+		break;
+	case DSM_RC_FINISHED:
+		str = "finished";
+		break;
+	case DSM_RC_INVALID_DSMHANDLE:
+		str = "invalid handle";
+		break;
+	case DSM_RC_INVALID_CALL:
+		str = "invalid call sequence";
+		break;
+	case DSM_RC_MORE_DATA:
+		str = "more data";
+		break;
+	case DSM_RC_CHECK_REASON_CODE:
+		str = "transaction aborted, check reason code";
+		break;
+	default:
+		str = "unknown error";
+		break;
+	}
+	snprintf(msg, DSM_MAX_RC_MSG_LENGTH, "ANS%04d%c (RC%d) dsmmock: %s\n",
+		 dsmRC < 0 ? -dsmRC : dsmRC,
+		 dsmRC == DSM_RC_OK || dsmRC == DSM_RC_MORE_DATA ||
+		 dsmRC == DSM_RC_FINISHED ? 'I' : 'E', dsmRC, str);
+
+	return DSM_RC_OK;
+}
+
+dsInt16_t dsmRegisterFS(dsUint32_t dsmHandle, regFSData *regFilespaceP)
+{
+	struct dsmmock_session_t *session;
+
+	SESSION_GET(session, dsmHandle);
+
+	return regFilespaceP && regFilespaceP->fsName ?
+		DSM_RC_OK : DSM_RC_INVALID_PARM;
+}
+
+dsInt16_t dsmQuerySessOptions(dsUint32_t dsmHandle, optStruct *optstructP)
+{
+	struct dsmmock_session_t *session;
+
+	SESSION_GET(session, dsmHandle);
+
+	memset(optstructP, 0, sizeof(optStruct));
+	memcpy(optstructP->dsmiDir, conf.dir, sizeof(conf.dir));
+	strncpy(optstructP->serverName, DSMMOCK_SERVER_NAME,
+		DSM_MAX_SERVERNAME_LENGTH);
+	strncpy(optstructP->serverAddress, "localhost",
+		DSM_MAX_FSNAME_LENGTH);
+	memcpy(optstructP->nodeName, session->node, sizeof(session->node));
+	optstructP->commMethod = 1;
+
+	return DSM_RC_OK;
+}
+
+dsInt16_t dsmQuerySessInfo(dsUint32_t dsmHandle, ApiSessInfo *SessInfoP)
+{
+	struct dsmmock_session_t *session;
+
+	SESSION_GET(session, dsmHandle);
+
+	memset(SessInfoP, 0, sizeof(ApiSessInfo));
+	SessInfoP->stVersion = ApiSessInfoVersion;
+	strncpy(SessInfoP->serverHost, "localhost", DSM_MAX_FSNAME_LENGTH);
+	date_now(&SessInfoP->serverDate);
+	strncpy(SessInfoP->serverType, "dsmmock",
+		DSM_MAX_PLATFORM_LENGTH * 2);
+	SessInfoP->serverVer = DSM_API_VERSION;
+	SessInfoP->serverRel = DSM_API_RELEASE;
+	SessInfoP->serverLev = DSM_API_LEVEL;
+	SessInfoP->serverSubLev = DSM_API_SUBLEVEL;
+	strncpy(SessInfoP->nodeType, "Linux", DSM_MAX_PLATFORM_LENGTH);
+	SessInfoP->fsdelim = '/';
+	SessInfoP->hldelim = '/';
+	SessInfoP->compression = COMPRESS_NO;
+	SessInfoP->archDel = ARCHDEL_YES;
+	SessInfoP->maxObjPerTxn = DSM_MAX_GET_OBJ;
+	memcpy(SessInfoP->id, session->node, sizeof(session->node));
+	memcpy(SessInfoP->owner, session->owner, sizeof(session->owner));
+	strncpy(SessInfoP->domainName, DSMMOCK_MC_NAME,
+		DSM_MAX_MC_NAME_LENGTH);
+	strncpy(SessInfoP->policySetName, DSMMOCK_MC_NAME,
+		DSM_MAX_MC_NAME_LENGTH);
+	strncpy(SessInfoP->dfltMCName, DSMMOCK_MC_NAME,
+		DSM_MAX_MC_NAME_LENGTH);
+	strncpy(SessInfoP->adsmServerName, DSMMOCK_SERVER_NAME,
+		DSM_MAX_SERVERNAME_LENGTH);
+
+	return DSM_RC_OK;
+}
+
+dsInt16_t dsmBeginQuery(dsUint32_t dsmHandle, dsmQueryType queryType,
+			dsmQueryBuff *queryBuffer)
+{
+	int rc = 0;
+	struct dsmmock_session_t *session;
+	const qryArchiveData *qry = queryBuffer;
+
+	SESSION_GET(session, dsmHandle);
+
+	query_reset(session);
+	session->q_type = queryType;
+	round_trip();
+
+	switch (queryType) {
+	case qtMC:
+		return DSM_RC_OK;
+	case qtArchive:
+		break;
+	default:
+		return DSM_RC_INVALID_PARM;
+	}
+
+	if (!qry || !qry->objName)
+		return DSM_RC_INVALID_PARM;
+
+	if (has_wildcard(qry->objName->fs) || has_wildcard(qry->objName->hl) ||
+	    has_wildcard(qry->objName->ll)) {
+		for (uint32_t shard = 0; shard < DSMMOCK_SHARDS && !rc; shard++)
+			rc = query_shard(session, shard, qry);
+	} else
+		rc = query_shard(session, shard_of(qry->objName), qry);
+
+	if (rc) {
+		query_reset(session);
+		return rc == -ENOMEM ? DSM_RC_NO_MEMORY : DSM_RC_UNSUCCESSFUL;
+	}
+	qsort(session->q_objs, session->q_num, sizeof(struct dsmmock_obj_t),
+	      obj_cmp);
+
+	return DSM_RC_OK;
+}
+
+dsInt16_t dsmGetNextQObj(dsUint32_t dsmHandle, DataBlk *dataBlkPtr)
+{
+	struct dsmmock_session_t *session;
+	const struct dsmmock_obj_t *obj;
+	qryRespArchiveData *resp;
+
+	SESSION_GET(session, dsmHandle);
+
+	dataBlkPtr->numBytes = 0;
+
+	if (session->q_type == qtMC) {
+		qryRespMCData *resp_mc = (qryRespMCData *)dataBlkPtr->bufferPtr;
+
+		if (session->q_idx++ > 0)
+			return DSM_RC_FINISHED;
+		if (dataBlkPtr->bufferLen < sizeof(qryRespMCData))
+			return DSM_RC_INVALID_PARM;
+		memset(resp_mc, 0, sizeof(qryRespMCData));
+		resp_mc->stVersion = qryRespMCDataVersion;
+		strncpy(resp_mc->mcName, DSMMOCK_MC_NAME,
+			DSM_MAX_MC_NAME_LENGTH);
+		dataBlkPtr->numBytes = sizeof(qryRespMCData);
+
+		return DSM_RC_MORE_DATA;
+	}
+
+	if (session->q_num == 0)
+		return DSM_RC_ABORT_NO_MATCH;
+	if (session->q_idx >= session->q_num)
+		return DSM_RC_FINISHED;
+	if (dataBlkPtr->bufferLen < sizeof(qryRespArchiveData))
+		return DSM_RC_INVALID_PARM;
+
+	obj = &session->q_objs[session->q_idx++];
+	resp = (qryRespArchiveData *)dataBlkPtr->bufferPtr;
+	memset(resp, 0, sizeof(qryRespArchiveData));
+	resp->stVersion = qryRespArchiveDataVersion;
+	resp->objName = obj->obj_name;
+	resp->copyGroup = 1;
+	strncpy(resp->mcName, DSMMOCK_MC_NAME, DSM_MAX_MC_NAME_LENGTH);
+	memcpy(resp->owner, obj->owner, sizeof(obj->owner));
+	resp->objId = obj->obj_id;
+	resp->insDate = obj->ins_date;
+	resp->expDate.year = DATE_PLUS_INFINITE;
+	memcpy(resp->descr, obj->descr, sizeof(obj->descr));
+	resp->objInfolen = obj->obj_info_len;
+	memcpy(resp->objInfo, obj->obj_info, obj->obj_info_len);
+	/* Objects are restored in order of their creation. */
+	resp->restoreOrderExt.lo_hi = obj->obj_id.hi;
+	resp->restoreOrderExt.lo_lo = obj->obj_id.lo;
+	resp->sizeEstimate = obj->size_estimate;
+	dataBlkPtr->numBytes = sizeof(qryRespArchiveData);
+
+	return DSM_RC_MORE_DATA;
+}
+
+dsInt16_t dsmEndQuery(dsUint32_t dsmHandle)
+{
+	struct dsmmock_session_t *session;
+
+	SESSION_GET(session, dsmHandle);
+
+	query_reset(session);
+
+	return DSM_RC_OK;
+}
+
+dsInt16_t dsmBeginTxn(dsUint32_t dsmHandle)
+{
+	struct dsmmock_session_t *session;
+
+	SESSION_GET(session, dsmHandle);
+
+	if (session->in_txn)
+		return DSM_RC_INVALID_CALL;
+	session->in_txn = true;
+
+	return DSM_RC_OK;
+}
+
+dsInt16_t dsmEndTxn(dsUint32_t dsmHandle, dsUint8_t vote,
+		    dsUint16_t *reason)
+{
+	dsInt16_t rc = DSM_RC_OK;
+	struct dsmmock_session_t *session;
+
+	*reason = 0;
+	SESSION_GET(session, dsmHandle);
+
+	if (!session->in_txn)
+		return DSM_RC_INVALID_CALL;
+	round_trip();
+
+	if (session->txn_reason)
+		*reason = session->txn_reason;
+	else if (vote != DSM_VOTE_COMMIT)
+		*reason = DSM_RS_ABORT_BY_CLIENT;
+	else if (txn_commit(session))
+		rc = DSM_RC_UNSUCCESSFUL;
+
+	if (*reason)
+		rc = DSM_RC_CHECK_REASON_CODE;
+	txn_reset(session);
+
+	return rc;
+}
+
+dsInt16_t dsmBindMC(dsUint32_t dsmHandle, dsmObjName *objNameP,
+		    dsmSendType sendType, mcBindKey *mcBindKeyP)
+{
+	struct dsmmock_session_t *session;
+
+	SESSION_GET(session, dsmHandle);
+	(void)objNameP;
+	(void)sendType;
+
+	strncpy(mcBindKeyP->mcName, DSMMOCK_MC_NAME, DSM_MAX_MC_NAME_LENGTH);
+	mcBindKeyP->backup_cg_exists = bFalse;
+	mcBindKeyP->archive_cg_exists = bTrue;
+	strncpy(mcBindKeyP->archive_copy_dest, "ARCHIVEPOOL",
+		DSM_MAX_MC_NAME_LENGTH);
+
+	return DSM_RC_OK;
+}
+
+dsInt16_t dsmSendObj(dsUint32_t dsmHandle, dsmSendType sendType,
+		     void *sendBuff, dsmObjName *objNameP,
+		     ObjAttr *objAttrPtr, DataBlk *dataBlkPtr)
+{
+	int rc;
+	struct dsmmock_session_t *session;
+	struct dsmmock_obj_t *obj;
+	const sndArchiveData *arch_data = sendBuff;
+	const uint32_t shard = shard_of(objNameP);
+	char path[PATH_MAX + 1];
+
+	SESSION_GET(session, dsmHandle);
+
+	if (!session->in_txn || session->send_fd >= 0)
+		return DSM_RC_INVALID_CALL;
+	if (sendType != stArchive && sendType != stArchiveMountWait)
+		return DSM_RC_INVALID_PARM;
+	if (objAttrPtr->objInfoLength > DSM_MAX_OBJINFO_LENGTH)
+		return DSM_RC_INVALID_PARM;
+
+	/* Transaction is aborted in dsmEndTxn, data is discarded. */
+	if (session->txn_reason)
+		return DSM_RC_OK;
+	if (!mount_claim(session, sendType == stArchiveMountWait)) {
+		session->txn_reason = DSM_RS_ABORT_EXCEED_MAX_MP;
+		return DSM_RC_OK;
+	}
+
+	obj = realloc(session->sent,
+		      (session->num_sent + 1) * sizeof(struct dsmmock_obj_t));
+	if (!obj)
+		return DSM_RC_NO_MEMORY;
+	session->sent = obj;
+	obj = &session->sent[session->num_sent];
+	memset(obj, 0, sizeof(struct dsmmock_obj_t));
+
+	obj->magic = DSMMOCK_MAGIC;
+	obj->obj_name = *objNameP;
+	memcpy(obj->owner, objAttrPtr->owner[0] ? objAttrPtr->owner :
+	       session->owner, sizeof(obj->owner));
+	if (arch_data && arch_data->descr)
+		strncpy(obj->descr, arch_data->descr, DSM_MAX_DESCR_LENGTH);
+	date_now(&obj->ins_date);
+	obj->size_estimate = objAttrPtr->sizeEstimate;
+	obj->obj_info_len = objAttrPtr->objInfoLength;
+	memcpy(obj->obj_info, objAttrPtr->objInfo, obj->obj_info_len);
+
+	snprintf(path, sizeof(path), "%s/%02x", session->root, shard);
+	rc = mkdir_ok(path);
+	if (!rc)
+		rc = obj_id_alloc(session, shard, &obj->obj_id);
+	if (rc)
+		return DSM_RC_UNSUCCESSFUL;
+
+	obj_path(session, &obj->obj_id, "data.tmp", path);
+	session->send_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC,
+				S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+	if (session->send_fd < 0)
+		return DSM_RC_UNSUCCESSFUL;
+	session->num_sent++;
+
+	if (dataBlkPtr && dataBlkPtr->bufferLen)
+		return dsmSendData(dsmHandle, dataBlkPtr);
+
+	return DSM_RC_OK;
+}
+
+dsInt16_t dsmSendData(dsUint32_t dsmHandle, DataBlk *dataBlkPtr)
+{
+	struct dsmmock_session_t *session;
+	uint32_t done = 0;
+
+	SESSION_GET(session, dsmHandle);
+
+	dataBlkPtr->numBytes = 0;
+	if (conf.conn_loss &&
+	    __atomic_add_fetch(&sends, 1, __ATOMIC_RELAXED) == conf.conn_loss) {
+		session->lost = true;
+		return DSM_RC_TCPIP_FAILURE;
+	}
+	if (session->txn_reason) {
+		dataBlkPtr->numBytes = dataBlkPtr->bufferLen;
+		return DSM_RC_OK;
+	}
+	if (session->send_fd < 0)
+		return DSM_RC_INVALID_CALL;
+
+	while (done < dataBlkPtr->bufferLen) {
+		const ssize_t len = write(session->send_fd,
+					  dataBlkPtr->bufferPtr + done,
+					  dataBlkPtr->bufferLen - done);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			return DSM_RC_UNSUCCESSFUL;
+		}
+		done += len;
+	}
+	dataBlkPtr->numBytes = done;
+	throttle(session, done);
+
+	return DSM_RC_OK;
+}
+
+dsInt16_t dsmEndSendObj(dsUint32_t dsmHandle)
+{
+	struct dsmmock_session_t *session;
+
+	SESSION_GET(session, dsmHandle);
+
+	if (session->txn_reason)
+		return DSM_RC_OK;
+	if (session->send_fd < 0)
+		return DSM_RC_INVALID_CALL;
+
+	close(session->send_fd);
+	session->send_fd = -1;
+
+	return DSM_RC_OK;
+}
+
+/* Update the most recent object of name objNameP. */
+dsInt16_t dsmUpdateObj(dsUint32_t dsmHandle, dsmSendType sendType,
+		       void *sendBuff, dsmObjName *objNameP,
+		       ObjAttr *objAttrPtr, dsUint32_t objUpdAct)
+{
+	int rc;
+	struct dsmmock_session_t *session;
+	const sndArchiveData *arch_data = sendBuff;
+	qryArchiveData qry;
+	struct dsmmock_obj_t *obj;
+
+	SESSION_GET(session, dsmHandle);
+
+	if (sendType != stArchive && sendType != stArchiveMountWait)
+		return DSM_RC_INVALID_PARM;
+	if ((objUpdAct & DSM_ARCHUPD_OBJINFO) &&
+	    objAttrPtr->objInfoLength > DSM_MAX_OBJINFO_LENGTH)
+		return DSM_RC_INVALID_PARM;
+	round_trip();
+
+	memset(&qry, 0, sizeof(qry));
+	qry.objName = objNameP;
+	qry.insDateLowerBound.year = DATE_MINUS_INFINITE;
+	qry.insDateUpperBound.year = DATE_PLUS_INFINITE;
+
+	query_reset(session);
+	rc = query_shard(session, shard_of(objNameP), &qry);
+	if (rc || session->q_num == 0) {
+		query_reset(session);
+		return rc ? DSM_RC_UNSUCCESSFUL : DSM_RC_ABORT_NO_MATCH;
+	}
+
+	obj = &session->q_objs[0];
+	for (size_t n = 1; n < session->q_num; n++) {
+		if (session->q_objs[n].obj_id.lo > obj->obj_id.lo)
+			obj = &session->q_objs[n];
+	}
+	if (objUpdAct & DSM_ARCHUPD_OBJINFO) {
+		obj->obj_info_len = objAttrPtr->objInfoLength;
+		memcpy(obj->obj_info, objAttrPtr->objInfo, obj->obj_info_len);
+	}
+	if ((objUpdAct & DSM_ARCHUPD_DESCRIPTION) && arch_data &&
+	    arch_data->descr)
+		strncpy(obj->descr, arch_data->descr, DSM_MAX_DESCR_LENGTH);
+
+	rc = obj_store(session, obj);
+	query_reset(session);
+
+	return rc ? DSM_RC_UNSUCCESSFUL : DSM_RC_OK;
+}
+
+dsInt16_t dsmDeleteObj(dsUint32_t dsmHandle, dsmDelType delType,
+		       dsmDelInfo delInfo)
+{
+	struct dsmmock_session_t *session;
+	ObjID *ids;
+
+	SESSION_GET(session, dsmHandle);
+
+	if (!session->in_txn)
+		return DSM_RC_INVALID_CALL;
+	if (delType != dtArchive)
+		return DSM_RC_INVALID_PARM;
+
+	ids = realloc(session->deleted,
+		      (session->num_deleted + 1) * sizeof(ObjID));
+	if (!ids)
+		return DSM_RC_NO_MEMORY;
+	session->deleted = ids;
+	session->deleted[session->num_deleted++] = delInfo.archInfo.objId;
+
+	return DSM_RC_OK;
+}
+
+dsInt16_t dsmBeginGetData(dsUint32_t dsmHandle, dsBool_t mountWait,
+			  dsmGetType getType, dsmGetList *dsmGetObjListP)
+{
+	struct dsmmock_session_t *session;
+	bool mounted;
+
+	SESSION_GET(session, dsmHandle);
+
+	if (getType != gtArchive || dsmGetObjListP->numObjId == 0 ||
+	    dsmGetObjListP->numObjId > DSM_MAX_GET_OBJ)
+		return DSM_RC_INVALID_PARM;
+
+	get_reset(session);
+	round_trip();
+
+	mounted = session->mounted;
+	if (!mount_claim(session, mountWait))
+		return DSM_RC_CHECK_REASON_CODE;
+	/* Mount and position tape of the objects, claiming the mount
+	   point already included the delay. */
+	if (mounted && conf.mount_usec)
+		sleep_ns(conf.mount_usec * 1000);
+
+	session->get_ids = malloc(dsmGetObjListP->numObjId * sizeof(ObjID));
+	if (!session->get_ids)
+		return DSM_RC_NO_MEMORY;
+	memcpy(session->get_ids, dsmGetObjListP->objId,
+	       dsmGetObjListP->numObjId * sizeof(ObjID));
+	session->get_num = dsmGetObjListP->numObjId;
+
+	return DSM_RC_OK;
+}
+
+dsInt16_t dsmGetData(dsUint32_t dsmHandle, DataBlk *dataBlkPtr)
+{
+	struct dsmmock_session_t *session;
+	ssize_t len;
+
+	SESSION_GET(session, dsmHandle);
+
+	dataBlkPtr->numBytes = 0;
+	if (session->get_fd < 0)
+		return DSM_RC_INVALID_CALL;
+
+	while (dataBlkPtr->numBytes < dataBlkPtr->bufferLen &&
+	       session->get_left > 0) {
+		len = read(session->get_fd,
+			   dataBlkPtr->bufferPtr + dataBlkPtr->numBytes,
+			   dataBlkPtr->bufferLen - dataBlkPtr->numBytes);
+		if (len < 0 && errno == EINTR)
+			continue;
+		if (len <= 0)
+			return DSM_RC_UNSUCCESSFUL;
+		dataBlkPtr->numBytes += len;
+		session->get_left -= len;
+	}
+	throttle(session, dataBlkPtr->numBytes);
+
+	return session->get_left > 0 ? DSM_RC_MORE_DATA : DSM_RC_FINISHED;
+}
+
+dsInt16_t dsmGetObj(dsUint32_t dsmHandle, ObjID *objIdP,
+		    DataBlk *dataBlkPtr)
+{
+	struct dsmmock_session_t *session;
+	struct stat st;
+	char path[PATH_MAX + 1];
+	bool listed = false;
+
+	SESSION_GET(session, dsmHandle);
+
+	dataBlkPtr->numBytes = 0;
+	if (session->get_fd >= 0)
+		return DSM_RC_INVALID_CALL;
+
+	for (size_t n = 0; n < session->get_num && !listed; n++)
+		listed = session->get_ids[n].hi == objIdP->hi &&
+			session->get_ids[n].lo == objIdP->lo;
+	if (!listed)
+		return DSM_RC_INVALID_PARM;
+
+	obj_path(session, objIdP, "data", path);
+	session->get_fd = open(path, O_RDONLY);
+	if (session->get_fd < 0)
+		return DSM_RC_UNSUCCESSFUL;
+	if (fstat(session->get_fd, &st)) {
+		close(session->get_fd);
+		session->get_fd = -1;
+		return DSM_RC_UNSUCCESSFUL;
+	}
+	session->get_left = st.st_size;
+
+	return dsmGetData(dsmHandle, dataBlkPtr);
+}
+
+dsInt16_t dsmEndGetObj(dsUint32_t dsmHandle)
+{
+	struct dsmmock_session_t *session;
+
+	SESSION_GET(session, dsmHandle);
+
+	if (session->get_fd >= 0) {
+		close(session->get_fd);
+		session->get_fd = -1;
+	}
+
+	return DSM_RC_OK;
+}
+
+dsInt16_t dsmEndGetData(dsUint32_t dsmHandle)
+{
+	struct dsmmock_session_t *session;
+
+	SESSION_GET(session, dsmHandle);
+
+	get_reset(session);
+
+	return DSM_RC_OK;
+}
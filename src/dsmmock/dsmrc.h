@@ -0,0 +1,51 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Copyright (c) 2026, GSI Helmholtz Centre for Heavy Ion Research
+ */
+
+/* Return and reason codes of the TSM API returned by libdsmmock. */
+
+#ifndef DSMRC_H
+#define DSMRC_H
+
+#define DSM_RC_OK			0
+#define DSM_RC_SUCCESSFUL		0
+#define DSM_RC_UNSUCCESSFUL		-1
+
+#define DSM_RC_ABORT_NO_MATCH		2
+
+/* Reason codes of dsmEndTxn. */
+#define DSM_RS_ABORT_BY_CLIENT		3
+#define DSM_RS_ABORT_EXCEED_MAX_MP	51
+
+#define DSM_RC_TCPIP_FAILURE		-50
+#define DSM_RC_CONN_TIMEDOUT		-51
+#define DSM_RC_CONN_REFUSED		-52
+#define DSM_RC_BAD_HOST_NAME		-53
+#define DSM_RC_NETWORK_UNREACHABLE	-54
+
+#define DSM_RC_NO_MEMORY		102
+#define DSM_RC_INVALID_PARM		109
+#define DSM_RC_FINISHED			121
+#define DSM_RC_UNKNOWN_FORMAT		122
+#define DSM_RC_COMM_PROTOCOL_ERROR	136
+#define DSM_RC_INVALID_DSMHANDLE	2014
+#define DSM_RC_INVALID_CALL		2041
+#define DSM_RC_FS_ALREADY_REGED		2062
+#define DSM_RC_MORE_DATA		2200
+#define DSM_RC_CHECK_REASON_CODE	2302
+
+#endif /* DSMRC_H */
@@ -32,15 +32,27 @@
 #include <semaphore.h>
 #include <time.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <linux/limits.h>
 #include <sys/syscall.h>
 #include <sys/time.h>
 #include <sys/param.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
 #include <uuid/uuid.h>
 #include <sys/xattr.h>
 #include <lustre/lustreapi.h>
 #include "ltsmapi.h"
 #include "queue.h"
+#include "slab.h"
+#include "lru.h"
+#include "bufpool.h"
+#include "compress.h"
+#include "spool.h"
+#include "alog.h"
+#include "metrics.h"
+#include "trace.h"
 
 #define XATTR_LTSM_UUID "user.ltsm.uuid"
 
@@ -59,8 +71,10 @@ struct options {
 	int o_nthreads;
 	int o_verbose;
 	int o_restore_stripe;
+	int o_archive_direct;
 	int o_abort_on_err;
 	int o_enable_maxmpc;
+	int o_async_log;
         int o_archive_cnt;
         int o_archive_id[LL_HSM_ORIGIN_MAX_ARCHIVE + 1];
 	char *o_mnt;
@@ -72,6 +86,10 @@ struct options {
 	char o_fsname[DSM_MAX_FSNAME_LENGTH + 1];
 	char o_fstype[DSM_MAX_FSTYPE_LENGTH + 1];
 	char o_conf[MAX_OPTIONS_LENGTH + 1];
+	char o_log_file[PATH_MAX + 1];
+	char o_metrics_file[PATH_MAX + 1];
+	char o_metrics_socket[PATH_MAX + 1];
+	char o_trace_file[PATH_MAX + 1];
 };
 
 static struct options opt = {
@@ -82,7 +100,11 @@ static struct options opt = {
 	.o_password = {0},
 	.o_fsname = {0},
 	.o_fstype = {0},
-	.o_conf = {0}
+	.o_conf = {0},
+	.o_log_file = {0},
+	.o_metrics_file = {0},
+	.o_metrics_socket = {0},
+	.o_trace_file = {0}
 };
 
 /* Threads */
@@ -93,7 +115,29 @@ enum {
 	FINISHED
 } 			proc_state = RUNNING;
 static uint16_t		nthreads = 1;
-static pthread_t	*threads;
+static uint16_t		nthreads_min = 0;
+
+struct worker_t {
+	pthread_t thread;
+	bool started;
+	bool exited;
+	uint64_t bytes;
+};
+static struct worker_t	*workers;
+static __thread struct worker_t *worker_self;
+
+/* Adaptive worker scaling, counters are protected by queue_mutex. */
+#define SCALE_INTERVAL		5	/* Seconds. */
+#define SCALE_IDLE_INTERVALS	6	/* Shrink after 30 seconds idle. */
+#define SCALE_HOLD_INTERVALS	6	/* Don't grow when throughput stalls. */
+static uint16_t		nworkers;
+static uint16_t		nworkers_busy;
+static uint16_t		nworkers_target;
+static uint16_t		nworkers_max;
+static bool		scale_maxmp = false;
+static uint64_t		scale_bytes;
+static pthread_t	scale_thread;
+static bool		scale_started = false;
 
 /* Work queue */
 #define QUEUE_MAX_ITEMS	(2 * nthreads)
@@ -102,8 +146,47 @@ static pthread_mutex_t	queue_mutex;
 static pthread_cond_t	queue_cond;
 static queue_t		queue;
 
+/* Work queue items, taken from a slab such that enqueue and dequeue do
+   not allocate. Only the fixed size part of hsm_action_item is copied,
+   as before. */
+#define CT_ITEMS_PER_SLAB	64
+struct ct_item_t {
+	struct hsm_action_item hai;	/* Must be first member. */
+	list_node_t node;
+	struct ct_backend_t *backend;
+	bool held;			/* Queued while all sessions of backend
+					   are taken, not counted in queue_sem. */
+};
+static struct slab_t	item_slab;
+
+/* Backends, indexed by archive id. Each backend has its own TSM node
+   account and session pool, whereas worker threads are shared among
+   all backends. Backend 0 is built from the servername, node and
+   password options and serves archive ids without a backend of their
+   own. Counters are protected by queue_mutex. */
+struct ct_backend_t {
+	bool configured;
+	int archive_id;
+	char servername[DSM_MAX_SERVERNAME_LENGTH + 1];
+	char node[DSM_MAX_NODE_LENGTH + 1];
+	char password[DSM_MAX_VERIFIER_LENGTH + 1];
+	char fsname[DSM_MAX_FSNAME_LENGTH + 1];
+	uint16_t sessions_min;
+	uint16_t sessions_max;
+	uint16_t nsessions;
+	uint16_t busy;
+	uint16_t queued;
+	uint16_t idle_intervals;
+	bool maxmp;
+	bool maxmp_exceeded;
+	struct spool_t spool;
+	bool spool_ready;
+};
+static struct ct_backend_t backends[LL_HSM_ORIGIN_MAX_ARCHIVE + 1];
+static uint16_t		nbackends;
+
 /* Session */
-static struct session_t	*sessions;
+static struct ct_backend_t *maxmp_probe = NULL;
 static char lustre_fsname[MAX_OBD_NAME + 1] = {0};
 static struct hsm_copytool_private *ctdata;
 
@@ -111,6 +194,46 @@ static struct hsm_copytool_private *ctdata;
 static int err_major;
 static int err_minor;
 
+/* Metrics export */
+#define METRICS_INTERVAL	15	/* Seconds between textfile updates. */
+enum ct_action_t {
+	CT_ACTION_ARCHIVE,
+	CT_ACTION_RESTORE,
+	CT_ACTION_REMOVE,
+	CT_ACTION_NUM
+};
+static const char *ct_action_names[CT_ACTION_NUM] = {
+	[CT_ACTION_ARCHIVE] = "archive",
+	[CT_ACTION_RESTORE] = "restore",
+	[CT_ACTION_REMOVE]  = "remove"
+};
+struct ct_stats_t {
+	uint64_t inflight[CT_ACTION_NUM];
+	uint64_t succeeded[CT_ACTION_NUM];
+	uint64_t failed[CT_ACTION_NUM];
+	struct metric_hist_t latency[CT_ACTION_NUM];
+};
+static struct ct_stats_t ct_stats;
+static int		metrics_sock = -1;
+static pthread_t	metrics_thread;
+static bool		metrics_started = false;
+
+/* Cache of FID to path resolutions, shared by worker threads. */
+#define FID_CACHE_SIZE		4096	/* Entries. */
+static uint32_t		fid_cache_size = FID_CACHE_SIZE;
+static struct lru_t	fid_cache;
+static bool		fid_cache_ready = false;
+
+/* Objects of at least this size are restored with O_DIRECT writes. */
+static uint64_t		restore_direct_bytes = 0;
+
+/* Compression of archived files, COMPRESS_* codec and level. */
+static uint32_t		compress_codec = COMPRESS_NONE;
+static int		compress_level = 0;
+
+/* Trace dump requested by SIGUSR1. */
+static volatile sig_atomic_t trace_dump_pending = 0;
+
 static void usage(const char *cmd_name, const int rc)
 {
 	dsmApiVersionEx libapi_ver = get_libapi_ver();
@@ -121,6 +244,9 @@ static void usage(const char *cmd_name, const int rc)
 		"\t\t""archive id number\n"
 		"\t-t, --threads <int>\n"
 		"\t\t""number of processing threads [default: %d]\n"
+		"\t--min-threads <int>\n"
+		"\t\t""enable adaptive scaling of processing threads between"
+		" min-threads and threads\n"
 		"\t-n, --node <string>\n"
 		"\t\t""node name registered on tsm server\n"
 		"\t-p, --password <string>\n"
@@ -129,11 +255,33 @@ static void usage(const char *cmd_name, const int rc)
 		"\t\t""owner of tsm node\n"
 		"\t-s, --servername <string>\n"
 		"\t\t""hostname of tsm server\n"
+		"\t--backend <id:servername:node:password"
+		"[:fsname[:min:max]]>\n"
+		"\t\t""route actions of archive id to own tsm node with"
+		" between min and max sessions, can be repeated\n"
+		"\t--fid-cache <int>\n"
+		"\t\t""number of cached FID to path resolutions, 0 disables"
+		" the cache [default: %d]\n"
 		"\t-c, --conf <file>\n"
 		"\t\t""option conf file\n"
 		"\t-v, --verbose {error, warn, message, info, debug}"
 		" [default: %s]\n"
 		"\t\t""produce more verbose output\n"
+		"\t--async-log\n"
+		"\t\t""write log messages asynchronously by a dedicated"
+		" thread\n"
+		"\t--log-file <file>\n"
+		"\t\t""write log messages asynchronously to file which is"
+		" rotated when exceeding %d MiB, %d rotated files are kept\n"
+		"\t--metrics-file <file>\n"
+		"\t\t""write metrics in Prometheus text format to file every"
+		" %d seconds\n"
+		"\t--metrics-socket <path>\n"
+		"\t\t""serve metrics in Prometheus text format on unix"
+		" socket\n"
+		"\t--trace <file>\n"
+		"\t\t""record spans of actions and dump them in Chrome trace"
+		" format to file on SIGUSR1 and exit\n"
 		"\t--abort-on-error\n"
 		"\t\t""abort operation on major error\n"
 		"\t--daemon\n"
@@ -142,9 +290,17 @@ static void usage(const char *cmd_name, const int rc)
 		"\t\t""don't run, just show what would be done\n"
 		"\t--restore-stripe\n"
 		"\t\t""restore stripe information\n"
+		"\t--archive-direct\n"
+		"\t\t""archive with O_DIRECT reads bypassing the page cache\n"
+		"\t--restore-direct <int>\n"
+		"\t\t""restore objects of at least int bytes with O_DIRECT"
+		" writes, 0 disables [default: 0]\n"
+		"\t--compress <codec>[:level]\n"
+		"\t\t""compress archived files with codec none, zlib, zstd"
+		" or lz4 [default: none]\n"
 		"\t--enable-maxmpc\n"
 		"\t\t""enable tsm mount point check to infer the maximum number"
-		" of feasible threads\n"
+		" of feasible threads, result is cached for 24 hours\n"
 		"\t-h, --help\n"
 		"\t\t""show this help\n"
 		"\nIBM API library version: %d.%d.%d.%d, "
@@ -152,7 +308,10 @@ static void usage(const char *cmd_name, const int rc)
 		"version: %s © 2017 by GSI Helmholtz Centre for Heavy Ion Research\n",
 		cmd_name,
 		nthreads,
+		FID_CACHE_SIZE,
 		LOG_LEVEL_HUMAN_STR(opt.o_verbose),
+		ALOG_MAX_SIZE / (1024 * 1024), ALOG_MAX_FILES,
+		METRICS_INTERVAL,
 		libapi_ver.version, libapi_ver.release, libapi_ver.level,
 		libapi_ver.subLevel,
 		appapi_ver.applicationVersion, appapi_ver.applicationRelease,
@@ -163,6 +322,10 @@ static void usage(const char *cmd_name, const int rc)
 
 static void sanity_arg_check(const struct options *opts, const char *argv)
 {
+	/* Default backend is optional when backends are given. */
+	if (nbackends > 0 && !opt.o_node[0] && !opt.o_servername[0])
+		return;
+
 	if (!opt.o_node[0]) {
 		fprintf(stdout, "missing argument -n, --node <string>\n\n");
 		usage(argv, 1);
@@ -197,7 +360,7 @@ static int parse_archive_id(const char *arg)
 	return rc;
 }
 
-static int parse_nthreads(const char *arg)
+static int parse_nthreads(const char *arg, uint16_t *val_nthreads)
 {
 	char *end = NULL;
 	int val = strtol(arg, &end, 10);
@@ -213,11 +376,134 @@ static int parse_nthreads(const char *arg)
 		CT_ERROR(rc, "number of threads must be greater than 0");
 		return rc;
 	}
-	nthreads = val;
+	*val_nthreads = val;
+
+	return rc;
+}
+
+static int parse_fid_cache(const char *arg)
+{
+	char *end = NULL;
+	long val = strtol(arg, &end, 10);
+	int rc = 0;
+
+	if (*arg == '\0' || *end != '\0' || val < 0 || val > UINT32_MAX) {
+		rc = -EINVAL;
+		CT_ERROR(rc, "invalid number of fid cache entries: '%s'", arg);
+		return rc;
+	}
+	fid_cache_size = val;
 
 	return rc;
 }
 
+static int parse_restore_direct(const char *arg)
+{
+	char *end = NULL;
+	unsigned long long val;
+	int rc = 0;
+
+	errno = 0;
+	val = strtoull(arg, &end, 10);
+	if (*arg == '\0' || *arg == '-' || *end != '\0' || errno) {
+		rc = -EINVAL;
+		CT_ERROR(rc, "invalid number of bytes: '%s'", arg);
+		return rc;
+	}
+	restore_direct_bytes = val;
+
+	return rc;
+}
+
+static int parse_compress(const char *arg)
+{
+	int rc;
+
+	rc = compress_parse(arg, &compress_codec, &compress_level);
+	if (rc)
+		CT_ERROR(rc, "invalid or unsupported compression: '%s'", arg);
+
+	return rc;
+}
+
+/* Parse backend of form id:servername:node:password[:fsname[:min:max]],
+   where an empty fsname selects the TSM filespace of the default
+   backend. */
+static int parse_backend(const char *arg)
+{
+	int rc;
+	char buf[MAX_OPTIONS_LENGTH + 1] = {0};
+	char *field[7] = {NULL};
+	char *str = buf;
+	char *end = NULL;
+	uint16_t nfields = 0;
+	struct ct_backend_t *backend;
+
+	strncpy(buf, arg, MAX_OPTIONS_LENGTH);
+	while (nfields < 7 && (field[nfields] = strsep(&str, ":")) != NULL)
+		nfields++;
+	if (str || (nfields != 4 && nfields != 5 && nfields != 7)) {
+		rc = -EINVAL;
+		CT_ERROR(rc, "invalid backend: '%s', expecting "
+			 "id:servername:node:password[:fsname[:min:max]]",
+			 arg);
+		return rc;
+	}
+
+	const int archive_id = strtol(field[0], &end, 10);
+	if (*field[0] == '\0' || *end != '\0' || archive_id <= 0 ||
+	    archive_id > (int)LL_HSM_ORIGIN_MAX_ARCHIVE) {
+		rc = -EINVAL;
+		CT_ERROR(rc, "invalid backend archive-id: '%s', must be in "
+			 "range 1..%zu", field[0], LL_HSM_ORIGIN_MAX_ARCHIVE);
+		return rc;
+	}
+	backend = &backends[archive_id];
+	if (backend->configured) {
+		rc = -EINVAL;
+		CT_ERROR(rc, "backend for archive-id %d already specified",
+			 archive_id);
+		return rc;
+	}
+
+	if (!field[1][0] || strlen(field[1]) > DSM_MAX_SERVERNAME_LENGTH ||
+	    !field[2][0] || strlen(field[2]) > DSM_MAX_NODE_LENGTH ||
+	    strlen(field[3]) > DSM_MAX_VERIFIER_LENGTH ||
+	    (nfields > 4 && strlen(field[4]) > DSM_MAX_FSNAME_LENGTH)) {
+		rc = -EINVAL;
+		CT_ERROR(rc, "invalid servername, node, password or fsname "
+			 "of backend '%s'", arg);
+		return rc;
+	}
+
+	memset(backend, 0, sizeof(struct ct_backend_t));
+	if (nfields == 7) {
+		rc = parse_nthreads(field[5], &backend->sessions_min);
+		if (rc)
+			return rc;
+		rc = parse_nthreads(field[6], &backend->sessions_max);
+		if (rc)
+			return rc;
+		if (backend->sessions_min > backend->sessions_max) {
+			rc = -EINVAL;
+			CT_ERROR(rc, "min sessions %d exceed max sessions %d "
+				 "of backend '%s'", backend->sessions_min,
+				 backend->sessions_max, arg);
+			return rc;
+		}
+	}
+	backend->archive_id = archive_id;
+	strcpy(backend->servername, field[1]);
+	strcpy(backend->node, field[2]);
+	strcpy(backend->password, field[3]);
+	if (nfields > 4)
+		strcpy(backend->fsname, field[4]);
+	backend->configured = true;
+	nbackends++;
+
+	return 0;
+}
+
 static void read_conf(const char *filename)
 {
 	int rc;
@@ -255,7 +541,26 @@ static void read_conf(const char *filename)
 						filename);
 			}
 			else if (OPTNCMP("threads", kv_opt.kv[n].key)) {
-				rc = parse_nthreads(kv_opt.kv[n].val);
+				rc = parse_nthreads(kv_opt.kv[n].val, &nthreads);
+				if (rc)
+					CT_WARN("wrong value '%s' for option "
+						"'%s' in conf file '%s'",
+						kv_opt.kv[n].val,
+						kv_opt.kv[n].key,
+						filename);
+			}
+			else if (OPTNCMP("min-threads", kv_opt.kv[n].key)) {
+				rc = parse_nthreads(kv_opt.kv[n].val,
+						    &nthreads_min);
+				if (rc)
+					CT_WARN("wrong value '%s' for option "
+						"'%s' in conf file '%s'",
+						kv_opt.kv[n].val,
+						kv_opt.kv[n].key,
+						filename);
+			}
+			else if (OPTNCMP("backend", kv_opt.kv[n].key)) {
+				rc = parse_backend(kv_opt.kv[n].val);
 				if (rc)
 					CT_WARN("wrong value '%s' for option "
 						"'%s' in conf file '%s'",
@@ -263,6 +568,45 @@ static void read_conf(const char *filename)
 						kv_opt.kv[n].key,
 						filename);
 			}
+			else if (OPTNCMP("fid-cache", kv_opt.kv[n].key)) {
+				rc = parse_fid_cache(kv_opt.kv[n].val);
+				if (rc)
+					CT_WARN("wrong value '%s' for option "
+						"'%s' in conf file '%s'",
+						kv_opt.kv[n].val,
+						kv_opt.kv[n].key,
+						filename);
+			}
+			else if (OPTNCMP("restore-direct", kv_opt.kv[n].key)) {
+				rc = parse_restore_direct(kv_opt.kv[n].val);
+				if (rc)
+					CT_WARN("wrong value '%s' for option "
+						"'%s' in conf file '%s'",
+						kv_opt.kv[n].val,
+						kv_opt.kv[n].key,
+						filename);
+			}
+			else if (OPTNCMP("compress", kv_opt.kv[n].key)) {
+				rc = parse_compress(kv_opt.kv[n].val);
+				if (rc)
+					CT_WARN("wrong value '%s' for option "
+						"'%s' in conf file '%s'",
+						kv_opt.kv[n].val,
+						kv_opt.kv[n].key,
+						filename);
+			}
+			else if (OPTNCMP("log-file", kv_opt.kv[n].key))
+				strncpy(opt.o_log_file, kv_opt.kv[n].val,
+					1 + MIN(PATH_MAX, MAX_OPTIONS_LENGTH));
+			else if (OPTNCMP("metrics-file", kv_opt.kv[n].key))
+				strncpy(opt.o_metrics_file, kv_opt.kv[n].val,
+					1 + MIN(PATH_MAX, MAX_OPTIONS_LENGTH));
+			else if (OPTNCMP("metrics-socket", kv_opt.kv[n].key))
+				strncpy(opt.o_metrics_socket, kv_opt.kv[n].val,
+					1 + MIN(PATH_MAX, MAX_OPTIONS_LENGTH));
+			else if (OPTNCMP("trace", kv_opt.kv[n].key))
+				strncpy(opt.o_trace_file, kv_opt.kv[n].val,
+					1 + MIN(PATH_MAX, MAX_OPTIONS_LENGTH));
 			else if (OPTNCMP("verbose", kv_opt.kv[n].key)) {
 				rc = parse_verbose(kv_opt.kv[n].val,
 						   &opt.o_verbose);
@@ -292,14 +636,25 @@ static int ct_parseopts(int argc, char *argv[])
 		{.name = "archive-id",	   .has_arg = required_argument, .flag = NULL,	                .val = 'a'},
 		{.name = "daemon",	   .has_arg = no_argument,       .flag = &opt.o_daemonize,      .val =   1},
 		{.name = "threads",        .has_arg = required_argument, .flag = NULL,	                .val = 't'},
+		{.name = "min-threads",    .has_arg = required_argument, .flag = NULL,	                .val = 'T'},
 		{.name = "node",           .has_arg = required_argument, .flag = NULL,                  .val = 'n'},
 		{.name = "password",       .has_arg = required_argument, .flag = NULL,                  .val = 'p'},
 		{.name = "owner",          .has_arg = required_argument, .flag = NULL,                  .val = 'o'},
 		{.name = "servername",     .has_arg = required_argument, .flag = NULL,                  .val = 's'},
+		{.name = "backend",        .has_arg = required_argument, .flag = NULL,                  .val = 'B'},
+		{.name = "fid-cache",      .has_arg = required_argument, .flag = NULL,                  .val = 'F'},
 		{.name = "conf",	   .has_arg = required_argument, .flag = NULL,		        .val = 'c'},
 		{.name = "verbose",        .has_arg = required_argument, .flag = NULL,                  .val = 'v'},
+		{.name = "async-log",      .has_arg = no_argument,       .flag = &opt.o_async_log,      .val =   1},
+		{.name = "log-file",       .has_arg = required_argument, .flag = NULL,                  .val = 'L'},
+		{.name = "metrics-file",   .has_arg = required_argument, .flag = NULL,                  .val = 'M'},
+		{.name = "metrics-socket", .has_arg = required_argument, .flag = NULL,                  .val = 'S'},
+		{.name = "trace",          .has_arg = required_argument, .flag = NULL,                  .val = 'R'},
 		{.name = "dry-run",	   .has_arg = no_argument,	 .flag = &opt.o_dry_run,        .val =   1},
 		{.name = "restore-stripe", .has_arg = no_argument,	 .flag = &opt.o_restore_stripe, .val =   1},
+		{.name = "archive-direct", .has_arg = no_argument,	 .flag = &opt.o_archive_direct, .val =   1},
+		{.name = "restore-direct", .has_arg = required_argument, .flag = NULL,                  .val = 'D'},
+		{.name = "compress",       .has_arg = required_argument, .flag = NULL,                  .val = 'Z'},
 		{.name = "enable-maxmpc",  .has_arg = no_argument,	 .flag = &opt.o_enable_maxmpc,  .val =   1},
 		{.name = "help",           .has_arg = no_argument,       .flag = NULL,		        .val = 'h'},
 		{.name = NULL}
@@ -318,11 +673,33 @@ static int ct_parseopts(int argc, char *argv[])
 			break;
 		}
 		case 't': {
-			rc = parse_nthreads(optarg);
+			rc = parse_nthreads(optarg, &nthreads);
 			if (rc)
 				return rc;
 			break;
 		}
+		case 'T': {
+			rc = parse_nthreads(optarg, &nthreads_min);
+			if (rc)
+				return rc;
+			break;
+		}
+		case 'L': {
+			strncpy(opt.o_log_file, optarg, PATH_MAX);
+			break;
+		}
+		case 'M': {
+			strncpy(opt.o_metrics_file, optarg, PATH_MAX);
+			break;
+		}
+		case 'S': {
+			strncpy(opt.o_metrics_socket, optarg, PATH_MAX);
+			break;
+		}
+		case 'R': {
+			strncpy(opt.o_trace_file, optarg, PATH_MAX);
+			break;
+		}
 		case 'n': {
 			strncpy(opt.o_node, optarg, DSM_MAX_NODE_LENGTH);
 			break;
@@ -341,6 +718,30 @@ static int ct_parseopts(int argc, char *argv[])
 				DSM_MAX_SERVERNAME_LENGTH);
 			break;
 		}
+		case 'B': {
+			rc = parse_backend(optarg);
+			if (rc)
+				return rc;
+			break;
+		}
+		case 'F': {
+			rc = parse_fid_cache(optarg);
+			if (rc)
+				return rc;
+			break;
+		}
+		case 'D': {
+			rc = parse_restore_direct(optarg);
+			if (rc)
+				return rc;
+			break;
+		}
+		case 'Z': {
+			rc = parse_compress(optarg);
+			if (rc)
+				return rc;
+			break;
+		}
 		case 'c': {
 			read_conf(optarg);
 			break;
@@ -394,14 +795,61 @@ static int ct_parseopts(int argc, char *argv[])
 		opt.o_fsname[len_fsname - 1] = '\0';
 	CT_DEBUG("using TSM filespace name '%s'", opt.o_fsname);
 
+	if (opt.o_node[0] && opt.o_servername[0]) {
+		struct ct_backend_t *backend = &backends[0];
+
+		strcpy(backend->servername, opt.o_servername);
+		strcpy(backend->node, opt.o_node);
+		strcpy(backend->password, opt.o_password);
+		backend->configured = true;
+	}
+
+	/* Without explicit archive ids and default backend, register
+	   the archive ids of the backends only. */
+	const bool register_backends = opt.o_archive_cnt == 0 &&
+		!backends[0].configured;
+	for (int id = 0; id <= (int)LL_HSM_ORIGIN_MAX_ARCHIVE; id++) {
+		struct ct_backend_t *backend = &backends[id];
+
+		if (!backend->configured)
+			continue;
+		if (!backend->fsname[0])
+			strcpy(backend->fsname, opt.o_fsname);
+		if (id > 0 && register_backends)
+			opt.o_archive_id[opt.o_archive_cnt++] = id;
+		CT_INFO("backend archive-id %d: servername '%s', node '%s', "
+			"filespace '%s'", id, backend->servername,
+			backend->node, backend->fsname);
+	}
+
 	return 0;
 }
 
+static int ct_log_start(void)
+{
+	int rc;
+
+	if (!opt.o_async_log && !opt.o_log_file[0])
+		return 0;
+
+	rc = alog_start(opt.o_log_file[0] ? opt.o_log_file : NULL,
+			ALOG_MAX_SIZE, ALOG_MAX_FILES);
+	if (rc)
+		CT_ERROR(rc, "cannot start asynchronous logging");
+
+	return rc;
+}
+
 static int progress_callback(struct progress_size_t *pg_size,
 			     struct session_t *session)
 {
 	int rc;
 
+	__atomic_fetch_add(&scale_bytes, pg_size->cur, __ATOMIC_RELAXED);
+	if (worker_self)
+		__atomic_fetch_add(&worker_self->bytes, pg_size->cur,
+				   __ATOMIC_RELAXED);
+
 	session->hai->hai_extent.length = pg_size->cur;
 	session->hai->hai_extent.offset = pg_size->cur_total - pg_size->cur;
 	rc = llapi_hsm_action_progress(session->hcp, &session->hai->hai_extent,
@@ -415,6 +863,38 @@ static int progress_callback(struct progress_size_t *pg_size,
 	return rc;
 }
 
+/* Look up path of fid in cache. A cached path is only returned if it
+   still resolves to fid, such that renamed or removed files are not
+   processed under a stale path. Resolving a path on the client is
+   mostly served from the dentry cache, whereas fid2path always asks
+   the MDT. */
+static bool fid_cache_get(const char *strfid, const lustre_fid *fid,
+			  char *resolved_path, size_t resolved_path_len)
+{
+	int rc;
+	lustre_fid fid_path;
+
+	if (!fid_cache_ready)
+		return false;
+
+	rc = lru_get(&fid_cache, strfid, resolved_path, resolved_path_len);
+	if (rc)
+		return false;
+
+	TRACE_BEGIN("llapi_path2fid");
+	rc = llapi_path2fid(resolved_path, &fid_path);
+	TRACE_END("llapi_path2fid");
+	if (rc == 0 && fid_path.f_seq == fid->f_seq &&
+	    fid_path.f_oid == fid->f_oid && fid_path.f_ver == fid->f_ver)
+		return true;
+
+	CT_DEBUG("cached path '%s' of fid '%s' is stale", resolved_path,
+		 strfid);
+	lru_remove(&fid_cache, strfid);
+
+	return false;
+}
+
 static int fid_realpath(const char *mnt, const lustre_fid *fid,
 			char *resolved_path, size_t resolved_path_len)
 {
@@ -426,8 +906,13 @@ static int fid_realpath(const char *mnt, const lustre_fid *fid,
 
 	snprintf(strfid, sizeof(strfid), DFID_NOBRACE, PFID(fid));
 
+	if (fid_cache_get(strfid, fid, resolved_path, resolved_path_len))
+		return strlen(resolved_path);
+
+	TRACE_BEGIN("llapi_fid2path");
 	rc = llapi_fid2path(mnt, strfid, file, sizeof(file),
 			    &recno, &linkno);
+	TRACE_END("llapi_fid2path");
 	if (rc < 0)
 		return rc;
 
@@ -436,14 +921,36 @@ static int fid_realpath(const char *mnt, const lustre_fid *fid,
 	if (rc >= resolved_path_len)
 		return -ENAMETOOLONG;
 
+	if (fid_cache_ready && lru_put(&fid_cache, strfid, resolved_path))
+		CT_WARN("caching path of fid '%s' failed", strfid);
+
 	return rc;
 }
 
+/* Drop cached path of fid after a failed action, the path might be the
+   cause. */
+static void fid_realpath_invalidate(const lustre_fid *fid)
+{
+	char strfid[FID_NOBRACE_LEN + 1];
+
+	if (!fid_cache_ready)
+		return;
+
+	snprintf(strfid, sizeof(strfid), DFID_NOBRACE, PFID(fid));
+	lru_remove(&fid_cache, strfid);
+}
+
 static int ct_hsm_action_begin(struct session_t *session, int mdt_index,
 			       int open_flags, bool is_error)
 {
-	return llapi_hsm_action_begin(&session->hcp, ctdata, session->hai,
-				      mdt_index, open_flags, is_error);
+	int rc;
+
+	TRACE_BEGIN("llapi_hsm_action_begin");
+	rc = llapi_hsm_action_begin(&session->hcp, ctdata, session->hai,
+				    mdt_index, open_flags, is_error);
+	TRACE_END("llapi_hsm_action_begin");
+
+	return rc;
 }
 
 static int ct_hsm_action_end(struct session_t *session, const int ct_rc,
@@ -457,8 +964,10 @@ static int ct_hsm_action_end(struct session_t *session, const int ct_rc,
 		   PFID(&session->hai->hai_fid),
 		   -ct_rc);
 
+	TRACE_BEGIN("llapi_hsm_action_end");
 	rc = llapi_hsm_action_end(&session->hcp, &session->hai->hai_extent,
 				  0 /* HP_FLAG_RETRY */, ct_rc ? EIO : 0);
+	TRACE_END("llapi_hsm_action_end");
 	if (rc == -ECANCELED)
 		CT_ERROR(rc, "completed action on '%s' has been canceled: "
 			 "cookie=%#jx, FID="DFID, fpath,
@@ -473,7 +982,7 @@ static int ct_hsm_action_end(struct session_t *session, const int ct_rc,
 	return rc;
 }
 
-static int ct_archive(struct session_t *session)
+static int ct_archive(struct session_t *session, const char *fsname)
 {
 	int rc;
 	int fd = -1;
@@ -549,9 +1058,11 @@ static int ct_archive(struct session_t *session)
 				fpath);
 	}
 
-	rc = tsm_archive_fpath(opt.o_fsname, fpath,
+	TRACE_BEGIN("tsm_archive_fpath");
+	rc = tsm_archive_fpath(fsname, fpath,
 			       uuid_str[0] ? uuid_str : NULL, fd,
 			       &lustre_info, session);
+	TRACE_END("tsm_archive_fpath");
 	if (rc) {
 		CT_ERROR(rc, "tsm_archive_fpath failed on '%s' and uuid '%s'",
 			 fpath, uuid_str);
@@ -578,7 +1089,7 @@ cleanup:
 	return rc;
 }
 
-static int ct_restore(struct session_t *session)
+static int ct_restore(struct session_t *session, const char *fsname)
 {
 	int rc;
 	int fd = -1;
@@ -595,8 +1106,10 @@ static int ct_restore(struct session_t *session)
 		return rc;
 	}
 
+	TRACE_BEGIN("getxattr");
 	rc = getxattr(fpath, XATTR_LTSM_UUID, (uuid_t *)&uuid,
 		      sizeof(uuid_t));
+	TRACE_END("getxattr");
 	CT_DEBUG("[rc=%zd] getxattr '%s'", rc, fpath);
 	if (rc < 0)
 		CT_WARN("getxattr failed on '%s' '%s', no "
@@ -641,13 +1154,15 @@ static int ct_restore(struct session_t *session)
 	   use the UUID together with /fs as a search key. */
 	if (uuid_str[0]) {
 		memset(&fpath, 0, sizeof(fpath));
-		snprintf(fpath, sizeof(fpath), "%s/*/*", opt.o_fsname);
+		snprintf(fpath, sizeof(fpath), "%s/*/*", fsname);
 		CT_INFO("found uuid: '%s', change query "
 			"fpath to '%s'", uuid_str, fpath);
 	}
 
-	rc = tsm_retrieve_fpath(opt.o_fsname, fpath,
+	TRACE_BEGIN("tsm_retrieve_fpath");
+	rc = tsm_retrieve_fpath(fsname, fpath,
 				uuid_str[0] ? uuid_str : NULL, fd, session);
+	TRACE_END("tsm_retrieve_fpath");
 	if (rc < 0) {
 		CT_ERROR(rc, "tsm_retrieve_fpath on '%s' and uuid '%s' "
 			 "failed", fpath, uuid_str);
@@ -665,7 +1180,7 @@ cleanup:
 	return rc;
 }
 
-static int ct_remove(struct session_t *session)
+static int ct_remove(struct session_t *session, const char *fsname)
 {
 	int rc;
 	int mdt_index = -1;
@@ -692,7 +1207,9 @@ static int ct_remove(struct session_t *session)
 		rc = 0;
 		goto cleanup;
 	}
-	rc = tsm_delete_fpath(opt.o_fsname, fpath, session);
+	TRACE_BEGIN("tsm_delete_fpath");
+	rc = tsm_delete_fpath(fsname, fpath, session);
+	TRACE_END("tsm_delete_fpath");
 	if (rc != DSM_RC_SUCCESSFUL) {
 		CT_ERROR(rc, "tsm_delete_fpath on '%s' failed", fpath);
 		goto cleanup;
@@ -704,39 +1221,50 @@ cleanup:
 	return rc;
 }
 
-static int ct_process_item(struct session_t *session)
+static int ct_action_idx(const enum hsm_copytool_action action)
 {
-	int rc = 0;
-
-	if (opt.o_verbose >= API_MSG_NORMAL) {
+	switch (action) {
+	case HSMA_ARCHIVE:
+		return CT_ACTION_ARCHIVE;
+	case HSMA_RESTORE:
+		return CT_ACTION_RESTORE;
+	case HSMA_REMOVE:
+		return CT_ACTION_REMOVE;
+	default:
+		return -1;
+	}
+}
 
-		char strfid[FID_LEN + 1];
-		char path[PATH_MAX];
-		long long recno = -1;
-		int linkno = 0;
+static int ct_process_item(struct session_t *session, const char *fsname)
+{
+	int rc = 0;
+	const int action = ct_action_idx(session->hai->hai_action);
+	const uint64_t ts = metrics_now();
 
-		snprintf(strfid, sizeof(strfid), DFID, PFID(&session->hai->hai_fid));
-		CT_MESSAGE("'%s' action %s reclen %d, cookie=%#jx",
-			   strfid,
-			   hsm_copytool_action2name(session->hai->hai_action),
-			   session->hai->hai_len,
-			   (uintmax_t)session->hai->hai_cookie);
-		rc = llapi_fid2path(opt.o_mnt, strfid, path,
-				    sizeof(path), &recno, &linkno);
-		if (rc < 0)
-			CT_ERROR(rc, "cannot get path of FID %s", strfid);
+	/* The path is resolved once by the action handler, fid2path is not
+	   repeated here for logging only. */
+	CT_MESSAGE("'"DFID"' action %s reclen %d, cookie=%#jx",
+		   PFID(&session->hai->hai_fid),
+		   hsm_copytool_action2name(session->hai->hai_action),
+		   session->hai->hai_len,
+		   (uintmax_t)session->hai->hai_cookie);
+
+	if (action >= 0) {
+		__atomic_fetch_add(&ct_stats.inflight[action], 1,
+				   __ATOMIC_RELAXED);
+		TRACE_BEGIN(ct_action_names[action]);
 	}
 
 	switch (session->hai->hai_action) {
 		/* set err_major, minor inside these functions */
 	case HSMA_ARCHIVE:
-		rc = ct_archive(session);
+		rc = ct_archive(session, fsname);
 		break;
 	case HSMA_RESTORE:
-		rc = ct_restore(session);
+		rc = ct_restore(session, fsname);
 		break;
 	case HSMA_REMOVE:
-		rc = ct_remove(session);
+		rc = ct_remove(session, fsname);
 		break;
 	case HSMA_CANCEL:
 		/* Cancel operation is handle by llapi_hsm_action_progress,
@@ -747,60 +1275,669 @@ static int ct_process_item(struct session_t *session)
 		CT_ERROR(rc, "unknown action %d, on '%s'",
 			 session->hai->hai_action,
 			 opt.o_mnt);
-		err_minor++;
+		__atomic_fetch_add(&err_minor, 1, __ATOMIC_RELAXED);
 		ct_hsm_action_end(session, rc, NULL);
 	}
-	free(session->hai);
+
+	if (rc)
+		fid_realpath_invalidate(&session->hai->hai_fid);
+
+	if (action >= 0) {
+		TRACE_END(ct_action_names[action]);
+		__atomic_fetch_sub(&ct_stats.inflight[action], 1,
+				   __ATOMIC_RELAXED);
+		__atomic_fetch_add(rc ? &ct_stats.failed[action] :
+				   &ct_stats.succeeded[action], 1,
+				   __ATOMIC_RELAXED);
+		metrics_hist_add(&ct_stats.latency[action], metrics_now() - ts,
+				 0);
+	}
 
 	return rc;
 }
 
+static void ct_cancel_item(struct hsm_action_item *hai)
+{
+	int rc;
+	struct hsm_copyaction_private *hcp;
+	char fid[128];
+
+	sprintf(fid, DFID, PFID(&hai->hai_fid));
+	CT_DEBUG("canceling fid '%s' action %s reclen %d, cookie=%#jx",
+		 fid, hsm_copytool_action2name(hai->hai_action),
+		 hai->hai_len, (uintmax_t)hai->hai_cookie);
+
+	rc = llapi_hsm_action_begin(&hcp, ctdata, hai, -1, 0, true);
+	if (rc < 0)
+		CT_ERROR(rc, "cancel with llapi_hsm_action_begin() failed");
+
+	rc = llapi_hsm_action_end(&hcp, &hai->hai_extent, 0, abs(rc));
+	if (rc < 0)
+		CT_ERROR(rc, "cancel with llapi_hsm_action_end() failed");
+}
+
+/* Backend of archive id, archive ids without a backend of their own
+   are served by the default backend if available. */
+static struct ct_backend_t *ct_backend(const int archive_id)
+{
+	if (archive_id > 0 && archive_id <= (int)LL_HSM_ORIGIN_MAX_ARCHIVE &&
+	    backends[archive_id].spool_ready)
+		return &backends[archive_id];
+
+	return backends[0].spool_ready ? &backends[0] : NULL;
+}
+
+/* Dequeue the oldest item whose backend has a free session, such that
+   a saturated backend does not block workers on items of other
+   backends. Grow the session pool of the backend on demand up to its
+   maximum, queue_mutex must be held. */
+static int ct_dequeue(list_node_t **node)
+{
+	int rc;
+	list_node_t *prev = NULL;
+	struct ct_item_t *item;
+	struct ct_backend_t *backend;
+
+	for (*node = list_head(&queue); *node; *node = list_next(*node)) {
+		item = list_data(*node);
+		if (item->backend->busy < item->backend->sessions_max)
+			break;
+		prev = *node;
+	}
+	if (*node == NULL)
+		return -EAGAIN;
+
+	rc = list_rem_next_node(&queue, prev, node);
+	if (rc)
+		return rc;
+
+	backend = ((struct ct_item_t *)list_data(*node))->backend;
+	backend->queued--;
+	backend->busy++;
+	backend->idle_intervals = 0;
+	if (backend->busy > backend->nsessions) {
+		backend->nsessions = backend->busy;
+		spool_resize(&backend->spool, backend->nsessions);
+	}
+
+	return 0;
+}
+
 static void *ct_thread(void *data)
 {
-	struct session_t *session = (struct session_t *) data;
+	struct worker_t *worker = (struct worker_t *) data;
+	struct session_t *session;
+	struct hsm_action_item *hai;
+	struct ct_item_t *item;
+	struct ct_backend_t *backend;
+	list_node_t *node;
 	int rc;
 
+	worker_self = worker;
+
 	for (;;) {
 		/* Critical region, lock. */
 		pthread_mutex_lock(&queue_mutex);
-		while (queue_size(&queue) == 0) {
-			if (proc_state != RUNNING) {
+		while (nworkers > nworkers_target ||
+		       (rc = ct_dequeue(&node)) == -EAGAIN) {
+			if (proc_state != RUNNING ||
+			    nworkers > nworkers_target) {
 				rc = 0;
-				pthread_mutex_unlock(&queue_mutex);
 				goto thread_exit;
 			}
 
 			pthread_cond_wait(&queue_cond, &queue_mutex);
 		}
 
-		rc = queue_dequeue(&queue, (void **)&session->hai);
+		item = list_data(node);
+		hai = &item->hai;
+		backend = item->backend;
+		nworkers_busy++;
 
 		/* Unlock. */
 		pthread_mutex_unlock(&queue_mutex);
 
-		/* Signal work queue empty slot */
-		sem_post(&queue_sem);
+		/* Signal work queue empty slot, held back items returned
+		   their slot when enqueued. */
+		if (!item->held)
+			sem_post(&queue_sem);
 
 		CT_DEBUG("dequeue action '%s' cookie=%#jx, FID="DFID"",
-			 hsm_copytool_action2name(session->hai->hai_action),
-			 (uintmax_t)session->hai->hai_cookie,
-			 PFID(&session->hai->hai_fid));
+			 hsm_copytool_action2name(hai->hai_action),
+			 (uintmax_t)hai->hai_cookie,
+			 PFID(&hai->hai_fid));
 		if (rc)
 			CT_ERROR(ECANCELED, "dequeue action '%s'"
 				 "cookie=%#jx, FID="DFID" failed",
-				 hsm_copytool_action2name(session->hai->hai_action),
-				 (uintmax_t)session->hai->hai_cookie,
-				 PFID(&session->hai->hai_fid));
+				 hsm_copytool_action2name(hai->hai_action),
+				 (uintmax_t)hai->hai_cookie,
+				 PFID(&hai->hai_fid));
+
+		if (trace_enabled) {
+			char strfid[FID_LEN + 1];
+
+			snprintf(strfid, sizeof(strfid), DFID,
+				 PFID(&hai->hai_fid));
+			trace_context_set(hai->hai_cookie, strfid);
+		}
+
+		/* Blocks while all sessions are busy or reconnecting, e.g.
+		   during a TSM server maintenance window. */
+		TRACE_BEGIN("spool_checkout");
+		session = spool_checkout(&backend->spool);
+		TRACE_END("spool_checkout");
+		if (session == NULL) {
+			ct_cancel_item(hai);
+			slab_free(&item_slab, item);
+			pthread_mutex_lock(&queue_mutex);
+			nworkers_busy--;
+			backend->busy--;
+			pthread_mutex_unlock(&queue_mutex);
+			continue;
+		}
+		session->hai = hai;
+		session->rc_tsm = DSM_RC_OK;
+		session->reason_tsm = 0;
 
-		rc = ct_process_item(session);
+		rc = ct_process_item(session, backend->fsname);
 		if (rc)
 			CT_ERROR(rc, "ct_process_item failed");
+
+		if (session->reason_tsm == DSM_RS_ABORT_EXCEED_MAX_MP) {
+			pthread_mutex_lock(&queue_mutex);
+			backend->maxmp = true;
+			scale_maxmp = true;
+			pthread_mutex_unlock(&queue_mutex);
+		}
+
+		session->hai = NULL;
+		spool_checkin(&backend->spool, session);
+		slab_free(&item_slab, item);
+		trace_context_clear();
+
+		/* Session of backend is free again, items held back for it
+		   can be dispatched. */
+		pthread_mutex_lock(&queue_mutex);
+		nworkers_busy--;
+		backend->busy--;
+		if (queue_size(&queue) > 0)
+			pthread_cond_signal(&queue_cond);
+		pthread_mutex_unlock(&queue_mutex);
 	}
 
 thread_exit:
+	nworkers--;
+	worker->exited = true;
+	pthread_mutex_unlock(&queue_mutex);
+
+	return NULL;
+}
+
+/* Start worker threads until nworkers_target is reached, queue_mutex
+   must be held. Slots of retired workers are joined and reused. */
+static int ct_start_workers(void)
+{
+	int rc = 0;
+	char thread_name[32];
+
+	for (uint16_t n = 0; n < nthreads &&
+		     nworkers < nworkers_target; n++) {
+		struct worker_t *worker = &workers[n];
+
+		if (worker->started && !worker->exited)
+			continue;
+		if (worker->started)
+			pthread_join(worker->thread, NULL);
+
+		worker->started = false;
+		worker->exited = false;
+		rc = pthread_create(&worker->thread, NULL, ct_thread, worker);
+		if (rc != 0) {
+			CT_ERROR(rc, "cannot create worker thread '%d' for"
+				 "'%s'", n, opt.o_mnt);
+			break;
+		}
+		worker->started = true;
+		nworkers++;
+
+		sprintf(thread_name, "lhsmtool_tsm/%d", n);
+		pthread_setname_np(worker->thread, thread_name);
+	}
+
+	return rc;
+}
+
+/* Lower the maximum number of sessions of backends which ran out of
+   mount points below their current size, queue_mutex must be held.
+   Return the new maximum number of workers. */
+static uint16_t ct_backends_maxmp(void)
+{
+	uint16_t nsessions_max = 0;
+
+	for (int id = 0; id <= (int)LL_HSM_ORIGIN_MAX_ARCHIVE; id++) {
+		struct ct_backend_t *backend = &backends[id];
+
+		if (!backend->spool_ready)
+			continue;
+		if (backend->maxmp) {
+			backend->maxmp = false;
+			backend->sessions_max = MAX(backend->sessions_min,
+						    backend->nsessions > 1 ?
+						    backend->nsessions - 1 : 1);
+			if (backend->nsessions > backend->sessions_max) {
+				backend->nsessions = backend->sessions_max;
+				spool_resize(&backend->spool,
+					     backend->nsessions);
+			}
+			CT_WARN("limiting sessions of archive-id %d node '%s'"
+				" to %d", id, backend->node,
+				backend->sessions_max);
+		}
+		nsessions_max += backend->sessions_max;
+	}
+
+	return MAX(nthreads_min, nsessions_max);
+}
+
+/* Shrink session pools of backends without queued actions and idle
+   sessions towards their minimum, queue_mutex must be held. */
+static void ct_backends_shrink(void)
+{
+	for (int id = 0; id <= (int)LL_HSM_ORIGIN_MAX_ARCHIVE; id++) {
+		struct ct_backend_t *backend = &backends[id];
+
+		if (!backend->spool_ready)
+			continue;
+		if (backend->queued > 0 ||
+		    backend->nsessions <= MAX(backend->sessions_min,
+					      backend->busy)) {
+			backend->idle_intervals = 0;
+			continue;
+		}
+		if (++backend->idle_intervals < SCALE_IDLE_INTERVALS)
+			continue;
+
+		backend->idle_intervals = 0;
+		backend->nsessions = MAX(backend->sessions_min, backend->busy);
+		spool_resize(&backend->spool, backend->nsessions);
+		CT_INFO("shrinking sessions of archive-id %d node '%s' to %d",
+			id, backend->node, backend->nsessions);
+	}
+}
+
+/* Scale workers between nthreads_min and nworkers_max. Grow while all
+   workers are busy and the work queue is not empty, as long as growing
+   increases the aggregated throughput. Shrink when workers are idle for
+   a while. On DSM_RS_ABORT_EXCEED_MAX_MP the server ran out of mount
+   points, thus lower the upper limit below the current size. Session
+   pools of backends grow on dispatch and are shrunk here. */
+static void *ct_scaler(void *data)
+{
+	uint64_t bytes_prev = 0;
+	uint64_t tput_prev = 0;
+	uint16_t idle_intervals = 0;
+	uint16_t hold_intervals = 0;
+	bool grew = false;
+
+	(void)data;
+
+	while (proc_state == RUNNING) {
+		for (int n = 0; n < SCALE_INTERVAL &&
+			     proc_state == RUNNING; n++)
+			sleep(1);
+		if (proc_state != RUNNING)
+			break;
+
+		const uint64_t bytes = __atomic_load_n(&scale_bytes,
+						       __ATOMIC_RELAXED);
+		const uint64_t tput = (bytes - bytes_prev) / SCALE_INTERVAL;
+		bytes_prev = bytes;
+
+		pthread_mutex_lock(&queue_mutex);
+		const size_t depth = queue_size(&queue);
+		uint16_t target = nworkers_target;
+
+		if (scale_maxmp) {
+			scale_maxmp = false;
+			nworkers_max = ct_backends_maxmp();
+			target = MIN(target, nworkers_max);
+			CT_WARN("maximum number of mount points exceeded, "
+				"limiting threads to %d", nworkers_max);
+			grew = false;
+		} else if (depth > 0 && nworkers_busy == nworkers &&
+			   target < nworkers_max) {
+			idle_intervals = 0;
+			if (grew && tput <= tput_prev + tput_prev / 20) {
+				/* Last growth did not increase throughput. */
+				grew = false;
+				hold_intervals = SCALE_HOLD_INTERVALS;
+			} else if (hold_intervals > 0)
+				hold_intervals--;
+			else {
+				target += MIN(depth, (size_t)(nworkers_max - target));
+				target = MIN(target, 2 * nworkers_target);
+				grew = true;
+			}
+		} else if (depth == 0 && nworkers_busy < nworkers &&
+			   target > nthreads_min) {
+			grew = false;
+			if (++idle_intervals >= SCALE_IDLE_INTERVALS) {
+				idle_intervals = 0;
+				target--;
+			}
+		} else {
+			grew = false;
+			idle_intervals = 0;
+		}
+
+		if (target != nworkers_target) {
+			CT_MESSAGE("scaling threads from %d to %d, queue depth "
+				   "%zu, throughput %" PRIu64 " bytes/s",
+				   nworkers_target, target, depth, tput);
+			nworkers_target = target;
+			ct_start_workers();
+			pthread_cond_broadcast(&queue_cond);
+		}
+		ct_backends_shrink();
+		tput_prev = tput;
+		pthread_mutex_unlock(&queue_mutex);
+	}
+
+	return NULL;
+}
+
+/* Write copytool state and library metrics in Prometheus text format. */
+static void ct_metrics_write(FILE *file)
+{
+	static struct metrics_snapshot_t snap;
+	struct metric_hist_t hist;
+	char labels[64];
+	size_t depth;
+	uint16_t busy, total, target;
+
+	pthread_mutex_lock(&queue_mutex);
+	depth = queue_size(&queue);
+	busy = nworkers_busy;
+	total = nworkers;
+	target = nworkers_target;
+	pthread_mutex_unlock(&queue_mutex);
+
+	fprintf(file, "# HELP ltsm_ct_queue_depth Actions waiting in the work"
+		" queue.\n"
+		"# TYPE ltsm_ct_queue_depth gauge\n"
+		"ltsm_ct_queue_depth %zu\n", depth);
+	fprintf(file, "# HELP ltsm_ct_workers Worker threads.\n"
+		"# TYPE ltsm_ct_workers gauge\n"
+		"ltsm_ct_workers{state=\"busy\"} %u\n"
+		"ltsm_ct_workers{state=\"running\"} %u\n"
+		"ltsm_ct_workers{state=\"target\"} %u\n",
+		busy, total, target);
+	fprintf(file, "# HELP ltsm_ct_sessions TSM sessions in the pool of"
+		" the backend.\n"
+		"# TYPE ltsm_ct_sessions gauge\n");
+	for (int id = 0; id <= (int)LL_HSM_ORIGIN_MAX_ARCHIVE; id++)
+		if (backends[id].spool_ready)
+			fprintf(file, "ltsm_ct_sessions{archive_id=\"%d\","
+				"node=\"%s\"} %u\n", id, backends[id].node,
+				spool_size(&backends[id].spool));
+
+	if (fid_cache_ready)
+		fprintf(file, "# HELP ltsm_ct_fid_cache_entries Cached FID to"
+			" path resolutions.\n"
+			"# TYPE ltsm_ct_fid_cache_entries gauge\n"
+			"ltsm_ct_fid_cache_entries %u\n"
+			"# HELP ltsm_ct_fid_cache_total Lookups in the FID to"
+			" path cache.\n"
+			"# TYPE ltsm_ct_fid_cache_total counter\n"
+			"ltsm_ct_fid_cache_total{result=\"hit\"} %lu\n"
+			"ltsm_ct_fid_cache_total{result=\"miss\"} %lu\n",
+			lru_size(&fid_cache),
+			(unsigned long)__atomic_load_n(&fid_cache.hits,
+						       __ATOMIC_RELAXED),
+			(unsigned long)__atomic_load_n(&fid_cache.misses,
+						       __ATOMIC_RELAXED));
+
+	if (bufpool_default()) {
+		struct bufpool_stats_t stats;
+
+		bufpool_stats(bufpool_default(), &stats);
+		fprintf(file, "# HELP ltsm_ct_bufpool_buffers Data buffers of"
+			" the shared buffer pool.\n"
+			"# TYPE ltsm_ct_bufpool_buffers gauge\n"
+			"ltsm_ct_bufpool_buffers{state=\"allocated\"} %lu\n"
+			"ltsm_ct_bufpool_buffers{state=\"in_use\"} %lu\n"
+			"ltsm_ct_bufpool_buffers{state=\"peak\"} %lu\n"
+			"# HELP ltsm_ct_bufpool_gets_total Buffers handed out"
+			" by the shared buffer pool.\n"
+			"# TYPE ltsm_ct_bufpool_gets_total counter\n"
+			"ltsm_ct_bufpool_gets_total{result=\"reuse\"} %lu\n"
+			"ltsm_ct_bufpool_gets_total{result=\"alloc\"} %lu\n",
+			(unsigned long)stats.buffers,
+			(unsigned long)stats.in_use,
+			(unsigned long)stats.peak,
+			(unsigned long)stats.reuses,
+			(unsigned long)(stats.gets - stats.reuses));
+	}
+
+	fprintf(file, "# HELP ltsm_ct_actions_inflight Actions currently"
+		" processed.\n"
+		"# TYPE ltsm_ct_actions_inflight gauge\n");
+	for (uint16_t a = 0; a < CT_ACTION_NUM; a++)
+		fprintf(file, "ltsm_ct_actions_inflight{action=\"%s\"} %lu\n",
+			ct_action_names[a], (unsigned long)__atomic_load_n(
+				&ct_stats.inflight[a], __ATOMIC_RELAXED));
+
+	fprintf(file, "# HELP ltsm_ct_actions_total Processed actions.\n"
+		"# TYPE ltsm_ct_actions_total counter\n");
+	for (uint16_t a = 0; a < CT_ACTION_NUM; a++)
+		fprintf(file, "ltsm_ct_actions_total{action=\"%s\","
+			"result=\"success\"} %lu\n"
+			"ltsm_ct_actions_total{action=\"%s\","
+			"result=\"failure\"} %lu\n",
+			ct_action_names[a], (unsigned long)__atomic_load_n(
+				&ct_stats.succeeded[a], __ATOMIC_RELAXED),
+			ct_action_names[a], (unsigned long)__atomic_load_n(
+				&ct_stats.failed[a], __ATOMIC_RELAXED));
+
+	fprintf(file, "# HELP ltsm_ct_action_duration_seconds Latency of"
+		" actions from dequeue to llapi_hsm_action_end.\n"
+		"# TYPE ltsm_ct_action_duration_seconds summary\n");
+	for (uint16_t a = 0; a < CT_ACTION_NUM; a++) {
+		metrics_hist_load(&hist, &ct_stats.latency[a]);
+		snprintf(labels, sizeof(labels), "action=\"%s\"",
+			 ct_action_names[a]);
+		metrics_prometheus_summary(file,
+					   "ltsm_ct_action_duration_seconds",
+					   labels, &hist);
+	}
+
+	fprintf(file, "# HELP ltsm_ct_errors_total Errors while processing"
+		" actions.\n"
+		"# TYPE ltsm_ct_errors_total counter\n"
+		"ltsm_ct_errors_total{severity=\"major\"} %d\n"
+		"ltsm_ct_errors_total{severity=\"minor\"} %d\n",
+		__atomic_load_n(&err_major, __ATOMIC_RELAXED),
+		__atomic_load_n(&err_minor, __ATOMIC_RELAXED));
+
+	fprintf(file, "# HELP ltsm_ct_worker_bytes_total Bytes transferred"
+		" by worker threads and their sessions.\n"
+		"# TYPE ltsm_ct_worker_bytes_total counter\n");
+	for (uint16_t n = 0; n < nthreads && workers; n++)
+		fprintf(file, "ltsm_ct_worker_bytes_total{worker=\"%u\"} "
+			"%lu\n", n, (unsigned long)__atomic_load_n(
+				&workers[n].bytes, __ATOMIC_RELAXED));
+
+	fprintf(file, "# HELP ltsm_log_dropped_total Log messages dropped by"
+		" the asynchronous logger.\n"
+		"# TYPE ltsm_log_dropped_total counter\n"
+		"ltsm_log_dropped_total %lu\n", (unsigned long)alog_dropped());
+
+	metrics_snapshot(&snap);
+	metrics_prometheus(file, &snap);
+}
+
+/* Replace textfile atomically, such that a scraper never reads a partially
+   written file. */
+static void ct_metrics_file(void)
+{
+	int rc;
+	FILE *file;
+	char fpath_tmp[PATH_MAX + 5];
+
+	snprintf(fpath_tmp, sizeof(fpath_tmp), "%s.tmp", opt.o_metrics_file);
+	file = fopen(fpath_tmp, "w");
+	if (!file) {
+		CT_ERROR(-errno, "fopen '%s'", fpath_tmp);
+		return;
+	}
+	ct_metrics_write(file);
+	rc = fclose(file);
+	if (rc) {
+		CT_ERROR(-errno, "fclose '%s'", fpath_tmp);
+		unlink(fpath_tmp);
+		return;
+	}
+
+	rc = rename(fpath_tmp, opt.o_metrics_file);
+	if (rc < 0) {
+		CT_ERROR(-errno, "rename '%s' to '%s'", fpath_tmp,
+			 opt.o_metrics_file);
+		unlink(fpath_tmp);
+	}
+}
+
+/* Write metrics to a client connected to the metrics socket. */
+static void ct_metrics_serve(void)
+{
+	int fd;
+	FILE *file;
+	const struct timeval timeout = {.tv_sec = 1, .tv_usec = 0};
+
+	fd = accept(metrics_sock, NULL, NULL);
+	if (fd < 0) {
+		CT_WARN("accept on metrics socket failed: %s",
+			strerror(errno));
+		return;
+	}
+	/* Don't stall on clients which don't read. */
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+	file = fdopen(fd, "w");
+	if (!file) {
+		CT_ERROR(-errno, "fdopen");
+		close(fd);
+		return;
+	}
+	ct_metrics_write(file);
+	fclose(file);
+}
+
+/* Only sockets are removed, such that a mistyped path does not delete
+   an arbitrary file. */
+static int ct_metrics_unlink(void)
+{
+	struct stat st;
+
+	if (lstat(opt.o_metrics_socket, &st))
+		return errno == ENOENT ? 0 : -errno;
+	if (!S_ISSOCK(st.st_mode))
+		return -EEXIST;
+	if (unlink(opt.o_metrics_socket))
+		return -errno;
+
+	return 0;
+}
+
+static int ct_metrics_listen(void)
+{
+	int rc;
+	struct sockaddr_un addr = {.sun_family = AF_UNIX};
+
+	if (strlen(opt.o_metrics_socket) >= sizeof(addr.sun_path)) {
+		rc = -ENAMETOOLONG;
+		CT_ERROR(rc, "metrics socket path '%s'", opt.o_metrics_socket);
+		return rc;
+	}
+	strncpy(addr.sun_path, opt.o_metrics_socket,
+		sizeof(addr.sun_path) - 1);
+
+	metrics_sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (metrics_sock < 0) {
+		rc = -errno;
+		CT_ERROR(rc, "socket");
+		return rc;
+	}
+
+	/* Remove stale socket of a previous run. */
+	rc = ct_metrics_unlink();
+	if (rc) {
+		CT_ERROR(rc, "metrics socket '%s' is no socket or cannot be "
+			 "removed", opt.o_metrics_socket);
+		goto cleanup;
+	}
+	rc = bind(metrics_sock, (struct sockaddr *)&addr, sizeof(addr));
+	if (rc < 0) {
+		rc = -errno;
+		CT_ERROR(rc, "bind '%s'", opt.o_metrics_socket);
+		goto cleanup;
+	}
+
+	rc = listen(metrics_sock, 4);
+	if (rc < 0) {
+		rc = -errno;
+		CT_ERROR(rc, "listen '%s'", opt.o_metrics_socket);
+		ct_metrics_unlink();
+		goto cleanup;
+	}
+	CT_MESSAGE("serving metrics on '%s'", opt.o_metrics_socket);
+
+	return 0;
+
+cleanup:
+	close(metrics_sock);
+	metrics_sock = -1;
+
+	return rc;
+}
+
+static void *ct_metrics(void *data)
+{
+	time_t next = 0;
+
+	(void)data;
+
+	while (proc_state == RUNNING) {
+		struct timespec now;
+
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if (opt.o_metrics_file[0] && now.tv_sec >= next) {
+			ct_metrics_file();
+			next = now.tv_sec + METRICS_INTERVAL;
+		}
+
+		if (metrics_sock >= 0) {
+			struct pollfd pfd = {.fd = metrics_sock,
+					     .events = POLLIN};
+
+			if (poll(&pfd, 1, 1000) > 0)
+				ct_metrics_serve();
+		} else
+			sleep(1);
+	}
+
 	return NULL;
 }
 
+static void ct_trace_dump(void)
+{
+	int rc;
+
+	rc = trace_dump(opt.o_trace_file);
+	if (rc)
+		CT_ERROR(rc, "trace_dump '%s'", opt.o_trace_file);
+	else
+		CT_MESSAGE("dumped trace to '%s'", opt.o_trace_file);
+}
 
 /* Daemon waits for messages from the kernel; run it in the background. */
 static int ct_run(void)
@@ -814,6 +1951,10 @@ static int ct_run(void)
 			CT_ERROR(rc, "cannot daemonize");
 			return rc;
 		}
+		/* Writer thread does not survive the fork in daemon(). */
+		rc = ct_log_start();
+		if (rc)
+			return rc;
 	}
 
 	rc = llapi_hsm_copytool_register(&ctdata, opt.o_mnt,
@@ -833,6 +1974,11 @@ static int ct_run(void)
 
 		int i = 0;
 
+		if (trace_dump_pending) {
+			trace_dump_pending = 0;
+			ct_trace_dump();
+		}
+
 		CT_DEBUG("waiting for message from kernel");
 
 		bool already_shown = false;
@@ -858,6 +2004,8 @@ static int ct_run(void)
 		} else if (rc == -EINTR && proc_state != RUNNING) {
 			CT_DEBUG("ct_run() stopping, interrupted %d", errno);
 			break;
+		} else if (rc == -EINTR && trace_dump_pending) {
+			continue;
 		} else if (rc < 0) {
 			CT_WARN("cannot receive action list: %s", strerror(-rc));
 			err_major++;
@@ -907,19 +2055,53 @@ static int ct_run(void)
 				break;
 			}
 
+			struct ct_item_t *item;
 			struct hsm_action_item *work_hai;
-			work_hai = malloc(sizeof(struct hsm_action_item));
-			if (work_hai == NULL) {
-				CT_ERROR(errno, "malloc failed");
+			struct ct_backend_t *backend;
+
+			backend = ct_backend(hal->hal_archive_id);
+			if (backend == NULL) {
+				rc = -EINVAL;
+				CT_ERROR(rc, "no backend for archive-id %d, "
+					 "cancel action '%s' cookie=%#jx, "
+					 "FID="DFID"", hal->hal_archive_id,
+					 hsm_copytool_action2name(hai->hai_action),
+					 (uintmax_t)hai->hai_cookie,
+					 PFID(&hai->hai_fid));
+				ct_cancel_item(hai);
+				sem_post(&queue_sem);
+				err_major++;
+				hai = hai_next(hai);
+				continue;
+			}
+
+			item = slab_alloc(&item_slab);
+			if (item == NULL) {
+				CT_ERROR(-ENOMEM, "slab_alloc failed");
 				break;
 			}
+			work_hai = &item->hai;
 			memcpy(work_hai, hai, sizeof(struct hsm_action_item));
+			item->node.data = item;
+			item->backend = backend;
 
 			/* Lock queue to avoid thread access. */
 			pthread_mutex_lock(&queue_mutex);
 
+			/* Items exceeding the free sessions of their backend
+			   wait for that backend only. They do not take slots
+			   of the work queue, thus a saturated backend does not
+			   block receiving actions of other archive ids. */
+			item->held = backend->queued + backend->busy >=
+				backend->sessions_max;
+
 			/* Insert hsm action into queue. */
-			rc = queue_enqueue(&queue, work_hai);
+			rc = queue_enqueue_node(&queue, &item->node);
+			if (!rc) {
+				backend->queued++;
+				if (item->held)
+					sem_post(&queue_sem);
+			}
 			CT_MESSAGE("enqueue action '%s' cookie=%#jx, FID="DFID"",
 				   hsm_copytool_action2name(work_hai->hai_action),
 				   (uintmax_t)work_hai->hai_cookie,
@@ -931,9 +2113,12 @@ static int ct_run(void)
 					 hsm_copytool_action2name(work_hai->hai_action),
 					 (uintmax_t)work_hai->hai_cookie,
 					 PFID(&work_hai->hai_fid));
+				slab_free(&item_slab, item);
 				err_major++;
-				if (opt.o_abort_on_err)
+				if (opt.o_abort_on_err) {
+					pthread_mutex_unlock(&queue_mutex);
 					break;
+				}
 			}
 
 			/* Free the lock of the queue. */
@@ -954,35 +2139,38 @@ static int ct_run(void)
 	CT_MESSAGE("Exiting: cleaning pending queue");
 
 	while (queue_size(&queue) > 0) {
-		struct hsm_action_item *hai;
-		struct hsm_copyaction_private *hcp;
-		char fid[128];
-
-		queue_dequeue(&queue, (void **)&hai);
-
-		sprintf(fid, DFID, PFID(&hai->hai_fid));
-		CT_DEBUG("canceling fid '%s' action %s reclen %d, cookie=%#jx",
-			fid, hsm_copytool_action2name(hai->hai_action),
-			hai->hai_len, (uintmax_t)hai->hai_cookie);
+		list_node_t *node;
 
-		rc = llapi_hsm_action_begin(&hcp, ctdata, hai, -1, 0, true);
-		if (rc < 0)
-			CT_ERROR(rc, "cancel with llapi_hsm_action_begin() failed");
+		struct ct_item_t *item;
 
-		rc = llapi_hsm_action_end(&hcp, &hai->hai_extent, 0, abs(rc));
-		if (rc < 0)
-			CT_ERROR(rc, "cancel with llapi_hsm_action_end() failed");
-
-		free(hai);
+		queue_dequeue_node(&queue, &node);
+		item = list_data(node);
+		item->backend->queued--;
+		ct_cancel_item(&item->hai);
+		slab_free(&item_slab, item);
 	}
 	pthread_mutex_unlock(&queue_mutex);
 
 	/* Signal all threads to continue */
 	proc_state = EXITING;
 	pthread_cond_broadcast(&queue_cond);
+	for (n = 0; n <= (int)LL_HSM_ORIGIN_MAX_ARCHIVE; n++)
+		if (backends[n].spool_ready)
+			spool_shutdown(&backends[n].spool);
+	if (scale_started) {
+		pthread_join(scale_thread, NULL);
+		scale_started = false;
+	}
+	if (metrics_started) {
+		pthread_join(metrics_thread, NULL);
+		metrics_started = false;
+	}
 	/* Wait for threads to terminate */
-	for (n = 0; n < nthreads; n++) {
-		rc = pthread_join(threads[n], NULL);
+	for (n = 0; n < nthreads && workers; n++) {
+		if (!workers[n].started)
+			continue;
+		rc = pthread_join(workers[n].thread, NULL);
+		workers[n].started = false;
 		CT_MESSAGE("Exiting: stopped thread worker %d with %d", n, rc);
 	}
 
@@ -995,20 +2183,143 @@ static int ct_run(void)
 	return rc;
 }
 
-static int ct_connect_sessions(void)
+static int ct_setup_session(struct session_t *session)
+{
+	int rc;
+
+	session->progress = progress_callback;
+	session->archive_direct = opt.o_archive_direct ? bTrue : bFalse;
+	session->compress_codec = compress_codec;
+	session->compress_level = compress_level;
+
+	if (!maxmp_probe)
+		return 0;
+
+	/* Find maximum number of allowed mountpoints (alias the number
+	   of maxium threads) by sending DSM_OBJ_DIRECTORY and verifying
+	   whether transaction was successful. If rc is ECONNREFUSED,
+	   then number of threads > maximum number of allowed
+	   mountpoints, and the current number of threads have to be
+	   decreased. The dummy objects of all sessions are deleted
+	   at once in ct_connect_sessions. */
+	rc = tsm_probe_free_mountp(maxmp_probe->fsname, session);
+	if (rc == ECONNREFUSED)
+		maxmp_probe->maxmp_exceeded = true;
+
+	return rc;
+}
+
+/* Connect the session pool of backend. Backends without min and max
+   sessions use the threads and min-threads options. */
+static int ct_connect_backend(struct ct_backend_t *backend)
 {
 	int rc;
 	struct login_t login;
-	int n;
-	int threads_asked = nthreads;
+	uint16_t sessions_asked;
+	uint16_t nsessions;
 
-	sessions = calloc(nthreads, sizeof(struct session_t));
-	if (sessions == NULL) {
-		rc = -errno;
-		CT_ERROR(rc, "malloc failed");
+	if (backend->sessions_max == 0) {
+		backend->sessions_max = nthreads;
+		backend->sessions_min = nthreads_min;
+	}
+	if (backend->sessions_min == 0 ||
+	    backend->sessions_min > backend->sessions_max)
+		backend->sessions_min = backend->sessions_max;
+	sessions_asked = backend->sessions_max;
+
+	memset(&login, 0, sizeof(login));
+	login_init(&login, backend->servername,
+		   backend->node, backend->password,
+		   opt.o_owner, LINUX_PLATFORM,
+		   backend->fsname, DEFAULT_FSTYPE);
+
+	if (opt.o_enable_maxmpc) {
+		uint16_t nmountp;
+		dsBool_t limited;
+
+		maxmp_probe = backend;
+		rc = tsm_mountp_cache_load(backend->servername, backend->node,
+					   MOUNTP_CACHE_TTL, &nmountp,
+					   &limited);
+		if (!rc && (limited || backend->sessions_max <= nmountp)) {
+			CT_MESSAGE("using cached number of mount points %d%s",
+				   nmountp, limited ? " (MAXNUMMP)" : "");
+			if (limited && backend->sessions_max > nmountp) {
+				backend->sessions_max = nmountp;
+				backend->sessions_min = MIN(backend->sessions_min,
+							    nmountp);
+			}
+			maxmp_probe = NULL;
+		}
+	}
+
+	/* Without mount point probe start with the minimum number of
+	   sessions and grow them on demand. */
+	nsessions = maxmp_probe ? backend->sessions_max :
+		backend->sessions_min;
+	rc = spool_init(&backend->spool, &login, nsessions, ct_setup_session);
+	backend->spool_ready = true;
+	if (maxmp_probe) {
+		/* Reconnected sessions are not probed again. */
+		maxmp_probe = NULL;
+		if (!rc) {
+			struct session_t *session;
+
+			session = spool_checkout(&backend->spool);
+			if (session) {
+				if (tsm_delete_mountp_probes(backend->fsname,
+							     session))
+					CT_WARN("tsm_delete_mountp_probes failed");
+				spool_checkin(&backend->spool, session);
+			}
+			tsm_mountp_cache_store(backend->servername,
+					       backend->node,
+					       spool_size(&backend->spool),
+					       backend->maxmp_exceeded ?
+					       bTrue : bFalse);
+		}
+	}
+	if (backend->maxmp_exceeded) {
+		if (opt.o_abort_on_err) {
+			/* exit and clean sessions */
+			rc = ECONNREFUSED;
+			CT_ERROR(rc, "Check TSM `MAXNUMMP` setting for the node"
+				 " '%s' (Maximum Mount Points Allowed). "
+				 "Aborting...", backend->node);
+			return rc;
+		}
+		CT_WARN("Check TSM `MAXNUMMP` setting for the node '%s'"
+			" (Maximum Mount Points Allowed)", backend->node);
+	}
+
+	if (rc) {
+		CT_WARN("tsm_query_session failed");
 		return rc;
 	}
 
+	/* One worker thread per session, don't attempt to create more. */
+	if (spool_size(&backend->spool) < nsessions) {
+		backend->sessions_max = spool_size(&backend->spool);
+		backend->sessions_min = MIN(backend->sessions_min,
+					    backend->sessions_max);
+	}
+	if (sessions_asked != backend->sessions_max)
+		CT_WARN("Created %d out of %d sessions for node '%s'!",
+			backend->sessions_max, sessions_asked, backend->node);
+
+	backend->nsessions = backend->sessions_min;
+	if (spool_size(&backend->spool) > backend->nsessions)
+		spool_resize(&backend->spool, backend->nsessions);
+
+	return 0;
+}
+
+static int ct_connect_sessions(void)
+{
+	int rc;
+	uint16_t threads = 0;
+	uint16_t threads_min = 0;
+
 	rc = tsm_init(DSM_MULTITHREAD);
 	if (rc) {
 		rc = -ECANCELED;
@@ -1016,104 +2327,77 @@ static int ct_connect_sessions(void)
 		return rc;
 	}
 
-	memset(&login, 0, sizeof(login));
-	login_init(&login, opt.o_servername,
-		   opt.o_node, opt.o_password,
-		   opt.o_owner, LINUX_PLATFORM,
-		   opt.o_fsname, DEFAULT_FSTYPE);
-
-	for (n = 0; n < nthreads; n++) {
-		sessions[n].progress = progress_callback;
-		CT_MESSAGE("tsm_init: session: %d", n + 1);
+	CT_DEBUG("Abort on error %d", opt.o_abort_on_err);
 
-		rc = tsm_connect(&login, &sessions[n]);
-		if (rc) {
-			CT_ERROR(rc, "tsm_init failed");
-			nthreads = n; // Don't attempt to create more threads.
-			rc = 0;
-			break;
-		}
+	for (int id = 0; id <= (int)LL_HSM_ORIGIN_MAX_ARCHIVE; id++) {
+		struct ct_backend_t *backend = &backends[id];
 
-		if (!opt.o_enable_maxmpc)
+		if (!backend->configured)
 			continue;
 
-		/* Find maximum number of allowed mountpoints (alias the number
-		   of maxium threads) by sending DSM_OBJ_DIRECTORY and verifying
-		   whether transaction was successful. If rc is ECONNREFUSED,
-		   then number of threads > maximum number of allowed
-		   mountpoints, and the current number of threads have to be
-		   decreased. */
-		rc = tsm_check_free_mountp(opt.o_fsname, &sessions[n]);
+		rc = ct_connect_backend(backend);
 		if (rc) {
-			tsm_disconnect(&sessions[n]);
-			nthreads = n; // don't attempt to create more threads
-			if (rc == ECONNREFUSED) {
-				if (opt.o_abort_on_err) {
-					/* exit and clean sessions */
-					CT_ERROR(rc, "Check TSM `MAXNUMMP` setting for the node"
-					" (Maximum Mount Points Allowed). Aborting...");
-					goto fail;
-				} else {
-					CT_WARN("Check TSM `MAXNUMMP` setting for the node"
-					" (Maximum Mount Points Allowed)");
-				}
-			}
-			rc = 0;
-			break;
+			CT_ERROR(rc, "connecting sessions of archive-id %d "
+				 "node '%s' failed", id, backend->node);
+			return rc;
 		}
+		threads += backend->sessions_max;
+		threads_min += backend->sessions_min;
 	}
 
-	CT_DEBUG("Abort on error %d", opt.o_abort_on_err);
-
-	if (nthreads == 0) {
-		CT_WARN("tsm_query_session failed");
-		return -EACCES;
-	}
+	/* Workers are shared among backends, thus one worker per session
+	   of all backends. */
+	nthreads = threads;
+	nthreads_min = threads_min;
+	nworkers_max = nthreads;
+	nworkers_target = nthreads_min;
 
-	if (threads_asked != nthreads)
-		CT_WARN("Created %d out of %d threads!", nthreads, threads_asked);
-fail:
-	return rc;
+	return 0;
 }
 
 static int ct_start_threads(void)
 {
 	int rc;
-	uint16_t n;
-	pthread_attr_t attr;
-	char thread_name[32];
 
-	threads = calloc(nthreads, sizeof(pthread_t));
-	if (threads == NULL) {
+	workers = calloc(nthreads, sizeof(struct worker_t));
+	if (workers == NULL) {
 		rc = -errno;
 		CT_ERROR(rc, "malloc failed");
 		return rc;
 	}
 
-	rc = pthread_attr_init(&attr);
-	if (rc != 0) {
-		CT_ERROR(rc, "pthread_attr_init failed");
-		goto cleanup;
-	}
-
-	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
-
-	for (n = 0; n < nthreads; n++) {
-		rc = pthread_create(&threads[n], &attr, ct_thread, &sessions[n]);
-		if (rc != 0)
-			CT_ERROR(rc, "cannot create worker thread '%d' for"
-				 "'%s'", n, opt.o_mnt);
+	pthread_mutex_lock(&queue_mutex);
+	rc = ct_start_workers();
+	pthread_mutex_unlock(&queue_mutex);
+	if (rc)
+		return rc;
 
-		sprintf(thread_name, "lhsmtool_tsm/%d", n);
-		pthread_setname_np(threads[n], thread_name);
+	if (nthreads_min < nworkers_max) {
+		CT_MESSAGE("adaptive scaling of threads between %d and %d",
+			   nthreads_min, nworkers_max);
+		rc = pthread_create(&scale_thread, NULL, ct_scaler, NULL);
+		if (rc != 0) {
+			CT_ERROR(rc, "cannot create scaling thread");
+			return rc;
+		}
+		scale_started = true;
+		pthread_setname_np(scale_thread, "lhsmtool_tsm/sc");
 	}
-	pthread_attr_destroy(&attr);
-
-	return rc;
 
-cleanup:
-	free(threads);
-	threads = NULL;
+	if (opt.o_metrics_socket[0]) {
+		rc = ct_metrics_listen();
+		if (rc)
+			return rc;
+	}
+	if (opt.o_metrics_file[0] || metrics_sock >= 0) {
+		rc = pthread_create(&metrics_thread, NULL, ct_metrics, NULL);
+		if (rc != 0) {
+			CT_ERROR(rc, "cannot create metrics thread");
+			return rc;
+		}
+		metrics_started = true;
+		pthread_setname_np(metrics_thread, "lhsmtool_tsm/mx");
+	}
 
 	return rc;
 }
@@ -1141,11 +2425,32 @@ static int ct_setup(void)
 		set_restore_stripe(true);
 		CT_MESSAGE("stripe information will be restored");
 	}
+	if (restore_direct_bytes > 0) {
+		set_restore_direct(restore_direct_bytes);
+		CT_MESSAGE("objects of at least %lu bytes will be restored "
+			   "with O_DIRECT", (unsigned long)restore_direct_bytes);
+	}
+	if (compress_codec != COMPRESS_NONE)
+		CT_MESSAGE("archived files will be compressed with %s",
+			   compress_name(compress_codec));
 
 	sem_init(&queue_sem, 0, QUEUE_MAX_ITEMS);
 	pthread_mutex_init(&queue_mutex, NULL);
 	pthread_cond_init(&queue_cond, NULL);
-	queue_init(&queue, free);
+	queue_init(&queue, NULL);
+	rc = slab_init(&item_slab, sizeof(struct ct_item_t), CT_ITEMS_PER_SLAB);
+	if (rc) {
+		CT_ERROR(rc, "slab_init failed");
+		return rc;
+	}
+	if (fid_cache_size > 0) {
+		rc = lru_init(&fid_cache, fid_cache_size);
+		if (rc) {
+			CT_ERROR(rc, "lru_init failed");
+			return rc;
+		}
+		fid_cache_ready = true;
+	}
 
 	/* Create nthreads sessions to TSM server. */
 	rc = ct_connect_sessions();
@@ -1177,20 +2482,34 @@ static void ct_cleanup(void)
 	sem_destroy(&queue_sem);
 	pthread_mutex_destroy(&queue_mutex);
 	pthread_cond_destroy(&queue_cond);
+	slab_destroy(&item_slab);
+	if (fid_cache_ready) {
+		lru_destroy(&fid_cache);
+		fid_cache_ready = false;
+	}
 
-	for (int n = 0; n < nthreads && sessions && threads; n++)
-		tsm_disconnect(&sessions[n]);
-
-	if (sessions) {
-		free(sessions);
-		sessions = NULL;
+	for (int id = 0; id <= (int)LL_HSM_ORIGIN_MAX_ARCHIVE; id++) {
+		if (backends[id].spool_ready) {
+			spool_destroy(&backends[id].spool);
+			backends[id].spool_ready = false;
+		}
 	}
-	if (threads) {
-		free(threads);
-		threads = NULL;
+	if (workers) {
+		free(workers);
+		workers = NULL;
+	}
+	if (metrics_sock >= 0) {
+		close(metrics_sock);
+		metrics_sock = -1;
+		ct_metrics_unlink();
 	}
 
 	tsm_cleanup(DSM_MULTITHREAD);
+
+	if (alog_dropped())
+		CT_WARN("asynchronous logger dropped %" PRIu64 " messages",
+			alog_dropped());
+	alog_stop();
 }
 
 static void atexit_unregister(void)
@@ -1228,6 +2547,15 @@ static void handler_int_term(int signal)
 	CT_DEBUG("Interrupt handler: process state: %d", proc_state);
 }
 
+/* SIGUSR1 requests a trace dump, which is written by the main thread. */
+static void handler_usr1(int signal)
+{
+	trace_dump_pending = 1;
+
+	if (pthread_self() != main_thread)
+		pthread_kill(main_thread, signal);
+}
+
 
 int main(int argc, char *argv[])
 {
@@ -1254,12 +2582,30 @@ int main(int argc, char *argv[])
 		return -rc;
 	}
 
+	if (opt.o_trace_file[0]) {
+		struct sigaction trace_sigaction;
+
+		trace_sigaction.sa_handler = handler_usr1;
+		trace_sigaction.sa_flags = 0;
+		sigemptyset(&trace_sigaction.sa_mask);
+		sigaction(SIGUSR1, &trace_sigaction, NULL);
+		trace_enable(TRACE_NUM_EVENTS);
+	}
+
+	if (!opt.o_daemonize) {
+		rc = ct_log_start();
+		if (rc)
+			return -rc;
+	}
+
 	rc = ct_setup();
 	if (rc)
 		goto error_cleanup;
 
 	rc = ct_run();
 	CT_MESSAGE("process finished, rc=%d (%s)", rc, strerror(-rc));
+	if (opt.o_trace_file[0])
+		ct_trace_dump();
 
 error_cleanup:
 	ct_cleanup();
@@ -0,0 +1,356 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Copyright (c) 2026, GSI Helmholtz Centre for Heavy Ion Research
+ */
+
+/*
+ * Asynchronous logger. Each logging thread formats its records into a
+ * thread owned single-producer single-consumer ring, a writer thread
+ * drains all rings and writes the records to stderr or to a file which
+ * is rotated when exceeding a maximum size. When a ring is full the record
+ * is dropped and counted instead of blocking the logging thread.
+ *
+ * Rings are never freed while the process is running, rings of exited
+ * threads are reused by new threads.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <linux/limits.h>
+#include "alog.h"
+#include "common.h"
+
+#define ALOG_BATCH	64	/* Records written with a single write. */
+
+struct alog_ring_t {
+	char rec[ALOG_RING_SLOTS][ALOG_RECORD_LEN];
+	uint16_t len[ALOG_RING_SLOTS];
+	uint32_t head;		/* Written by logging thread. */
+	uint32_t tail;		/* Written by writer thread. */
+	uint64_t dropped;
+	int owned;
+	struct alog_ring_t *next;
+};
+
+static struct alog_ring_t *rings = NULL;
+static __thread struct alog_ring_t *ring_self = NULL;
+static pthread_key_t ring_key;
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+
+static pthread_t writer;
+static int running = 0;
+static uint64_t dropped_total = 0;
+
+static int fd = STDERR_FILENO;
+static char path[PATH_MAX + 1] = {0};
+static size_t sink_max_size;
+static uint16_t sink_max_files;
+static size_t cur_size;
+
+static api_log_callback_t old_error_callback;
+static api_log_callback_t old_info_callback;
+
+static void ring_release(void *data)
+{
+	struct alog_ring_t *ring = data;
+
+	__atomic_store_n(&ring->owned, 0, __ATOMIC_RELEASE);
+}
+
+static void ring_key_create(void)
+{
+	pthread_key_create(&ring_key, ring_release);
+}
+
+static struct alog_ring_t *ring_get(void)
+{
+	struct alog_ring_t *ring;
+
+	if (ring_self)
+		return ring_self;
+
+	/* Reuse ring of an exited thread. */
+	for (ring = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); ring;
+	     ring = ring->next) {
+		int expected = 0;
+
+		if (__atomic_compare_exchange_n(&ring->owned, &expected, 1,
+						false, __ATOMIC_ACQUIRE,
+						__ATOMIC_RELAXED))
+			goto out;
+	}
+
+	ring = calloc(1, sizeof(struct alog_ring_t));
+	if (!ring)
+		return NULL;
+	ring->owned = 1;
+	ring->next = __atomic_load_n(&rings, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(&rings, &ring->next, ring, false,
+					    __ATOMIC_RELEASE,
+					    __ATOMIC_RELAXED))
+		;
+out:
+	ring_self = ring;
+	pthread_setspecific(ring_key, ring);
+
+	return ring;
+}
+
+static void alog_callback(enum api_message_level level, int err,
+			  const char *fmt, va_list ap)
+{
+	int len;
+	char *rec;
+	uint32_t head;
+	struct alog_ring_t *ring = ring_get();
+
+	if (!ring) {
+		__atomic_fetch_add(&dropped_total, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	head = ring->head;
+	if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >=
+	    ALOG_RING_SLOTS) {
+		__atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	/* Reserve last byte for trailing newline. */
+	rec = ring->rec[head & (ALOG_RING_SLOTS - 1)];
+	len = vsnprintf(rec, ALOG_RECORD_LEN - 1, fmt, ap);
+	if (len < 0)
+		len = 0;
+	else if (len > ALOG_RECORD_LEN - 2)
+		len = ALOG_RECORD_LEN - 2;
+
+	if (!(level & API_MSG_NO_ERRNO) && err) {
+		char buf[128];
+
+		len += snprintf(rec + len, ALOG_RECORD_LEN - 1 - len,
+				": %s (%d)",
+				strerror_r(err, buf, sizeof(buf)), err);
+		if (len > ALOG_RECORD_LEN - 2)
+			len = ALOG_RECORD_LEN - 2;
+	}
+	rec[len++] = '\n';
+	ring->len[head & (ALOG_RING_SLOTS - 1)] = len;
+
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+static void alog_rotate(void)
+{
+	char src[PATH_MAX + 8];
+	char dst[PATH_MAX + 8];
+
+	close(fd);
+	for (uint16_t n = sink_max_files; n > 1; n--) {
+		snprintf(src, sizeof(src), "%s.%u", path, n - 1);
+		snprintf(dst, sizeof(dst), "%s.%u", path, n);
+		rename(src, dst);
+	}
+	if (sink_max_files > 0) {
+		snprintf(dst, sizeof(dst), "%s.1", path);
+		rename(path, dst);
+	}
+
+	fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+	if (fd < 0)
+		fd = STDERR_FILENO;
+	cur_size = 0;
+}
+
+static bool alog_exceeds(const size_t len)
+{
+	return path[0] && sink_max_size && fd != STDERR_FILENO &&
+		cur_size + len > sink_max_size;
+}
+
+static void alog_write(const char *buf, const size_t len)
+{
+	if (len == 0)
+		return;
+
+	write_size(fd, buf, len);
+	cur_size += len;
+}
+
+/* Append record to buf, flush buf and rotate file when the record does not
+   fit into buf or into the current log file. */
+static size_t alog_append(char *buf, size_t len, const char *rec,
+			  const size_t rec_len)
+{
+	if (len + rec_len > ALOG_BATCH * ALOG_RECORD_LEN ||
+	    alog_exceeds(len + rec_len)) {
+		alog_write(buf, len);
+		len = 0;
+		if (cur_size > 0 && alog_exceeds(rec_len))
+			alog_rotate();
+	}
+	memcpy(buf + len, rec, rec_len);
+
+	return len + rec_len;
+}
+
+static size_t alog_drain(void)
+{
+	static char buf[ALOG_BATCH * ALOG_RECORD_LEN];
+	size_t len = 0;
+	size_t nrec = 0;
+
+	for (struct alog_ring_t *ring = __atomic_load_n(&rings,
+							__ATOMIC_ACQUIRE);
+	     ring; ring = ring->next) {
+		uint32_t tail = ring->tail;
+		const uint32_t head = __atomic_load_n(&ring->head,
+						      __ATOMIC_ACQUIRE);
+		uint64_t dropped;
+
+		for (; tail != head; tail++, nrec++) {
+			const uint32_t idx = tail & (ALOG_RING_SLOTS - 1);
+
+			len = alog_append(buf, len, ring->rec[idx],
+					  ring->len[idx]);
+		}
+		__atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+
+		dropped = __atomic_exchange_n(&ring->dropped, 0,
+					      __ATOMIC_RELAXED);
+		if (dropped) {
+			char rec[ALOG_RECORD_LEN];
+			int rec_len;
+
+			__atomic_fetch_add(&dropped_total, dropped,
+					   __ATOMIC_RELAXED);
+			rec_len = snprintf(rec, sizeof(rec),
+					   RED "[W] " RESET "%f alog: dropped "
+					   "%lu messages\n", time_now(),
+					   (unsigned long)dropped);
+			len = alog_append(buf, len, rec, rec_len);
+		}
+	}
+	alog_write(buf, len);
+
+	return nrec;
+}
+
+static void *alog_writer(void *data)
+{
+	UNUSED(data);
+
+	while (__atomic_load_n(&running, __ATOMIC_ACQUIRE)) {
+		if (alog_drain() == 0)
+			usleep(ALOG_IDLE_USEC);
+	}
+	alog_drain();
+
+	return NULL;
+}
+
+/**
+ * @brief Install asynchronous logger as error and info callback.
+ *
+ * @param[in] fpath     Log file, if NULL log to stderr.
+ * @param[in] max_size  Rotate log file when exceeding max_size bytes,
+ *                      0 disables rotation.
+ * @param[in] max_files Number of rotated log files fpath.1 ... fpath.N kept.
+ * @return 0 on success, otherwise negative errno.
+ */
+int alog_start(const char *fpath, const size_t max_size,
+	       const uint16_t max_files)
+{
+	int rc;
+
+	if (running)
+		return -EALREADY;
+
+	pthread_once(&ring_key_once, ring_key_create);
+
+	if (fpath) {
+		if (strlen(fpath) > PATH_MAX - 8)
+			return -ENAMETOOLONG;
+		fd = open(fpath, O_WRONLY | O_CREAT | O_APPEND, 0644);
+		if (fd < 0) {
+			rc = -errno;
+			fd = STDERR_FILENO;
+			CT_ERROR(rc, "open '%s'", fpath);
+			return rc;
+		}
+		strncpy(path, fpath, PATH_MAX);
+		cur_size = lseek(fd, 0, SEEK_END);
+	}
+	sink_max_size = max_size;
+	sink_max_files = max_files;
+
+	running = 1;
+	rc = pthread_create(&writer, NULL, alog_writer, NULL);
+	if (rc) {
+		running = 0;
+		CT_ERROR(rc, "pthread_create");
+		if (fd != STDERR_FILENO)
+			close(fd);
+		fd = STDERR_FILENO;
+		path[0] = '\0';
+		return -rc;
+	}
+	pthread_setname_np(writer, "alog");
+
+	old_error_callback = api_error_callback_set(alog_callback);
+	old_info_callback = api_info_callback_set(alog_callback);
+	api_log_serialize(0);
+
+	return 0;
+}
+
+/**
+ * @brief Restore previous callbacks, write pending records and stop writer.
+ */
+void alog_stop(void)
+{
+	if (!running)
+		return;
+
+	api_log_serialize(1);
+	api_error_callback_set(old_error_callback);
+	api_info_callback_set(old_info_callback);
+
+	__atomic_store_n(&running, 0, __ATOMIC_RELEASE);
+	pthread_join(writer, NULL);
+
+	if (fd != STDERR_FILENO)
+		close(fd);
+	fd = STDERR_FILENO;
+	path[0] = '\0';
+}
+
+/**
+ * @brief Number of dropped records since process start.
+ */
+uint64_t alog_dropped(void)
+{
+	return __atomic_load_n(&dropped_total, __ATOMIC_RELAXED);
+}
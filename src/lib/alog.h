@@ -0,0 +1,37 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Copyright (c) 2026, GSI Helmholtz Centre for Heavy Ion Research
+ */
+
+#ifndef ALOG_H
+#define ALOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "log.h"
+
+#define ALOG_RECORD_LEN		512
+#define ALOG_RING_SLOTS		1024	/* Must be power of two. */
+#define ALOG_IDLE_USEC		2000
+#define ALOG_MAX_SIZE		(64 * 1024 * 1024)
+#define ALOG_MAX_FILES		8
+
+int alog_start(const char *fpath, const size_t max_size,
+	       const uint16_t max_files);
+void alog_stop(void);
+uint64_t alog_dropped(void);
+
+#endif /* ALOG_H */
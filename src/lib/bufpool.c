@@ -0,0 +1,330 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Copyright (c) 2026, GSI Helmholtz Centre for Heavy Ion Research
+ */
+
+/*
+ * Pool of equally sized, page aligned data buffers. Buffers are carved
+ * out of huge page sized chunks which are never returned to the system
+ * before the pool is destroyed, thus buffers are reused without malloc,
+ * memset and page faults. Each thread keeps up to BUFPOOL_TCACHE freed
+ * buffers in its own cache, such that the pool mutex is only taken when
+ * the cache runs empty or full.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/param.h>
+#include <sys/syscall.h>
+#include "bufpool.h"
+#include "common.h"
+#include "log.h"
+
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED	1
+#endif
+
+struct bufpool_tcache_t {
+	struct bufpool_t *pool;
+	uint16_t num;
+	void *buf[BUFPOOL_TCACHE];
+};
+
+static struct bufpool_t default_pool;
+static struct bufpool_t *default_pool_ptr = NULL;
+static pthread_once_t default_pool_once = PTHREAD_ONCE_INIT;
+
+static void bufpool_push(struct bufpool_t *pool, void *buf)
+{
+	*(void **)buf = pool->free_list;
+	pool->free_list = buf;
+}
+
+static void *bufpool_pop(struct bufpool_t *pool)
+{
+	void *buf = pool->free_list;
+
+	if (buf)
+		pool->free_list = *(void **)buf;
+
+	return buf;
+}
+
+static void bufpool_tcache_free(void *data)
+{
+	struct bufpool_tcache_t *tcache = data;
+	struct bufpool_t *pool = tcache->pool;
+
+	pthread_mutex_lock(&pool->mutex);
+	while (tcache->num > 0)
+		bufpool_push(pool, tcache->buf[--tcache->num]);
+	pthread_mutex_unlock(&pool->mutex);
+	free(tcache);
+}
+
+static struct bufpool_tcache_t *bufpool_tcache(struct bufpool_t *pool)
+{
+	struct bufpool_tcache_t *tcache;
+
+	tcache = pthread_getspecific(pool->tcache_key);
+	if (tcache)
+		return tcache;
+
+	tcache = calloc(1, sizeof(struct bufpool_tcache_t));
+	if (!tcache)
+		return NULL;
+	tcache->pool = pool;
+	if (pthread_setspecific(pool->tcache_key, tcache)) {
+		free(tcache);
+		return NULL;
+	}
+
+	return tcache;
+}
+
+/* Prefer memory of the NUMA node the calling thread runs on, the kernel
+   falls back to other nodes when the node is exhausted. */
+static void bufpool_numa_local(void *mem, const size_t len)
+{
+#if defined(SYS_getcpu) && defined(SYS_mbind)
+	unsigned int cpu;
+	unsigned int node;
+	unsigned long nodemask;
+
+	if (syscall(SYS_getcpu, &cpu, &node, NULL) ||
+	    node >= sizeof(nodemask) * 8)
+		return;
+	nodemask = 1UL << node;
+	if (syscall(SYS_mbind, mem, len, MPOL_PREFERRED, &nodemask,
+		    sizeof(nodemask) * 8, 0))
+		CT_DEBUG("mbind to NUMA node %u failed: %s", node,
+			 strerror(errno));
+#else
+	(void)mem;
+	(void)len;
+#endif
+}
+
+static int bufpool_grow(struct bufpool_t *pool)
+{
+	struct bufpool_chunk_t *chunk;
+	const size_t align = pool->flags & BUFPOOL_HUGEPAGE ?
+		BUFPOOL_HUGEPAGE_SIZE : BUFPOOL_PAGE_SIZE;
+	int rc;
+
+	chunk = malloc(sizeof(struct bufpool_chunk_t));
+	if (!chunk)
+		return -errno;
+	rc = posix_memalign(&chunk->mem, align, pool->chunk_size);
+	if (rc) {
+		free(chunk);
+		return -rc;
+	}
+	if (pool->flags & BUFPOOL_HUGEPAGE)
+		madvise(chunk->mem, pool->chunk_size, MADV_HUGEPAGE);
+	if (pool->flags & BUFPOOL_NUMA)
+		bufpool_numa_local(chunk->mem, pool->chunk_size);
+
+	chunk->next = pool->chunks;
+	pool->chunks = chunk;
+	for (size_t off = 0; off < pool->chunk_size; off += pool->size)
+		bufpool_push(pool, (char *)chunk->mem + off);
+	pool->stats.buffers += pool->chunk_size / pool->size;
+
+	return 0;
+}
+
+/**
+ * @brief Initialize pool of buffers.
+ *
+ * @param[out] pool  Pool to initialize.
+ * @param[in]  size  Bytes per buffer, rounded up to page size.
+ * @param[in]  flags BUFPOOL_HUGEPAGE, BUFPOOL_NUMA or 0.
+ * @return 0 on success, otherwise negative errno.
+ */
+int bufpool_init(struct bufpool_t *pool, const size_t size,
+		 const uint32_t flags)
+{
+	int rc;
+
+	if (size == 0)
+		return -EINVAL;
+
+	memset(pool, 0, sizeof(struct bufpool_t));
+	pool->size = roundup(size, BUFPOOL_PAGE_SIZE);
+	pool->chunk_size = pool->size * MAX(1, BUFPOOL_HUGEPAGE_SIZE /
+					    pool->size);
+	pool->flags = flags;
+	rc = -pthread_key_create(&pool->tcache_key, bufpool_tcache_free);
+	if (rc) {
+		CT_ERROR(rc, "pthread_key_create");
+		return rc;
+	}
+	pthread_mutex_init(&pool->mutex, NULL);
+
+	return 0;
+}
+
+/**
+ * @brief Free all buffers, no other thread must use the pool anymore.
+ *
+ * @param[in] pool Pool to destroy.
+ */
+void bufpool_destroy(struct bufpool_t *pool)
+{
+	struct bufpool_tcache_t *tcache;
+	struct bufpool_chunk_t *chunk;
+
+	tcache = pthread_getspecific(pool->tcache_key);
+	free(tcache);
+	pthread_key_delete(pool->tcache_key);
+
+	while (pool->chunks) {
+		chunk = pool->chunks;
+		pool->chunks = chunk->next;
+		free(chunk->mem);
+		free(chunk);
+	}
+	pool->free_list = NULL;
+	pthread_mutex_destroy(&pool->mutex);
+}
+
+/**
+ * @brief Get buffer of pool->size bytes, content is undefined.
+ *
+ * @param[in] pool Pool.
+ * @return Page aligned buffer, NULL if no memory is available.
+ */
+void *bufpool_get(struct bufpool_t *pool)
+{
+	struct bufpool_tcache_t *tcache;
+	void *buf = NULL;
+	uint64_t in_use;
+	uint64_t peak;
+	bool reuse = true;
+
+	if (!pool) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	tcache = bufpool_tcache(pool);
+	if (tcache && tcache->num > 0)
+		buf = tcache->buf[--tcache->num];
+	else {
+		pthread_mutex_lock(&pool->mutex);
+		if (!pool->free_list) {
+			int rc = bufpool_grow(pool);
+
+			if (rc) {
+				pthread_mutex_unlock(&pool->mutex);
+				CT_ERROR(rc, "bufpool_grow");
+				errno = -rc;
+				return NULL;
+			}
+			reuse = false;
+		}
+		buf = bufpool_pop(pool);
+		/* Refill half of the thread cache at once. */
+		while (tcache && pool->free_list &&
+		       tcache->num < BUFPOOL_TCACHE / 2)
+			tcache->buf[tcache->num++] = bufpool_pop(pool);
+		pthread_mutex_unlock(&pool->mutex);
+	}
+
+	__atomic_add_fetch(&pool->stats.gets, 1, __ATOMIC_RELAXED);
+	if (reuse)
+		__atomic_add_fetch(&pool->stats.reuses, 1, __ATOMIC_RELAXED);
+	in_use = __atomic_add_fetch(&pool->stats.in_use, 1, __ATOMIC_RELAXED);
+	peak = __atomic_load_n(&pool->stats.peak, __ATOMIC_RELAXED);
+	while (in_use > peak &&
+	       !__atomic_compare_exchange_n(&pool->stats.peak, &peak, in_use,
+					    false, __ATOMIC_RELAXED,
+					    __ATOMIC_RELAXED))
+		;
+
+	return buf;
+}
+
+/**
+ * @brief Put buffer back to pool.
+ *
+ * @param[in] pool Pool the buffer was taken from.
+ * @param[in] buf  Buffer returned by bufpool_get or NULL.
+ */
+void bufpool_put(struct bufpool_t *pool, void *buf)
+{
+	struct bufpool_tcache_t *tcache;
+
+	if (!pool || !buf)
+		return;
+
+	__atomic_sub_fetch(&pool->stats.in_use, 1, __ATOMIC_RELAXED);
+	tcache = bufpool_tcache(pool);
+	if (tcache && tcache->num < BUFPOOL_TCACHE) {
+		tcache->buf[tcache->num++] = buf;
+		return;
+	}
+	pthread_mutex_lock(&pool->mutex);
+	bufpool_push(pool, buf);
+	pthread_mutex_unlock(&pool->mutex);
+}
+
+/**
+ * @brief Get usage statistics of pool.
+ *
+ * @param[in]  pool  Pool.
+ * @param[out] stats Statistics.
+ */
+void bufpool_stats(struct bufpool_t *pool, struct bufpool_stats_t *stats)
+{
+	stats->gets = __atomic_load_n(&pool->stats.gets, __ATOMIC_RELAXED);
+	stats->reuses = __atomic_load_n(&pool->stats.reuses,
+					__ATOMIC_RELAXED);
+	stats->in_use = __atomic_load_n(&pool->stats.in_use,
+					__ATOMIC_RELAXED);
+	stats->peak = __atomic_load_n(&pool->stats.peak, __ATOMIC_RELAXED);
+	pthread_mutex_lock(&pool->mutex);
+	stats->buffers = pool->stats.buffers;
+	pthread_mutex_unlock(&pool->mutex);
+}
+
+static void bufpool_default_init(void)
+{
+	if (bufpool_init(&default_pool, TSM_BUF_LENGTH,
+			 BUFPOOL_HUGEPAGE | BUFPOOL_NUMA) == 0)
+		default_pool_ptr = &default_pool;
+}
+
+/**
+ * @brief Pool of TSM_BUF_LENGTH buffers shared by all data paths.
+ *
+ * @return Pool, NULL if it cannot be initialized.
+ */
+struct bufpool_t *bufpool_default(void)
+{
+	pthread_once(&default_pool_once, bufpool_default_init);
+
+	return default_pool_ptr;
+}
@@ -0,0 +1,69 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Copyright (c) 2026, GSI Helmholtz Centre for Heavy Ion Research
+ */
+
+#ifndef BUFPOOL_H
+#define BUFPOOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#define BUFPOOL_PAGE_SIZE	4096
+#define BUFPOOL_HUGEPAGE_SIZE	(2UL << 20)	/* 2 MiB. */
+/* Buffers kept per thread before they are returned to the pool. */
+#define BUFPOOL_TCACHE		8
+
+/* Flags of bufpool_init. */
+#define BUFPOOL_HUGEPAGE	0x1	/* Back buffers by transparent huge
+					   pages. */
+#define BUFPOOL_NUMA		0x2	/* Prefer memory of the NUMA node
+					   the allocating thread runs on. */
+
+struct bufpool_chunk_t {
+	void *mem;
+	struct bufpool_chunk_t *next;
+};
+
+struct bufpool_stats_t {
+	uint64_t gets;		/* Buffers handed out. */
+	uint64_t reuses;	/* Of them served without allocation. */
+	uint64_t buffers;	/* Allocated buffers. */
+	uint64_t in_use;	/* Buffers not yet put back. */
+	uint64_t peak;		/* Maximum of in_use. */
+};
+
+struct bufpool_t {
+	size_t size;		/* Bytes per buffer, multiple of page size. */
+	size_t chunk_size;	/* Bytes allocated at once. */
+	uint32_t flags;
+	void *free_list;	/* Linked through the first bytes. */
+	struct bufpool_chunk_t *chunks;
+	pthread_key_t tcache_key;
+	struct bufpool_stats_t stats;
+	pthread_mutex_t mutex;
+};
+
+int bufpool_init(struct bufpool_t *pool, const size_t size,
+		 const uint32_t flags);
+void bufpool_destroy(struct bufpool_t *pool);
+void *bufpool_get(struct bufpool_t *pool);
+void bufpool_put(struct bufpool_t *pool, void *buf);
+void bufpool_stats(struct bufpool_t *pool, struct bufpool_stats_t *stats);
+struct bufpool_t *bufpool_default(void);
+
+#endif /* BUFPOOL_H */
@@ -17,6 +17,7 @@
  */
 
 #include "common.h"
+#include "bufpool.h"
 
 static int parse_line(char *line, struct kv_opt *kv_opt)
 {
@@ -152,12 +153,21 @@ int crc32file(const char *filename, uint32_t *crc32result)
 	FILE *file;
 	size_t cur_read;
 	uint32_t crc32sum = 0;
-	unsigned char buf[TSM_BUF_LENGTH] = {0};
+	unsigned char *buf;
+
+	buf = bufpool_get(bufpool_default());
+	if (!buf) {
+		rc = -ENOMEM;
+		CT_ERROR(rc, "bufpool_get");
+
+		return rc;
+	}
 
 	file = fopen(filename, "r");
 	if (file == NULL) {
 		rc = -errno;
 		CT_ERROR(rc, "fopen failed on '%s'", filename);
+		bufpool_put(bufpool_default(), buf);
 
 		return rc;
 	}
@@ -174,6 +184,8 @@ int crc32file(const char *filename, uint32_t *crc32result)
 
 	} while (!feof(file));
 
+	bufpool_put(bufpool_default(), buf);
+
 	int rc_minor;
 
 	rc_minor = fclose(file);
@@ -0,0 +1,607 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Copyright (c) 2026, GSI Helmholtz Centre for Heavy Ion Research
+ */
+
+/*
+ * Block wise compression of archived data. The data stream is split into
+ * blocks of COMPRESS_BLOCK bytes, which are compressed independently by
+ * a pool of worker threads while the submitting thread reads the next
+ * blocks and sends finished frames. Jobs form a ring, frames are thus
+ * handed back in submission order. Decompression consumes the frames in
+ * pieces of arbitrary size as delivered by dsmGetData.
+ */
+
+#if HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <limits.h>
+#include <zlib.h>
+#include <sys/param.h>
+#include "compress.h"
+#include "bufpool.h"
+#include "log.h"
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+
+static const char *codec_names[] = {"none", "zlib", "zstd", "lz4"};
+
+/**
+ * @brief Whether codec is compiled in.
+ *
+ * @param[in] codec COMPRESS_* codec.
+ * @return true if data can be compressed and decompressed with codec.
+ */
+bool compress_supported(const uint32_t codec)
+{
+	switch (codec) {
+	case COMPRESS_NONE:
+	case COMPRESS_ZLIB:
+		return true;
+#ifdef HAVE_ZSTD
+	case COMPRESS_ZSTD:
+		return true;
+#endif
+#ifdef HAVE_LZ4
+	case COMPRESS_LZ4:
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+const char *compress_name(const uint32_t codec)
+{
+	if (codec < sizeof(codec_names) / sizeof(codec_names[0]))
+		return codec_names[codec];
+
+	return "unknown";
+}
+
+/**
+ * @brief Parse codec name and optional level, e.g. zstd:3.
+ *
+ * @param[in]  arg   Codec name followed by optional :level.
+ * @param[out] codec COMPRESS_* codec.
+ * @param[out] level Compression level, 0 selects the codec default.
+ * @return 0 on success, -EINVAL on unknown name or invalid level,
+ *         -EOPNOTSUPP if codec is not compiled in.
+ */
+int compress_parse(const char *arg, uint32_t *codec, int *level)
+{
+	const char *colon = strchr(arg, ':');
+	const size_t len = colon ? (size_t)(colon - arg) : strlen(arg);
+	long val = 0;
+
+	if (colon) {
+		char *end = NULL;
+
+		errno = 0;
+		val = strtol(colon + 1, &end, 10);
+		if (errno || end == colon + 1 || *end != '\0' ||
+		    val < 0 || val > INT_MAX)
+			return -EINVAL;
+	}
+
+	for (uint32_t c = 0; c < sizeof(codec_names) /
+		     sizeof(codec_names[0]); c++) {
+		if (strlen(codec_names[c]) == len &&
+		    !strncasecmp(arg, codec_names[c], len)) {
+			if (!compress_supported(c))
+				return -EOPNOTSUPP;
+			*codec = c;
+			*level = (int)val;
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
+
+static void *cctx_create(const uint32_t codec)
+{
+#ifdef HAVE_ZSTD
+	if (codec == COMPRESS_ZSTD)
+		return ZSTD_createCCtx();
+#endif
+	(void)codec;
+
+	return NULL;
+}
+
+static void cctx_free(const uint32_t codec, void *cctx)
+{
+#ifdef HAVE_ZSTD
+	if (codec == COMPRESS_ZSTD)
+		ZSTD_freeCCtx(cctx);
+#endif
+	(void)codec;
+	(void)cctx;
+}
+
+/**
+ * @brief Compress data of job into a frame.
+ *
+ * Payload is limited to less than job->len bytes, data which does not
+ * shrink is stored uncompressed.
+ *
+ * @return 0 on success, otherwise negative errno.
+ */
+static int compress_frame(const uint32_t codec, const int level, void *cctx,
+			  struct compress_job_t *job)
+{
+	struct compress_frame_t *hdr = (struct compress_frame_t *)job->frame;
+	char *payload = job->frame + sizeof(struct compress_frame_t);
+	size_t len = 0;
+
+	if (job->len > COMPRESS_BLOCK)
+		return -EINVAL;
+
+	if (job->len > 1) {
+		switch (codec) {
+		case COMPRESS_ZLIB: {
+			uLongf dest_len = job->len - 1;
+
+			if (compress2((Bytef *)payload, &dest_len,
+				      (const Bytef *)job->data, job->len,
+				      level > 0 ? MIN(level, 9) : 1) == Z_OK)
+				len = dest_len;
+			break;
+		}
+#ifdef HAVE_ZSTD
+		case COMPRESS_ZSTD: {
+			size_t rc;
+
+			rc = ZSTD_compressCCtx(cctx, payload, job->len - 1,
+					       job->data, job->len,
+					       level > 0 ? level :
+					       ZSTD_CLEVEL_DEFAULT);
+			if (!ZSTD_isError(rc))
+				len = rc;
+			break;
+		}
+#endif
+#ifdef HAVE_LZ4
+		case COMPRESS_LZ4: {
+			int rc;
+
+			rc = LZ4_compress_fast(job->data, payload, job->len,
+					       job->len - 1,
+					       level > 0 ? level : 1);
+			if (rc > 0)
+				len = rc;
+			break;
+		}
+#endif
+		default:
+			return -EOPNOTSUPP;
+		}
+	}
+	(void)cctx;
+
+	/* Incompressible, store as is. */
+	if (len == 0) {
+		memcpy(payload, job->data, job->len);
+		len = job->len;
+	}
+	hdr->len = len;
+	hdr->raw_len = job->len;
+	job->frame_len = sizeof(struct compress_frame_t) + len;
+
+	return 0;
+}
+
+static void *compress_worker(void *arg)
+{
+	struct compress_t *compress = arg;
+	struct compress_job_t *job;
+	void *cctx;
+
+	cctx = cctx_create(compress->codec);
+	pthread_mutex_lock(&compress->mutex);
+	for (;;) {
+		job = NULL;
+		/* Oldest pending job first, it is sent next. */
+		for (uint16_t n = 0; n < compress->count && !job; n++) {
+			struct compress_job_t *j = &compress->job[
+				(compress->tail + n) % compress->depth];
+
+			if (j->state == COMPRESS_PENDING)
+				job = j;
+		}
+		if (!job) {
+			if (compress->stop)
+				break;
+			pthread_cond_wait(&compress->cond_work,
+					  &compress->mutex);
+			continue;
+		}
+		job->state = COMPRESS_BUSY;
+		pthread_mutex_unlock(&compress->mutex);
+
+		job->rc = compress_frame(compress->codec, compress->level,
+					 cctx, job);
+
+		pthread_mutex_lock(&compress->mutex);
+		job->state = COMPRESS_DONE;
+		pthread_cond_broadcast(&compress->cond_done);
+	}
+	pthread_mutex_unlock(&compress->mutex);
+	cctx_free(compress->codec, cctx);
+
+	return NULL;
+}
+
+/**
+ * @brief Initialize compression and start worker threads.
+ *
+ * @param[out] compress Compression to initialize.
+ * @param[in]  codec    COMPRESS_* codec other than COMPRESS_NONE.
+ * @param[in]  level    Compression level, 0 selects the codec default.
+ * @param[in]  nthreads Number of worker threads, 0 compresses each block
+ *                      in compress_submit.
+ * @return 0 on success, otherwise negative errno.
+ */
+int compress_init(struct compress_t *compress, const uint32_t codec,
+		  const int level, const uint16_t nthreads)
+{
+	int rc = 0;
+
+	if (codec == COMPRESS_NONE || !compress_supported(codec))
+		return -EOPNOTSUPP;
+
+	memset(compress, 0, sizeof(struct compress_t));
+	compress->codec = codec;
+	compress->level = level;
+	/* Workers compress while the previous frames are sent. */
+	compress->depth = MAX(1, 2 * nthreads);
+	pthread_mutex_init(&compress->mutex, NULL);
+	pthread_cond_init(&compress->cond_work, NULL);
+	pthread_cond_init(&compress->cond_done, NULL);
+
+	compress->job = calloc(compress->depth, sizeof(struct compress_job_t));
+	if (!compress->job) {
+		rc = -ENOMEM;
+		goto cleanup;
+	}
+	for (uint16_t n = 0; n < compress->depth; n++) {
+		compress->job[n].in = bufpool_get(bufpool_default());
+		compress->job[n].frame = malloc(COMPRESS_FRAME_MAX);
+		if (!compress->job[n].in || !compress->job[n].frame) {
+			rc = -ENOMEM;
+			goto cleanup;
+		}
+	}
+
+	if (nthreads == 0) {
+		compress->cctx = cctx_create(codec);
+		return 0;
+	}
+
+	compress->threads = calloc(nthreads, sizeof(pthread_t));
+	if (!compress->threads) {
+		rc = -ENOMEM;
+		goto cleanup;
+	}
+	for (uint16_t n = 0; n < nthreads; n++) {
+		rc = -pthread_create(&compress->threads[n], NULL,
+				     compress_worker, compress);
+		if (rc) {
+			CT_ERROR(rc, "pthread_create");
+			goto cleanup;
+		}
+		compress->nthreads++;
+	}
+
+	return 0;
+
+cleanup:
+	compress_destroy(compress);
+
+	return rc;
+}
+
+/**
+ * @brief Stop worker threads and free all jobs.
+ *
+ * @param[in] compress Compression initialized by compress_init.
+ */
+void compress_destroy(struct compress_t *compress)
+{
+	pthread_mutex_lock(&compress->mutex);
+	compress->stop = true;
+	/* Discard submitted jobs not yet taken by a worker. */
+	for (uint16_t n = 0; compress->job && n < compress->depth; n++)
+		if (compress->job[n].state == COMPRESS_PENDING)
+			compress->job[n].state = COMPRESS_DONE;
+	pthread_cond_broadcast(&compress->cond_work);
+	pthread_mutex_unlock(&compress->mutex);
+
+	for (uint16_t n = 0; n < compress->nthreads; n++)
+		pthread_join(compress->threads[n], NULL);
+	free(compress->threads);
+	compress->threads = NULL;
+	compress->nthreads = 0;
+	cctx_free(compress->codec, compress->cctx);
+	compress->cctx = NULL;
+
+	for (uint16_t n = 0; compress->job && n < compress->depth; n++) {
+		bufpool_put(bufpool_default(), compress->job[n].in);
+		free(compress->job[n].frame);
+	}
+	free(compress->job);
+	compress->job = NULL;
+
+	pthread_cond_destroy(&compress->cond_done);
+	pthread_cond_destroy(&compress->cond_work);
+	pthread_mutex_destroy(&compress->mutex);
+}
+
+/**
+ * @brief Get job to be filled and submitted.
+ *
+ * job->data defaults to job->in and can be pointed to data elsewhere,
+ * which must stay valid until the job is released.
+ *
+ * @param[in] compress Compression.
+ * @return Free job, NULL if all jobs are submitted.
+ */
+struct compress_job_t *compress_job(struct compress_t *compress)
+{
+	struct compress_job_t *job;
+
+	if (compress->count == compress->depth)
+		return NULL;
+
+	job = &compress->job[compress->head];
+	job->data = job->in;
+	job->len = 0;
+	job->frame_len = 0;
+	job->rc = 0;
+
+	return job;
+}
+
+/**
+ * @brief Submit job returned by compress_job.
+ *
+ * @param[in] compress Compression.
+ * @param[in] job      Job with data and len set.
+ */
+void compress_submit(struct compress_t *compress, struct compress_job_t *job)
+{
+	if (compress->nthreads == 0) {
+		job->rc = compress_frame(compress->codec, compress->level,
+					 compress->cctx, job);
+		job->state = COMPRESS_DONE;
+	}
+
+	pthread_mutex_lock(&compress->mutex);
+	if (compress->nthreads > 0) {
+		job->state = COMPRESS_PENDING;
+		pthread_cond_signal(&compress->cond_work);
+	}
+	compress->head = (compress->head + 1) % compress->depth;
+	compress->count++;
+	pthread_mutex_unlock(&compress->mutex);
+}
+
+/**
+ * @brief Wait for the oldest submitted job.
+ *
+ * @param[in] compress Compression.
+ * @return Job with frame or rc set, NULL if no job is submitted.
+ */
+struct compress_job_t *compress_wait(struct compress_t *compress)
+{
+	struct compress_job_t *job;
+
+	if (compress->count == 0)
+		return NULL;
+
+	job = &compress->job[compress->tail];
+	pthread_mutex_lock(&compress->mutex);
+	while (job->state != COMPRESS_DONE)
+		pthread_cond_wait(&compress->cond_done, &compress->mutex);
+	pthread_mutex_unlock(&compress->mutex);
+
+	if (job->rc == 0) {
+		compress->bytes_in += job->len;
+		compress->bytes_out += job->frame_len;
+	}
+
+	return job;
+}
+
+/**
+ * @brief Release job returned by compress_wait for reuse.
+ *
+ * @param[in] compress Compression.
+ */
+void compress_release(struct compress_t *compress)
+{
+	pthread_mutex_lock(&compress->mutex);
+	compress->job[compress->tail].state = COMPRESS_FREE;
+	compress->tail = (compress->tail + 1) % compress->depth;
+	compress->count--;
+	pthread_mutex_unlock(&compress->mutex);
+}
+
+/**
+ * @brief Initialize decompression of a frame sequence.
+ *
+ * @param[out] decompress Decompression to initialize.
+ * @param[in]  codec      COMPRESS_* codec other than COMPRESS_NONE.
+ * @return 0 on success, otherwise negative errno.
+ */
+int decompress_init(struct decompress_t *decompress, const uint32_t codec)
+{
+	memset(decompress, 0, sizeof(struct decompress_t));
+	if (codec == COMPRESS_NONE || !compress_supported(codec))
+		return -EOPNOTSUPP;
+
+	decompress->codec = codec;
+#ifdef HAVE_ZSTD
+	if (codec == COMPRESS_ZSTD) {
+		decompress->dctx = ZSTD_createDCtx();
+		if (!decompress->dctx)
+			return -ENOMEM;
+	}
+#endif
+	/* Both hold at most COMPRESS_BLOCK bytes. Raw data is page aligned
+	   and thus can be written with O_DIRECT. */
+	decompress->payload = bufpool_get(bufpool_default());
+	decompress->raw = bufpool_get(bufpool_default());
+	if (!decompress->payload || !decompress->raw) {
+		decompress_destroy(decompress);
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+void decompress_destroy(struct decompress_t *decompress)
+{
+#ifdef HAVE_ZSTD
+	if (decompress->dctx)
+		ZSTD_freeDCtx(decompress->dctx);
+#endif
+	decompress->dctx = NULL;
+	bufpool_put(bufpool_default(), decompress->payload);
+	bufpool_put(bufpool_default(), decompress->raw);
+	decompress->payload = NULL;
+	decompress->raw = NULL;
+}
+
+static int decompress_frame(struct decompress_t *decompress)
+{
+	const size_t len = decompress->hdr.len;
+	const size_t raw_len = decompress->hdr.raw_len;
+
+	switch (decompress->codec) {
+	case COMPRESS_ZLIB: {
+		uLongf dest_len = raw_len;
+
+		if (uncompress((Bytef *)decompress->raw, &dest_len,
+			       (const Bytef *)decompress->payload,
+			       len) != Z_OK || dest_len != raw_len)
+			return -EINVAL;
+		break;
+	}
+#ifdef HAVE_ZSTD
+	case COMPRESS_ZSTD: {
+		size_t rc;
+
+		rc = ZSTD_decompressDCtx(decompress->dctx, decompress->raw,
+					 raw_len, decompress->payload, len);
+		if (ZSTD_isError(rc) || rc != raw_len)
+			return -EINVAL;
+		break;
+	}
+#endif
+#ifdef HAVE_LZ4
+	case COMPRESS_LZ4: {
+		int rc;
+
+		rc = LZ4_decompress_safe(decompress->payload, decompress->raw,
+					 len, raw_len);
+		if (rc < 0 || (size_t)rc != raw_len)
+			return -EINVAL;
+		break;
+	}
+#endif
+	default:
+		return -EOPNOTSUPP;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Consume compressed data up to the end of the current frame.
+ *
+ * @param[in]  decompress Decompression.
+ * @param[in]  buf        Compressed data.
+ * @param[in]  len        Bytes of compressed data.
+ * @param[out] raw        Uncompressed data of the frame if completed by
+ *                        buf, otherwise NULL. Valid until next call.
+ * @param[out] raw_len    Bytes of uncompressed data.
+ * @return Number of consumed bytes of buf, otherwise negative errno.
+ */
+ssize_t decompress_feed(struct decompress_t *decompress, const char *buf,
+			const size_t len, const char **raw, size_t *raw_len)
+{
+	const size_t hdr_len = sizeof(struct compress_frame_t);
+	size_t n = 0;
+	size_t l;
+	int rc;
+
+	*raw = NULL;
+	*raw_len = 0;
+
+	if (decompress->hdr_pos < hdr_len) {
+		l = MIN(len, hdr_len - decompress->hdr_pos);
+		memcpy((char *)&decompress->hdr + decompress->hdr_pos, buf, l);
+		n += l;
+		decompress->hdr_pos += l;
+		if (decompress->hdr_pos < hdr_len)
+			return n;
+		if (decompress->hdr.raw_len > COMPRESS_BLOCK ||
+		    decompress->hdr.len > decompress->hdr.raw_len)
+			return -EINVAL;
+		decompress->payload_pos = 0;
+	}
+
+	l = MIN(len - n, decompress->hdr.len - decompress->payload_pos);
+	memcpy(decompress->payload + decompress->payload_pos, buf + n, l);
+	n += l;
+	decompress->payload_pos += l;
+	if (decompress->payload_pos < decompress->hdr.len)
+		return n;
+
+	/* Frame is complete. */
+	if (decompress->hdr.len == decompress->hdr.raw_len)
+		*raw = decompress->payload;
+	else {
+		rc = decompress_frame(decompress);
+		if (rc)
+			return rc;
+		*raw = decompress->raw;
+	}
+	*raw_len = decompress->hdr.raw_len;
+	decompress->hdr_pos = 0;
+
+	return n;
+}
+
+/**
+ * @brief Whether all consumed data formed complete frames.
+ */
+bool decompress_idle(const struct decompress_t *decompress)
+{
+	return decompress->hdr_pos == 0;
+}
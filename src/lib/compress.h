@@ -0,0 +1,113 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Copyright (c) 2026, GSI Helmholtz Centre for Heavy Ion Research
+ */
+
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include "common.h"
+
+/* Codecs, stored in obj_info_t (MAGIC_ID_V3). */
+#define COMPRESS_NONE	0
+#define COMPRESS_ZLIB	1
+#define COMPRESS_ZSTD	2
+#define COMPRESS_LZ4	3
+
+/* Bytes of uncompressed data per frame. */
+#define COMPRESS_BLOCK	TSM_BUF_LENGTH
+
+/* Compressed data is a sequence of frames, each header is followed by
+   len bytes of payload. Blocks which do not shrink are stored
+   uncompressed, that is len equals raw_len. */
+struct compress_frame_t {
+	uint32_t len;		/* Bytes of payload. */
+	uint32_t raw_len;	/* Bytes of uncompressed data. */
+};
+
+#define COMPRESS_FRAME_MAX	(sizeof(struct compress_frame_t) + \
+				 COMPRESS_BLOCK)
+
+enum compress_state_t {
+	COMPRESS_FREE	 = 0,	/* Owned by the submitting thread. */
+	COMPRESS_PENDING = 1,	/* Waiting for a worker. */
+	COMPRESS_BUSY	 = 2,	/* Compressed by a worker. */
+	COMPRESS_DONE	 = 3	/* Frame is ready to be sent. */
+};
+
+struct compress_job_t {
+	char *in;		/* Buffer of COMPRESS_BLOCK bytes. */
+	const char *data;	/* Uncompressed data, in or external. */
+	size_t len;		/* Bytes of data. */
+	char *frame;		/* Buffer of COMPRESS_FRAME_MAX bytes. */
+	size_t frame_len;	/* Bytes of header and payload. */
+	int rc;			/* 0 or negative errno. */
+	enum compress_state_t state;
+};
+
+struct compress_t {
+	uint32_t codec;
+	int level;
+	uint16_t nthreads;	/* 0 compresses in compress_submit. */
+	pthread_t *threads;
+	void *cctx;		/* Codec context without worker threads. */
+	uint16_t depth;		/* Number of jobs. */
+	struct compress_job_t *job;
+	uint16_t head;		/* Next job handed to the submitter. */
+	uint16_t tail;		/* Oldest submitted job. */
+	uint16_t count;		/* Submitted jobs not yet released. */
+	uint64_t bytes_in;
+	uint64_t bytes_out;
+	bool stop;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond_work;
+	pthread_cond_t cond_done;
+};
+
+struct decompress_t {
+	uint32_t codec;
+	void *dctx;
+	struct compress_frame_t hdr;
+	size_t hdr_pos;		/* Received bytes of hdr. */
+	char *payload;
+	size_t payload_pos;	/* Received bytes of payload. */
+	char *raw;
+};
+
+bool compress_supported(const uint32_t codec);
+const char *compress_name(const uint32_t codec);
+int compress_parse(const char *arg, uint32_t *codec, int *level);
+
+int compress_init(struct compress_t *compress, const uint32_t codec,
+		  const int level, const uint16_t nthreads);
+void compress_destroy(struct compress_t *compress);
+struct compress_job_t *compress_job(struct compress_t *compress);
+void compress_submit(struct compress_t *compress, struct compress_job_t *job);
+struct compress_job_t *compress_wait(struct compress_t *compress);
+void compress_release(struct compress_t *compress);
+
+int decompress_init(struct decompress_t *decompress, const uint32_t codec);
+void decompress_destroy(struct decompress_t *decompress);
+ssize_t decompress_feed(struct decompress_t *decompress, const char *buf,
+			const size_t len, const char **raw, size_t *raw_len);
+bool decompress_idle(const struct decompress_t *decompress);
+
+#endif /* COMPRESS_H */
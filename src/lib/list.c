@@ -55,6 +55,14 @@ int list_ins_next(list_t *list, list_node_t *node, const void *data)
 		return RC_ERROR;
 
 	new_node->data = (void *)data;
+
+	return list_ins_next_node(list, node, new_node);
+}
+
+/* Insert caller allocated new_node after node, or at the head of the
+   list if node is NULL. */
+int list_ins_next_node(list_t *list, list_node_t *node, list_node_t *new_node)
+{
 	/* Insertation at the head of the list. */
 	if (node == NULL) {
 		if (list_size(list) == 0)
@@ -76,16 +84,31 @@ int list_ins_next(list_t *list, list_node_t *node, const void *data)
 
 int list_rem_next(list_t *list, list_node_t *node, void **data)
 {
+	int rc;
 	list_node_t *old_node;
 
+	rc = list_rem_next_node(list, node, &old_node);
+	if (rc)
+		return rc;
+
+	*data = old_node->data;
+	free(old_node);
+
+	return RC_SUCCESS;
+}
+
+/* Unlink node after node, or the head if node is NULL, without freeing
+   it. */
+int list_rem_next_node(list_t *list, list_node_t *node,
+		       list_node_t **old_node)
+{
 	/* No removal from an empty list. */
 	if (list_size(list) == 0)
 		return RC_ERROR;
 
 	/* Removal from the head of list. */
 	if (node == NULL) {
-		*data = list->head->data;
-		old_node = list->head;
+		*old_node = list->head;
 		list->head = list->head->next;
 		if (list_size(list) == 1)
 			list->tail = NULL;
@@ -93,13 +116,11 @@ int list_rem_next(list_t *list, list_node_t *node, void **data)
 		/* Removal from somewhere other than the head. */
 		if (node->next == NULL)
 			return RC_ERROR;
-		*data = node->next->data;
-		old_node = node->next;
+		*old_node = node->next;
 		node->next = node->next->next;
 		if (node->next == NULL)
 			list->tail = node;
 	}
-	free(old_node);
 	list->size--;
 
 	return RC_SUCCESS;
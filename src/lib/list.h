@@ -58,4 +58,11 @@ int list_ins_next(list_t *list, list_node_t *node, const void *data);
 int list_rem_next(list_t *list, list_node_t *node, void **data);
 void list_for_each(const list_t *list, void (*callback)(void *data));
 
+/* Variants operating on caller allocated nodes, e.g. embedded in the
+   data or taken from a slab. Do not mix with list_ins_next/list_rem_next
+   and list_destroy on the same list, as those free the nodes. */
+int list_ins_next_node(list_t *list, list_node_t *node, list_node_t *new_node);
+int list_rem_next_node(list_t *list, list_node_t *node,
+		       list_node_t **old_node);
+
 #endif
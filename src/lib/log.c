@@ -18,17 +18,42 @@
 
 #include "log.h"
 
-static unsigned int api_msg_level = API_MSG_NORMAL;
-typedef void (*api_log_callback_t)(enum api_message_level level, int err,
-				   const char *fmt, va_list ap);
+unsigned int api_msg_level = API_MSG_NORMAL;
+static int api_log_serialized = 1;
 
-inline double time_now(void)
+static __thread pid_t api_tid = 0;
+static pthread_once_t api_tid_once = PTHREAD_ONCE_INIT;
+
+/* Coarse clock is read without a syscall and its resolution (a few
+   milliseconds) is sufficient for log timestamps. */
+double time_now(void)
 {
-	struct timeval tv;
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+
+	return ts.tv_sec + 0.000000001 * ts.tv_nsec;
+}
 
-	gettimeofday(&tv, NULL);
+static void api_tid_reset(void)
+{
+	/* Child of fork inherits the cached thread id of its parent. */
+	api_tid = 0;
+}
 
-	return tv.tv_sec + 0.000001 * tv.tv_usec;
+static void api_tid_atfork(void)
+{
+	pthread_atfork(NULL, NULL, api_tid_reset);
+}
+
+pid_t api_gettid(void)
+{
+	if (api_tid == 0) {
+		pthread_once(&api_tid_once, api_tid_atfork);
+		api_tid = syscall(SYS_gettid);
+	}
+
+	return api_tid;
 }
 
 int api_msg_get_level(void)
@@ -92,6 +117,13 @@ api_log_callback_t api_info_callback_set(api_log_callback_t cb)
 	return old;
 }
 
+/* Callbacks which are thread-safe on their own (e.g. the asynchronous
+   logger) disable serialization of api_error. */
+void api_log_serialize(const int serialize)
+{
+	api_log_serialized = serialize;
+}
+
 void api_error(enum api_message_level level, int err, const char *fmt, ...)
 {
 	static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -101,6 +133,14 @@ void api_error(enum api_message_level level, int err, const char *fmt, ...)
         if ((level & API_MSG_MASK) > api_msg_level)
                 return;
 
+	if (!api_log_serialized) {
+		va_start(args, fmt);
+		api_error_callback(level, abs(err), fmt, args);
+		va_end(args);
+		errno = tmp_errno;
+		return;
+	}
+
 	pthread_mutex_lock(&log_mutex);
 	va_start(args, fmt);
         api_error_callback(level, abs(err), fmt, args);
@@ -33,6 +33,7 @@
 #include <sys/syscall.h>
 #include <sys/types.h>
 #include <sys/time.h>
+#include <time.h>
 #include <linux/limits.h>
 
 #define LOG_LEVEL_HUMAN_STR(s)		              \
@@ -63,10 +64,23 @@ enum api_message_level {
 	API_MSG_MAX
 };
 
+extern unsigned int api_msg_level;
+
+typedef void (*api_log_callback_t)(enum api_message_level level, int err,
+				   const char *fmt, va_list ap);
+
 int api_msg_get_level(void);
 void api_msg_set_level(int level);
+api_log_callback_t api_error_callback_set(api_log_callback_t cb);
+api_log_callback_t api_info_callback_set(api_log_callback_t cb);
+void api_log_serialize(const int serialize);
 void api_error(enum api_message_level level, int err, const char *fmt, ...);
 double time_now(void);
+pid_t api_gettid(void);
+
+/* Evaluated in the CT_* macros, thus disabled levels neither format
+   arguments nor query time and thread id. */
+#define API_MSG_ENABLED(level)	((unsigned int)(level) <= api_msg_level)
 
 #define NRM  "\x1B[0m"
 #define RED  "\x1B[31m"
@@ -78,34 +92,49 @@ double time_now(void);
 #define WHT  "\x1B[37m"
 #define RESET "\033[0m"
 
-#define CT_ERROR(_rc, _format, ...)				       \
-	api_error(API_MSG_ERROR, _rc,				       \
-		  RED "[E] " RESET "%f [%ld] %s:%d "_format,	       \
-		  time_now(), syscall(SYS_gettid), __FILE__, __LINE__, \
-		  ## __VA_ARGS__)
-
-#define CT_WARN(_format, ...)					       \
-	api_error(API_MSG_WARN | API_MSG_NO_ERRNO, 0,		       \
-		  RED "[W] " RESET "%f [%ld] %s:%d "_format,	       \
-		  time_now(), syscall(SYS_gettid), __FILE__, __LINE__, \
-		  ## __VA_ARGS__)
+#define CT_ERROR(_rc, _format, ...)					\
+do {									\
+	if (API_MSG_ENABLED(API_MSG_ERROR))				\
+		api_error(API_MSG_ERROR, _rc,				\
+			  RED "[E] " RESET "%f [%d] %s:%d "_format,	\
+			  time_now(), api_gettid(), __FILE__, __LINE__,	\
+			  ## __VA_ARGS__);				\
+} while (0)
+
+#define CT_WARN(_format, ...)						\
+do {									\
+	if (API_MSG_ENABLED(API_MSG_WARN))				\
+		api_error(API_MSG_WARN | API_MSG_NO_ERRNO, 0,		\
+			  RED "[W] " RESET "%f [%d] %s:%d "_format,	\
+			  time_now(), api_gettid(), __FILE__, __LINE__,	\
+			  ## __VA_ARGS__);				\
+} while (0)
 
 #define CT_MESSAGE(_format, ...)					\
-	api_error(API_MSG_NORMAL | API_MSG_NO_ERRNO, 0,			\
-		  MAG "[M] " RESET "%f [%ld] %s:%d "_format,		\
-		  time_now(), syscall(SYS_gettid), __FILE__, __LINE__,	\
-		  ## __VA_ARGS__)
-
-#define CT_INFO(_format, ...)					       \
-	api_error(API_MSG_INFO | API_MSG_NO_ERRNO, 0,		       \
-		  YEL "[I] " RESET "%f [%ld] %s:%d "_format,	       \
-		  time_now(), syscall(SYS_gettid), __FILE__, __LINE__, \
-		  ## __VA_ARGS__)
-
-#define CT_DEBUG(_format, ...)					       \
-	api_error(API_MSG_DEBUG | API_MSG_NO_ERRNO, 0,		       \
-		  BLU "[D] " RESET "%f [%ld] %s:%d "_format,	       \
-		  time_now(), syscall(SYS_gettid), __FILE__, __LINE__, \
-		  ## __VA_ARGS__)
+do {									\
+	if (API_MSG_ENABLED(API_MSG_NORMAL))				\
+		api_error(API_MSG_NORMAL | API_MSG_NO_ERRNO, 0,		\
+			  MAG "[M] " RESET "%f [%d] %s:%d "_format,	\
+			  time_now(), api_gettid(), __FILE__, __LINE__,	\
+			  ## __VA_ARGS__);				\
+} while (0)
+
+#define CT_INFO(_format, ...)						\
+do {									\
+	if (API_MSG_ENABLED(API_MSG_INFO))				\
+		api_error(API_MSG_INFO | API_MSG_NO_ERRNO, 0,		\
+			  YEL "[I] " RESET "%f [%d] %s:%d "_format,	\
+			  time_now(), api_gettid(), __FILE__, __LINE__,	\
+			  ## __VA_ARGS__);				\
+} while (0)
+
+#define CT_DEBUG(_format, ...)						\
+do {									\
+	if (API_MSG_ENABLED(API_MSG_DEBUG))				\
+		api_error(API_MSG_DEBUG | API_MSG_NO_ERRNO, 0,		\
+			  BLU "[D] " RESET "%f [%d] %s:%d "_format,	\
+			  time_now(), api_gettid(), __FILE__, __LINE__,	\
+			  ## __VA_ARGS__);				\
+} while (0)
 
 #endif /* LOG_H */
@@ -0,0 +1,284 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Copyright (c) 2026, GSI Helmholtz Centre for Heavy Ion Research
+ */
+
+/*
+ * Bounded cache of string keys and values with least recently used
+ * eviction. Entries are found through a chained hash table and kept in
+ * a doubly linked recency list, all operations are protected by a mutex
+ * and values are copied out, thus the cache can be shared by threads.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "lru.h"
+
+static uint32_t lru_hash(const void *data)
+{
+	return hash_djb_str(((const struct lru_entry_t *)data)->key);
+}
+
+static int lru_match(const void *data1, const void *data2)
+{
+	return strcmp(((const struct lru_entry_t *)data1)->key,
+		      ((const struct lru_entry_t *)data2)->key) == 0 ?
+		RC_SUCCESS : RC_ERROR;
+}
+
+static void lru_entry_free(void *data)
+{
+	struct lru_entry_t *entry = data;
+
+	free(entry->key);
+	free(entry->val);
+	free(entry);
+}
+
+static void lru_unlink(struct lru_t *lru, struct lru_entry_t *entry)
+{
+	if (entry->prev)
+		entry->prev->next = entry->next;
+	else
+		lru->head = entry->next;
+	if (entry->next)
+		entry->next->prev = entry->prev;
+	else
+		lru->tail = entry->prev;
+	entry->prev = entry->next = NULL;
+}
+
+static void lru_link_head(struct lru_t *lru, struct lru_entry_t *entry)
+{
+	entry->prev = NULL;
+	entry->next = lru->head;
+	if (lru->head)
+		lru->head->prev = entry;
+	lru->head = entry;
+	if (!lru->tail)
+		lru->tail = entry;
+}
+
+static struct lru_entry_t *lru_lookup(struct lru_t *lru, const char *key)
+{
+	int rc;
+	void *data = NULL;
+	const struct lru_entry_t lookup = {.key = (char *)key};
+
+	rc = chashtable_lookup(&lru->table, &lookup, &data);
+
+	return rc == RC_DATA_FOUND ? data : NULL;
+}
+
+/* Remove entry from table and recency list, lru->mutex must be held. */
+static void lru_evict(struct lru_t *lru, struct lru_entry_t *entry)
+{
+	void *data = entry;
+
+	lru_unlink(lru, entry);
+	chashtable_remove(&lru->table, entry, &data);
+	lru_entry_free(entry);
+}
+
+/**
+ * @brief Initialize cache holding at most capacity entries.
+ *
+ * @param[out] lru      Cache.
+ * @param[in]  capacity Maximum number of entries.
+ * @return 0 on success, -EINVAL if capacity is 0 or -ENOMEM.
+ */
+int lru_init(struct lru_t *lru, const uint32_t capacity)
+{
+	int rc;
+
+	if (capacity == 0)
+		return -EINVAL;
+
+	memset(lru, 0, sizeof(struct lru_t));
+	lru->capacity = capacity;
+
+	/* Entries are released by lru_evict and lru_destroy, not by the
+	   table. */
+	rc = chashtable_init(&lru->table, capacity, lru_hash, lru_match,
+			     NULL);
+	if (rc)
+		return -ENOMEM;
+
+	return -pthread_mutex_init(&lru->mutex, NULL);
+}
+
+/**
+ * @brief Release all entries of cache.
+ *
+ * @param[in] lru Cache.
+ */
+void lru_destroy(struct lru_t *lru)
+{
+	struct lru_entry_t *entry = lru->head;
+
+	while (entry) {
+		struct lru_entry_t *next = entry->next;
+
+		lru_entry_free(entry);
+		entry = next;
+	}
+	chashtable_destroy(&lru->table);
+	pthread_mutex_destroy(&lru->mutex);
+	lru->head = lru->tail = NULL;
+}
+
+/**
+ * @brief Copy value of key into val and mark entry most recently used.
+ *
+ * @param[in]  lru     Cache.
+ * @param[in]  key     Key to look up.
+ * @param[out] val     Buffer receiving the value.
+ * @param[in]  val_len Size of val in bytes.
+ * @return 0 on success, -ENOENT if key is not cached or -ENAMETOOLONG if
+ *         value does not fit into val.
+ */
+int lru_get(struct lru_t *lru, const char *key, char *val,
+	    const size_t val_len)
+{
+	int rc = 0;
+	struct lru_entry_t *entry;
+
+	pthread_mutex_lock(&lru->mutex);
+	entry = lru_lookup(lru, key);
+	if (!entry) {
+		lru->misses++;
+		rc = -ENOENT;
+		goto unlock;
+	}
+	lru->hits++;
+
+	if (strlen(entry->val) >= val_len) {
+		rc = -ENAMETOOLONG;
+		goto unlock;
+	}
+	strcpy(val, entry->val);
+
+	if (lru->head != entry) {
+		lru_unlink(lru, entry);
+		lru_link_head(lru, entry);
+	}
+
+unlock:
+	pthread_mutex_unlock(&lru->mutex);
+
+	return rc;
+}
+
+/**
+ * @brief Insert or replace value of key and mark entry most recently used.
+ *
+ * When the cache is full, the least recently used entry is evicted.
+ *
+ * @param[in] lru Cache.
+ * @param[in] key Key to insert.
+ * @param[in] val Value of key.
+ * @return 0 on success or -ENOMEM.
+ */
+int lru_put(struct lru_t *lru, const char *key, const char *val)
+{
+	int rc = 0;
+	char *dup;
+	struct lru_entry_t *entry;
+
+	pthread_mutex_lock(&lru->mutex);
+	entry = lru_lookup(lru, key);
+	if (entry) {
+		dup = strdup(val);
+		if (!dup) {
+			rc = -ENOMEM;
+			goto unlock;
+		}
+		free(entry->val);
+		entry->val = dup;
+		if (lru->head != entry) {
+			lru_unlink(lru, entry);
+			lru_link_head(lru, entry);
+		}
+		goto unlock;
+	}
+
+	entry = calloc(1, sizeof(struct lru_entry_t));
+	if (!entry) {
+		rc = -ENOMEM;
+		goto unlock;
+	}
+	entry->key = strdup(key);
+	entry->val = strdup(val);
+	if (!entry->key || !entry->val) {
+		lru_entry_free(entry);
+		rc = -ENOMEM;
+		goto unlock;
+	}
+
+	if (chashtable_size(&lru->table) >= lru->capacity)
+		lru_evict(lru, lru->tail);
+
+	if (chashtable_insert(&lru->table, entry) != RC_SUCCESS) {
+		lru_entry_free(entry);
+		rc = -ENOMEM;
+		goto unlock;
+	}
+	lru_link_head(lru, entry);
+
+unlock:
+	pthread_mutex_unlock(&lru->mutex);
+
+	return rc;
+}
+
+/**
+ * @brief Remove key from cache, e.g. when its value became stale.
+ *
+ * @param[in] lru Cache.
+ * @param[in] key Key to remove.
+ */
+void lru_remove(struct lru_t *lru, const char *key)
+{
+	struct lru_entry_t *entry;
+
+	pthread_mutex_lock(&lru->mutex);
+	entry = lru_lookup(lru, key);
+	if (entry)
+		lru_evict(lru, entry);
+	pthread_mutex_unlock(&lru->mutex);
+}
+
+/**
+ * @brief Number of entries currently cached.
+ *
+ * @param[in] lru Cache.
+ * @return Number of entries.
+ */
+uint32_t lru_size(struct lru_t *lru)
+{
+	uint32_t size;
+
+	pthread_mutex_lock(&lru->mutex);
+	size = chashtable_size(&lru->table);
+	pthread_mutex_unlock(&lru->mutex);
+
+	return size;
+}
@@ -0,0 +1,52 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Copyright (c) 2026, GSI Helmholtz Centre for Heavy Ion Research
+ */
+
+#ifndef LRU_H
+#define LRU_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+#include "chashtable.h"
+
+struct lru_entry_t {
+	char *key;
+	char *val;
+	struct lru_entry_t *prev;	/* Towards most recently used. */
+	struct lru_entry_t *next;	/* Towards least recently used. */
+};
+
+struct lru_t {
+	uint32_t capacity;
+	chashtable_t table;
+	struct lru_entry_t *head;	/* Most recently used. */
+	struct lru_entry_t *tail;	/* Least recently used. */
+	uint64_t hits;
+	uint64_t misses;
+	pthread_mutex_t mutex;
+};
+
+int lru_init(struct lru_t *lru, const uint32_t capacity);
+void lru_destroy(struct lru_t *lru);
+int lru_get(struct lru_t *lru, const char *key, char *val,
+	    const size_t val_len);
+int lru_put(struct lru_t *lru, const char *key, const char *val);
+void lru_remove(struct lru_t *lru, const char *key);
+uint32_t lru_size(struct lru_t *lru);
+
+#endif /* LRU_H */
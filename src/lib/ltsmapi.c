@@ -30,6 +30,8 @@
 #include <math.h>
 #include <stdint.h>
 #include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/param.h>
@@ -40,6 +42,11 @@
 #include "ltsmapi.h"
 #include "common.h"
 #include "qtable.h"
+#include "metrics.h"
+#include "trace.h"
+#include "prefetch.h"
+#include "bufpool.h"
+#include "compress.h"
 
 #ifdef HAVE_LUSTRE
 #include <attr/xattr.h>
@@ -60,6 +67,14 @@
 static char rcmsg[DSM_MAX_RC_MSG_LENGTH + 1] = {0};
 static dsBool_t do_recursive = bFalse;
 static dsBool_t restore_stripe = bFalse;
+static uint32_t progress_interval_ms = PROGRESS_INTERVAL_MS;
+static uint64_t progress_bytes = PROGRESS_BYTES;
+static uint64_t crc32_inline_bytes = CRC32_INLINE_BYTES;
+static uint64_t restore_direct_bytes = 0;
+static char mountp_cache_dir[PATH_MAX] = MOUNTP_CACHE_DIR;
+static uint16_t prefetch_files = PREFETCH_FILES;
+static uint64_t prefetch_bytes = PREFETCH_BYTES;
+static uint16_t prefetch_threads = PREFETCH_THREADS;
 static char prefix[PATH_MAX + 1] = {0};
 
 #define TSM_GET_MSG(session, rc)			\
@@ -69,12 +84,38 @@ do {							\
 	rcmsg[strlen(rcmsg)-1] = '\0';			\
 } while (0)
 
+static dsBool_t rc_conn_lost(const dsInt16_t rc)
+{
+	switch (rc) {
+	case DSM_RC_TCPIP_FAILURE:
+	case DSM_RC_CONN_TIMEDOUT:
+	case DSM_RC_CONN_REFUSED:
+	case DSM_RC_BAD_HOST_NAME:
+	case DSM_RC_NETWORK_UNREACHABLE:
+	case DSM_RC_COMM_PROTOCOL_ERROR:
+		return bTrue;
+	}
+	return bFalse;
+}
+
+/* A lost connection is latched, later calls on the dead session must
+   not hide it. */
 #define TSM_ERROR(session, rc, func)					\
 do {									\
+	session->rc_tsm = rc;						\
+	if (rc_conn_lost(rc))						\
+		session->conn_lost = bTrue;				\
 	TSM_GET_MSG(session, rc);					\
 	CT_ERROR(0, "%s: handle: %d %s", func, session->handle, rcmsg);	\
 } while (0)
 
+#define TSM_REASON(session, reason, func)				\
+do {									\
+	session->reason_tsm = reason;					\
+	TSM_GET_MSG(session, reason);					\
+	CT_ERROR(0, "%s: handle: %d %s", func, session->handle, rcmsg);	\
+} while (0)
+
 #define TSM_DEBUG(session, rc, func)					\
 do {									\
 	TSM_GET_MSG(session, rc);					\
@@ -237,6 +278,123 @@ void set_restore_stripe(const dsBool_t _restore_stripe)
 	restore_stripe = _restore_stripe;
 }
 
+/**
+ * @brief Bound the rate of progress function callbacks.
+ *
+ * Progress is accumulated and reported once interval_ms milliseconds
+ * elapsed or bytes are pending since the last report, whatever comes first.
+ * Completion of an object is always reported. Setting both values to 0
+ * reports progress for each transferred buffer.
+ *
+ * @param[in] interval_ms Minimum time between two reports.
+ * @param[in] bytes       Maximum number of not yet reported bytes.
+ */
+void set_progress_throttle(const uint32_t interval_ms, const uint64_t bytes)
+{
+	progress_interval_ms = interval_ms;
+	progress_bytes = bytes;
+}
+
+/**
+ * @brief Set size limit of files checksummed before sending.
+ *
+ * Files with size up to bytes are read completely and checksummed before
+ * dsmSendObj, thus the crc32 is stored without an additional dsmUpdateObj
+ * round trip. Larger files are checksummed while sending. Setting 0
+ * checksums all files while sending.
+ *
+ * @param[in] bytes Maximum file size in bytes.
+ */
+void set_crc32_inline(const uint64_t bytes)
+{
+	crc32_inline_bytes = bytes;
+}
+
+/**
+ * @brief Set size limit of objects restored with O_DIRECT writes.
+ *
+ * Objects with size of at least bytes are written in retrieve_obj with
+ * O_DIRECT and DIRECT_IO_ALIGN aligned buffers, bypassing the page cache.
+ * If the file system does not support O_DIRECT, buffered writes are used.
+ * Setting 0 disables O_DIRECT writes.
+ *
+ * @param[in] bytes Minimum object size in bytes.
+ */
+void set_restore_direct(const uint64_t bytes)
+{
+	restore_direct_bytes = bytes;
+}
+
+/**
+ * @brief Set directory of mount point probe cache files.
+ *
+ * @param[in] dir Directory, default is MOUNTP_CACHE_DIR.
+ */
+void set_mountp_cache_dir(const char *dir)
+{
+	strncpy(mountp_cache_dir, dir, sizeof(mountp_cache_dir) - 1);
+}
+
+/**
+ * @brief Set read ahead of regular files when archiving a directory.
+ *
+ * While a file is sent, the next files of at most bytes in total are read
+ * ahead into memory and checksummed by threads, thus no dsmUpdateObj is
+ * required for them. Setting files or threads to 0 disables read ahead.
+ *
+ * @param[in] files   Maximum number of files read ahead.
+ * @param[in] bytes   Maximum size in bytes of all files read ahead.
+ * @param[in] threads Number of threads reading files and chunks of files.
+ */
+void set_prefetch(const uint16_t files, const uint64_t bytes,
+		  const uint16_t threads)
+{
+	prefetch_files = files;
+	prefetch_bytes = bytes;
+	prefetch_threads = threads;
+}
+
+static void progress_reset(struct session_t *session)
+{
+	session->progress_state.bytes = 0;
+	clock_gettime(CLOCK_MONOTONIC_COARSE, &session->progress_state.ts);
+}
+
+static int progress_dispatch(struct session_t *session, const uint64_t cur,
+			     const uint64_t cur_total, const uint64_t total,
+			     const dsBool_t force)
+{
+	int rc;
+	struct timespec now;
+	struct progress_state_t *state = &session->progress_state;
+
+	state->bytes += cur;
+	if (state->bytes == 0)
+		return 0;
+
+	clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+	if (!force && state->bytes < progress_bytes &&
+	    (uint64_t)(now.tv_sec - state->ts.tv_sec) * 1000 +
+	    (now.tv_nsec - state->ts.tv_nsec) / 1000000 < progress_interval_ms)
+		return 0;
+
+	struct progress_size_t progress_size = {
+		.cur = state->bytes,
+		.cur_total = cur_total,
+		.total = total
+	};
+	state->bytes = 0;
+	state->ts = now;
+
+	rc = session->progress(&progress_size, session);
+	if (rc == -ECANCELED)
+		CT_WARN("progress operation canceled");
+	else if (rc)
+		CT_ERROR(rc, "progress function callback failed");
+
+	return rc;
+}
+
 int parse_verbose(const char *val, int *opt_verbose)
 {
 	if (!val)
@@ -400,6 +558,396 @@ int xattr_set_lov(int fd, const struct lustre_info_t *lustre_info,
 }
 #endif /* HAVE_LUSTRE */
 
+/**
+ * @brief Extend crc32 by len zero bytes.
+ *
+ * The crc32 of the zeros is built by doubling with crc32_combine, thus
+ * holes of sparse files are checksummed in O(log len) without any data.
+ *
+ * @param[in] crc crc32 of the preceding data.
+ * @param[in] len Number of zero bytes.
+ * @return crc32 of preceding data followed by len zero bytes.
+ */
+static uint32_t crc32_zeros(const uint32_t crc, const uint64_t len)
+{
+	const unsigned char zero = 0;
+	uint32_t zeros = 0;
+	uint32_t blk = crc32(0, &zero, 1);
+	uint64_t blk_len = 1;
+
+	for (uint64_t l = len; l; l >>= 1) {
+		if (l & 1)
+			zeros = crc32_combine(zeros, blk, blk_len);
+		blk = crc32_combine(blk, blk, blk_len);
+		blk_len <<= 1;
+	}
+
+	return crc32_combine(crc, zeros, len);
+}
+
+struct sparse_t {
+	struct sparse_hdr_t hdr;
+	struct sparse_extent_t *extent;
+	size_t map_pos;		/* Processed bytes of header and extent map. */
+	uint32_t cur;		/* Current extent. */
+	uint64_t pos;		/* Processed bytes of current extent. */
+	uint64_t end;		/* End of last processed extent. */
+	uint64_t stream;	/* Bytes of header, extent map and data. */
+};
+
+static size_t sparse_map_len(const struct sparse_t *sparse)
+{
+	return sizeof(struct sparse_hdr_t) +
+		sparse->hdr.num * sizeof(struct sparse_extent_t);
+}
+
+/**
+ * @brief Collect data extents of file by means of SEEK_DATA and SEEK_HOLE.
+ *
+ * @param[in]  fd     File descriptor, position is reset to 0.
+ * @param[in]  size   File size.
+ * @param[out] sparse Extent map, extent array is allocated on success.
+ * @return 1 if holes sum up to at least SPARSE_HOLE_BYTES, 0 if file
+ *         should be archived dense, negative errno on error.
+ */
+static int sparse_map(int fd, const off64_t size, struct sparse_t *sparse)
+{
+	int rc = 0;
+	off64_t data;
+	off64_t hole = 0;
+	uint64_t data_bytes = 0;
+	uint32_t max = 0;
+
+	memset(sparse, 0, sizeof(*sparse));
+	while (hole < size) {
+		data = lseek(fd, hole, SEEK_DATA);
+		if (data < 0) {
+			/* Trailing hole, or SEEK_DATA is not supported. */
+			rc = errno == ENXIO ? 0 : (errno == EINVAL ? 1 : -errno);
+			if (rc)
+				goto cleanup;
+			break;
+		}
+		hole = lseek(fd, data, SEEK_HOLE);
+		if (hole < 0) {
+			rc = -errno;
+			goto cleanup;
+		}
+		hole = MIN(hole, size);
+		if (data >= hole)
+			break;
+
+		if (sparse->hdr.num == max) {
+			struct sparse_extent_t *extent;
+
+			if (max == SPARSE_MAX_EXTENTS) {
+				rc = 1;
+				goto cleanup;
+			}
+			max = max ? 2 * max : 64;
+			extent = realloc(sparse->extent, max * sizeof(*extent));
+			if (!extent) {
+				rc = -ENOMEM;
+				goto cleanup;
+			}
+			sparse->extent = extent;
+		}
+		sparse->extent[sparse->hdr.num].offset = data;
+		sparse->extent[sparse->hdr.num].length = hole - data;
+		sparse->hdr.num++;
+		data_bytes += hole - data;
+	}
+	rc = 0;
+
+cleanup:
+	if (lseek(fd, 0, SEEK_SET) < 0 && rc == 0)
+		rc = -errno;
+	/* rc 1 flags unsupported SEEK_DATA or too many extents. */
+	if (rc == 0 && (uint64_t)size - data_bytes >= SPARSE_HOLE_BYTES) {
+		sparse->hdr.magic = SPARSE_MAGIC;
+		sparse->stream = sparse_map_len(sparse) + data_bytes;
+		return 1;
+	}
+	free(sparse->extent);
+	sparse->extent = NULL;
+
+	return rc < 0 ? rc : 0;
+}
+
+/**
+ * @brief Fill buf with the next bytes of the sparse data stream.
+ *
+ * The stream consists of the header, the extent map and the data of the
+ * extents. crc is updated with the file content including the holes
+ * preceding each extent.
+ *
+ * @return Number of bytes filled, 0 at end of stream or negative errno.
+ */
+static ssize_t sparse_read(int fd, struct sparse_t *sparse, char *buf,
+			   const size_t len, uint32_t *crc)
+{
+	size_t n = 0;
+	const size_t map_len = sparse_map_len(sparse);
+
+	while (n < len && sparse->map_pos < map_len) {
+		const size_t hdr_len = sizeof(struct sparse_hdr_t);
+		size_t l;
+		const char *src;
+
+		if (sparse->map_pos < hdr_len) {
+			src = (const char *)&sparse->hdr + sparse->map_pos;
+			l = MIN(len - n, hdr_len - sparse->map_pos);
+		} else {
+			src = (const char *)sparse->extent +
+				sparse->map_pos - hdr_len;
+			l = MIN(len - n, map_len - sparse->map_pos);
+		}
+		memcpy(buf + n, src, l);
+		n += l;
+		sparse->map_pos += l;
+	}
+
+	while (n < len && sparse->cur < sparse->hdr.num) {
+		const struct sparse_extent_t *extent =
+			&sparse->extent[sparse->cur];
+		ssize_t r;
+
+		if (sparse->pos == 0)
+			*crc = crc32_zeros(*crc, extent->offset - sparse->end);
+		r = pread(fd, buf + n, MIN(len - n, extent->length - sparse->pos),
+			  extent->offset + sparse->pos);
+		if (r < 0)
+			return -errno;
+		if (r == 0)
+			return -EIO;	/* File shrank. */
+		*crc = crc32(*crc, (const unsigned char *)buf + n, r);
+		n += r;
+		sparse->pos += r;
+		if (sparse->pos == extent->length) {
+			sparse->end = extent->offset + extent->length;
+			sparse->cur++;
+			sparse->pos = 0;
+		}
+	}
+
+	return n;
+}
+
+/**
+ * @brief Consume bytes of the sparse data stream and write the extents.
+ *
+ * Extents are written at their offsets, holes are left unwritten and
+ * thus recreated as long as fd refers to an empty file.
+ *
+ * @return 0 on success, otherwise negative errno.
+ */
+static int sparse_write(int fd, struct sparse_t *sparse, const char *buf,
+			const size_t len, const off64_t size, uint32_t *crc)
+{
+	size_t n = 0;
+	const size_t hdr_len = sizeof(struct sparse_hdr_t);
+
+	while (n < len && sparse->map_pos < hdr_len) {
+		const size_t l = MIN(len - n, hdr_len - sparse->map_pos);
+
+		memcpy((char *)&sparse->hdr + sparse->map_pos, buf + n, l);
+		n += l;
+		sparse->map_pos += l;
+		if (sparse->map_pos < hdr_len)
+			break;
+		if (sparse->hdr.magic != SPARSE_MAGIC ||
+		    sparse->hdr.num > SPARSE_MAX_EXTENTS)
+			return -EINVAL;
+		sparse->extent = calloc(MAX(sparse->hdr.num, 1),
+					sizeof(struct sparse_extent_t));
+		if (!sparse->extent)
+			return -ENOMEM;
+	}
+
+	const size_t map_len = sparse_map_len(sparse);
+	while (n < len && sparse->map_pos < map_len) {
+		const size_t l = MIN(len - n, map_len - sparse->map_pos);
+
+		memcpy((char *)sparse->extent + sparse->map_pos - hdr_len,
+		       buf + n, l);
+		n += l;
+		sparse->map_pos += l;
+		if (sparse->map_pos < map_len)
+			break;
+		uint64_t end = 0;
+
+		for (uint32_t e = 0; e < sparse->hdr.num; e++) {
+			const struct sparse_extent_t *extent =
+				&sparse->extent[e];
+
+			if (extent->offset < end ||
+			    extent->offset + extent->length > (uint64_t)size)
+				return -EINVAL;
+			end = extent->offset + extent->length;
+		}
+	}
+
+	while (n < len && sparse->cur < sparse->hdr.num) {
+		const struct sparse_extent_t *extent =
+			&sparse->extent[sparse->cur];
+		ssize_t w;
+
+		if (sparse->pos == 0)
+			*crc = crc32_zeros(*crc, extent->offset - sparse->end);
+		w = pwrite(fd, buf + n, MIN(len - n, extent->length - sparse->pos),
+			   extent->offset + sparse->pos);
+		if (w < 0)
+			return -errno;
+		*crc = crc32(*crc, (const unsigned char *)buf + n, w);
+		n += w;
+		sparse->pos += w;
+		if (sparse->pos == extent->length) {
+			sparse->end = extent->offset + extent->length;
+			sparse->cur++;
+			sparse->pos = 0;
+		}
+	}
+
+	/* Data beyond the last extent. */
+	return n < len ? -EINVAL : 0;
+}
+
+/**
+ * @brief Write buffer with O_DIRECT and buffered tail.
+ *
+ * The DIRECT_IO_ALIGN aligned part of buf is written with O_DIRECT,
+ * the remaining tail after clearing O_DIRECT from fd. Same applies if
+ * the file system rejects O_DIRECT writes with EINVAL.
+ *
+ * @param[in]     fd     File descriptor opened for writing.
+ * @param[in]     buf    DIRECT_IO_ALIGN aligned buffer.
+ * @param[in]     len    Number of bytes to write.
+ * @param[in,out] direct Whether O_DIRECT is set on fd, cleared on fallback.
+ * @return Number of written bytes, otherwise negative errno.
+ */
+static ssize_t write_direct(int fd, const char *buf, const size_t len,
+			    dsBool_t *direct)
+{
+	size_t total = 0;
+
+	while (total < len) {
+		const size_t aligned = (len - total) &
+			~((size_t)DIRECT_IO_ALIGN - 1);
+		ssize_t n;
+
+		if (*direct && aligned == 0) {
+			if (fcntl(fd, F_SETFL,
+				  fcntl(fd, F_GETFL) & ~O_DIRECT) < 0)
+				return -errno;
+			*direct = bFalse;
+		}
+		n = write(fd, buf + total, *direct ? aligned : len - total);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EINVAL && *direct) {
+				CT_DEBUG("[fd=%d] O_DIRECT write rejected, "
+					 "fall back to buffered write", fd);
+				if (fcntl(fd, F_SETFL,
+					  fcntl(fd, F_GETFL) & ~O_DIRECT) < 0)
+					return -errno;
+				*direct = bFalse;
+				continue;
+			}
+			return -errno;
+		}
+		total += n;
+	}
+
+	return total;
+}
+
+/**
+ * @brief Read into buffer with O_DIRECT.
+ *
+ * If the file system rejects O_DIRECT reads with EINVAL, O_DIRECT is
+ * cleared from fd and data is read buffered.
+ *
+ * @param[in]     fd     File descriptor opened for reading.
+ * @param[out]    buf    DIRECT_IO_ALIGN aligned buffer.
+ * @param[in]     len    Number of bytes to read, multiple of
+ *                       DIRECT_IO_ALIGN.
+ * @param[in,out] direct Whether O_DIRECT is set on fd, cleared on fallback.
+ * @return Number of read bytes, 0 on end of file, otherwise negative errno.
+ */
+static ssize_t read_direct(int fd, char *buf, const size_t len,
+			   dsBool_t *direct)
+{
+	ssize_t n;
+
+	do {
+		n = read(fd, buf, len);
+		if (n < 0 && errno == EINVAL && *direct) {
+			CT_DEBUG("[fd=%d] O_DIRECT read rejected, fall back "
+				 "to buffered read", fd);
+			if (fcntl(fd, F_SETFL,
+				  fcntl(fd, F_GETFL) & ~O_DIRECT) < 0)
+				return -errno;
+			*direct = bFalse;
+			errno = EINTR;
+		}
+	} while (n < 0 && errno == EINTR);
+
+	return n < 0 ? -errno : n;
+}
+
+/**
+ * @brief Write uncompressed object data and extend crc32.
+ *
+ * @param[in]     fd     File descriptor opened for writing.
+ * @param[in]     buf    Data, DIRECT_IO_ALIGN aligned if direct is set.
+ * @param[in]     len    Number of bytes of data.
+ * @param[in]     sparse Extent map of sparse object, otherwise NULL.
+ * @param[in]     size   Object size.
+ * @param[in,out] direct Whether O_DIRECT is set on fd, cleared on fallback.
+ * @param[in,out] crc    crc32 of the file data written so far.
+ * @return 0 on success, otherwise negative errno.
+ */
+static int restore_write(int fd, const char *buf, const size_t len,
+			 struct sparse_t *sparse, const off64_t size,
+			 dsBool_t *direct, uint32_t *crc)
+{
+	ssize_t n = 0;
+	size_t total = 0;
+	uint64_t ts;
+
+	if (sparse) {
+		ts = metrics_now();
+		n = sparse_write(fd, sparse, buf, len, size, crc);
+		metrics_record(METRIC_WRITE, ts, len);
+		return n;
+	}
+
+	ts = metrics_now();
+	if (*direct) {
+		n = write_direct(fd, buf, len, direct);
+		if (n < 0)
+			return n;
+	} else {
+		while (total < len) {
+			n = write(fd, buf + total, len - total);
+			if (n < 0) {
+				if (errno == EINTR)
+					continue;
+				return -errno;
+			}
+			total += n;
+		}
+	}
+	metrics_record(METRIC_WRITE, ts, len);
+
+	ts = metrics_now();
+	*crc = crc32(*crc, (const unsigned char *)buf, len);
+	metrics_record(METRIC_CRC32, ts, len);
+
+	return 0;
+}
+
 /**
  * @brief Retrieve and write object data into file descriptor.
  *
@@ -419,6 +967,11 @@ static dsInt16_t retrieve_obj(qryRespArchiveData *query_data,
 	dsInt16_t rc;
 	dsInt16_t rc_minor	= 0;
 	dsBool_t  is_local_fd	= bFalse;
+	dsBool_t  preallocated	= bFalse;
+	dsBool_t  direct	= bFalse;
+	int	  fd_flags	= -1;
+	off64_t	  fd_pos	= 0;
+	ssize_t   total_written = 0;
 
 	size_t len = strlen(prefix) +
 		strlen(query_data->objName.fs) +
@@ -483,9 +1036,64 @@ static dsInt16_t retrieve_obj(qryRespArchiveData *query_data,
 	}
 #endif
 
-	buf = malloc(sizeof(char) * TSM_BUF_LENGTH);
+	const off64_t obj_size = to_off64_t(obj_info->size);
+	const dsBool_t is_sparse = obj_info->magic != MAGIC_ID_V1 &&
+		(obj_info->flags & OBJ_INFO_SPARSE) ? bTrue : bFalse;
+	const uint32_t codec = obj_info->magic == MAGIC_ID_V3 ?
+		obj_info->codec : COMPRESS_NONE;
+	struct sparse_t sparse;
+	struct decompress_t decompress;
+
+	memset(&sparse, 0, sizeof(sparse));
+	memset(&decompress, 0, sizeof(decompress));
+	if (codec != COMPRESS_NONE) {
+		rc = decompress_init(&decompress, codec);
+		if (rc) {
+			CT_ERROR(-rc, "decompress_init of codec '%s'",
+				 compress_name(codec));
+			rc_minor = DSM_RC_UNSUCCESSFUL;
+			goto cleanup_fd;
+		}
+	}
+
+	/* Allocate blocks of the whole object at once after the stripe
+	   layout is set, instead of incrementally by each write. Holes of
+	   sparse objects must not be allocated. */
+	struct stat st;
+	const dsBool_t is_reg = fstat(fd, &st) == 0 && S_ISREG(st.st_mode) ?
+		bTrue : bFalse;
+
+	fd_pos = lseek(fd, 0, SEEK_CUR);
+	if (fd_pos < 0)
+		fd_pos = 0;
+	if (is_reg && obj_size > 0 && !is_sparse) {
+		rc = fallocate(fd, FALLOC_FL_KEEP_SIZE, fd_pos, obj_size);
+		if (rc < 0) {
+			CT_DEBUG("[fd=%d] fallocate of %zu bytes failed: %s",
+				 fd, (size_t)obj_size, strerror(errno));
+			/* Release partially allocated blocks. */
+			if (errno != EOPNOTSUPP &&
+			    ftruncate(fd, st.st_size) < 0)
+				CT_WARN("[fd=%d] ftruncate failed: %s", fd,
+					strerror(errno));
+		} else
+			preallocated = bTrue;
+	}
+
+	fd_flags = fcntl(fd, F_GETFL);
+	if (restore_direct_bytes > 0 && is_reg && !is_sparse &&
+	    fd_flags >= 0 && (uint64_t)obj_size >= restore_direct_bytes &&
+	    fd_pos % DIRECT_IO_ALIGN == 0) {
+		if (fcntl(fd, F_SETFL, fd_flags | O_DIRECT) < 0)
+			CT_DEBUG("[fd=%d] O_DIRECT not supported: %s", fd,
+				 strerror(errno));
+		else
+			direct = bTrue;
+	}
+
+	buf = bufpool_get(bufpool_default());
 	if (!buf) {
-		CT_ERROR(errno, "malloc");
+		CT_ERROR(errno, "bufpool_get");
 		rc_minor = DSM_RC_UNSUCCESSFUL;
 		goto cleanup_fd;
 	}
@@ -495,18 +1103,21 @@ static dsInt16_t retrieve_obj(qryRespArchiveData *query_data,
 	dataBlk.bufferLen = TSM_BUF_LENGTH;
 	dataBlk.numBytes  = 0;
 	dataBlk.bufferPtr = buf;
-	memset(dataBlk.bufferPtr, 0, TSM_BUF_LENGTH);
 
-	off64_t obj_size = to_off64_t(obj_info->size);
 	dsBool_t done = bFalse;
-	ssize_t total_written = 0;
 	ssize_t cur_written = 0;
+	size_t buf_fill = 0;
+	int rc_write;
+	uint64_t ts;
 
 	/* Request data with a single dsmGetObj call, otherwise data
 	   is larger and we need additional dsmGetData calls. */
+	ts = metrics_now();
 	rc = dsmGetObj(session->handle, &(query_data->objId), &dataBlk);
+	metrics_record(METRIC_GET_DATA, ts, dataBlk.numBytes);
 	TSM_DEBUG(session, rc,  "dsmGetObj");
 	uint32_t crc32sum = 0;
+	progress_reset(session);
 
 	while (!done) {
 
@@ -515,14 +1126,64 @@ static dsInt16_t retrieve_obj(qryRespArchiveData *query_data,
 			rc_minor = rc;
 			goto cleanup;
 		}
-		cur_written = write(fd, buf, dataBlk.numBytes);
-		if (cur_written < 0) {
-			CT_ERROR(errno, "write");
-			rc_minor = DSM_RC_UNSUCCESSFUL;
-			goto cleanup;
+		if (codec != COMPRESS_NONE) {
+			/* Frames are written once complete, all but the last
+			   one hold TSM_BUF_LENGTH aligned bytes. */
+			cur_written = 0;
+			for (size_t off = 0; off < dataBlk.numBytes;) {
+				const char *raw;
+				size_t raw_len;
+				ssize_t n;
+
+				n = decompress_feed(&decompress, buf + off,
+						    dataBlk.numBytes - off,
+						    &raw, &raw_len);
+				if (n < 0) {
+					CT_ERROR(-n, "decompress_feed");
+					rc_minor = DSM_RC_UNSUCCESSFUL;
+					goto cleanup;
+				}
+				off += n;
+				if (!raw)
+					continue;
+				rc_write = restore_write(fd, raw, raw_len,
+							 is_sparse ? &sparse :
+							 NULL, obj_size,
+							 &direct, &crc32sum);
+				if (rc_write) {
+					CT_ERROR(-rc_write, "restore_write");
+					rc_minor = DSM_RC_UNSUCCESSFUL;
+					goto cleanup;
+				}
+				cur_written += raw_len;
+			}
+		} else if (direct) {
+			/* Data is accumulated to full, aligned buffers. */
+			cur_written = dataBlk.numBytes;
+			buf_fill += dataBlk.numBytes;
+			if (buf_fill == TSM_BUF_LENGTH ||
+			    rc == DSM_RC_FINISHED) {
+				rc_write = restore_write(fd, buf, buf_fill,
+							 NULL, obj_size,
+							 &direct, &crc32sum);
+				if (rc_write) {
+					CT_ERROR(-rc_write, "restore_write");
+					rc_minor = DSM_RC_UNSUCCESSFUL;
+					goto cleanup;
+				}
+				buf_fill = 0;
+			}
+		} else {
+			rc_write = restore_write(fd, buf, dataBlk.numBytes,
+						 is_sparse ? &sparse : NULL,
+						 obj_size, &direct, &crc32sum);
+			if (rc_write) {
+				CT_ERROR(-rc_write, "restore_write");
+				rc_minor = DSM_RC_UNSUCCESSFUL;
+				goto cleanup;
+			}
+			cur_written = dataBlk.numBytes;
 		}
-		crc32sum = crc32(crc32sum, (const unsigned char *)buf,
-				 cur_written);
 		total_written += cur_written;
 		CT_INFO("datablk_numbytes: %zu, cur_written: %zu,"
 			" total_written: %zu, obj_size: %zu",
@@ -530,36 +1191,48 @@ static dsInt16_t retrieve_obj(qryRespArchiveData *query_data,
 
 		/* Function callback on updating progress */
 		if (session->progress != NULL) {
-			struct progress_size_t progress_size = {
-				.cur = cur_written,
-				.cur_total = total_written,
-				.total = obj_size
-			};
-			rc_minor = session->progress(&progress_size,
-						     session);
-			if (rc_minor) {
-				if (rc_minor == -ECANCELED)
-					CT_WARN("progress "
-						"operation "
-						"canceled");
-				else
-					CT_ERROR(rc_minor,
-						 "progress "
-						 "function "
-						 "callback "
-						 "failed");
-
+			rc_minor = progress_dispatch(session, cur_written,
+						     total_written, obj_size,
+						     rc == DSM_RC_FINISHED);
+			if (rc_minor)
 				goto cleanup;
-			}
 		}
 		if (rc == DSM_RC_MORE_DATA) {
+			dataBlk.bufferPtr = buf + buf_fill;
+			dataBlk.bufferLen = TSM_BUF_LENGTH - buf_fill;
 			dataBlk.numBytes = 0;
+			ts = metrics_now();
 			rc = dsmGetData(session->handle, &dataBlk);
+			metrics_record(METRIC_GET_DATA, ts, dataBlk.numBytes);
 			TSM_DEBUG(session, rc,  "dsmGetData");
 		} else	/* DSM_RC_FINISHED */
 			done = bTrue;
 	} /* End while (!done) */
 
+	if (codec != COMPRESS_NONE && !decompress_idle(&decompress)) {
+		CT_ERROR(EIO, "compressed object data incomplete");
+		rc_minor = DSM_RC_UNSUCCESSFUL;
+		goto cleanup;
+	}
+
+	/* Recreate the trailing hole, total_written is the file size
+	   once all extents are written. */
+	if (is_sparse) {
+		if (sparse.map_pos < sizeof(struct sparse_hdr_t) ||
+		    sparse.cur < sparse.hdr.num) {
+			CT_ERROR(EIO, "sparse object data incomplete");
+			rc_minor = DSM_RC_UNSUCCESSFUL;
+			goto cleanup;
+		}
+		if (ftruncate(fd, obj_size) < 0) {
+			CT_ERROR(errno, "ftruncate");
+			rc_minor = DSM_RC_UNSUCCESSFUL;
+			goto cleanup;
+		}
+		crc32sum = crc32_zeros(crc32sum, obj_size - sparse.end);
+		total_written = obj_size;
+	}
+
 	/* Do a sanity check whether size of object (hi, lo) matches
 	   the total_written bytes. */
 	if (obj_size != total_written)
@@ -578,10 +1251,24 @@ cleanup:
 	if (rc != DSM_RC_SUCCESSFUL)
 		TSM_ERROR(session, rc, "dsmEndGetObj");
 
-	if (buf)
-		free(buf);
+	bufpool_put(bufpool_default(), buf);
+	if (sparse.extent)
+		free(sparse.extent);
 
 cleanup_fd:
+	if (codec != COMPRESS_NONE)
+		decompress_destroy(&decompress);
+	/* Release preallocated blocks not covered by written data. */
+	if (preallocated) {
+		const off64_t fd_end = lseek(fd, 0, SEEK_CUR);
+
+		if (fd_end >= 0 && fd_end < fd_pos + obj_size &&
+		    ftruncate(fd, fd_end) < 0)
+			CT_WARN("[fd=%d] ftruncate failed: %s", fd,
+				strerror(errno));
+	}
+	if (fd_flags >= 0 && fcntl(fd, F_GETFL) != fd_flags)
+		fcntl(fd, F_SETFL, fd_flags);
 	if (is_local_fd && !(fd < 0)) {
 		rc = close(fd);
 		if (rc < 0) {
@@ -600,7 +1287,9 @@ static void display_qra(const qryRespArchiveData *qra_data, const uint32_t n,
 	char ins_str_date[128] = {0};
 	char exp_str_date[128] = {0};
 	struct obj_info_t obj_info;
-	memcpy(&obj_info, (char *)qra_data->objInfo, qra_data->objInfolen);
+	memset(&obj_info, 0, sizeof(obj_info));
+	memcpy(&obj_info, (char *)qra_data->objInfo,
+	       MIN(qra_data->objInfolen, sizeof(obj_info)));
 	date_to_str(ins_str_date, &(qra_data->insDate));
 	date_to_str(exp_str_date, &(qra_data->expDate));
 
@@ -763,6 +1452,9 @@ dsInt16_t tsm_connect(struct login_t *login, struct session_t *session)
 	}
 
 	strncpy(session->owner, login->owner, DSM_MAX_OWNER_LENGTH + 1);
+	session->rc_tsm = DSM_RC_OK;
+	session->reason_tsm = 0;
+	session->conn_lost = bFalse;
 
 	regFSData reg_fs_data;
 	memset(&reg_fs_data, 0, sizeof(reg_fs_data));
@@ -788,6 +1480,76 @@ dsInt16_t tsm_connect(struct login_t *login, struct session_t *session)
 void tsm_disconnect(struct session_t *session)
 {
 	dsmTerminate(session->handle);
+
+	if (session->compress) {
+		compress_destroy(session->compress);
+		free(session->compress);
+		session->compress = NULL;
+	}
+}
+
+/**
+ * @brief Check whether a TSM API error indicated a lost connection.
+ *
+ * Return codes of the tsm_* functions are often mapped to
+ * DSM_RC_UNSUCCESSFUL, thus inspect the session, which records any
+ * connection loss since it was connected.
+ *
+ * @param[in] session Session data.
+ * @return bTrue if connection to the TSM server is broken, otherwise bFalse.
+ */
+dsBool_t tsm_conn_lost(const struct session_t *session)
+{
+	return session->conn_lost;
+}
+
+/**
+ * @brief Verify session is alive by a lightweight server round trip.
+ *
+ * Query the management classes of the active policy set, which
+ * requires the server to respond, however does not touch any objects.
+ *
+ * @param[in] session Session data.
+ * @return DSM_RC_SUCCESSFUL on success otherwise TSM API error code.
+ */
+dsInt16_t tsm_check_session(struct session_t *session)
+{
+	dsInt16_t rc;
+	qryMCData qry_mc_data;
+	qryRespMCData qry_resp_mc_data;
+	DataBlk data_blk;
+
+	qry_mc_data.stVersion = qryMCDataVersion;
+	qry_mc_data.mcName = "";	/* All management classes. */
+	qry_mc_data.mcDetail = bFalse;
+
+	rc = dsmBeginQuery(session->handle, qtMC, &qry_mc_data);
+	TSM_DEBUG(session, rc, "dsmBeginQuery");
+	if (rc) {
+		TSM_ERROR(session, rc, "dsmBeginQuery");
+		return rc;
+	}
+
+	data_blk.stVersion = DataBlkVersion;
+	data_blk.bufferLen = sizeof(qry_resp_mc_data);
+	data_blk.bufferPtr = (char *)&qry_resp_mc_data;
+	qry_resp_mc_data.stVersion = qryRespMCDataVersion;
+
+	do {
+		rc = dsmGetNextQObj(session->handle, &data_blk);
+	} while (rc == DSM_RC_MORE_DATA);
+
+	if (rc != DSM_RC_FINISHED && rc != DSM_RC_ABORT_NO_MATCH) {
+		TSM_ERROR(session, rc, "dsmGetNextQObj");
+		dsmEndQuery(session->handle);
+		return rc;
+	}
+
+	rc = dsmEndQuery(session->handle);
+	if (rc)
+		TSM_ERROR(session, rc, "dsmEndQuery");
+
+	return rc;
 }
 
 /**
@@ -976,7 +1738,9 @@ static dsInt16_t tsm_query_hl_ll_date(const char *fs,
 	qryArchiveData qry_ar_data;
 	dsmObjName obj_name;
 	dsInt16_t rc;
+	const uint64_t ts = metrics_now();
 
+	TRACE_BEGIN("query");
 	strncpy(obj_name.fs, fs, DSM_MAX_FSNAME_LENGTH);
 	strncpy(obj_name.hl, hl, DSM_MAX_HL_LENGTH);
 	strncpy(obj_name.ll, ll, DSM_MAX_LL_LENGTH);
@@ -1053,6 +1817,9 @@ static dsInt16_t tsm_query_hl_ll_date(const char *fs,
 	}
 
 cleanup:
+	metrics_record(METRIC_QUERY, ts, 0);
+	TRACE_END("query");
+
 	return rc;
 }
 
@@ -1140,7 +1907,8 @@ static dsInt16_t obj_attr_prepare(ObjAttr *obj_attr,
 
 	obj_attr->stVersion = ObjAttrVersion;
 	obj_attr->mcNameP = NULL;
-	obj_attr->objCompressed = bFalse; /* Note: Currently no compression is supported. */
+	obj_attr->objCompressed = archive_info->obj_info.codec != COMPRESS_NONE ?
+		bTrue : bFalse;
 	obj_attr->objInfoLength = sizeof(struct obj_info_t);
 	obj_attr->objInfo = (char *)malloc(obj_attr->objInfoLength);
 	if (!obj_attr->objInfo) {
@@ -1184,19 +1952,182 @@ static dsInt16_t tsm_obj_update_crc32(ObjAttr *obj_attr,
 	return DSM_RC_SUCCESSFUL;
 }
 
-static dsInt16_t tsm_del_obj(const qryRespArchiveData *qry_resp_ar_data,
-			     struct session_t *session)
+/**
+ * @brief Store crc32 updates of all deferred objects in one transaction.
+ *
+ * @param[in] session Session data.
+ * @return DSM_RC_SUCCESSFUL on success otherwise DSM_RC_UNSUCCESSFUL.
+ */
+static dsInt16_t tsm_obj_update_crc32_flush(struct session_t *session)
 {
-	dsmDelInfo del_info;
 	dsInt16_t rc;
 	dsUint16_t err_reason;
 	dsUint8_t vote_txn = DSM_VOTE_COMMIT;
+	ObjAttr obj_attr;
+	uint64_t ts;
+
+	if (session->crc32_update_num == 0)
+		return DSM_RC_SUCCESSFUL;
 
+	TRACE_BEGIN("tsm_obj_update_crc32_flush");
 	rc = dsmBeginTxn(session->handle);
 	TSM_DEBUG(session, rc,  "dsmBeginTxn");
 	if (rc) {
 		TSM_ERROR(session, rc, "dsmBeginTxn");
-		return rc;
+		goto cleanup;
+	}
+
+	memset(&obj_attr, 0, sizeof(obj_attr));
+	obj_attr.stVersion = ObjAttrVersion;
+	obj_attr.objCompressed = bFalse;
+	obj_attr.objInfoLength = sizeof(struct obj_info_t);
+	for (uint32_t n = 0; n < session->crc32_update_num; n++) {
+		struct crc32_update_t *update = &session->crc32_update[n];
+
+		obj_attr.sizeEstimate = update->obj_info.size;
+		obj_attr.objInfo = (char *)&update->obj_info;
+		rc = dsmUpdateObj(session->handle, stArchive, NULL,
+				  &update->obj_name, &obj_attr,
+				  DSM_ARCHUPD_OBJINFO);
+		TSM_DEBUG(session, rc, "dsmUpdateObj");
+		if (rc) {
+			TSM_ERROR(session, rc, "dsmUpdateObj");
+			vote_txn = DSM_VOTE_ABORT;
+			break;
+		}
+	}
+
+	ts = metrics_now();
+	rc = dsmEndTxn(session->handle, vote_txn, &err_reason);
+	metrics_record(METRIC_TXN_COMMIT, ts, 0);
+	TSM_DEBUG(session, rc,  "dsmEndTxn");
+	if (rc || err_reason) {
+		TSM_ERROR(session, rc, "dsmEndTxn");
+		TSM_REASON(session, err_reason, "dsmEndTxn reason");
+	}
+	if (rc || err_reason || vote_txn == DSM_VOTE_ABORT) {
+		CT_ERROR(EFAILED, "crc32 of %u objects not stored",
+			 session->crc32_update_num);
+		rc = DSM_RC_UNSUCCESSFUL;
+	}
+
+cleanup:
+	session->crc32_update_num = 0;
+	TRACE_END("tsm_obj_update_crc32_flush");
+
+	return rc;
+}
+
+/**
+ * @brief Store crc32 of archived object.
+ *
+ * If the session defers updates (see tsm_archive_fpath), the update is
+ * queued and the queue is flushed in one transaction once it holds
+ * CRC32_UPDATE_BATCH objects. Otherwise dsmUpdateObj is called directly.
+ */
+static dsInt16_t tsm_obj_update_crc32_defer(ObjAttr *obj_attr,
+					    struct archive_info_t *archive_info,
+					    const uint32_t crc32,
+					    struct session_t *session)
+{
+	struct crc32_update_t *update;
+
+	if (!session->crc32_update || session->tsm_file)
+		return tsm_obj_update_crc32(obj_attr, archive_info, crc32,
+					    session);
+
+	update = &session->crc32_update[session->crc32_update_num++];
+	memcpy(&update->obj_name, &archive_info->obj_name,
+	       sizeof(update->obj_name));
+	memcpy(&update->obj_info, obj_attr->objInfo, sizeof(update->obj_info));
+	update->obj_info.crc32 = crc32;
+
+	if (session->crc32_update_num == CRC32_UPDATE_BATCH)
+		return tsm_obj_update_crc32_flush(session);
+
+	return DSM_RC_SUCCESSFUL;
+}
+
+/**
+ * @brief Get buffer of size bytes, from the shared buffer pool if it fits.
+ *
+ * @param[in] size Bytes required.
+ * @return Buffer to be released with inline_buf_put, NULL on error.
+ */
+static char *inline_buf_get(const size_t size)
+{
+	if (size <= TSM_BUF_LENGTH)
+		return bufpool_get(bufpool_default());
+
+	return malloc(size);
+}
+
+static void inline_buf_put(char *buf, const size_t size)
+{
+	if (size <= TSM_BUF_LENGTH)
+		bufpool_put(bufpool_default(), buf);
+	else
+		free(buf);
+}
+
+/**
+ * @brief Read small file completely and compute its crc32.
+ *
+ * @param[in]  fd   File descriptor positioned at the beginning.
+ * @param[in]  size Expected file size.
+ * @param[out] buf  Buffer holding the file data, released by caller with
+ *                  inline_buf_put.
+ * @param[out] crc  Computed crc32.
+ * @return DSM_RC_SUCCESSFUL on success otherwise DSM_RC_UNSUCCESSFUL.
+ */
+static dsInt16_t read_crc32_inline(int fd, const size_t size, char **buf,
+				   uint32_t *crc)
+{
+	ssize_t cur_read;
+	char c;
+	uint64_t ts;
+
+	*buf = inline_buf_get(size);
+	if (!*buf) {
+		CT_ERROR(errno, "inline_buf_get");
+		return DSM_RC_UNSUCCESSFUL;
+	}
+
+	ts = metrics_now();
+	cur_read = read_size(fd, *buf, size);
+	if (cur_read < 0) {
+		CT_ERROR(-cur_read, "read");
+		return DSM_RC_UNSUCCESSFUL;
+	}
+	metrics_record(METRIC_READ, ts, cur_read);
+	/* File shrank or grew since stat. */
+	if ((size_t)cur_read != size || read(fd, &c, 1) != 0) {
+		CT_ERROR(EIO, "file size changed while reading, "
+			 "expected %zu bytes", size);
+		return DSM_RC_UNSUCCESSFUL;
+	}
+
+	ts = metrics_now();
+	*crc = crc32(0, (const unsigned char *)*buf, size);
+	metrics_record(METRIC_CRC32, ts, size);
+
+	return DSM_RC_SUCCESSFUL;
+}
+
+static dsInt16_t tsm_del_obj(const qryRespArchiveData *qry_resp_ar_data,
+			     struct session_t *session)
+{
+	dsmDelInfo del_info;
+	dsInt16_t rc;
+	dsUint16_t err_reason;
+	dsUint8_t vote_txn = DSM_VOTE_COMMIT;
+	uint64_t ts;
+
+	rc = dsmBeginTxn(session->handle);
+	TSM_DEBUG(session, rc,  "dsmBeginTxn");
+	if (rc) {
+		TSM_ERROR(session, rc, "dsmBeginTxn");
+		return rc;
 	}
 
 	del_info.archInfo.stVersion = delArchVersion;
@@ -1211,11 +2142,13 @@ static dsInt16_t tsm_del_obj(const qryRespArchiveData *qry_resp_ar_data,
 	}
 
 cleanup_transaction:
+	ts = metrics_now();
 	rc = dsmEndTxn(session->handle, vote_txn, &err_reason);
+	metrics_record(METRIC_TXN_COMMIT, ts, 0);
 	TSM_DEBUG(session, rc,  "dsmEndTxn");
 	if (rc || err_reason) {
 		TSM_ERROR(session, rc, "dsmEndTxn");
-		TSM_ERROR(session, err_reason, "dsmEndTxn reason");
+		TSM_REASON(session, err_reason, "dsmEndTxn reason");
 	}
 
 	return rc;
@@ -1286,6 +2219,46 @@ cleanup:
 	return rc;
 }
 
+/**
+ * @brief Query objects of fpath into caller owned query table.
+ *
+ * In contrast to tsm_query_fpath the query table session->qtable is
+ * neither initialized, printed nor destroyed, such that several queries
+ * can be accumulated into the same table by the caller, who finally calls
+ * create_array and destroy_qtable.
+ *
+ * @param[in] fs               File space name.
+ * @param[in] fpath            Path (including wildcards) to query.
+ * @param[in] desc             Description or NULL.
+ * @param[in] date_lower_bound Lower bound of insertion date.
+ * @param[in] date_upper_bound Upper bound of insertion date.
+ * @param[in] session          Session with initialized qtable.
+ * @return DSM_RC_SUCCESSFUL on success otherwise DSM_RC_UNSUCCESSFUL.
+ */
+dsInt16_t tsm_query_fpath_qtable(const char *fs, const char *fpath,
+				 const char *desc,
+				 const dsmDate *date_lower_bound,
+				 const dsmDate *date_upper_bound,
+				 struct session_t *session)
+{
+	dsInt16_t rc;
+	char hl[DSM_MAX_HL_LENGTH + 1] = {0};
+	char ll[DSM_MAX_LL_LENGTH + 1] = {0};
+
+	rc = extract_hl_ll(fpath, fs, hl, ll);
+	if (rc) {
+		CT_ERROR(EFAILED, "extract_hl_ll");
+		return rc;
+	}
+	rc = tsm_query_hl_ll_date(fs, hl, ll, desc,
+				  date_lower_bound, date_upper_bound,
+				  session);
+	if (rc)
+		CT_ERROR(EFAILED, "tsm_query_hl_ll_date failed");
+
+	return rc;
+}
+
 dsInt16_t tsm_query_fpath(const char *fs, const char *fpath, const char *desc,
 			  const dsmDate *date_lower_bound,
 			  const dsmDate *date_upper_bound,
@@ -1331,7 +2304,24 @@ cleanup:
 	return rc;
 }
 
-static dsInt16_t tsm_retrieve_generic(int fd, struct session_t *session)
+/**
+ * @brief Retrieve array of queried objects.
+ *
+ * Retrieve the n objects of qra in array order, which should be the
+ * restore order of the objects (see SORT_RESTORE_ORDER), into fd or
+ * when fd < 0 into files named fs/hl/ll. Objects are retrieved in chunks
+ * of at most DSM_MAX_GET_OBJ objects. The caller owns qra, thus several
+ * sessions can retrieve disjoint parts of the same query array.
+ *
+ * @param[in] qra     Array of query responses.
+ * @param[in] n       Number of elements in qra.
+ * @param[in] fd      File descriptor or -1.
+ * @param[in] session Session with established connection.
+ * @return DSM_RC_SUCCESSFUL on success otherwise DSM_RC_UNSUCCESSFUL,
+ *         also if qra is empty.
+ */
+dsInt16_t tsm_retrieve_qra(const qryRespArchiveData *qra, const uint32_t n,
+			   int fd, struct session_t *session)
 {
 	dsInt16_t rc;
 	dsInt16_t rc_minor = 0;
@@ -1348,14 +2338,18 @@ static dsInt16_t tsm_retrieve_generic(int fd, struct session_t *session)
 	   the query replies in chunks of maximum size DSM_MAX_GET_OBJ and call
 	   dsmBeginGetData on each chunk. */
 	uint32_t c_begin = 0;
-	uint32_t c_end = MIN(session->qtable.qarray.size, DSM_MAX_GET_OBJ) - 1;
-	uint32_t c_total = ceil((double)session->qtable.qarray.size /
-				(double)DSM_MAX_GET_OBJ);
+	uint32_t c_end = MIN(n, DSM_MAX_GET_OBJ) - 1;
+	uint32_t c_total = ceil((double)n / (double)DSM_MAX_GET_OBJ);
 	uint32_t c_cur = 0;
 	uint32_t num_objs;
 	qryRespArchiveData query_data;
 	uint32_t i;
 
+	if (n == 0 || qra == NULL) {
+		CT_ERROR(ENODATA, "get_query has no match");
+		return DSM_RC_UNSUCCESSFUL;
+	}
+
 	do {
 		num_objs = c_end - c_begin + 1;
 
@@ -1367,22 +2361,13 @@ static dsInt16_t tsm_retrieve_generic(int fd, struct session_t *session)
 			CT_ERROR(rc, "malloc");
 			goto cleanup;
 		}
-		for (uint32_t c_iter = c_begin; c_iter <= c_end; c_iter++) {
-
-			rc = get_qra(&session->qtable, &query_data, c_iter);
-			CT_DEBUG("[rc=%d] get_qra: %lu", rc, c_iter);
-			if (rc != DSM_RC_SUCCESSFUL) {
-				errno = ENODATA; /* No data available */
-				CT_ERROR(errno, "get_query");
-				goto cleanup;
-			} else if (session->qtable.qarray.size == 0) {
-				CT_INFO("get_query has no match");
-				goto cleanup;
-			}
-			get_list.objId[i++] = query_data.objId;
-		}
+		for (uint32_t c_iter = c_begin; c_iter <= c_end; c_iter++)
+			get_list.objId[i++] = qra[c_iter].objId;
 
+		/* Includes waiting for tape mounts. */
+		TRACE_BEGIN("dsmBeginGetData");
 		rc = dsmBeginGetData(session->handle, bTrue /* mountWait */, gtArchive, &get_list);
+		TRACE_END("dsmBeginGetData");
 		TSM_DEBUG(session, rc,  "dsmBeginGetData");
 		if (rc) {
 			TSM_ERROR(session, rc, "dsmBeginGetData");
@@ -1392,25 +2377,32 @@ static dsInt16_t tsm_retrieve_generic(int fd, struct session_t *session)
 		struct obj_info_t obj_info;
 		for (uint32_t c_iter = c_begin; c_iter <= c_end; c_iter++) {
 
-			rc = get_qra(&session->qtable, &query_data, c_iter);
-			CT_DEBUG("[rc=%d] get_qra: %lu", rc, c_iter);
-			if (rc != DSM_RC_SUCCESSFUL) {
-				rc_minor = ENODATA; /* No data available */
-				CT_ERROR(rc_minor, "get_query");
-				goto cleanup_getdata;
-			}
+			query_data = qra[c_iter];
+			/* Objects archived with MAGIC_ID_V1 have no flags,
+			   with MAGIC_ID_V2 no codec. */
+			memset(&obj_info, 0, sizeof(obj_info));
 			memcpy(&obj_info,
 			       (char *)&(query_data.objInfo),
-			       query_data.objInfolen);
-
-			if (obj_info.magic != MAGIC_ID_V1)
-				CT_WARN("object magic mismatch MAGIC_ID: %d",
-					obj_info.magic);
+			       MIN(query_data.objInfolen, sizeof(obj_info)));
+
+			/* Data of unknown formats may contain sparse
+			   headers or compressed frames, it cannot be
+			   restored. */
+			if (obj_info.magic != MAGIC_ID_V1 &&
+			    obj_info.magic != MAGIC_ID_V2 &&
+			    obj_info.magic != MAGIC_ID_V3) {
+				rc_minor = DSM_RC_UNSUCCESSFUL;
+				CT_ERROR(EPROTO, "object magic mismatch "
+					 "MAGIC_ID: %d", obj_info.magic);
+				goto cleanup_getdata;
+			}
 
 			display_qra(&query_data, c_iter, "[retrieve]");
 			switch (query_data.objName.objType) {
 			case DSM_OBJ_FILE: {
+				TRACE_BEGIN("retrieve_obj");
 				rc_minor = retrieve_obj(&query_data, &obj_info, fd, session);
+				TRACE_END("retrieve_obj");
 				CT_DEBUG("[rc=%d] retrieve_obj", rc_minor);
 				if (rc_minor != DSM_RC_SUCCESSFUL) {
 					CT_ERROR(EFAILED, "retrieve_obj failed");
@@ -1446,7 +2438,9 @@ static dsInt16_t tsm_retrieve_generic(int fd, struct session_t *session)
 		} /* End-for iterate objid's. */
 cleanup_getdata:
 		/* There are no return codes that are specific to this call. */
+		TRACE_BEGIN("dsmEndGetData");
 		rc = dsmEndGetData(session->handle);
+		TRACE_END("dsmEndGetData");
 		TSM_DEBUG(session, rc,  "dsmEndGetData");
 		if (rc_minor)
 			break;
@@ -1454,8 +2448,8 @@ cleanup_getdata:
 		c_cur++;
 		c_begin = c_end + 1;
 		/* Process last chunk and size not a multiple of DSM_MAX_GET_OBJ.*/
-		c_end = (c_cur == c_total - 1 && session->qtable.qarray.size % DSM_MAX_GET_OBJ != 0) ?
-			c_begin + (session->qtable.qarray.size % DSM_MAX_GET_OBJ) - 1 :
+		c_end = (c_cur == c_total - 1 && n % DSM_MAX_GET_OBJ != 0) ?
+			c_begin + (n % DSM_MAX_GET_OBJ) - 1 :
 			c_begin + DSM_MAX_GET_OBJ - 1; /* Process not last chunk. */
 	} while (c_cur < c_total);
 
@@ -1502,17 +2496,124 @@ dsInt16_t tsm_retrieve_fpath(const char *fs, const char *fpath,
 		CT_ERROR(EFAILED, "create_array failed");
 		goto cleanup;
 	}
-	rc = tsm_retrieve_generic(fd, session);
+	rc = tsm_retrieve_qra(session->qtable.qarray.data,
+			      session->qtable.qarray.size, fd, session);
 	if (rc)
-		CT_ERROR(EFAILED, "tsm_retrieve_generic failed");
+		CT_ERROR(EFAILED, "tsm_retrieve_qra failed");
 
 cleanup:
 	destroy_qtable(&session->qtable);
 	return rc;
 }
 
+/* Data stream of an archived file. */
+struct archive_src_t {
+	int fd;
+	const char *inline_buf;	/* Data read upfront, otherwise NULL. */
+	struct sparse_t *sparse;	/* Extents of sparse file, otherwise NULL. */
+	size_t size;		/* Bytes of inline data. */
+	size_t pos;		/* Bytes of inline data read. */
+	dsBool_t direct;	/* O_DIRECT is set on fd. */
+	dsBool_t dontneed;	/* Evict data read buffered from page cache. */
+	off64_t dontneed_pos;
+	uint32_t crc32;		/* Of file data read, excluding inline data. */
+};
+
+/**
+ * @brief Read next block of the data stream of an archived file.
+ *
+ * @param[in,out] src  Data stream.
+ * @param[in]     buf  DIRECT_IO_ALIGN aligned buffer of TSM_BUF_LENGTH
+ *                     bytes, not used for inline data.
+ * @param[out]    data Read data, either buf or part of the inline data.
+ * @return Number of read bytes, 0 at end of stream, otherwise negative
+ *         errno.
+ */
+static ssize_t archive_read(struct archive_src_t *src, char *buf,
+			    const char **data)
+{
+	ssize_t cur_read;
+	uint64_t ts;
+
+	*data = buf;
+	if (src->inline_buf) {
+		cur_read = MIN(src->size - src->pos, TSM_BUF_LENGTH);
+		*data = src->inline_buf + src->pos;
+		src->pos += cur_read;
+		return cur_read;
+	}
+
+	ts = metrics_now();
+	if (src->sparse)
+		cur_read = sparse_read(src->fd, src->sparse, buf,
+				       TSM_BUF_LENGTH, &src->crc32);
+	else if (src->direct)
+		cur_read = read_direct(src->fd, buf, TSM_BUF_LENGTH,
+				       &src->direct);
+	else {
+		cur_read = read(src->fd, buf, TSM_BUF_LENGTH);
+		if (cur_read < 0)
+			cur_read = -errno;
+	}
+	if (cur_read <= 0)
+		return cur_read;
+	metrics_record(METRIC_READ, ts, cur_read);
+
+	if (src->sparse)
+		return cur_read;
+
+	ts = metrics_now();
+	src->crc32 = crc32(src->crc32, (const unsigned char *)buf, cur_read);
+	metrics_record(METRIC_CRC32, ts, cur_read);
+
+	if (src->dontneed && !src->direct) {
+		const off64_t pos = lseek(src->fd, 0, SEEK_CUR);
+
+		if (pos - src->dontneed_pos >= DONTNEED_BYTES) {
+			posix_fadvise(src->fd, src->dontneed_pos,
+				      pos - src->dontneed_pos,
+				      POSIX_FADV_DONTNEED);
+			src->dontneed_pos = pos;
+		}
+	}
+
+	return cur_read;
+}
+
+/**
+ * @brief Compression of the session, started on first use.
+ *
+ * @return Compression or NULL if disabled or not available.
+ */
+static struct compress_t *session_compress(struct session_t *session)
+{
+	int rc;
+
+	if (session->compress_codec == COMPRESS_NONE || session->compress)
+		return session->compress;
+
+	session->compress = calloc(1, sizeof(struct compress_t));
+	if (!session->compress) {
+		CT_ERROR(errno, "calloc");
+		return NULL;
+	}
+	rc = compress_init(session->compress, session->compress_codec,
+			   session->compress_level, COMPRESS_THREADS);
+	if (rc) {
+		CT_WARN("[rc=%d] compress_init of codec '%s' failed, archive "
+			"uncompressed", rc,
+			compress_name(session->compress_codec));
+		free(session->compress);
+		session->compress = NULL;
+		session->compress_codec = COMPRESS_NONE;
+	}
+
+	return session->compress;
+}
+
 static dsInt16_t tsm_archive_generic(struct archive_info_t *archive_info,
-				     int fd, struct session_t *session)
+				     int fd, struct prefetch_file_t *pfile,
+				     struct session_t *session)
 {
 	dsInt16_t rc;
 	dsInt16_t rc_minor = 0;
@@ -1528,11 +2629,32 @@ static dsInt16_t tsm_archive_generic(struct archive_info_t *archive_info,
 	dsUint8_t vote_txn;
 	dsBool_t is_local_fd = bFalse;
 	uint32_t crc32sum = 0;
+	uint64_t ts;
+	char *buf = NULL;
+	char *inline_buf = NULL;
+	dsBool_t is_sparse = bFalse;
+	struct sparse_t sparse;
+	struct archive_src_t src;
+	struct compress_t *compress = NULL;
+	int fd_flags = -1;
+	dsBool_t prefetched = bFalse;
 
 	data_blk.bufferPtr = NULL;
 	obj_attr.objInfo = NULL;
+	memset(&sparse, 0, sizeof(sparse));
+	memset(&src, 0, sizeof(src));
+
+	/* Data of file was read ahead and checksummed already, unless the
+	   file was modified or replaced since it was read. */
+	if (pfile && prefetch_wait(session->prefetch, pfile) == 0 &&
+	    archive_info->obj_name.objType == DSM_OBJ_FILE &&
+	    !prefetch_modified(&pfile->st, &archive_info->st)) {
+		inline_buf = pfile->data;
+		crc32sum = pfile->crc32;
+		prefetched = bTrue;
+	}
 
-	if (fd < 0) {
+	if (fd < 0 && !prefetched) {
 		fd = open(archive_info->fpath, O_RDONLY,
 			  archive_info->obj_info.st_mode);
 		if (fd < 0) {
@@ -1542,6 +2664,53 @@ static dsInt16_t tsm_archive_generic(struct archive_info_t *archive_info,
 		is_local_fd = bTrue;
 	}
 
+	TRACE_BEGIN("tsm_archive_generic");
+	/* Small files are read and checksummed upfront, such that the
+	   crc32 is part of objInfo at dsmSendObj and no dsmUpdateObj round
+	   trip is required after the transaction. Directories have crc32 0
+	   anyway. */
+	archive_info->obj_info.crc32 = 0;
+	archive_info->obj_info.flags = 0;
+	archive_info->obj_info.codec = COMPRESS_NONE;
+	archive_info->obj_info.raw_size = archive_info->obj_info.size;
+	if (prefetched)
+		archive_info->obj_info.crc32 = crc32sum;
+	else if (archive_info->obj_name.objType == DSM_OBJ_FILE &&
+	    (uint64_t)to_off64_t(archive_info->obj_info.size) <=
+	    crc32_inline_bytes) {
+		rc = read_crc32_inline(fd,
+				       to_off64_t(archive_info->obj_info.size),
+				       &inline_buf, &crc32sum);
+		if (rc)
+			goto cleanup;
+		archive_info->obj_info.crc32 = crc32sum;
+	} else if (archive_info->obj_name.objType == DSM_OBJ_FILE) {
+		/* Send data extents only, holes are recreated on retrieve. */
+		rc = sparse_map(fd, to_off64_t(archive_info->obj_info.size),
+				&sparse);
+		if (rc < 0)
+			CT_WARN("[rc=%d] sparse_map failed on '%s', archive "
+				"all data", rc, archive_info->fpath);
+		is_sparse = rc == 1 ? bTrue : bFalse;
+		if (is_sparse) {
+			archive_info->obj_info.flags |= OBJ_INFO_SPARSE;
+			archive_info->obj_info.raw_size =
+				to_dsStruct64_t(sparse.stream);
+			CT_INFO("archive sparse '%s' with %u extents, %zu of "
+				"%zu bytes", archive_info->fpath,
+				sparse.hdr.num, (size_t)sparse.stream,
+				(size_t)to_off64_t(archive_info->obj_info.size));
+		}
+	}
+
+	/* Blocks of the data stream, that is the extents of sparse files,
+	   are compressed in parallel. */
+	if (archive_info->obj_name.objType == DSM_OBJ_FILE) {
+		compress = session_compress(session);
+		if (compress)
+			archive_info->obj_info.codec = compress->codec;
+	}
+
 	/* Start transaction. */
 	rc = dsmBeginTxn(session->handle);
 	TSM_DEBUG(session, rc,  "dsmBeginTxn");
@@ -1569,10 +2738,23 @@ static dsInt16_t tsm_archive_generic(struct archive_info_t *archive_info,
 	rc = obj_attr_prepare(&obj_attr, archive_info);
 	if (rc)
 		goto cleanup_transaction;
+	if (is_sparse)
+		obj_attr.sizeEstimate = to_dsStruct64_t(sparse.stream);
+	/* Upper bound, incompressible blocks are stored as is. */
+	if (compress) {
+		const uint64_t raw_size =
+			to_off64_t(archive_info->obj_info.raw_size);
+
+		obj_attr.sizeEstimate = to_dsStruct64_t(
+			raw_size + howmany(raw_size, COMPRESS_BLOCK) *
+			sizeof(struct compress_frame_t) + (raw_size == 0));
+	}
 
 	/* Start sending object. */
+	TRACE_BEGIN("dsmSendObj");
 	rc = dsmSendObj(session->handle, stArchive, &arch_data,
 			&(archive_info->obj_name), &obj_attr, NULL);
+	TRACE_END("dsmSendObj");
 	TSM_DEBUG(session, rc,  "dsmSendObj");
 	if (rc) {
 		TSM_ERROR(session, rc, "dsmSendObj");
@@ -1580,44 +2762,125 @@ static dsInt16_t tsm_archive_generic(struct archive_info_t *archive_info,
 	}
 
 	if (archive_info->obj_name.objType == DSM_OBJ_FILE) {
-		data_blk.bufferPtr = (char *)malloc(sizeof(char) * TSM_BUF_LENGTH);
-		if (!data_blk.bufferPtr) {
-			rc = errno;
-			CT_ERROR(rc, "malloc");
-			goto cleanup_transaction;
+		/* Compression reads into the buffers of its jobs. */
+		if (!inline_buf && !compress) {
+			buf = bufpool_get(bufpool_default());
+			if (!buf) {
+				rc = DSM_RC_UNSUCCESSFUL;
+				CT_ERROR(errno, "bufpool_get");
+				goto cleanup_transaction;
+			}
+		}
+		src.fd = fd;
+		src.inline_buf = inline_buf;
+		src.size = to_off64_t(archive_info->obj_info.size);
+		src.sparse = is_sparse ? &sparse : NULL;
+		src.crc32 = crc32sum;
+		/* Bypass the page cache with O_DIRECT, if not supported
+		   fall back to POSIX_FADV_DONTNEED behind the read
+		   position. */
+		if (session->archive_direct && !inline_buf && !is_sparse) {
+			struct stat st;
+
+			src.dontneed = bTrue;
+			src.dontneed_pos = lseek(fd, 0, SEEK_CUR);
+			fd_flags = fcntl(fd, F_GETFL);
+			if (src.dontneed_pos >= 0 && fd_flags >= 0 &&
+			    src.dontneed_pos % DIRECT_IO_ALIGN == 0 &&
+			    fstat(fd, &st) == 0 && S_ISREG(st.st_mode) &&
+			    fcntl(fd, F_SETFL, fd_flags | O_DIRECT) == 0)
+				src.direct = bTrue;
+			else
+				CT_DEBUG("[fd=%d] O_DIRECT not supported, use "
+					 "POSIX_FADV_DONTNEED", fd);
+			if (src.dontneed_pos < 0)
+				src.dontneed_pos = 0;
 		}
 		data_blk.stVersion = DataBlkVersion;
 		ssize_t total_size = to_off64_t(archive_info->obj_info.size);
+		dsBool_t src_eof = bFalse;
 
+		progress_reset(session);
 		while (!done) {
-
-			cur_read = read(fd, data_blk.bufferPtr, TSM_BUF_LENGTH);
-			if (cur_read < 0) {
-				CT_ERROR(errno, "read");
-				rc_minor = DSM_RC_UNSUCCESSFUL;
-				goto cleanup_transaction;
-			} else if (cur_read == 0)
+			struct compress_job_t *job = NULL;
+			const char *data = NULL;
+			size_t data_len = 0;
+
+			if (compress) {
+				/* Read ahead while workers compress the
+				   submitted blocks. */
+				while (!src_eof &&
+				       (job = compress_job(compress))) {
+					cur_read = archive_read(&src, job->in,
+								&job->data);
+					if (cur_read < 0) {
+						CT_ERROR(-cur_read,
+							 "archive_read");
+						rc_minor = DSM_RC_UNSUCCESSFUL;
+						goto cleanup_transaction;
+					}
+					if (cur_read == 0) {
+						src_eof = bTrue;
+						break;
+					}
+					job->len = cur_read;
+					compress_submit(compress, job);
+				}
+				job = compress_wait(compress);
+				if (job && job->rc) {
+					CT_ERROR(-job->rc, "compress");
+					rc_minor = DSM_RC_UNSUCCESSFUL;
+					goto cleanup_transaction;
+				}
+				cur_read = job ? (ssize_t)job->len : 0;
+				data = job ? job->frame : NULL;
+				data_len = job ? job->frame_len : 0;
+			} else {
+				cur_read = archive_read(&src, buf, &data);
+				if (cur_read < 0) {
+					CT_ERROR(-cur_read, "archive_read");
+					rc_minor = DSM_RC_UNSUCCESSFUL;
+					goto cleanup_transaction;
+				}
+				data_len = cur_read;
+			}
+			if (cur_read == 0) {
 				/* Zero indicates end of file. */
 				done = bTrue;
-			else {
+				if (is_sparse)
+					src.crc32 = crc32_zeros(src.crc32,
+								total_size -
+								sparse.end);
+
+				/* Report pending progress. */
+				if (session->progress != NULL) {
+					rc_minor = progress_dispatch(
+						session, 0, total_read,
+						total_size, bTrue);
+					if (rc_minor)
+						goto cleanup_transaction;
+				}
+			} else {
 				total_read += cur_read;
-				data_blk.bufferLen = cur_read;
+				data_blk.bufferPtr = (char *)data;
+				data_blk.bufferLen = data_len;
 
 				data_blk.numBytes = 0;
+				ts = metrics_now();
 				rc = dsmSendData(session->handle, &data_blk);
+				metrics_record(METRIC_SEND_DATA, ts,
+					       data_blk.numBytes);
 				TSM_DEBUG(session, rc,  "dsmSendData");
 				if (rc) {
 					TSM_ERROR(session, rc, "dsmSendData");
 					goto cleanup_transaction;
 				}
 				CT_INFO("cur_read: %zu, total_read: %zu,"
-					" total_size: %zu", cur_read,
-					total_read, total_size);
-
-				crc32sum = crc32(crc32sum,
-						 (const unsigned char *)
-						 data_blk.bufferPtr,
-						 data_blk.numBytes);
+					" total_size: %zu, sent: %u", cur_read,
+					total_read, total_size,
+					data_blk.numBytes);
+				if (job)
+					compress_release(compress);
 
 				if (data_blk.numBytes != data_blk.bufferLen)
 					CT_WARN("dsmSendData transmitted %u"
@@ -1627,34 +2890,20 @@ static dsInt16_t tsm_archive_generic(struct archive_info_t *archive_info,
 
 				/* Function callback on progress */
 				if (session->progress != NULL) {
-					struct progress_size_t progress_size = {
-						.cur = cur_read,
-						.cur_total = total_read,
-						.total = total_size
-					};
-					rc_minor = session->progress(
-						&progress_size, session);
-					if (rc_minor) {
-						if (rc_minor == -ECANCELED)
-							CT_WARN("progress "
-								"operation "
-								"canceled");
-						else
-							CT_ERROR(rc_minor,
-								 "progress "
-								 "function "
-								 "callback "
-								 "failed");
-
-	 					goto cleanup_transaction;
-	 				}
+					rc_minor = progress_dispatch(
+						session, cur_read, total_read,
+						total_size, bFalse);
+					if (rc_minor)
+						goto cleanup_transaction;
 				}
 			}
 		}
+		crc32sum = src.crc32;
 		/* File obj. was archived, verify that the number of bytes read
 		   from file descriptor matches the number of bytes we
 		   transfered with dsmSendData. */
-		success = total_read == to_off64_t(archive_info->obj_info.size) ?
+		success = total_read == (is_sparse ? (ssize_t)sparse.stream :
+					 to_off64_t(archive_info->obj_info.size)) ?
 			bTrue : bFalse;
 	} else /* dsmSendObj was successful and we archived a directory obj. */
 		success = bTrue;
@@ -1670,11 +2919,15 @@ cleanup_transaction:
 	/* Commit transaction (DSM_VOTE_COMMIT) on success, otherwise
 	   roll back current transaction (DSM_VOTE_ABORT). */
 	vote_txn = success == bTrue ? DSM_VOTE_COMMIT : DSM_VOTE_ABORT;
+	TRACE_BEGIN("dsmEndTxn");
+	ts = metrics_now();
 	rc = dsmEndTxn(session->handle, vote_txn, &err_reason);
+	metrics_record(METRIC_TXN_COMMIT, ts, 0);
+	TRACE_END("dsmEndTxn");
 	TSM_DEBUG(session, rc,  "dsmEndTxn");
 	if (rc || err_reason) {
 		TSM_ERROR(session, rc, "dsmEndTxn");
-		TSM_ERROR(session, err_reason, "dsmEndTxn reason");
+		TSM_REASON(session, err_reason, "dsmEndTxn reason");
 		success = bFalse;
 	}
 	if (success) {
@@ -1701,19 +2954,39 @@ cleanup_transaction:
 				archive_info->obj_name.ll,
 				archive_info->desc);
 		}
-		rc = tsm_obj_update_crc32(&obj_attr, archive_info, crc32sum,
-					  session);
-		CT_DEBUG("[rc=%d] tsm_obj_update_crc32, crc32: 0x%08x (%010u)",
-			 rc, crc32sum, crc32sum);
-		if (rc)
-			CT_ERROR(EFAILED, "tsm_obj_update_crc32");
+		/* Large files only, objInfo of small files and directories
+		   already holds the final crc32. */
+		if (archive_info->obj_name.objType == DSM_OBJ_FILE &&
+		    !inline_buf) {
+			rc = tsm_obj_update_crc32_defer(&obj_attr,
+							archive_info,
+							crc32sum, session);
+			CT_DEBUG("[rc=%d] tsm_obj_update_crc32_defer, "
+				 "crc32: 0x%08x (%010u)",
+				 rc, crc32sum, crc32sum);
+			if (rc)
+				CT_ERROR(EFAILED, "tsm_obj_update_crc32_defer");
+		}
 	}
 
 cleanup:
+	/* Wait for blocks still compressed after an error. */
+	while (compress && compress_wait(compress))
+		compress_release(compress);
 	if (obj_attr.objInfo)
 		free(obj_attr.objInfo);
-	if (data_blk.bufferPtr)
-		free(data_blk.bufferPtr);
+	bufpool_put(bufpool_default(), buf);
+	if (inline_buf && !prefetched)
+		inline_buf_put(inline_buf,
+			       to_off64_t(archive_info->obj_info.size));
+	if (sparse.extent)
+		free(sparse.extent);
+	if (fd_flags >= 0 && fcntl(fd, F_GETFL) != fd_flags)
+		fcntl(fd, F_SETFL, fd_flags);
+	/* Evict data read buffered, including inline and sparse reads. */
+	if (session->archive_direct && !src.direct && fd >= 0 &&
+	    archive_info->obj_name.objType == DSM_OBJ_FILE)
+		posix_fadvise(fd, src.dontneed_pos, 0, POSIX_FADV_DONTNEED);
 
 	if (is_local_fd && !(fd < 0)) {
 		rc = close(fd);
@@ -1723,6 +2996,7 @@ cleanup:
 		}
 
 	}
+	TRACE_END("tsm_archive_generic");
 
 	return (rc_minor ? DSM_RC_UNSUCCESSFUL : rc);
 }
@@ -1768,8 +3042,9 @@ static dsInt16_t tsm_archive_prepare(const char *fs, const char *fpath,
 		rc = DSM_RC_UNSUCCESSFUL;
 		goto cleanup;
 	}
+	archive_info->st = st_buf;
 	archive_info->obj_info.size = to_dsStruct64_t(st_buf.st_size);
-	archive_info->obj_info.magic = MAGIC_ID_V1;
+	archive_info->obj_info.magic = MAGIC_ID_V3;
 	archive_info->obj_info.st_mode = st_buf.st_mode;
 
 	if (S_ISREG(st_buf.st_mode))
@@ -1812,6 +3087,43 @@ cleanup:
 	return rc;
 }
 
+/* Directory entry read before it is archived, such that regular files
+   are read ahead while preceding entries are archived. */
+struct dir_ahead_t {
+	struct dirent entry;
+	size_t size;		/* Of regular file, otherwise 0. */
+	struct prefetch_file_t *pfile;
+};
+
+static void dir_ahead_prefetch(const char *dpath, struct dir_ahead_t *ahead,
+			       const dsBool_t do_stat, struct session_t *session)
+{
+	char path[PATH_MAX + 1];
+	struct stat st_buf;
+
+	if (!(ahead->entry.d_type == DT_REG ||
+	      ahead->entry.d_type == DT_UNKNOWN) || ahead->pfile)
+		return;
+	if (snprintf(path, sizeof(path), "%s/%s", dpath,
+		     ahead->entry.d_name) >= (int)sizeof(path))
+		return;
+	if (do_stat) {
+		if (lstat(path, &st_buf) || !S_ISREG(st_buf.st_mode))
+			return;
+		/* Sparse files are archived by data extents only. */
+		if ((uint64_t)st_buf.st_size > crc32_inline_bytes &&
+		    st_buf.st_blocks * 512 + SPARSE_HOLE_BYTES <=
+		    st_buf.st_size)
+			return;
+		ahead->size = st_buf.st_size;
+	}
+	/* Empty files and files exceeding the remaining budget are read
+	   when archived. */
+	if (ahead->size > 0)
+		prefetch_add(session->prefetch, path, ahead->size,
+			     &ahead->pfile);
+}
+
 static dsInt16_t tsm_archive_recursive(struct archive_info_t *archive_info,
 				       struct session_t *session)
 {
@@ -1822,33 +3134,80 @@ static dsInt16_t tsm_archive_recursive(struct archive_info_t *archive_info,
 	char dpath[PATH_MAX + 1] = {0};
         int path_len;
 	int old_errno;
+	const uint16_t window = session->prefetch ? prefetch_files + 1 : 1;
+	struct dir_ahead_t *ahead;
+	struct prefetch_file_t *pfile = NULL;
+	uint16_t head = 0;
+	uint16_t count = 0;
+	dsBool_t eof = bFalse;
+	dsBool_t restat = bFalse;
 
 	/* TODO: Still not happy with this implementation.
 	   There must be a smarter and more elegant approach. */
 	strncpy(dpath, archive_info->fpath, sizeof(dpath));
 
+	ahead = calloc(window, sizeof(struct dir_ahead_t));
+	if (!ahead) {
+		rc = errno;
+		CT_ERROR(rc, "calloc");
+		return rc;
+	}
+
         dir = opendir(dpath);
         if (!dir) {
 		rc = errno;
 		CT_ERROR(rc, "opendir: %s", dpath);
+		free(ahead);
 		return rc;
         }
         while (1) {
-		old_errno = errno;
-                entry = readdir(dir);
-                if (!entry) {
-			/* End of dir stream, NULL is returned and errno
-			   is not changed. */
-			if (errno == old_errno) {
-				rc = DSM_RC_SUCCESSFUL;
-				break;
-			}
-			else {
-				rc = errno;
-				CT_ERROR(rc, "readdir: %s", dpath);
+		if (pfile) {
+			prefetch_release(session->prefetch, pfile);
+			pfile = NULL;
+		}
+
+		/* Keep up to window entries read ahead, regular files among
+		   them are prefetched as long as the budget permits. */
+		while (!eof && count < window) {
+			struct dir_ahead_t *next;
+
+			old_errno = errno;
+			entry = readdir(dir);
+			if (!entry) {
+				/* End of dir stream, NULL is returned and
+				   errno is not changed. */
+				eof = bTrue;
+				if (errno != old_errno) {
+					rc = errno;
+					CT_ERROR(rc, "readdir: %s", dpath);
+					goto cleanup;
+				}
 				break;
 			}
-                }
+			next = &ahead[(head + count++) % window];
+			memcpy(&next->entry, entry, sizeof(struct dirent));
+			next->size = 0;
+			next->pfile = NULL;
+			if (session->prefetch)
+				dir_ahead_prefetch(dpath, next, bTrue,
+						   session);
+		}
+		/* Retry files skipped due to exhausted budget, or released
+		   before descending into a subdirectory. */
+		for (uint16_t n = 0; session->prefetch && n < count; n++)
+			dir_ahead_prefetch(dpath, &ahead[(head + n) % window],
+					   restat, session);
+		restat = bFalse;
+		if (count == 0) {
+			rc = DSM_RC_SUCCESSFUL;
+			break;
+		}
+		entry = &ahead[head].entry;
+		pfile = ahead[head].pfile;
+		ahead[head].pfile = NULL;
+		head = (head + 1) % window;
+		count--;
+
                 path_len = snprintf(path, PATH_MAX, "%s/%s", dpath,
 				    entry->d_name);
                 if (path_len >= PATH_MAX) {
@@ -1888,7 +3247,8 @@ static dsInt16_t tsm_archive_recursive(struct archive_info_t *archive_info,
 					archive_info->obj_name.ll);
 				break;
 			}
-			rc = tsm_archive_generic(archive_info, -1, session);
+			rc = tsm_archive_generic(archive_info, -1, pfile,
+						 session);
 			if (rc)
 				CT_WARN("tsm_archive_generic failed: %s", archive_info->fpath);
 			break;
@@ -1910,7 +3270,8 @@ static dsInt16_t tsm_archive_recursive(struct archive_info_t *archive_info,
 					archive_info->obj_name.ll);
 				break;
 			}
-			rc = tsm_archive_generic(archive_info, -1, session);
+			rc = tsm_archive_generic(archive_info, -1, NULL,
+						 session);
 			if (rc) {
 				CT_WARN("tsm_archive_generic failed: %s", archive_info->fpath);
 				break;
@@ -1927,6 +3288,20 @@ static dsInt16_t tsm_archive_recursive(struct archive_info_t *archive_info,
 				}
 				memset(archive_info->fpath, 0, sizeof(archive_info->fpath));
 				memcpy(archive_info->fpath, _fpath, sizeof(archive_info->fpath));
+				/* Prefetched files of this directory would get
+				   stale and hold budget of the subdirectory. */
+				for (uint16_t n = 0; session->prefetch &&
+					     n < count; n++) {
+					struct dir_ahead_t *next =
+						&ahead[(head + n) % window];
+
+					if (next->pfile) {
+						prefetch_release(session->prefetch,
+								 next->pfile);
+						next->pfile = NULL;
+					}
+				}
+				restat = bTrue;
 				rc = tsm_archive_recursive(archive_info, session);
 			}
 			break;
@@ -1937,6 +3312,16 @@ static dsInt16_t tsm_archive_recursive(struct archive_info_t *archive_info,
 			break;
 		}
         }
+cleanup:
+	if (pfile)
+		prefetch_release(session->prefetch, pfile);
+	for (uint16_t n = 0; n < count; n++) {
+		struct dir_ahead_t *next = &ahead[(head + n) % window];
+
+		if (next->pfile)
+			prefetch_release(session->prefetch, next->pfile);
+	}
+	free(ahead);
         closedir(dir);
 
         return rc;
@@ -1991,43 +3376,59 @@ dsInt16_t tsm_archive_fpath(const char *fs, const char *fpath, const char *desc,
 	/* If fpath is a directory D, then archive D and all regular files
 	   inside D. If do_recursive is bTrue, archive recursively
 	   regular files and directories inside D. */
-	if (archive_info.obj_name.objType == DSM_OBJ_DIRECTORY)
+	if (archive_info.obj_name.objType == DSM_OBJ_DIRECTORY) {
+		dsInt16_t rc_flush;
+
+		/* Batch the crc32 updates of large files inside D into
+		   few transactions instead of one round trip per file. */
+		session->crc32_update = calloc(CRC32_UPDATE_BATCH,
+					       sizeof(struct crc32_update_t));
+		if (!session->crc32_update)
+			CT_WARN("calloc failed, crc32 updates not batched");
+		session->crc32_update_num = 0;
+
+		/* Read ahead regular files while the current one is sent. */
+		if (prefetch_files > 0 && prefetch_threads > 0) {
+			session->prefetch = calloc(1, sizeof(struct prefetch_t));
+			if (!session->prefetch ||
+			    prefetch_init(session->prefetch, prefetch_threads,
+					  prefetch_bytes, PREFETCH_CHUNK,
+					  session->archive_direct)) {
+				CT_WARN("prefetch not available, files are "
+					"read when archived");
+				free(session->prefetch);
+				session->prefetch = NULL;
+			}
+		}
+
 		/* Archive (recursively) inside D. */
-		return tsm_archive_recursive(&archive_info, session);
-	else
-		/* Archive regular file. */
-		return tsm_archive_generic(&archive_info, fd, session);
+		rc = tsm_archive_recursive(&archive_info, session);
 
-	return rc;
+		if (session->prefetch) {
+			prefetch_destroy(session->prefetch);
+			free(session->prefetch);
+			session->prefetch = NULL;
+		}
+
+		rc_flush = tsm_obj_update_crc32_flush(session);
+		free(session->crc32_update);
+		session->crc32_update = NULL;
+
+		return rc ? rc : rc_flush;
+	}
+
+	/* Archive regular file. */
+	return tsm_archive_generic(&archive_info, fd, NULL, session);
 }
 
 
-/**
- * @brief Send dummy object to find the maximum number of mountpoints.
- *
- * The TSM API allows to create multiple sessions, thus
- * enabling multithreaded operations. This however requires, that the TSM server
- * has enabled multiple parallel mount points. There exists no low level TSM API
- * function to query this value. This function should be called by threaded
- * applications (e.g. lhsmtool_tsm) having multiple sessions opened to find
- * maximum number of allowed mountpoints (alias the number of maxium threads)
- * by sending DSM_OBJ_DIRECTORY and verifying whether transaction was
- * successful.
- *
- * @param[in] fs File space name.
- * @param[in] session Active session.
- * @return    DSM_RC_SUCCESSFUL on succes, otherwise ECONNABORTED, or
- *            ECONNREFUSED if maximum number of mountpoints is exceeded.
- */
-dsInt16_t tsm_check_free_mountp(const char *fs, struct session_t *session)
+static dsInt16_t mountp_probe_info(const char *fs,
+				   struct archive_info_t *archive_info)
 {
-	dsInt16_t rc;
-
-	const char hl[] = "/.mount";
-	const char ll[] = "/.test-maxnummp";
+	const char hl[] = MOUNTP_PROBE_HL;
+	const char ll[] = MOUNTP_PROBE_LL;
 	const size_t len_fs = strlen(fs);
 	const size_t len = len_fs + strlen(hl) + strlen(ll) + 1;
-	char fpath[len];
 
 	if (len_fs > DSM_MAX_FSNAME_LENGTH) {
 		CT_ERROR(ENAMETOOLONG, "file space name too long");
@@ -2038,26 +3439,46 @@ dsInt16_t tsm_check_free_mountp(const char *fs, struct session_t *session)
 		return ECONNABORTED;
 	}
 
-	memset(fpath, 0, len);
+	memset(archive_info, 0, sizeof(struct archive_info_t));
+	strncpy(archive_info->desc, "node mountpoint check",
+		DSM_MAX_DESCR_LENGTH);
+	archive_info->obj_info.magic = MAGIC_ID_V3;
+	archive_info->obj_info.size.hi = 0;
+	archive_info->obj_info.size.lo = 1;
+	archive_info->obj_name.objType = DSM_OBJ_DIRECTORY;
 
 	if (len_fs == 1 && fs[0] == '/')
-		snprintf(fpath, len - 1, "%s%s", hl, ll);
+		snprintf(archive_info->fpath, len - 1, "%s%s", hl, ll);
 	else
-		snprintf(fpath, len, "%s%s%s", fs, hl, ll);
-
-	/* Create dummy DSM_OBJ_DIRECTORY. */
-	struct archive_info_t archive_info = {.desc = "node mountpoint check",
-					      .obj_info = {.magic =
-							   MAGIC_ID_V1,
-							   .size.hi = 0,
-							   .size.lo = 1},
-					      .obj_name = {.objType =
-							   DSM_OBJ_DIRECTORY}};
-
-	strncpy(archive_info.fpath, fpath, PATH_MAX);
-	strncpy(archive_info.obj_name.fs, fs, DSM_MAX_FSNAME_LENGTH);
-	strncpy(archive_info.obj_name.hl, hl, DSM_MAX_HL_LENGTH);
-	strncpy(archive_info.obj_name.ll, ll, DSM_MAX_LL_LENGTH);
+		snprintf(archive_info->fpath, len, "%s%s%s", fs, hl, ll);
+
+	strncpy(archive_info->obj_name.fs, fs, DSM_MAX_FSNAME_LENGTH);
+	strncpy(archive_info->obj_name.hl, hl, DSM_MAX_HL_LENGTH);
+	strncpy(archive_info->obj_name.ll, ll, DSM_MAX_LL_LENGTH);
+
+	return DSM_RC_SUCCESSFUL;
+}
+
+/**
+ * @brief Send dummy object to probe for a free mountpoint.
+ *
+ * All sessions send the same dummy DSM_OBJ_DIRECTORY object, which is
+ * left on the server. Call tsm_delete_mountp_probes once after probing
+ * all sessions to remove the dummy objects in a single transaction.
+ *
+ * @param[in] fs File space name.
+ * @param[in] session Active session.
+ * @return    DSM_RC_SUCCESSFUL on succes, otherwise ECONNABORTED, or
+ *            ECONNREFUSED if maximum number of mountpoints is exceeded.
+ */
+dsInt16_t tsm_probe_free_mountp(const char *fs, struct session_t *session)
+{
+	dsInt16_t rc;
+	struct archive_info_t archive_info;
+
+	rc = mountp_probe_info(fs, &archive_info);
+	if (rc)
+		return rc;
 
 	/* Check if we have free mountpoints left for the node. */
 	dsUint8_t vote_txn = DSM_VOTE_COMMIT;
@@ -2109,6 +3530,7 @@ dsInt16_t tsm_check_free_mountp(const char *fs, struct session_t *session)
 
 	rc = dsmEndTxn(session->handle, vote_txn, &err_reason);
 	if (rc) {
+		session->reason_tsm = err_reason;
 		TSM_DEBUG(session, err_reason, "dsmEndTxn reason");
 		if (err_reason == DSM_RS_ABORT_EXCEED_MAX_MP)
 			rc = ECONNREFUSED;
@@ -2116,21 +3538,338 @@ dsInt16_t tsm_check_free_mountp(const char *fs, struct session_t *session)
 			rc = ECONNABORTED;
 		goto cleanup;
 	}
+	CT_INFO("passed mount point check");
 
-	/* Delete dummy DSM_OBJ_DIRECTORY. */
-	rc = tsm_delete_fpath(fs, archive_info.fpath, session);
+cleanup:
+	if (obj_attr.objInfo) {
+		free(obj_attr.objInfo);
+		obj_attr.objInfo = NULL;
+	}
+
+	return rc;
+}
+
+/**
+ * @brief Delete all dummy objects sent by tsm_probe_free_mountp.
+ *
+ * Unlike tsm_delete_fpath, all archived copies of the dummy object are
+ * collected by a single query and deleted in a single transaction.
+ *
+ * @param[in] fs File space name.
+ * @param[in] session Active session.
+ * @return    DSM_RC_SUCCESSFUL on succes, otherwise ECONNABORTED.
+ */
+dsInt16_t tsm_delete_mountp_probes(const char *fs, struct session_t *session)
+{
+	dsInt16_t rc;
+	struct archive_info_t archive_info;
+	qryArchiveData qry_ar_data;
+	qryRespArchiveData qry_resp_ar_data;
+	DataBlk data_blk;
+	ObjID *obj_ids = NULL;
+	uint32_t num_obj_ids = 0;
+
+	rc = mountp_probe_info(fs, &archive_info);
+	if (rc)
+		return rc;
+
+	archive_info.obj_name.objType = DSM_OBJ_ANY_TYPE;
+	memset(&qry_ar_data, 0, sizeof(qry_ar_data));
+	qry_ar_data.stVersion = qryArchiveDataVersion;
+	qry_ar_data.insDateLowerBound.year = DATE_MINUS_INFINITE;
+	qry_ar_data.insDateUpperBound.year = DATE_PLUS_INFINITE;
+	qry_ar_data.expDateLowerBound.year = DATE_MINUS_INFINITE;
+	qry_ar_data.expDateUpperBound.year = DATE_PLUS_INFINITE;
+	qry_ar_data.descr = "*";
+	qry_ar_data.owner = (char *)session->owner;
+	qry_ar_data.objName = &archive_info.obj_name;
+
+	rc = dsmBeginQuery(session->handle, qtArchive, &qry_ar_data);
+	TSM_DEBUG(session, rc, "dsmBeginQuery");
+	if (rc) {
+		TSM_ERROR(session, rc, "dsmBeginQuery");
+		return ECONNABORTED;
+	}
+
+	data_blk.stVersion = DataBlkVersion;
+	data_blk.bufferLen = sizeof(qry_resp_ar_data);
+	data_blk.bufferPtr = (char *)&qry_resp_ar_data;
+	qry_resp_ar_data.stVersion = qryRespArchiveDataVersion;
+
+	for (;;) {
+		rc = dsmGetNextQObj(session->handle, &data_blk);
+		if (rc != DSM_RC_MORE_DATA)
+			break;
+
+		ObjID *ids = realloc(obj_ids, (num_obj_ids + 1) * sizeof(ObjID));
+		if (!ids) {
+			CT_ERROR(errno, "realloc failed");
+			break;
+		}
+		obj_ids = ids;
+		obj_ids[num_obj_ids++] = qry_resp_ar_data.objId;
+	}
+	if (rc != DSM_RC_FINISHED && rc != DSM_RC_ABORT_NO_MATCH &&
+	    rc != DSM_RC_MORE_DATA)
+		TSM_ERROR(session, rc, "dsmGetNextQObj");
+
+	rc = dsmEndQuery(session->handle);
+	if (rc) {
+		TSM_ERROR(session, rc, "dsmEndQuery");
+		rc = ECONNABORTED;
+		goto cleanup;
+	}
+
+	if (num_obj_ids == 0)
+		goto cleanup;
+
+	dsUint8_t vote_txn = DSM_VOTE_COMMIT;
+	dsUint16_t err_reason = 0;
+
+	rc = dsmBeginTxn(session->handle);
+	TSM_DEBUG(session, rc, "dsmBeginTxn");
 	if (rc) {
-		CT_ERROR(rc, "tsm_delete_fpath failed on '%s'",
-			 archive_info.fpath);
+		TSM_ERROR(session, rc, "dsmBeginTxn");
 		rc = ECONNABORTED;
+		goto cleanup;
 	}
-	else
-		CT_INFO("passed mount point check");
+
+	for (uint32_t n = 0; n < num_obj_ids; n++) {
+		dsmDelInfo del_info;
+
+		del_info.archInfo.stVersion = delArchVersion;
+		del_info.archInfo.objId = obj_ids[n];
+		rc = dsmDeleteObj(session->handle, dtArchive, del_info);
+		TSM_DEBUG(session, rc, "dsmDeleteObj");
+		if (rc) {
+			TSM_ERROR(session, rc, "dsmDeleteObj");
+			vote_txn = DSM_VOTE_ABORT;
+			break;
+		}
+	}
+
+	rc = dsmEndTxn(session->handle, vote_txn, &err_reason);
+	TSM_DEBUG(session, rc, "dsmEndTxn");
+	if (rc || vote_txn == DSM_VOTE_ABORT) {
+		TSM_REASON(session, err_reason, "dsmEndTxn reason");
+		rc = ECONNABORTED;
+	} else
+		CT_INFO("deleted %u mount point probe objects", num_obj_ids);
 
 cleanup:
-	if (obj_attr.objInfo) {
-		free(obj_attr.objInfo);
-		obj_attr.objInfo = NULL;
+	free(obj_ids);
+
+	return rc;
+}
+
+/**
+ * @brief Send dummy object to find the maximum number of mountpoints.
+ *
+ * The TSM API allows to create multiple sessions, thus
+ * enabling multithreaded operations. This however requires, that the TSM server
+ * has enabled multiple parallel mount points. There exists no low level TSM API
+ * function to query this value. This function should be called by threaded
+ * applications (e.g. lhsmtool_tsm) having multiple sessions opened to find
+ * maximum number of allowed mountpoints (alias the number of maxium threads)
+ * by sending DSM_OBJ_DIRECTORY and verifying whether transaction was
+ * successful.
+ *
+ * @param[in] fs File space name.
+ * @param[in] session Active session.
+ * @return    DSM_RC_SUCCESSFUL on succes, otherwise ECONNABORTED, or
+ *            ECONNREFUSED if maximum number of mountpoints is exceeded.
+ */
+dsInt16_t tsm_check_free_mountp(const char *fs, struct session_t *session)
+{
+	dsInt16_t rc;
+
+	rc = tsm_probe_free_mountp(fs, session);
+	if (rc)
+		return rc;
+
+	/* Delete dummy DSM_OBJ_DIRECTORY. */
+	return tsm_delete_mountp_probes(fs, session);
+}
+
+static int mountp_cache_fpath(const char *servername, const char *node,
+			      char *fpath, const size_t len)
+{
+	int n;
+
+	n = snprintf(fpath, len, "%s/ltsm-maxnummp-%s-%s", mountp_cache_dir,
+		     servername && servername[0] ? servername : "default",
+		     node && node[0] ? node : "default");
+	if (n < 0 || (size_t)n >= len)
+		return -ENAMETOOLONG;
+
+	/* Server and node names must not introduce subdirectories. */
+	for (char *c = fpath + strlen(mountp_cache_dir) + 1; *c; c++)
+		if (*c == '/')
+			*c = '_';
+
+	return 0;
+}
+
+/* Cache entries limit the number of sessions, thus only files and
+   directories which cannot be modified by other users are trusted. */
+static int mountp_cache_trusted(const char *fpath, const struct stat *st)
+{
+	if (st->st_uid != geteuid() || st->st_mode & (S_IWGRP | S_IWOTH)) {
+		CT_WARN("ignoring mount point cache '%s' owned by uid %u "
+			"with mode %o", fpath, st->st_uid,
+			st->st_mode & ALLPERMS);
+		return -EPERM;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Load cached result of a previous mountpoint probe.
+ *
+ * @param[in] servername TSM server name.
+ * @param[in] node TSM node name.
+ * @param[in] ttl Maximum age of cached result in seconds.
+ * @param[out] nmountp Number of sessions which passed the probe.
+ * @param[out] limited bTrue if probe hit the MAXNUMMP limit, thus nmountp
+ *                     is the maximum number of mountpoints.
+ * @return 0 on success, -ENOENT if no valid cache entry exists, -ESTALE
+ *         if cache entry is older than ttl, -EPERM if cache file is
+ *         not owned by the effective user or writable by others, or
+ *         -ENAMETOOLONG if the cache file path exceeds PATH_MAX.
+ */
+int tsm_mountp_cache_load(const char *servername, const char *node,
+			  const time_t ttl, uint16_t *nmountp,
+			  dsBool_t *limited)
+{
+	int rc;
+	int fd;
+	FILE *file;
+	struct stat st;
+	char fpath[PATH_MAX] = {0};
+	unsigned int n;
+	int l;
+	long long tstamp;
+
+	rc = mountp_cache_fpath(servername, node, fpath, sizeof(fpath));
+	if (rc)
+		return rc;
+
+	fd = open(fpath, O_RDONLY | O_NOFOLLOW);
+	if (fd < 0)
+		return errno == ELOOP ? -EPERM : -errno;
+	if (fstat(fd, &st)) {
+		rc = -errno;
+		close(fd);
+		return rc;
+	}
+	if (!S_ISREG(st.st_mode)) {
+		close(fd);
+		return -ENOENT;
+	}
+	rc = mountp_cache_trusted(fpath, &st);
+	if (rc) {
+		close(fd);
+		return rc;
+	}
+
+	file = fdopen(fd, "r");
+	if (!file) {
+		rc = -errno;
+		close(fd);
+		return rc;
+	}
+	rc = fscanf(file, "%u %d %lld", &n, &l, &tstamp);
+	fclose(file);
+	if (rc != 3 || n == 0 || n > UINT16_MAX)
+		return -ENOENT;
+
+	if (time(NULL) - (time_t)tstamp > ttl) {
+		CT_INFO("mount point cache '%s' expired", fpath);
+		return -ESTALE;
+	}
+
+	*nmountp = n;
+	*limited = l ? bTrue : bFalse;
+
+	return 0;
+}
+
+/**
+ * @brief Store result of a mountpoint probe.
+ *
+ * Cache directory is created if missing. Cache file is written to a newly
+ * created temporary file and replaced atomically, thus concurrently
+ * starting processes never read a partially written cache entry.
+ *
+ * @param[in] servername TSM server name.
+ * @param[in] node TSM node name.
+ * @param[in] nmountp Number of sessions which passed the probe.
+ * @param[in] limited bTrue if probe hit the MAXNUMMP limit.
+ * @return 0 on success, otherwise negative errno.
+ */
+int tsm_mountp_cache_store(const char *servername, const char *node,
+			   const uint16_t nmountp, const dsBool_t limited)
+{
+	int rc = 0;
+	int fd;
+	FILE *file;
+	struct stat st;
+	char fpath[PATH_MAX] = {0};
+	char fpath_tmp[PATH_MAX + 16] = {0};
+
+	if (mkdir(mountp_cache_dir, S_IRWXU | S_IRGRP | S_IXGRP |
+		  S_IROTH | S_IXOTH) && errno != EEXIST) {
+		rc = -errno;
+		CT_WARN("cannot create mount point cache directory '%s': %s",
+			mountp_cache_dir, strerror(-rc));
+		return rc;
+	}
+	if (lstat(mountp_cache_dir, &st)) {
+		rc = -errno;
+		CT_WARN("cannot stat mount point cache directory '%s': %s",
+			mountp_cache_dir, strerror(-rc));
+		return rc;
+	}
+	if (!S_ISDIR(st.st_mode))
+		return -ENOTDIR;
+	rc = mountp_cache_trusted(mountp_cache_dir, &st);
+	if (rc)
+		return rc;
+
+	rc = mountp_cache_fpath(servername, node, fpath, sizeof(fpath));
+	if (rc)
+		return rc;
+	snprintf(fpath_tmp, sizeof(fpath_tmp), "%s.XXXXXX", fpath);
+
+	/* Created exclusively with mode 0600. */
+	fd = mkstemp(fpath_tmp);
+	if (fd < 0) {
+		rc = -errno;
+		CT_WARN("cannot create mount point cache '%s': %s",
+			fpath_tmp, strerror(-rc));
+		return rc;
+	}
+	file = fdopen(fd, "w");
+	if (!file) {
+		rc = -errno;
+		close(fd);
+		unlink(fpath_tmp);
+		return rc;
+	}
+
+	if (fprintf(file, "%u %d %lld\n", nmountp, limited ? 1 : 0,
+		    (long long)time(NULL)) < 0)
+		rc = -EIO;
+	if (fclose(file) && !rc)
+		rc = -errno;
+
+	if (!rc && rename(fpath_tmp, fpath))
+		rc = -errno;
+	if (rc) {
+		CT_WARN("cannot write mount point cache '%s': %s",
+			fpath, strerror(-rc));
+		unlink(fpath_tmp);
 	}
 
 	return rc;
@@ -2193,7 +3932,7 @@ cleanup_transaction:
 	TSM_DEBUG(session, rc,	"dsmEndTxn");
 	if (rc || err_reason) {
 		TSM_ERROR(session, rc, "dsmEndTxn");
-		TSM_ERROR(session, err_reason, "dsmEndTxn reason");
+		TSM_REASON(session, err_reason, "dsmEndTxn reason");
 	}
 
 	if (session->tsm_file->obj_attr.objInfo) {
@@ -2210,6 +3949,7 @@ static int tsm_fclose_write(struct session_t *session)
 	dsUint8_t vote_txn = session->tsm_file->err == 0 ?
 		DSM_VOTE_COMMIT : DSM_VOTE_ABORT;
 	dsUint16_t err_reason;
+	uint64_t ts;
 
 	rc = dsmEndSendObj(session->handle);
 	TSM_DEBUG(session, rc,  "dsmEndSendObj");
@@ -2218,11 +3958,13 @@ static int tsm_fclose_write(struct session_t *session)
 		vote_txn = DSM_VOTE_ABORT;
 	}
 
+	ts = metrics_now();
 	rc = dsmEndTxn(session->handle, vote_txn, &err_reason);
+	metrics_record(METRIC_TXN_COMMIT, ts, 0);
 	TSM_DEBUG(session, rc,  "dsmEndTxn");
 	if (rc || err_reason) {
 		TSM_ERROR(session, rc, "dsmEndTxn");
-		TSM_ERROR(session, err_reason, "dsmEndTxn reason");
+		TSM_REASON(session, err_reason, "dsmEndTxn reason");
 	}
 
 	if (vote_txn == DSM_VOTE_COMMIT) {
@@ -2267,7 +4009,7 @@ static int init_tsm_file(const char *fs, const char *fpath, const char *desc,
 		}
 	}
 
-	session->tsm_file->archive_info.obj_info.magic = MAGIC_ID_V1;
+	session->tsm_file->archive_info.obj_info.magic = MAGIC_ID_V3;
 	session->tsm_file->archive_info.obj_name.objType = DSM_OBJ_FILE;
 	session->tsm_file->archive_info.obj_info.crc32 = 0;
 	session->tsm_file->archive_info.obj_info.st_mode =
@@ -2319,11 +4061,15 @@ ssize_t tsm_fwrite(const void *ptr, size_t size, size_t nmemb,
 {
 	int rc;
 	DataBlk data_blk;
+	uint64_t ts;
 
 	data_blk.bufferLen = size * nmemb;
 	data_blk.bufferPtr = (void *)ptr;
 	data_blk.stVersion = DataBlkVersion;
+	data_blk.numBytes = 0;
+	ts = metrics_now();
 	rc = dsmSendData(session->handle, &data_blk);
+	metrics_record(METRIC_SEND_DATA, ts, data_blk.numBytes);
 	TSM_DEBUG(session, rc, "dsmSendData");
 	if (rc) {
 		TSM_ERROR(session, rc, "dsmSendData");
@@ -2331,15 +4077,91 @@ ssize_t tsm_fwrite(const void *ptr, size_t size, size_t nmemb,
 	}
 	else {
 		session->tsm_file->bytes_processed += data_blk.numBytes;
+		ts = metrics_now();
 		session->tsm_file->archive_info.obj_info.crc32 = crc32(
 			session->tsm_file->archive_info.obj_info.crc32,
 			(const unsigned char *)ptr,
 			data_blk.numBytes);
+		metrics_record(METRIC_CRC32, ts, data_blk.numBytes);
 	}
 
 	return rc == 0 ? (ssize_t)data_blk.numBytes : (ssize_t)-1;
 }
 
+/**
+ * @brief Write vector of buffers to opened TSM object.
+ *
+ * Gather-write counterpart of tsm_fwrite. Each segment of iov is handed
+ * directly to dsmSendData, so callers assembling e.g. header and payload
+ * need not copy them into one contiguous buffer first. The CRC32 sum is
+ * continued across all segments in order.
+ *
+ * @param[in] iov     Array of buffers to be written.
+ * @param[in] iovcnt  Number of elements in iov.
+ * @param[in] session Session with object opened by tsm_fopen.
+ * @return Number of bytes written, otherwise -1 and errno is set
+ *         appropriately.
+ */
+ssize_t tsm_fwritev(const struct iovec *iov, int iovcnt,
+		    struct session_t *session)
+{
+	int rc;
+	DataBlk data_blk;
+	ssize_t total_written = 0;
+	uint64_t ts;
+
+	if (!iov || iovcnt < 0 ||
+	    !session || !session->tsm_file) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	data_blk.stVersion = DataBlkVersion;
+
+	for (int i = 0; i < iovcnt; i++) {
+		const unsigned char *base = iov[i].iov_base;
+		size_t remaining = iov[i].iov_len;
+
+		/* DataBlk.bufferLen is 32 bit, hand over segments larger
+		   than 4 GiB in several dsmSendData calls. */
+		while (remaining > 0) {
+			data_blk.bufferLen = MIN(remaining, UINT32_MAX);
+			data_blk.bufferPtr = (char *)base;
+			data_blk.numBytes = 0;
+
+			ts = metrics_now();
+			rc = dsmSendData(session->handle, &data_blk);
+			metrics_record(METRIC_SEND_DATA, ts,
+				       data_blk.numBytes);
+			TSM_DEBUG(session, rc, "dsmSendData");
+			if (rc) {
+				TSM_ERROR(session, rc, "dsmSendData");
+				errno = EIO;
+				return total_written > 0 ? total_written : -1;
+			}
+
+			session->tsm_file->bytes_processed += data_blk.numBytes;
+			ts = metrics_now();
+			session->tsm_file->archive_info.obj_info.crc32 = crc32(
+				session->tsm_file->archive_info.obj_info.crc32,
+				base, data_blk.numBytes);
+			metrics_record(METRIC_CRC32, ts, data_blk.numBytes);
+			total_written += data_blk.numBytes;
+
+			/* Short send, report what was transmitted so far. */
+			if (data_blk.numBytes != data_blk.bufferLen) {
+				CT_WARN("dsmSendData transmitted %u out of %u",
+					data_blk.numBytes, data_blk.bufferLen);
+				return total_written;
+			}
+			base += data_blk.numBytes;
+			remaining -= data_blk.numBytes;
+		}
+	}
+
+	return total_written;
+}
+
 int tsm_fclose(struct session_t *session)
 {
 	int rc;
@@ -37,6 +37,9 @@
 #include <stdbool.h>
 #include <limits.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
 #include "dsmapitd.h"
 #include "dsmapifp.h"
 #include "dsmapips.h"
@@ -51,8 +54,49 @@
 #endif
 
 #define MAGIC_ID_V1 71147
+#define MAGIC_ID_V2 71148	/* obj_info_t with flags. */
+#define MAGIC_ID_V3 71149	/* obj_info_t with codec and raw_size. */
 #define DEFAULT_NUM_BUCKETS 64
 
+#define PROGRESS_INTERVAL_MS	1000
+#define PROGRESS_BYTES		(1ULL << 30)	/* 1 GiB. */
+
+/* Files up to this size are read and checksummed before dsmSendObj, such
+   that no dsmUpdateObj is required for storing the crc32. */
+#define CRC32_INLINE_BYTES	(4 * TSM_BUF_LENGTH)	/* 1 MiB. */
+/* Maximum number of deferred dsmUpdateObj calls per transaction. */
+#define CRC32_UPDATE_BATCH	256
+
+/* Files having at least this number of bytes in holes are archived
+   sparse, that is data extents only, preceded by the extent map. */
+#define SPARSE_HOLE_BYTES	(4 * TSM_BUF_LENGTH)	/* 1 MiB. */
+#define SPARSE_MAX_EXTENTS	65536
+#define SPARSE_MAGIC		0x53505253	/* "SPRS" */
+
+/* Alignment of buffer, offset and length of O_DIRECT reads and writes. */
+#define DIRECT_IO_ALIGN		4096
+/* Without O_DIRECT support, archive evicts read data from the page cache
+   in steps of this size behind the read position. */
+#define DONTNEED_BYTES		(16 * TSM_BUF_LENGTH)	/* 4 MiB. */
+
+/* Archiving a directory reads ahead up to PREFETCH_FILES regular files
+   of at most PREFETCH_BYTES in total, while the current file is sent. */
+#define PREFETCH_FILES		8
+#define PREFETCH_BYTES		(256 * TSM_BUF_LENGTH)	/* 64 MiB. */
+#define PREFETCH_THREADS	4
+#define PREFETCH_CHUNK		(4 * TSM_BUF_LENGTH)	/* 1 MiB. */
+
+/* Worker threads compressing blocks of archived files, if compression
+   is enabled on the session. */
+#define COMPRESS_THREADS	4
+
+#define MOUNTP_PROBE_HL		"/.mount"
+#define MOUNTP_PROBE_LL		"/.test-maxnummp"
+#ifndef MOUNTP_CACHE_DIR
+#define MOUNTP_CACHE_DIR	"/var/lib/ltsm"
+#endif
+#define MOUNTP_CACHE_TTL	86400	/* Seconds. */
+
 enum sort_by_t {
 	SORT_NONE	     = 0,
 	SORT_DATE_ASCENDING  = 1,
@@ -79,12 +123,28 @@ struct lustre_info_t {
 	struct lov_t lov;
 };
 
+/* Flags of obj_info_t (MAGIC_ID_V2). */
+#define OBJ_INFO_SPARSE		0x1	/* Data is sparse_hdr_t, extents, data. */
+
 struct obj_info_t {
 	uint32_t magic;
 	dsStruct64_t size;
 	mode_t st_mode;
 	uint32_t crc32;
 	struct lustre_info_t lustre_info;
+	uint32_t flags;
+	uint32_t codec;		/* Compression, COMPRESS_* (MAGIC_ID_V3). */
+	dsStruct64_t raw_size;	/* Bytes of data before compression. */
+};
+
+struct sparse_extent_t {
+	uint64_t offset;
+	uint64_t length;
+};
+
+struct sparse_hdr_t {
+	uint32_t magic;
+	uint32_t num;		/* Number of sparse_extent_t following. */
 };
 
 struct archive_info_t {
@@ -92,6 +152,7 @@ struct archive_info_t {
 	char desc[DSM_MAX_DESCR_LENGTH + 1];
 	struct obj_info_t obj_info;
 	dsmObjName obj_name;
+	struct stat st;		/* Of fpath, set by tsm_archive_prepare. */
 };
 
 struct qarray_t {
@@ -113,6 +174,11 @@ struct progress_size_t {
 	uint64_t total;
 };
 
+struct progress_state_t {
+	uint64_t bytes;		/* Not yet reported bytes. */
+	struct timespec ts;	/* Time of last report. */
+};
+
 struct tsm_file_t {
 	ObjAttr obj_attr;
 	struct archive_info_t archive_info;
@@ -120,8 +186,16 @@ struct tsm_file_t {
 	int err;
 };
 
+struct crc32_update_t {
+	dsmObjName obj_name;
+	struct obj_info_t obj_info;
+};
+
 struct session_t {
 	dsUint32_t handle;
+	dsInt16_t rc_tsm;	/* Last TSM API error code. */
+	dsUint16_t reason_tsm;	/* Last dsmEndTxn reason code. */
+	dsBool_t conn_lost;	/* TSM API error indicated lost connection. */
 	char owner[DSM_MAX_OWNER_LENGTH + 1];
 	struct qtable_t qtable;
 
@@ -130,14 +204,39 @@ struct session_t {
 	long hal_flags;
 	int (*progress)(struct progress_size_t *data,
 			struct session_t *session);
+	struct progress_state_t progress_state;
 
 	struct tsm_file_t *tsm_file;
+
+	/* Deferred crc32 updates of large files, see tsm_archive_fpath. */
+	struct crc32_update_t *crc32_update;
+	uint32_t crc32_update_num;
+
+	/* Archive reads bypass the page cache, by O_DIRECT or otherwise
+	   posix_fadvise(POSIX_FADV_DONTNEED). */
+	dsBool_t archive_direct;
+
+	/* Read ahead of regular files, see tsm_archive_fpath. */
+	struct prefetch_t *prefetch;
+
+	/* Archived files are compressed with compress_codec (COMPRESS_*)
+	   and compress_level, 0 selects the codec default. The worker
+	   threads are started on first use and stopped by tsm_disconnect. */
+	uint32_t compress_codec;
+	int compress_level;
+	struct compress_t *compress;
 };
 
 void set_recursive(const dsBool_t recursive);
 void select_latest(const dsBool_t latest);
 void set_prefix(const char *_prefix);
 void set_restore_stripe(const dsBool_t _restore_stripe);
+void set_progress_throttle(const uint32_t interval_ms, const uint64_t bytes);
+void set_crc32_inline(const uint64_t bytes);
+void set_restore_direct(const uint64_t bytes);
+void set_mountp_cache_dir(const char *dir);
+void set_prefetch(const uint16_t files, const uint64_t bytes,
+		  const uint16_t threads);
 int parse_verbose(const char *val, int *opt_verbose);
 int mkdir_p(const char *path, const mode_t st_mode);
 dsInt16_t extract_hl_ll(const char *fpath, const char *fs,
@@ -153,11 +252,20 @@ void tsm_cleanup(const dsBool_t mt_flag);
 
 dsInt16_t tsm_connect(struct login_t *login, struct session_t *session);
 void tsm_disconnect(struct session_t *session);
+dsBool_t tsm_conn_lost(const struct session_t *session);
+dsInt16_t tsm_check_session(struct session_t *session);
 
 dsmAppVersion get_appapi_ver(void);
 dsmApiVersionEx get_libapi_ver(void);
 
 dsInt16_t tsm_check_free_mountp(const char *fs, struct session_t *session);
+dsInt16_t tsm_probe_free_mountp(const char *fs, struct session_t *session);
+dsInt16_t tsm_delete_mountp_probes(const char *fs, struct session_t *session);
+int tsm_mountp_cache_load(const char *servername, const char *node,
+			  const time_t ttl, uint16_t *nmountp,
+			  dsBool_t *limited);
+int tsm_mountp_cache_store(const char *servername, const char *node,
+			   const uint16_t nmountp, const dsBool_t limited);
 dsInt16_t tsm_query_session(struct session_t *session);
 dsInt16_t tsm_archive_fpath(const char *fs, const char *fpath,
 			    const char *desc, int fd,
@@ -167,11 +275,18 @@ dsInt16_t tsm_query_fpath(const char *fs, const char *fpath,
 			  const char *desc, const dsmDate *date_lower_bound,
 			  const dsmDate *date_upper_bound,
 			  struct  session_t *session);
+dsInt16_t tsm_query_fpath_qtable(const char *fs, const char *fpath,
+				 const char *desc,
+				 const dsmDate *date_lower_bound,
+				 const dsmDate *date_upper_bound,
+				 struct session_t *session);
 dsInt16_t tsm_delete_fpath(const char *fs, const char *fpath,
 			   struct  session_t *session);
 dsInt16_t tsm_retrieve_fpath(const char *fs, const char *fpath,
 			     const char *desc, int fd,
 			     struct session_t *session);
+dsInt16_t tsm_retrieve_qra(const qryRespArchiveData *qra, const uint32_t n,
+			   int fd, struct session_t *session);
 
 #ifdef HAVE_LUSTRE
 int xattr_get_lov(const int fd, struct lustre_info_t *lustre_info,
@@ -186,6 +301,8 @@ int tsm_fopen(const char *fs, const char *fpath, const char *desc,
 	      struct session_t *session);
 ssize_t tsm_fwrite(const void *ptr, size_t size, size_t nmemb,
 		   struct session_t *session);
+ssize_t tsm_fwritev(const struct iovec *iov, int iovcnt,
+		    struct session_t *session);
 int tsm_fclose(struct session_t *session);
 
 #endif /* TSMAPI_H */
@@ -0,0 +1,424 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Copyright (c) 2026, GSI Helmholtz Centre for Heavy Ion Research
+ */
+
+/*
+ * Latency and byte counters of the I/O and TSM calls on the data path.
+ * Each thread updates its own set of histograms without atomic
+ * read-modify-write operations, snapshots sum up the sets of all threads.
+ * Sets are never freed while the process is running, sets of exited
+ * threads are reused by new threads, thus counters are cumulative.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "metrics.h"
+
+struct metrics_thread_t {
+	struct metric_hist_t hist[METRIC_NUM];
+	int owned;
+	struct metrics_thread_t *next;
+};
+
+static const char *metric_names[METRIC_NUM] = {
+	[METRIC_READ]	    = "read",
+	[METRIC_WRITE]	    = "write",
+	[METRIC_SEND_DATA]  = "dsmSendData",
+	[METRIC_GET_DATA]   = "dsmGetData",
+	[METRIC_CRC32]	    = "crc32",
+	[METRIC_TXN_COMMIT] = "dsmEndTxn",
+	[METRIC_QUERY]	    = "query"
+};
+
+static struct metrics_thread_t *threads = NULL;
+static __thread struct metrics_thread_t *thread_self = NULL;
+static pthread_key_t thread_key;
+static pthread_once_t thread_key_once = PTHREAD_ONCE_INIT;
+
+static void thread_release(void *data)
+{
+	struct metrics_thread_t *thread = data;
+
+	__atomic_store_n(&thread->owned, 0, __ATOMIC_RELEASE);
+}
+
+static void thread_key_create(void)
+{
+	pthread_key_create(&thread_key, thread_release);
+}
+
+static struct metrics_thread_t *thread_get(void)
+{
+	struct metrics_thread_t *thread;
+
+	if (thread_self)
+		return thread_self;
+
+	pthread_once(&thread_key_once, thread_key_create);
+
+	/* Reuse set of an exited thread. */
+	for (thread = __atomic_load_n(&threads, __ATOMIC_ACQUIRE); thread;
+	     thread = thread->next) {
+		int expected = 0;
+
+		if (__atomic_compare_exchange_n(&thread->owned, &expected, 1,
+						false, __ATOMIC_ACQUIRE,
+						__ATOMIC_RELAXED))
+			goto out;
+	}
+
+	thread = calloc(1, sizeof(struct metrics_thread_t));
+	if (!thread)
+		return NULL;
+	thread->owned = 1;
+	thread->next = __atomic_load_n(&threads, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(&threads, &thread->next, thread,
+					    false, __ATOMIC_RELEASE,
+					    __ATOMIC_RELAXED))
+		;
+out:
+	thread_self = thread;
+	pthread_setspecific(thread_key, thread);
+
+	return thread;
+}
+
+static uint16_t bucket_idx(const uint64_t val)
+{
+	uint16_t exp;
+
+	if (val < METRIC_SUB_COUNT)
+		return val;
+
+	exp = 63 - __builtin_clzll(val);
+	if (exp > METRIC_MAX_EXP)
+		return METRIC_BUCKETS - 1;
+
+	return (exp - METRIC_SUB_BITS + 1) * METRIC_SUB_COUNT +
+		((val >> (exp - METRIC_SUB_BITS)) & (METRIC_SUB_COUNT - 1));
+}
+
+static uint64_t bucket_upper(const uint16_t idx)
+{
+	const uint16_t group = idx / METRIC_SUB_COUNT;
+	const uint16_t sub = idx % METRIC_SUB_COUNT;
+	uint16_t shift;
+
+	if (group == 0)
+		return idx;
+
+	shift = group - 1;
+
+	return ((uint64_t)(METRIC_SUB_COUNT + sub + 1) << shift) - 1;
+}
+
+static inline void counter_add(uint64_t *counter, const uint64_t val)
+{
+	/* Single writer, readers only need untorn values. */
+	__atomic_store_n(counter, *counter + val, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Current CLOCK_MONOTONIC time in nanoseconds.
+ */
+uint64_t metrics_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief Record latency and processed bytes of a single call.
+ *
+ * @param[in] metric   Metric to update.
+ * @param[in] start_ns Start time obtained with metrics_now().
+ * @param[in] bytes    Number of bytes processed by the call.
+ */
+void metrics_record(const enum metric_t metric, const uint64_t start_ns,
+		    const uint64_t bytes)
+{
+	struct metrics_thread_t *thread = thread_get();
+	struct metric_hist_t *hist;
+	uint64_t ns;
+
+	if (!thread)
+		return;
+
+	ns = metrics_now() - start_ns;
+	hist = &thread->hist[metric];
+	counter_add(&hist->count, 1);
+	counter_add(&hist->bytes, bytes);
+	counter_add(&hist->sum_ns, ns);
+	counter_add(&hist->buckets[bucket_idx(ns)], 1);
+	if (ns > hist->max_ns)
+		__atomic_store_n(&hist->max_ns, ns, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Sum up counters and histograms of all threads.
+ *
+ * @param[out] snap Snapshot of cumulative values since process start.
+ */
+void metrics_snapshot(struct metrics_snapshot_t *snap)
+{
+	memset(snap, 0, sizeof(struct metrics_snapshot_t));
+	snap->ts = metrics_now();
+
+	for (struct metrics_thread_t *thread = __atomic_load_n(
+		     &threads, __ATOMIC_ACQUIRE); thread;
+	     thread = thread->next) {
+		for (uint16_t m = 0; m < METRIC_NUM; m++) {
+			struct metric_hist_t *h = &thread->hist[m];
+			struct metric_hist_t *s = &snap->hist[m];
+			uint64_t max_ns;
+
+			s->count += __atomic_load_n(&h->count,
+						    __ATOMIC_RELAXED);
+			s->bytes += __atomic_load_n(&h->bytes,
+						    __ATOMIC_RELAXED);
+			s->sum_ns += __atomic_load_n(&h->sum_ns,
+						     __ATOMIC_RELAXED);
+			max_ns = __atomic_load_n(&h->max_ns, __ATOMIC_RELAXED);
+			if (max_ns > s->max_ns)
+				s->max_ns = max_ns;
+			for (uint16_t b = 0; b < METRIC_BUCKETS; b++)
+				s->buckets[b] += __atomic_load_n(
+					&h->buckets[b], __ATOMIC_RELAXED);
+		}
+	}
+}
+
+/**
+ * @brief Compute difference of two snapshots.
+ *
+ * Maximum latencies cannot be subtracted, the maximum of end is used.
+ *
+ * @param[out] diff  Difference end - start, ts holds the elapsed time.
+ * @param[in]  start Earlier snapshot.
+ * @param[in]  end   Later snapshot.
+ */
+void metrics_diff(struct metrics_snapshot_t *diff,
+		  const struct metrics_snapshot_t *start,
+		  const struct metrics_snapshot_t *end)
+{
+	diff->ts = end->ts - start->ts;
+	for (uint16_t m = 0; m < METRIC_NUM; m++) {
+		const struct metric_hist_t *s = &start->hist[m];
+		const struct metric_hist_t *e = &end->hist[m];
+		struct metric_hist_t *d = &diff->hist[m];
+
+		d->count = e->count - s->count;
+		d->bytes = e->bytes - s->bytes;
+		d->sum_ns = e->sum_ns - s->sum_ns;
+		d->max_ns = e->max_ns;
+		for (uint16_t b = 0; b < METRIC_BUCKETS; b++)
+			d->buckets[b] = e->buckets[b] - s->buckets[b];
+	}
+}
+
+/**
+ * @brief Latency below which the given percentage of calls fall.
+ *
+ * @param[in] hist       Histogram.
+ * @param[in] percentile Percentile in range [0, 100].
+ * @return Upper bound of the matching bucket in ns, 0 if hist is empty.
+ */
+uint64_t metrics_percentile(const struct metric_hist_t *hist,
+			    const double percentile)
+{
+	uint64_t target;
+	uint64_t cum = 0;
+
+	if (hist->count == 0)
+		return 0;
+
+	target = (uint64_t)(percentile / 100.0 * hist->count + 0.5);
+	if (target == 0)
+		target = 1;
+
+	for (uint16_t b = 0; b < METRIC_BUCKETS; b++) {
+		cum += hist->buckets[b];
+		if (cum >= target) {
+			const uint64_t upper = bucket_upper(b);
+
+			return upper < hist->max_ns ? upper : hist->max_ns;
+		}
+	}
+
+	return hist->max_ns;
+}
+
+const char *metrics_name(const enum metric_t metric)
+{
+	return metric < METRIC_NUM ? metric_names[metric] : "unknown";
+}
+
+/**
+ * @brief Print count, throughput and latency percentiles of each metric.
+ *
+ * Throughput is computed over snap->ts, thus snap should be the
+ * difference of two snapshots.
+ *
+ * @param[in] file Output stream.
+ * @param[in] name Name of the measured operation.
+ * @param[in] snap Snapshot obtained with metrics_diff().
+ */
+void metrics_print(FILE *file, const char *name,
+		   const struct metrics_snapshot_t *snap)
+{
+	const double sec = snap->ts / 1e9;
+
+	for (uint16_t m = 0; m < METRIC_NUM; m++) {
+		const struct metric_hist_t *h = &snap->hist[m];
+
+		if (h->count == 0)
+			continue;
+
+		fprintf(file, "[measurement]\t'%s' %-11s calls: %lu, "
+			"bytes: %lu, %.3f Mbytes / sec, latency usec "
+			"mean: %.1f, p50: %.1f, p99: %.1f, p999: %.1f, "
+			"max: %.1f\n", name, metric_names[m],
+			(unsigned long)h->count, (unsigned long)h->bytes,
+			sec > 0 ? h->bytes / sec / 1e6 : 0.0,
+			h->sum_ns / 1e3 / h->count,
+			metrics_percentile(h, 50.0) / 1e3,
+			metrics_percentile(h, 99.0) / 1e3,
+			metrics_percentile(h, 99.9) / 1e3,
+			h->max_ns / 1e3);
+	}
+	fflush(file);
+}
+
+/**
+ * @brief Record latency and bytes in a histogram shared between threads.
+ *
+ * In contrast to metrics_record, atomic read-modify-write operations are
+ * used, thus it is intended for infrequent events such as complete
+ * actions rather than single calls.
+ *
+ * @param[in] hist  Shared histogram.
+ * @param[in] ns    Latency in ns.
+ * @param[in] bytes Number of bytes processed.
+ */
+void metrics_hist_add(struct metric_hist_t *hist, const uint64_t ns,
+		      const uint64_t bytes)
+{
+	uint64_t max_ns = __atomic_load_n(&hist->max_ns, __ATOMIC_RELAXED);
+
+	__atomic_fetch_add(&hist->count, 1, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&hist->bytes, bytes, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&hist->sum_ns, ns, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&hist->buckets[bucket_idx(ns)], 1,
+			   __ATOMIC_RELAXED);
+	while (ns > max_ns &&
+	       !__atomic_compare_exchange_n(&hist->max_ns, &max_ns, ns, true,
+					    __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+}
+
+/**
+ * @brief Copy histogram which is concurrently updated by other threads.
+ *
+ * @param[out] dst Copy of histogram.
+ * @param[in]  src Histogram updated with metrics_hist_add.
+ */
+void metrics_hist_load(struct metric_hist_t *dst,
+		       const struct metric_hist_t *src)
+{
+	dst->count = __atomic_load_n(&src->count, __ATOMIC_RELAXED);
+	dst->bytes = __atomic_load_n(&src->bytes, __ATOMIC_RELAXED);
+	dst->sum_ns = __atomic_load_n(&src->sum_ns, __ATOMIC_RELAXED);
+	dst->max_ns = __atomic_load_n(&src->max_ns, __ATOMIC_RELAXED);
+	for (uint16_t b = 0; b < METRIC_BUCKETS; b++)
+		dst->buckets[b] = __atomic_load_n(&src->buckets[b],
+						  __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Print histogram as Prometheus summary in text exposition format.
+ *
+ * HELP and TYPE lines of the metric family have to be printed by the
+ * caller.
+ *
+ * @param[in] file   Output stream.
+ * @param[in] name   Metric family name, e.g. ltsm_call_duration_seconds.
+ * @param[in] labels Labels without braces, e.g. call="read", or "".
+ * @param[in] hist   Histogram.
+ */
+void metrics_prometheus_summary(FILE *file, const char *name,
+				const char *labels,
+				const struct metric_hist_t *hist)
+{
+	static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+	const char *sep = labels[0] ? "," : "";
+	const char *open = labels[0] ? "{" : "";
+	const char *close = labels[0] ? "}" : "";
+
+	for (uint16_t q = 0; q < sizeof(quantiles) / sizeof(quantiles[0]);
+	     q++) {
+		fprintf(file, "%s{%s%squantile=\"%g\"} ", name, labels, sep,
+			quantiles[q]);
+		/* Quantiles of an empty summary are undefined. */
+		if (hist->count == 0)
+			fprintf(file, "NaN\n");
+		else
+			fprintf(file, "%.9f\n", metrics_percentile(
+					hist, quantiles[q] * 100.0) / 1e9);
+	}
+	fprintf(file, "%s_sum%s%s%s %.9f\n", name, open, labels, close,
+		hist->sum_ns / 1e9);
+	fprintf(file, "%s_count%s%s%s %lu\n", name, open, labels, close,
+		(unsigned long)hist->count);
+}
+
+/**
+ * @brief Print per call metrics in Prometheus text exposition format.
+ *
+ * @param[in] file Output stream.
+ * @param[in] snap Snapshot obtained with metrics_snapshot().
+ */
+void metrics_prometheus(FILE *file, const struct metrics_snapshot_t *snap)
+{
+	char labels[64];
+
+	fprintf(file, "# HELP ltsm_call_duration_seconds Latency of I/O and "
+		"TSM calls on the data path.\n"
+		"# TYPE ltsm_call_duration_seconds summary\n");
+	for (uint16_t m = 0; m < METRIC_NUM; m++) {
+		snprintf(labels, sizeof(labels), "call=\"%s\"",
+			 metric_names[m]);
+		metrics_prometheus_summary(file, "ltsm_call_duration_seconds",
+					   labels, &snap->hist[m]);
+	}
+
+	fprintf(file, "# HELP ltsm_call_bytes_total Bytes processed by I/O "
+		"and TSM calls on the data path.\n"
+		"# TYPE ltsm_call_bytes_total counter\n");
+	for (uint16_t m = 0; m < METRIC_NUM; m++)
+		fprintf(file, "ltsm_call_bytes_total{call=\"%s\"} %lu\n",
+			metric_names[m], (unsigned long)snap->hist[m].bytes);
+}
@@ -0,0 +1,80 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Copyright (c) 2026, GSI Helmholtz Centre for Heavy Ion Research
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/* Log-linear histogram, each power of two is divided into
+   METRIC_SUB_COUNT buckets, i.e. relative error is at most 12.5%.
+   Latencies above 2^METRIC_MAX_EXP ns (about 18 minutes) are counted
+   in the last bucket. */
+#define METRIC_SUB_BITS		3
+#define METRIC_SUB_COUNT	(1 << METRIC_SUB_BITS)
+#define METRIC_MAX_EXP		40
+#define METRIC_BUCKETS		((METRIC_MAX_EXP - METRIC_SUB_BITS + 2) * \
+				 METRIC_SUB_COUNT)
+
+enum metric_t {
+	METRIC_READ,
+	METRIC_WRITE,
+	METRIC_SEND_DATA,
+	METRIC_GET_DATA,
+	METRIC_CRC32,
+	METRIC_TXN_COMMIT,
+	METRIC_QUERY,
+	METRIC_NUM
+};
+
+struct metric_hist_t {
+	uint64_t count;
+	uint64_t bytes;
+	uint64_t sum_ns;
+	uint64_t max_ns;
+	uint64_t buckets[METRIC_BUCKETS];
+};
+
+struct metrics_snapshot_t {
+	uint64_t ts;		/* CLOCK_MONOTONIC in ns. */
+	struct metric_hist_t hist[METRIC_NUM];
+};
+
+uint64_t metrics_now(void);
+void metrics_record(const enum metric_t metric, const uint64_t start_ns,
+		    const uint64_t bytes);
+void metrics_snapshot(struct metrics_snapshot_t *snap);
+void metrics_diff(struct metrics_snapshot_t *diff,
+		  const struct metrics_snapshot_t *start,
+		  const struct metrics_snapshot_t *end);
+uint64_t metrics_percentile(const struct metric_hist_t *hist,
+			    const double percentile);
+const char *metrics_name(const enum metric_t metric);
+void metrics_print(FILE *file, const char *name,
+		   const struct metrics_snapshot_t *snap);
+void metrics_hist_add(struct metric_hist_t *hist, const uint64_t ns,
+		      const uint64_t bytes);
+void metrics_hist_load(struct metric_hist_t *dst,
+		       const struct metric_hist_t *src);
+void metrics_prometheus_summary(FILE *file, const char *name,
+				const char *labels,
+				const struct metric_hist_t *hist);
+void metrics_prometheus(FILE *file, const struct metrics_snapshot_t *snap);
+
+#endif /* METRICS_H */
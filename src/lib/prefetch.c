@@ -0,0 +1,431 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Copyright (c) 2026, GSI Helmholtz Centre for Heavy Ion Research
+ */
+
+/*
+ * Read ahead of files into memory by a pool of worker threads. Files are
+ * opened in the order they are added, and split into chunks which are
+ * read in parallel with pread and checksummed. On Lustre the chunk size
+ * is the stripe size of striped files, thus several OSTs are read at
+ * once. The data buffers of all added and not yet released files are
+ * bounded by a memory budget.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <sys/param.h>
+#include "prefetch.h"
+#include "log.h"
+
+#ifdef HAVE_LUSTRE
+#include <attr/xattr.h>
+#include <lustre/lustreapi.h>
+#endif
+
+static struct prefetch_file_t *prefetch_next(struct prefetch_t *prefetch)
+{
+	for (struct prefetch_file_t *file = prefetch->head; file;
+	     file = file->next) {
+		if (file->state == PREFETCH_QUEUED ||
+		    (file->state == PREFETCH_READING &&
+		     file->next_chunk < file->nchunks))
+			return file;
+	}
+
+	return NULL;
+}
+
+static void prefetch_dequeue(struct prefetch_t *prefetch,
+			     struct prefetch_file_t *file)
+{
+	struct prefetch_file_t *prev = NULL;
+
+	for (struct prefetch_file_t *cur = prefetch->head; cur;
+	     prev = cur, cur = cur->next) {
+		if (cur != file)
+			continue;
+		if (prev)
+			prev->next = cur->next;
+		else
+			prefetch->head = cur->next;
+		if (prefetch->tail == cur)
+			prefetch->tail = prev;
+		cur->next = NULL;
+		return;
+	}
+}
+
+/**
+ * @brief Whether file was modified or replaced between two stat calls.
+ *
+ * @param[in] st_old Earlier stat of file.
+ * @param[in] st_new Later stat of file.
+ * @return true if data of st_new may differ from data of st_old.
+ */
+bool prefetch_modified(const struct stat *st_old, const struct stat *st_new)
+{
+	return st_old->st_dev != st_new->st_dev ||
+		st_old->st_ino != st_new->st_ino ||
+		st_old->st_size != st_new->st_size ||
+		st_old->st_mtim.tv_sec != st_new->st_mtim.tv_sec ||
+		st_old->st_mtim.tv_nsec != st_new->st_mtim.tv_nsec ||
+		st_old->st_ctim.tv_sec != st_new->st_ctim.tv_sec ||
+		st_old->st_ctim.tv_nsec != st_new->st_ctim.tv_nsec;
+}
+
+static void prefetch_finish(struct prefetch_t *prefetch,
+			    struct prefetch_file_t *file)
+{
+	if (file->fd >= 0) {
+		struct stat st;
+
+		/* File modified while read results in torn data. */
+		if (!file->rc && fstat(file->fd, &st))
+			file->rc = -errno;
+		else if (!file->rc && prefetch_modified(&file->st, &st)) {
+			CT_INFO("'%s' modified while prefetched", file->fpath);
+			file->rc = -ESTALE;
+		}
+		close(file->fd);
+		file->fd = -1;
+	}
+	if (!file->rc) {
+		file->crc32 = 0;
+		for (uint32_t c = 0; c < file->nchunks; c++)
+			file->crc32 = crc32_combine(file->crc32,
+						    file->chunk_crc32[c],
+						    MIN(file->chunk, file->size -
+							c * file->chunk));
+		prefetch->files++;
+		prefetch->bytes += file->size;
+	}
+	prefetch_dequeue(prefetch, file);
+	file->state = PREFETCH_DONE;
+	pthread_cond_broadcast(&prefetch->cond_done);
+}
+
+static int prefetch_open(struct prefetch_t *prefetch,
+			 struct prefetch_file_t *file)
+{
+	size_t chunk = prefetch->chunk;
+
+	file->fd = open(file->fpath, O_RDONLY);
+	if (file->fd < 0)
+		return -errno;
+	if (fstat(file->fd, &file->st))
+		return -errno;
+	/* File was truncated or replaced after it was added. */
+	if (!S_ISREG(file->st.st_mode) ||
+	    (size_t)file->st.st_size != file->size)
+		return -ESTALE;
+
+#ifdef HAVE_LUSTRE
+	/* Read one stripe per chunk, such that chunks read in parallel
+	   are served by different OSTs. */
+	char lov_buf[XATTR_SIZE_MAX];
+	const struct lov_user_md *lum = (struct lov_user_md *)lov_buf;
+
+	if (fgetxattr(file->fd, XATTR_LUSTRE_LOV, lov_buf, sizeof(lov_buf)) >=
+	    (ssize_t)sizeof(struct lov_user_md) &&
+	    (lum->lmm_magic == LOV_USER_MAGIC_V1
+#ifdef LOV_USER_MAGIC_V3
+	     || lum->lmm_magic == LOV_USER_MAGIC_V3
+#endif
+	     ) &&
+	    lum->lmm_stripe_count > 1 && lum->lmm_stripe_size > 0)
+		chunk = lum->lmm_stripe_size;
+#endif
+
+	file->chunk = chunk;
+	file->nchunks = (file->size + chunk - 1) / chunk;
+	file->pending = file->nchunks;
+	file->chunk_crc32 = calloc(file->nchunks, sizeof(uint32_t));
+	if (!file->chunk_crc32)
+		return -errno;
+
+	return 0;
+}
+
+static int prefetch_read_chunk(struct prefetch_t *prefetch,
+			       struct prefetch_file_t *file, const uint32_t c)
+{
+	const off_t offset = (off_t)c * file->chunk;
+	const size_t len = MIN(file->chunk, file->size - offset);
+	size_t total = 0;
+
+	while (total < len) {
+		ssize_t n = pread(file->fd, file->data + offset + total,
+				  len - total, offset + total);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+		/* File was truncated after it was added. */
+		if (n == 0)
+			return -EIO;
+		total += n;
+	}
+	file->chunk_crc32[c] = crc32(0, (const unsigned char *)file->data +
+				     offset, len);
+	if (prefetch->dontneed)
+		posix_fadvise(file->fd, offset, len, POSIX_FADV_DONTNEED);
+
+	return 0;
+}
+
+static void *prefetch_worker(void *data)
+{
+	struct prefetch_t *prefetch = data;
+	struct prefetch_file_t *file;
+	int rc;
+
+	pthread_mutex_lock(&prefetch->mutex);
+	for (;;) {
+		while (!prefetch->stop && !(file = prefetch_next(prefetch)))
+			pthread_cond_wait(&prefetch->cond_work,
+					  &prefetch->mutex);
+		if (prefetch->stop)
+			break;
+
+		if (file->state == PREFETCH_QUEUED) {
+			file->state = PREFETCH_OPENING;
+			pthread_mutex_unlock(&prefetch->mutex);
+			rc = prefetch_open(prefetch, file);
+			pthread_mutex_lock(&prefetch->mutex);
+			if (rc) {
+				CT_WARN("[rc=%d] prefetch open failed on '%s'",
+					rc, file->fpath);
+				file->rc = rc;
+				prefetch_finish(prefetch, file);
+			} else
+				file->state = PREFETCH_READING;
+			pthread_cond_broadcast(&prefetch->cond_work);
+			continue;
+		}
+
+		const uint32_t c = file->next_chunk++;
+
+		if (file->next_chunk == file->nchunks)
+			prefetch_dequeue(prefetch, file);
+		pthread_mutex_unlock(&prefetch->mutex);
+		rc = prefetch_read_chunk(prefetch, file, c);
+		pthread_mutex_lock(&prefetch->mutex);
+		if (rc && !file->rc) {
+			CT_WARN("[rc=%d] prefetch read failed on '%s'", rc,
+				file->fpath);
+			file->rc = rc;
+		}
+		if (--file->pending == 0)
+			prefetch_finish(prefetch, file);
+	}
+	pthread_mutex_unlock(&prefetch->mutex);
+
+	return NULL;
+}
+
+/**
+ * @brief Start worker threads reading ahead files.
+ *
+ * @param[out] prefetch Prefetch to initialize.
+ * @param[in]  nthreads Number of worker threads.
+ * @param[in]  budget   Maximum bytes of all not yet released files.
+ * @param[in]  chunk    Bytes read by one pread, replaced by the stripe
+ *                      size of striped Lustre files.
+ * @param[in]  dontneed Evict read data from the page cache.
+ * @return 0 on success, otherwise negative errno.
+ */
+int prefetch_init(struct prefetch_t *prefetch, const uint16_t nthreads,
+		  const size_t budget, const size_t chunk, const bool dontneed)
+{
+	int rc;
+
+	if (nthreads == 0 || chunk == 0)
+		return -EINVAL;
+
+	memset(prefetch, 0, sizeof(struct prefetch_t));
+	prefetch->budget = budget;
+	prefetch->chunk = chunk;
+	prefetch->dontneed = dontneed;
+	pthread_mutex_init(&prefetch->mutex, NULL);
+	pthread_cond_init(&prefetch->cond_work, NULL);
+	pthread_cond_init(&prefetch->cond_done, NULL);
+
+	prefetch->threads = calloc(nthreads, sizeof(pthread_t));
+	if (!prefetch->threads) {
+		rc = -errno;
+		goto cleanup;
+	}
+	for (; prefetch->nthreads < nthreads; prefetch->nthreads++) {
+		rc = -pthread_create(&prefetch->threads[prefetch->nthreads],
+				     NULL, prefetch_worker, prefetch);
+		if (rc)
+			goto cleanup;
+	}
+
+	return 0;
+
+cleanup:
+	CT_ERROR(rc, "prefetch_init failed");
+	prefetch_destroy(prefetch);
+
+	return rc;
+}
+
+/**
+ * @brief Stop worker threads, all added files must be released before.
+ *
+ * @param[in] prefetch Prefetch to destroy.
+ */
+void prefetch_destroy(struct prefetch_t *prefetch)
+{
+	pthread_mutex_lock(&prefetch->mutex);
+	prefetch->stop = true;
+	pthread_cond_broadcast(&prefetch->cond_work);
+	pthread_mutex_unlock(&prefetch->mutex);
+
+	for (uint16_t t = 0; t < prefetch->nthreads; t++)
+		pthread_join(prefetch->threads[t], NULL);
+	free(prefetch->threads);
+	prefetch->threads = NULL;
+	prefetch->nthreads = 0;
+
+	CT_INFO("prefetched %lu files of %lu bytes",
+		(unsigned long)prefetch->files,
+		(unsigned long)prefetch->bytes);
+
+	pthread_cond_destroy(&prefetch->cond_done);
+	pthread_cond_destroy(&prefetch->cond_work);
+	pthread_mutex_destroy(&prefetch->mutex);
+}
+
+/**
+ * @brief Queue file for reading ahead.
+ *
+ * @param[in]  prefetch Prefetch.
+ * @param[in]  fpath    Path of regular file.
+ * @param[in]  size     Size of file in bytes, greater than 0.
+ * @param[out] file     Handle for prefetch_wait and prefetch_release.
+ * @return 0 on success, -ENOSPC if the memory budget is exhausted,
+ *         otherwise negative errno.
+ */
+int prefetch_add(struct prefetch_t *prefetch, const char *fpath,
+		 const size_t size, struct prefetch_file_t **file)
+{
+	struct prefetch_file_t *_file;
+	int rc;
+
+	if (size == 0)
+		return -EINVAL;
+
+	pthread_mutex_lock(&prefetch->mutex);
+	if (size > prefetch->budget - prefetch->used) {
+		pthread_mutex_unlock(&prefetch->mutex);
+		return -ENOSPC;
+	}
+	prefetch->used += size;
+	pthread_mutex_unlock(&prefetch->mutex);
+
+	_file = calloc(1, sizeof(struct prefetch_file_t));
+	if (!_file) {
+		rc = -errno;
+		goto cleanup;
+	}
+	_file->fpath = strdup(fpath);
+	_file->data = malloc(size);
+	if (!_file->fpath || !_file->data) {
+		rc = -ENOMEM;
+		goto cleanup;
+	}
+	_file->size = size;
+	_file->fd = -1;
+	_file->state = PREFETCH_QUEUED;
+
+	pthread_mutex_lock(&prefetch->mutex);
+	if (prefetch->tail)
+		prefetch->tail->next = _file;
+	else
+		prefetch->head = _file;
+	prefetch->tail = _file;
+	pthread_cond_signal(&prefetch->cond_work);
+	pthread_mutex_unlock(&prefetch->mutex);
+	*file = _file;
+
+	return 0;
+
+cleanup:
+	if (_file) {
+		free(_file->fpath);
+		free(_file->data);
+		free(_file);
+	}
+	pthread_mutex_lock(&prefetch->mutex);
+	prefetch->used -= size;
+	pthread_mutex_unlock(&prefetch->mutex);
+
+	return rc;
+}
+
+/**
+ * @brief Wait until file is read completely.
+ *
+ * @param[in] prefetch Prefetch.
+ * @param[in] file     File returned by prefetch_add.
+ * @return 0 if file->data, file->crc32 and file->st are valid, otherwise
+ *         negative errno, -ESTALE if file was modified while read.
+ */
+int prefetch_wait(struct prefetch_t *prefetch, struct prefetch_file_t *file)
+{
+	int rc;
+
+	pthread_mutex_lock(&prefetch->mutex);
+	while (file->state != PREFETCH_DONE)
+		pthread_cond_wait(&prefetch->cond_done, &prefetch->mutex);
+	rc = file->rc;
+	pthread_mutex_unlock(&prefetch->mutex);
+
+	return rc;
+}
+
+/**
+ * @brief Free file and return its data size to the memory budget.
+ *
+ * @param[in] prefetch Prefetch.
+ * @param[in] file     File returned by prefetch_add.
+ */
+void prefetch_release(struct prefetch_t *prefetch,
+		      struct prefetch_file_t *file)
+{
+	prefetch_wait(prefetch, file);
+
+	pthread_mutex_lock(&prefetch->mutex);
+	prefetch->used -= file->size;
+	pthread_mutex_unlock(&prefetch->mutex);
+
+	free(file->chunk_crc32);
+	free(file->fpath);
+	free(file->data);
+	free(file);
+}
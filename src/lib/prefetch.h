@@ -0,0 +1,79 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Copyright (c) 2026, GSI Helmholtz Centre for Heavy Ion Research
+ */
+
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+enum prefetch_state_t {
+	PREFETCH_QUEUED	 = 0,	/* Waiting to be opened. */
+	PREFETCH_OPENING = 1,	/* Opened by a worker. */
+	PREFETCH_READING = 2,	/* Chunks are handed out to workers. */
+	PREFETCH_DONE	 = 3	/* All chunks read or failed. */
+};
+
+struct prefetch_file_t {
+	char *fpath;
+	char *data;
+	size_t size;
+	size_t chunk;		/* Bytes per chunk, Lustre stripe size. */
+	uint32_t nchunks;
+	uint32_t next_chunk;	/* Next chunk handed out to a worker. */
+	uint32_t pending;	/* Chunks not yet read. */
+	uint32_t *chunk_crc32;
+	uint32_t crc32;		/* Of all data, valid if rc is 0. */
+	struct stat st;		/* Of fd, unchanged while data was read. */
+	int fd;
+	int rc;			/* 0 or negative errno. */
+	enum prefetch_state_t state;
+	struct prefetch_file_t *next;
+};
+
+struct prefetch_t {
+	uint16_t nthreads;
+	pthread_t *threads;
+	size_t budget;		/* Maximum bytes of data buffers. */
+	size_t used;
+	size_t chunk;		/* Default bytes per chunk. */
+	bool dontneed;		/* Evict read data from page cache. */
+	bool stop;
+	struct prefetch_file_t *head;	/* Files with work, oldest first. */
+	struct prefetch_file_t *tail;
+	uint64_t files;
+	uint64_t bytes;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond_work;
+	pthread_cond_t cond_done;
+};
+
+int prefetch_init(struct prefetch_t *prefetch, const uint16_t nthreads,
+		  const size_t budget, const size_t chunk, const bool dontneed);
+void prefetch_destroy(struct prefetch_t *prefetch);
+int prefetch_add(struct prefetch_t *prefetch, const char *fpath,
+		 const size_t size, struct prefetch_file_t **file);
+int prefetch_wait(struct prefetch_t *prefetch, struct prefetch_file_t *file);
+void prefetch_release(struct prefetch_t *prefetch,
+		      struct prefetch_file_t *file);
+bool prefetch_modified(const struct stat *st_old, const struct stat *st_new);
+
+#endif /* PREFETCH_H */
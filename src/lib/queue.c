@@ -34,3 +34,13 @@ int queue_dequeue(queue_t *queue, void **data)
 {
 	return list_rem_next(queue, NULL, data);
 }
+
+int queue_enqueue_node(queue_t *queue, list_node_t *node)
+{
+	return list_ins_next_node(queue, list_tail(queue), node);
+}
+
+int queue_dequeue_node(queue_t *queue, list_node_t **node)
+{
+	return list_rem_next_node(queue, NULL, node);
+}
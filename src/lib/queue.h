@@ -36,4 +36,6 @@ typedef list_t queue_t;
 
 int queue_enqueue(queue_t *queue, const void *data);
 int queue_dequeue(queue_t *queue, void **data);
+int queue_enqueue_node(queue_t *queue, list_node_t *node);
+int queue_dequeue_node(queue_t *queue, list_node_t **node);
 #endif
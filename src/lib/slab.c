@@ -0,0 +1,148 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Copyright (c) 2026, GSI Helmholtz Centre for Heavy Ion Research
+ */
+
+/*
+ * Allocator for objects of fixed size. Objects are carved from chunks of
+ * nobjs objects and recycled through a free list, chunks are only
+ * released by slab_destroy. After warming up, allocation and release
+ * are a pointer swap under a mutex and do not call malloc/free.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "slab.h"
+
+/* Chunk header is padded such that objects keep the alignment of
+   malloc. */
+#define SLAB_ALIGN	_Alignof(max_align_t)
+#define SLAB_HDR_SIZE	SLAB_ALIGN
+
+static size_t slab_align(const size_t size)
+{
+	return (size + SLAB_ALIGN - 1) / SLAB_ALIGN * SLAB_ALIGN;
+}
+
+/**
+ * @brief Initialize allocator for objects of size obj_size.
+ *
+ * @param[out] slab     Slab allocator.
+ * @param[in]  obj_size Size of objects in bytes.
+ * @param[in]  nobjs    Number of objects allocated at once when the
+ *                      free list is empty.
+ * @return 0 on success, -EINVAL if obj_size or nobjs is 0.
+ */
+int slab_init(struct slab_t *slab, const size_t obj_size,
+	      const uint32_t nobjs)
+{
+	if (obj_size == 0 || nobjs == 0)
+		return -EINVAL;
+
+	memset(slab, 0, sizeof(struct slab_t));
+	slab->obj_size = slab_align(obj_size < sizeof(void *) ?
+				    sizeof(void *) : obj_size);
+	slab->nobjs = nobjs;
+
+	return -pthread_mutex_init(&slab->mutex, NULL);
+}
+
+/**
+ * @brief Release all chunks, objects still in use become invalid.
+ *
+ * @param[in] slab Slab allocator.
+ */
+void slab_destroy(struct slab_t *slab)
+{
+	void *chunk = slab->chunks;
+
+	while (chunk) {
+		void *next = *(void **)chunk;
+
+		free(chunk);
+		chunk = next;
+	}
+	pthread_mutex_destroy(&slab->mutex);
+	memset(slab, 0, sizeof(struct slab_t));
+}
+
+/* Allocate chunk and put its objects on the free list, called with mutex
+   held. */
+static int slab_grow(struct slab_t *slab)
+{
+	char *chunk;
+	char *obj;
+
+	chunk = malloc(SLAB_HDR_SIZE + (size_t)slab->nobjs * slab->obj_size);
+	if (!chunk)
+		return -ENOMEM;
+
+	*(void **)chunk = slab->chunks;
+	slab->chunks = chunk;
+	slab->nchunks++;
+
+	obj = chunk + SLAB_HDR_SIZE;
+	for (uint32_t n = 0; n < slab->nobjs; n++, obj += slab->obj_size) {
+		*(void **)obj = slab->free;
+		slab->free = obj;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Allocate object, contents are undefined.
+ *
+ * @param[in] slab Slab allocator.
+ * @return Object or NULL if no memory is available.
+ */
+void *slab_alloc(struct slab_t *slab)
+{
+	void *obj = NULL;
+
+	pthread_mutex_lock(&slab->mutex);
+	if (slab->free || slab_grow(slab) == 0) {
+		obj = slab->free;
+		slab->free = *(void **)obj;
+		slab->nused++;
+	}
+	pthread_mutex_unlock(&slab->mutex);
+
+	return obj;
+}
+
+/**
+ * @brief Return object obtained by slab_alloc to the free list.
+ *
+ * @param[in] slab Slab allocator.
+ * @param[in] obj  Object, NULL is ignored.
+ */
+void slab_free(struct slab_t *slab, void *obj)
+{
+	if (!obj)
+		return;
+
+	pthread_mutex_lock(&slab->mutex);
+	*(void **)obj = slab->free;
+	slab->free = obj;
+	slab->nused--;
+	pthread_mutex_unlock(&slab->mutex);
+}
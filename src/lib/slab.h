@@ -0,0 +1,42 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Copyright (c) 2026, GSI Helmholtz Centre for Heavy Ion Research
+ */
+
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+struct slab_t {
+	size_t obj_size;
+	uint32_t nobjs;		/* Objects per chunk. */
+	void *free;		/* Free objects, linked through first word. */
+	void *chunks;		/* Chunks, linked through first word. */
+	uint32_t nchunks;
+	uint64_t nused;
+	pthread_mutex_t mutex;
+};
+
+int slab_init(struct slab_t *slab, const size_t obj_size,
+	      const uint32_t nobjs);
+void slab_destroy(struct slab_t *slab);
+void *slab_alloc(struct slab_t *slab);
+void slab_free(struct slab_t *slab, void *obj);
+
+#endif /* SLAB_H */
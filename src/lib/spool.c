@@ -0,0 +1,407 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Copyright (c) 2026, GSI Helmholtz Centre for Heavy Ion Research
+ */
+
+/*
+ * Pool of TSM sessions. Sessions are checked out for the duration of
+ * a single operation and checked in afterwards. Sessions which lost their
+ * connection (e.g. during a server maintenance window) are transparently
+ * reconnected on a later checkout with exponential backoff, sessions
+ * idle for a long time are health-checked before being handed out.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/param.h>
+#include "spool.h"
+#include "log.h"
+
+static time_t spool_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec;
+}
+
+static int spool_connect(struct spool_t *spool, struct spool_entry_t *entry)
+{
+	int rc;
+
+	if (entry->connected) {
+		tsm_disconnect(&entry->session);
+		entry->connected = false;
+	}
+	memset(&entry->session, 0, sizeof(struct session_t));
+
+	rc = tsm_connect(&spool->login, &entry->session);
+	if (rc) {
+		CT_ERROR(0, "tsm_connect failed");
+		tsm_disconnect(&entry->session);
+		return rc;
+	}
+
+	if (spool->setup) {
+		rc = spool->setup(&entry->session);
+		if (rc) {
+			CT_ERROR(rc, "session setup failed");
+			tsm_disconnect(&entry->session);
+			return rc;
+		}
+	}
+	entry->connected = true;
+	entry->last_used = spool_now();
+
+	return 0;
+}
+
+static void spool_entry_free(struct spool_entry_t *entry)
+{
+	if (entry->connected)
+		tsm_disconnect(&entry->session);
+	free(entry);
+}
+
+static void spool_remove(struct spool_t *spool, struct spool_entry_t *entry)
+{
+	for (uint16_t n = 0; n < spool->size; n++) {
+		if (spool->entries[n] == entry) {
+			spool->entries[n] = spool->entries[--spool->size];
+			spool->entries[spool->size] = NULL;
+			return;
+		}
+	}
+}
+
+/**
+ * @brief Initialize session pool and connect sessions.
+ *
+ * Sessions are connected one after another, the first failing connect or
+ * setup stops creating further sessions, thus the pool can contain less
+ * than nsessions sessions. Setup callback is invoked on each (re)connected
+ * session and allows the caller to set e.g. the progress callback.
+ *
+ * @param[out] spool Session pool.
+ * @param[in] login Login data used for all (re)connects.
+ * @param[in] nsessions Number of sessions to connect.
+ * @param[in] setup Optional callback invoked after each connect.
+ * @return 0 on success, -EACCES if no session could be connected, or
+ *         -ENOMEM on allocation failure.
+ */
+int spool_init(struct spool_t *spool, const struct login_t *login,
+	       const uint16_t nsessions,
+	       int (*setup)(struct session_t *session))
+{
+	int rc;
+	pthread_condattr_t attr;
+
+	if (nsessions == 0)
+		return -EINVAL;
+
+	memset(spool, 0, sizeof(struct spool_t));
+	memcpy(&spool->login, login, sizeof(struct login_t));
+	spool->setup = setup;
+
+	pthread_mutex_init(&spool->mutex, NULL);
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&spool->cond, &attr);
+	pthread_condattr_destroy(&attr);
+
+	spool->entries = calloc(nsessions, sizeof(struct spool_entry_t *));
+	if (!spool->entries) {
+		rc = -errno;
+		CT_ERROR(rc, "calloc failed");
+		return rc;
+	}
+
+	for (uint16_t n = 0; n < nsessions; n++) {
+		struct spool_entry_t *entry;
+
+		entry = calloc(1, sizeof(struct spool_entry_t));
+		if (!entry) {
+			CT_ERROR(-errno, "calloc failed");
+			break;
+		}
+
+		CT_MESSAGE("tsm_init: session: %d", n + 1);
+		rc = spool_connect(spool, entry);
+		if (rc) {
+			free(entry);
+			break;
+		}
+		entry->state = SPOOL_IDLE;
+		spool->entries[spool->size++] = entry;
+	}
+	spool->target = spool->size;
+
+	if (spool->size == 0)
+		return -EACCES;
+
+	if (spool->size != nsessions)
+		CT_WARN("connected %d out of %d sessions",
+			spool->size, nsessions);
+
+	return 0;
+}
+
+/**
+ * @brief Disconnect all sessions and release pool resources.
+ *
+ * Must not be called while sessions are checked out.
+ *
+ * @param[in] spool Session pool.
+ */
+void spool_destroy(struct spool_t *spool)
+{
+	pthread_mutex_lock(&spool->mutex);
+	for (uint16_t n = 0; n < spool->size; n++)
+		spool_entry_free(spool->entries[n]);
+	free(spool->entries);
+	spool->entries = NULL;
+	spool->size = 0;
+	spool->target = 0;
+	pthread_mutex_unlock(&spool->mutex);
+
+	pthread_cond_destroy(&spool->cond);
+	pthread_mutex_destroy(&spool->mutex);
+}
+
+/**
+ * @brief Wake up all threads blocked in spool_checkout.
+ *
+ * Subsequent calls of spool_checkout return NULL.
+ *
+ * @param[in] spool Session pool.
+ */
+void spool_shutdown(struct spool_t *spool)
+{
+	pthread_mutex_lock(&spool->mutex);
+	spool->shutdown = true;
+	pthread_cond_broadcast(&spool->cond);
+	pthread_mutex_unlock(&spool->mutex);
+}
+
+/**
+ * @brief Check out a session for exclusive use.
+ *
+ * Blocks until a session is available. Idle sessions are preferred,
+ * otherwise a broken session whose backoff time expired is reconnected.
+ * Sessions idle longer than SPOOL_IDLE_CHECK seconds are verified with
+ * a server round trip and reconnected if the check fails.
+ *
+ * @param[in] spool Session pool.
+ * @return Session on success, NULL if pool is shut down.
+ */
+struct session_t *spool_checkout(struct spool_t *spool)
+{
+	int rc;
+	time_t now;
+	time_t wakeup;
+	enum spool_state_t state;
+	struct spool_entry_t *entry;
+
+	pthread_mutex_lock(&spool->mutex);
+	for (;;) {
+		struct spool_entry_t *idle = NULL;
+		struct spool_entry_t *broken = NULL;
+
+		if (spool->shutdown) {
+			pthread_mutex_unlock(&spool->mutex);
+			return NULL;
+		}
+
+		now = spool_now();
+		wakeup = now + SPOOL_BACKOFF_MAX;
+		for (uint16_t n = 0; n < spool->size && !idle; n++) {
+			struct spool_entry_t *e = spool->entries[n];
+
+			if (e->state == SPOOL_IDLE)
+				idle = e;
+			else if (e->state == SPOOL_BROKEN) {
+				if (e->next_retry <= now) {
+					if (!broken)
+						broken = e;
+				} else if (e->next_retry < wakeup)
+					wakeup = e->next_retry;
+			}
+		}
+
+		entry = idle ? idle : broken;
+		if (!entry) {
+			struct timespec ts = {.tv_sec = wakeup, .tv_nsec = 0};
+
+			pthread_cond_timedwait(&spool->cond, &spool->mutex,
+					       &ts);
+			continue;
+		}
+
+		state = entry->state;
+		entry->state = SPOOL_BUSY;
+		pthread_mutex_unlock(&spool->mutex);
+
+		if (state == SPOOL_IDLE) {
+			if (now - entry->last_used < SPOOL_IDLE_CHECK)
+				return &entry->session;
+
+			rc = tsm_check_session(&entry->session);
+			if (!rc)
+				return &entry->session;
+			CT_WARN("idle session failed health check, reconnecting");
+		}
+
+		rc = spool_connect(spool, entry);
+		if (!rc) {
+			if (entry->retries)
+				CT_MESSAGE("session reconnected after %d "
+					   "attempts", entry->retries);
+			entry->retries = 0;
+			return &entry->session;
+		}
+
+		pthread_mutex_lock(&spool->mutex);
+		const time_t backoff = MIN(SPOOL_BACKOFF_MIN << entry->retries,
+					   SPOOL_BACKOFF_MAX);
+		if (backoff < SPOOL_BACKOFF_MAX)
+			entry->retries++;
+		entry->state = SPOOL_BROKEN;
+		entry->next_retry = spool_now() + backoff;
+		CT_WARN("session reconnect failed, retrying in %ld seconds",
+			(long)backoff);
+	}
+}
+
+/**
+ * @brief Return a session previously obtained by spool_checkout.
+ *
+ * Sessions which lost their connection are marked broken and reconnected
+ * on a later checkout. If the pool was shrunk below its current size, the
+ * session is disconnected and retired.
+ *
+ * @param[in] spool Session pool.
+ * @param[in] session Session to return.
+ */
+void spool_checkin(struct spool_t *spool, struct session_t *session)
+{
+	struct spool_entry_t *entry = (struct spool_entry_t *)session;
+	const bool lost = tsm_conn_lost(session);
+
+	pthread_mutex_lock(&spool->mutex);
+	entry->last_used = spool_now();
+	if (spool->size > spool->target) {
+		spool_remove(spool, entry);
+		pthread_mutex_unlock(&spool->mutex);
+		spool_entry_free(entry);
+		return;
+	}
+
+	if (lost) {
+		CT_WARN("session lost connection to TSM server");
+		entry->state = SPOOL_BROKEN;
+		entry->next_retry = entry->last_used;
+	} else
+		entry->state = SPOOL_IDLE;
+
+	pthread_cond_signal(&spool->cond);
+	pthread_mutex_unlock(&spool->mutex);
+}
+
+/**
+ * @brief Grow or shrink the session pool.
+ *
+ * New sessions are connected lazily on checkout. When shrinking, idle and
+ * broken sessions are disconnected immediately, checked out sessions are
+ * retired on checkin.
+ *
+ * @param[in] spool Session pool.
+ * @param[in] nsessions New number of sessions.
+ * @return 0 on success, -EINVAL or -ENOMEM on failure.
+ */
+int spool_resize(struct spool_t *spool, const uint16_t nsessions)
+{
+	int rc = 0;
+
+	if (nsessions == 0)
+		return -EINVAL;
+
+	pthread_mutex_lock(&spool->mutex);
+	if (nsessions > spool->size) {
+		struct spool_entry_t **entries;
+
+		entries = realloc(spool->entries,
+				  nsessions * sizeof(struct spool_entry_t *));
+		if (!entries) {
+			rc = -errno;
+			CT_ERROR(rc, "realloc failed");
+			goto unlock;
+		}
+		spool->entries = entries;
+
+		while (spool->size < nsessions) {
+			struct spool_entry_t *entry;
+
+			entry = calloc(1, sizeof(struct spool_entry_t));
+			if (!entry) {
+				rc = -errno;
+				CT_ERROR(rc, "calloc failed");
+				break;
+			}
+			entry->state = SPOOL_BROKEN;
+			spool->entries[spool->size++] = entry;
+		}
+	}
+	spool->target = nsessions;
+
+	for (uint16_t n = spool->size; n-- > 0 && spool->size > spool->target;) {
+		struct spool_entry_t *entry = spool->entries[n];
+
+		if (entry->state == SPOOL_BUSY)
+			continue;
+		spool_remove(spool, entry);
+		spool_entry_free(entry);
+	}
+	CT_INFO("session pool resized to %d sessions", nsessions);
+
+	pthread_cond_broadcast(&spool->cond);
+unlock:
+	pthread_mutex_unlock(&spool->mutex);
+
+	return rc;
+}
+
+/**
+ * @brief Number of sessions currently owned by the pool.
+ *
+ * @param[in] spool Session pool.
+ * @return Number of sessions.
+ */
+uint16_t spool_size(struct spool_t *spool)
+{
+	uint16_t size;
+
+	pthread_mutex_lock(&spool->mutex);
+	size = spool->size;
+	pthread_mutex_unlock(&spool->mutex);
+
+	return size;
+}
@@ -0,0 +1,67 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Copyright (c) 2026, GSI Helmholtz Centre for Heavy Ion Research
+ */
+
+#ifndef SPOOL_H
+#define SPOOL_H
+
+#include <stdbool.h>
+#include <pthread.h>
+#include <time.h>
+#include "ltsmapi.h"
+
+#define SPOOL_BACKOFF_MIN	1	/* Seconds. */
+#define SPOOL_BACKOFF_MAX	64	/* Seconds. */
+#define SPOOL_IDLE_CHECK	600	/* Seconds. */
+
+enum spool_state_t {
+	SPOOL_IDLE,
+	SPOOL_BUSY,
+	SPOOL_BROKEN
+};
+
+struct spool_entry_t {
+	struct session_t session;	/* Must be first member. */
+	enum spool_state_t state;
+	bool connected;
+	uint16_t retries;
+	time_t next_retry;
+	time_t last_used;
+};
+
+struct spool_t {
+	struct login_t login;
+	struct spool_entry_t **entries;
+	uint16_t size;
+	uint16_t target;
+	bool shutdown;
+	int (*setup)(struct session_t *session);
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+};
+
+int spool_init(struct spool_t *spool, const struct login_t *login,
+	       const uint16_t nsessions,
+	       int (*setup)(struct session_t *session));
+void spool_destroy(struct spool_t *spool);
+void spool_shutdown(struct spool_t *spool);
+struct session_t *spool_checkout(struct spool_t *spool);
+void spool_checkin(struct spool_t *spool, struct session_t *session);
+int spool_resize(struct spool_t *spool, const uint16_t nsessions);
+uint16_t spool_size(struct spool_t *spool);
+
+#endif /* SPOOL_H */
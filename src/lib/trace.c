@@ -0,0 +1,340 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Copyright (c) 2026, GSI Helmholtz Centre for Heavy Ion Research
+ */
+
+/*
+ * Span tracing. Each thread records begin and end events into its own
+ * ring which keeps the most recent events. Events carry the trace context
+ * of the thread, e.g. the HSM action cookie and FID, such that spans of
+ * library calls can be attributed to the action being processed.
+ * trace_dump writes all rings in Chrome trace event format, which can be
+ * loaded into chrome://tracing or https://ui.perfetto.dev.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include "trace.h"
+#include "log.h"
+
+/* Slot n of the ring is valid while seq equals n + 1, it is 0 while a
+   writer updates the slot. */
+struct trace_event_t {
+	uint64_t seq;
+	uint64_t ts;
+	const char *name;
+	uint64_t cookie;
+	char ctx[TRACE_CTX_LEN];
+	char phase;
+};
+
+struct trace_ring_t {
+	struct trace_event_t *events;
+	uint32_t nevents;
+	uint64_t head;
+	pid_t tid;
+	char thread_name[16];
+	uint64_t cookie;
+	char ctx[TRACE_CTX_LEN];
+	int owned;
+	struct trace_ring_t *next;
+};
+
+int trace_enabled = 0;
+
+static uint32_t trace_nevents = TRACE_NUM_EVENTS;
+static struct trace_ring_t *rings = NULL;
+static __thread struct trace_ring_t *ring_self = NULL;
+static pthread_key_t ring_key;
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+
+static void ring_release(void *data)
+{
+	struct trace_ring_t *ring = data;
+
+	__atomic_store_n(&ring->owned, 0, __ATOMIC_RELEASE);
+}
+
+static void ring_key_create(void)
+{
+	pthread_key_create(&ring_key, ring_release);
+}
+
+static struct trace_ring_t *ring_get(void)
+{
+	struct trace_ring_t *ring;
+
+	if (ring_self)
+		return ring_self;
+
+	pthread_once(&ring_key_once, ring_key_create);
+
+	/* Reuse ring of an exited thread, its events are kept until
+	   overwritten. */
+	for (ring = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); ring;
+	     ring = ring->next) {
+		int expected = 0;
+
+		if (__atomic_compare_exchange_n(&ring->owned, &expected, 1,
+						false, __ATOMIC_ACQUIRE,
+						__ATOMIC_RELAXED))
+			goto out;
+	}
+
+	ring = calloc(1, sizeof(struct trace_ring_t));
+	if (!ring)
+		return NULL;
+	ring->events = calloc(trace_nevents, sizeof(struct trace_event_t));
+	if (!ring->events) {
+		free(ring);
+		return NULL;
+	}
+	ring->nevents = trace_nevents;
+	ring->owned = 1;
+	ring->next = __atomic_load_n(&rings, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(&rings, &ring->next, ring, false,
+					    __ATOMIC_RELEASE,
+					    __ATOMIC_RELAXED))
+		;
+out:
+	ring->tid = api_gettid();
+	pthread_getname_np(pthread_self(), ring->thread_name,
+			   sizeof(ring->thread_name));
+	ring->cookie = 0;
+	ring->ctx[0] = '\0';
+	ring_self = ring;
+	pthread_setspecific(ring_key, ring);
+
+	return ring;
+}
+
+static uint64_t trace_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Print string as JSON string literal. */
+static void json_str(FILE *file, const char *str)
+{
+	fputc('"', file);
+	for (; *str; str++) {
+		if (*str == '"' || *str == '\\')
+			fprintf(file, "\\%c", *str);
+		else if ((unsigned char)*str < 0x20)
+			fprintf(file, "\\u%04x", (unsigned char)*str);
+		else
+			fputc(*str, file);
+	}
+	fputc('"', file);
+}
+
+/**
+ * @brief Enable recording of trace events.
+ *
+ * @param[in] nevents Number of most recent events kept per thread, takes
+ *                    effect for threads recording their first event.
+ * @return 0 on success, -EINVAL if nevents is 0.
+ */
+int trace_enable(const uint32_t nevents)
+{
+	if (nevents == 0)
+		return -EINVAL;
+
+	trace_nevents = nevents;
+	__atomic_store_n(&trace_enabled, 1, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+void trace_disable(void)
+{
+	__atomic_store_n(&trace_enabled, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Record begin or end event of span name.
+ *
+ * Use macros TRACE_BEGIN and TRACE_END which skip the call when tracing
+ * is disabled.
+ *
+ * @param[in] name  Span name, must be a string literal.
+ * @param[in] phase 'B' for begin or 'E' for end.
+ */
+void trace_event(const char *name, const char phase)
+{
+	struct trace_ring_t *ring = ring_get();
+	struct trace_event_t *event;
+
+	if (!ring)
+		return;
+
+	const uint64_t head = ring->head;
+
+	event = &ring->events[head % ring->nevents];
+	__atomic_store_n(&event->seq, 0, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	event->ts = trace_now();
+	event->name = name;
+	event->phase = phase;
+	event->cookie = ring->cookie;
+	memcpy(event->ctx, ring->ctx, sizeof(event->ctx));
+	__atomic_store_n(&event->seq, head + 1, __ATOMIC_RELEASE);
+
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Attach cookie and context to subsequent events of calling thread.
+ *
+ * @param[in] cookie Identifier, e.g. HSM action cookie.
+ * @param[in] ctx    Context string, e.g. FID, or NULL.
+ */
+void trace_context_set(const uint64_t cookie, const char *ctx)
+{
+	struct trace_ring_t *ring;
+
+	if (!trace_enabled)
+		return;
+
+	ring = ring_get();
+	if (!ring)
+		return;
+
+	ring->cookie = cookie;
+	if (ctx) {
+		strncpy(ring->ctx, ctx, TRACE_CTX_LEN - 1);
+		ring->ctx[TRACE_CTX_LEN - 1] = '\0';
+	} else
+		ring->ctx[0] = '\0';
+}
+
+void trace_context_clear(void)
+{
+	if (ring_self) {
+		ring_self->cookie = 0;
+		ring_self->ctx[0] = '\0';
+	}
+}
+
+/* Copy slot if it holds the event with sequence number seq, and was not
+   modified while copied. */
+static bool trace_event_copy(const struct trace_event_t *slot,
+			     const uint64_t seq, struct trace_event_t *event)
+{
+	if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != seq)
+		return false;
+	memcpy(event, slot, sizeof(struct trace_event_t));
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq)
+		return false;
+	event->ctx[TRACE_CTX_LEN - 1] = '\0';
+
+	return true;
+}
+
+/**
+ * @brief Write recorded events of all threads in Chrome trace format.
+ *
+ * Recording is suspended while dumping, events are kept such that a
+ * later dump contains them again unless overwritten. Threads which
+ * passed the trace_enabled check before may still record events, slots
+ * they update meanwhile are skipped.
+ *
+ * @param[in] fpath Output file.
+ * @return 0 on success, otherwise negative errno.
+ */
+int trace_dump(const char *fpath)
+{
+	int rc = 0;
+	FILE *file;
+	bool first = true;
+	const int enabled = __atomic_exchange_n(&trace_enabled, 0,
+						__ATOMIC_ACQ_REL);
+	const pid_t pid = getpid();
+
+	file = fopen(fpath, "w");
+	if (!file) {
+		rc = -errno;
+		CT_ERROR(rc, "fopen '%s'", fpath);
+		goto out;
+	}
+
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	for (struct trace_ring_t *ring = __atomic_load_n(&rings,
+							 __ATOMIC_ACQUIRE);
+	     ring; ring = ring->next) {
+		const uint64_t head = __atomic_load_n(&ring->head,
+						      __ATOMIC_ACQUIRE);
+		const uint64_t tail = head > ring->nevents ?
+			head - ring->nevents : 0;
+
+		fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\","
+			"\"pid\":%d,\"tid\":%d,\"args\":{\"name\":",
+			first ? "" : ",", pid, ring->tid);
+		json_str(file, ring->thread_name);
+		fprintf(file, "}}");
+		first = false;
+
+		for (uint64_t n = tail; n < head; n++) {
+			struct trace_event_t event;
+
+			/* Skip slots overwritten or being written by a
+			   thread which still records events. */
+			if (!trace_event_copy(&ring->events[n % ring->nevents],
+					      n + 1, &event))
+				continue;
+
+			fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"%c\","
+				"\"ts\":%.3f,\"pid\":%d,\"tid\":%d",
+				event.name, event.phase, event.ts / 1e3,
+				pid, ring->tid);
+			if (event.phase == 'B' && (event.cookie ||
+						   event.ctx[0])) {
+				fprintf(file, ",\"args\":{\"cookie\":"
+					"\"%#jx\",\"ctx\":",
+					(uintmax_t)event.cookie);
+				json_str(file, event.ctx);
+				fprintf(file, "}");
+			}
+			fprintf(file, "}");
+		}
+	}
+	fprintf(file, "\n]}\n");
+
+	if (fclose(file)) {
+		rc = -errno;
+		CT_ERROR(rc, "fclose '%s'", fpath);
+	}
+
+out:
+	__atomic_store_n(&trace_enabled, enabled, __ATOMIC_RELEASE);
+
+	return rc;
+}
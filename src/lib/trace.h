@@ -0,0 +1,48 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Copyright (c) 2026, GSI Helmholtz Centre for Heavy Ion Research
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+#define TRACE_NUM_EVENTS	16384	/* Default events per thread. */
+#define TRACE_CTX_LEN		48
+
+extern int trace_enabled;
+
+#define TRACE_BEGIN(name)						\
+do {									\
+	if (__builtin_expect(trace_enabled, 0))				\
+		trace_event(name, 'B');					\
+} while (0)
+
+#define TRACE_END(name)							\
+do {									\
+	if (__builtin_expect(trace_enabled, 0))				\
+		trace_event(name, 'E');					\
+} while (0)
+
+int trace_enable(const uint32_t nevents);
+void trace_disable(void);
+void trace_event(const char *name, const char phase);
+void trace_context_set(const uint64_t cookie, const char *ctx);
+void trace_context_clear(void);
+int trace_dump(const char *fpath);
+
+#endif /* TRACE_H */
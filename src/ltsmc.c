@@ -20,14 +20,44 @@
 #include <stdlib.h>
 #include <time.h>
 #include <getopt.h>
+#include <pthread.h>
+#include <unistd.h>
 #include <sys/stat.h>
 #include <sys/param.h>
 #include <zlib.h>
 #include "ltsmapi.h"
-#include "measurement.h"
+#include "metrics.h"
+#include "bufpool.h"
+#include "compress.h"
+
+/* Pipe engine: A reader thread fills a ring of buffers from stdin while
+   the main thread sends the filled buffers with tsm_fwrite, such that
+   reading stdin and sending to the TSM server overlap. */
+#ifndef PIPE_NUM_BUFS
+#define PIPE_NUM_BUFS	8
+#endif
+
+#ifndef PIPE_BUF_LENGTH
+#define PIPE_BUF_LENGTH	(4 * TSM_BUF_LENGTH)	/* 1 MiB. */
+#endif
+
+struct pipe_buf_t {
+	char *data;
+	size_t size;
+};
 
-MSRT_DECLARE(tsm_archive_fpath);
-MSRT_DECLARE(tsm_retrieve_fpath);
+struct pipe_ring_t {
+	struct pipe_buf_t buf[PIPE_NUM_BUFS];
+	uint16_t head;		/* Next buffer filled by reader. */
+	uint16_t tail;		/* Next buffer sent by main thread. */
+	uint16_t count;		/* Number of filled buffers. */
+	int eof;
+	int err;
+	int cancel;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond_filled;
+	pthread_cond_t cond_empty;
+};
 
 struct options {
 	int o_archive;
@@ -39,7 +69,10 @@ struct options {
 	int o_latest;
 	int o_recursive;
 	int o_checksum;
+	int o_direct;
 	int o_sort;
+	uint32_t o_compress_codec;
+	int o_compress_level;
 	char o_servername[DSM_MAX_SERVERNAME_LENGTH + 1];
 	char o_node[DSM_MAX_NODE_LENGTH + 1];
 	char o_owner[DSM_MAX_OWNER_LENGTH + 1];
@@ -83,6 +116,8 @@ static void usage(const char *cmd_name, const int rc)
 		"\t-l, --latest [retrieve object with latest timestamp when multiple exists]\n"
 		"\t-x, --prefix [retrieve prefix directory]\n"
 		"\t-r, --recursive [archive directory and all sub-directories]\n"
+		"\t--direct [archive with O_DIRECT reads bypassing the page cache]\n"
+		"\t--compress={none, zlib, zstd, lz4}[:level] [compress archived files, default: none]\n"
 		"\t-t, --sort={ascending, descending, restore} [sort query in date or restore order]\n"
 		"\t-f, --fsname <string> [default: '/']\n"
 		"\t-d, --description <string>\n"
@@ -276,6 +311,8 @@ static int parseopts(int argc, char *argv[])
 		{.name = "delete",	.has_arg = no_argument,       .flag = &opt.o_delete,   .val = 1},
 		{.name = "pipe",        .has_arg = no_argument,       .flag = &opt.o_pipe,     .val = 1},
 		{.name = "checksum",    .has_arg = no_argument,       .flag = &opt.o_checksum, .val = 1},
+		{.name = "direct",      .has_arg = no_argument,       .flag = &opt.o_direct,   .val = 1},
+		{.name = "compress",	.has_arg = required_argument, .flag = NULL,	       .val = 'Z'},
 		{.name = "latest",	.has_arg = no_argument,       .flag = NULL,            .val = 'l'},
 		{.name = "recursive",	.has_arg = no_argument,       .flag = NULL,	       .val = 'r'},
 		{.name = "sort",	.has_arg = required_argument, .flag = NULL,	       .val = 't'},
@@ -362,6 +399,16 @@ static int parseopts(int argc, char *argv[])
 			set_prefix(optarg);
 			break;
 		}
+		case 'Z': {
+			int rc = compress_parse(optarg, &opt.o_compress_codec,
+						&opt.o_compress_level);
+			if (rc) {
+				CT_ERROR(-rc, "wrong argument for "
+					 "--compress '%s'", optarg);
+				usage(argv[0], 1);
+			}
+			break;
+		}
 		case 'c': {
 			read_conf(optarg);
 			break;
@@ -401,18 +448,166 @@ static int parseopts(int argc, char *argv[])
 	return 0;
 }
 
-static int progress_callback(struct progress_size_t *pg_size,
-			      struct session_t *session)
+static void *pipe_reader(void *data)
 {
-	MSRT_DATA(tsm_archive_fpath, pg_size->cur);
-	MSRT_DATA(tsm_retrieve_fpath, pg_size->cur);
+	struct pipe_ring_t *ring = data;
+	struct pipe_buf_t *buf;
+	ssize_t size;
+
+	pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+
+	for (;;) {
+		pthread_mutex_lock(&ring->mutex);
+		while (ring->count == PIPE_NUM_BUFS && !ring->cancel)
+			pthread_cond_wait(&ring->cond_empty, &ring->mutex);
+		if (ring->cancel) {
+			pthread_mutex_unlock(&ring->mutex);
+			break;
+		}
+		buf = &ring->buf[ring->head];
+		pthread_mutex_unlock(&ring->mutex);
+
+		/* Only allow cancellation while blocking on stdin, in case
+		   the sender fails and stdin never reaches end of file. */
+		pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+		size = read_size(STDIN_FILENO, buf->data, PIPE_BUF_LENGTH);
+		pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+
+		pthread_mutex_lock(&ring->mutex);
+		if (size < 0) {
+			ring->err = -size;
+			CT_ERROR(ring->err, "read failed on stdin");
+		} else {
+			buf->size = size;
+			if (size > 0) {
+				ring->head = (ring->head + 1) % PIPE_NUM_BUFS;
+				ring->count++;
+			}
+			/* Short read indicates end of file. */
+			if (size < PIPE_BUF_LENGTH)
+				ring->eof = 1;
+		}
+		pthread_cond_signal(&ring->cond_filled);
+		if (ring->err || ring->eof) {
+			pthread_mutex_unlock(&ring->mutex);
+			break;
+		}
+		pthread_mutex_unlock(&ring->mutex);
+	}
 
-	return 0;
+	return NULL;
+}
+
+/* Print per call metrics of operation started at snapshot start. */
+static void display_metrics(const char *name,
+			    const struct metrics_snapshot_t *start)
+{
+	struct metrics_snapshot_t end;
+	struct metrics_snapshot_t diff;
+
+	if (!API_MSG_ENABLED(API_MSG_INFO))
+		return;
+
+	metrics_snapshot(&end);
+	metrics_diff(&diff, start, &end);
+	metrics_print(stdout, name, &diff);
+}
+
+static int pipe_stdin(struct session_t *session)
+{
+	int rc = 0;
+	pthread_t reader;
+	struct pipe_ring_t ring;
+	struct bufpool_t pool;
+	struct metrics_snapshot_t msrt;
+
+	memset(&ring, 0, sizeof(ring));
+	rc = bufpool_init(&pool, PIPE_BUF_LENGTH,
+			  BUFPOOL_HUGEPAGE | BUFPOOL_NUMA);
+	if (rc) {
+		CT_ERROR(rc, "bufpool_init");
+		return rc;
+	}
+	for (uint16_t n = 0; n < PIPE_NUM_BUFS; n++) {
+		ring.buf[n].data = bufpool_get(&pool);
+		if (!ring.buf[n].data) {
+			rc = -ENOMEM;
+			CT_ERROR(rc, "bufpool_get");
+			goto cleanup;
+		}
+	}
+	pthread_mutex_init(&ring.mutex, NULL);
+	pthread_cond_init(&ring.cond_filled, NULL);
+	pthread_cond_init(&ring.cond_empty, NULL);
+
+	rc = pthread_create(&reader, NULL, pipe_reader, &ring);
+	if (rc) {
+		CT_ERROR(rc, "pthread_create");
+		rc = -rc;
+		goto cleanup_sync;
+	}
+
+	metrics_snapshot(&msrt);
+	for (;;) {
+		struct pipe_buf_t *buf;
+		ssize_t written;
+
+		pthread_mutex_lock(&ring.mutex);
+		while (ring.count == 0 && !ring.eof && !ring.err)
+			pthread_cond_wait(&ring.cond_filled, &ring.mutex);
+		if (ring.count == 0) {
+			/* Drained all buffers and reader is done. */
+			if (ring.err)
+				rc = -ring.err;
+			pthread_mutex_unlock(&ring.mutex);
+			break;
+		}
+		buf = &ring.buf[ring.tail];
+		pthread_mutex_unlock(&ring.mutex);
+
+		written = tsm_fwrite(buf->data, 1, buf->size, session);
+		if (written < 0 || (size_t)written != buf->size) {
+			rc = -EIO;
+			CT_ERROR(errno, "tsm_fwrite failed");
+			break;
+		}
+
+		pthread_mutex_lock(&ring.mutex);
+		ring.tail = (ring.tail + 1) % PIPE_NUM_BUFS;
+		ring.count--;
+		pthread_cond_signal(&ring.cond_empty);
+		pthread_mutex_unlock(&ring.mutex);
+	}
+
+	if (rc) {
+		pthread_mutex_lock(&ring.mutex);
+		ring.cancel = 1;
+		pthread_cond_signal(&ring.cond_empty);
+		pthread_mutex_unlock(&ring.mutex);
+		pthread_cancel(reader);
+	}
+	pthread_join(reader, NULL);
+
+	if (!rc)
+		display_metrics("tsm_fwrite", &msrt);
+
+cleanup_sync:
+	pthread_cond_destroy(&ring.cond_empty);
+	pthread_cond_destroy(&ring.cond_filled);
+	pthread_mutex_destroy(&ring.mutex);
+
+cleanup:
+	for (uint16_t n = 0; n < PIPE_NUM_BUFS; n++)
+		bufpool_put(&pool, ring.buf[n].data);
+	bufpool_destroy(&pool);
+
+	return rc;
 }
 
 int main(int argc, char *argv[])
 {
 	int rc;
+	struct metrics_snapshot_t msrt;
 	api_msg_set_level(opt.o_verbose);
 	rc = parseopts(argc, argv);
 	if (rc) {
@@ -469,6 +664,9 @@ int main(int argc, char *argv[])
 
 	session.qtable.multiple = opt.o_latest == 1 ? bFalse : bTrue;
 	session.qtable.sort_by = opt.o_sort;
+	session.archive_direct = opt.o_direct == 1 ? bTrue : bFalse;
+	session.compress_codec = opt.o_compress_codec;
+	session.compress_level = opt.o_compress_level;
 
 	rc = tsm_init(DSM_SINGLETHREAD);
 	if (rc)
@@ -493,23 +691,11 @@ int main(int argc, char *argv[])
 			goto cleanup_tsm;
 		}
 
-		char buf[TSM_BUF_LENGTH] = {0};
-		size_t size;
-		do {
-			size = fread(buf, 1, TSM_BUF_LENGTH, stdin);
-			if (ferror(stdin)) {
-				session.tsm_file->err = EIO;
-				CT_ERROR(EIO, "fread failed");
-				break;
-			}
-			if (size == 0)
-				break;
-			rc = tsm_fwrite(buf, 1, size, &session);
-			if (rc < 0) {
-				CT_ERROR(errno, "tsm_fwrite failed");
-				break;
-			}
-		} while (!feof(stdin));
+		rc = pipe_stdin(&session);
+		if (rc) {
+			session.tsm_file->err = -rc;
+			CT_ERROR(-rc, "pipe_stdin failed");
+		}
 
 		rc = tsm_fclose(&session);
 		if (rc)
@@ -518,8 +704,6 @@ int main(int argc, char *argv[])
 		goto cleanup_tsm;
 	}
 
-	session.progress = progress_callback;
-
 	rc = tsm_connect(&login, &session);
 	if (rc)
 		goto cleanup_tsm;
@@ -536,22 +720,20 @@ int main(int argc, char *argv[])
 					     opt.o_desc, &opt.o_date_lower_bound,
 					     &opt.o_date_upper_bound, &session);
 		else if (opt.o_retrieve) {
-			MSRT_START(tsm_retrieve_fpath);
+			metrics_snapshot(&msrt);
 			rc = tsm_retrieve_fpath(opt.o_fsname, files_dirs_arg[i],
 						opt.o_desc, -1, &session);
-			MSRT_STOP(tsm_retrieve_fpath);
-			MSRT_DISPLAY_RESULT(tsm_retrieve_fpath);
+			display_metrics("tsm_retrieve_fpath", &msrt);
 		}
 		else if (opt.o_delete)
 			rc = tsm_delete_fpath(opt.o_fsname, files_dirs_arg[i],
 					      &session);
 		else if (opt.o_archive) {
-			MSRT_START(tsm_archive_fpath);
+			metrics_snapshot(&msrt);
 			rc = tsm_archive_fpath(opt.o_fsname,
 					       files_dirs_arg[i],
 					       opt.o_desc, -1, NULL, &session);
-			MSRT_STOP(tsm_archive_fpath);
-			MSRT_DISPLAY_RESULT(tsm_archive_fpath);
+			display_metrics("tsm_archive_fpath", &msrt);
 		}
 		if (rc)
 			goto cleanup_tsm;
@@ -0,0 +1,832 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Copyright (c) 2026, GSI Helmholtz Centre for Heavy Ion Research
+ */
+
+/* Synchronize a Lustre directory with the objects archived on the TSM
+   server. The objects are queried once into a query table, missing files
+   are created by a pool of threads, and the data is either restored by the
+   Lustre copytool (HSM stubs and batched HSM requests) or retrieved
+   directly by several TSM sessions in restore order. */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <time.h>
+#include <libgen.h>
+#include <sys/stat.h>
+#include <sys/param.h>
+#include <lustre/lustreapi.h>
+#include "ltsmapi.h"
+#include "qtable.h"
+#include "common.h"
+
+#ifndef SYNC_NUM_THREADS
+#define SYNC_NUM_THREADS	4
+#endif
+
+#ifndef SYNC_DAYS_AGO
+#define SYNC_DAYS_AGO		7
+#endif
+
+/* Number of FIDs per llapi_hsm_request. */
+#ifndef SYNC_HSM_BATCH
+#define SYNC_HSM_BATCH		64
+#endif
+
+enum sync_state_t {
+	SYNC_SKIP    = 0,	/* Directory, existing file or failure. */
+	SYNC_PENDING = 1	/* Stub created resp. data to be retrieved. */
+};
+
+struct options {
+	int o_archive_id;
+	int o_nthreads;
+	int o_days_ago;
+	int o_crc32_verify;
+	int o_omit_copytool;
+	int o_no_restore;
+	int o_dry_run;
+	int o_verbose;
+	char o_servername[DSM_MAX_SERVERNAME_LENGTH + 1];
+	char o_node[DSM_MAX_NODE_LENGTH + 1];
+	char o_owner[DSM_MAX_OWNER_LENGTH + 1];
+	char o_password[DSM_MAX_VERIFIER_LENGTH + 1];
+	char o_fsname[DSM_MAX_FSNAME_LENGTH + 1];
+	char o_dir[PATH_MAX + 1];
+};
+
+static struct options opt = {
+	.o_archive_id	 = 0,
+	.o_nthreads	 = SYNC_NUM_THREADS,
+	.o_days_ago	 = SYNC_DAYS_AGO,
+	.o_crc32_verify	 = 0,
+	.o_omit_copytool = 0,
+	.o_no_restore	 = 0,
+	.o_dry_run	 = 0,
+	.o_verbose	 = API_MSG_NORMAL,
+	.o_servername	 = {0},
+	.o_node		 = {0},
+	.o_owner	 = {0},
+	.o_password	 = {0},
+	.o_fsname	 = "/",
+	.o_dir		 = {0}
+};
+
+struct sync_stats_t {
+	uint32_t files;
+	uint32_t dirs;
+	uint32_t exist;
+	uint32_t mismatch;
+	uint32_t pending;
+	uint32_t done;
+	uint32_t failed;
+	uint64_t bytes;
+};
+
+static struct sync_stats_t stats;
+static struct login_t login;
+static struct qarray_t *qarray;
+static uint8_t *state;
+static lustre_fid *fids;
+static uint32_t npending;
+static uint32_t chunk;
+static uint32_t next_idx;
+
+static void usage(const char *cmd_name, const int rc)
+{
+	dsmApiVersionEx libapi_ver = get_libapi_ver();
+	dsmAppVersion appapi_ver = get_appapi_ver();
+
+	fprintf(stdout, "usage: %s [options] <lustre_directory>\n"
+		"\t-f, --filespace <string> [default: %s]\n"
+		"\t-s, --servername <string>\n"
+		"\t-n, --node <string>\n"
+		"\t-p, --password <string>\n"
+		"\t-o, --owner <string>\n"
+		"\t-a, --archive-id <int> [default: %d]\n"
+		"\t-t, --threads <int> [default: %d]\n"
+		"\t\t""number of threads creating files resp. tsm sessions"
+		" retrieving data\n"
+		"\t-y, --days-ago <int> [default: %d]\n"
+		"\t\t""only objects archived within the last days,"
+		" 0 selects all objects\n"
+		"\t-c, --crc32-verify\n"
+		"\t\t""verify crc32 of already existing files\n"
+		"\t-x, --omit-copytool <yes,no> [default: no]\n"
+		"\t\t""retrieve data by tsm sessions instead of the Lustre"
+		" copytool\n"
+		"\t-r, --no-restore\n"
+		"\t\t""create released files only, data is restored by the"
+		" copytool on first access\n"
+		"\t-d, --dry-run\n"
+		"\t\t""don't run, just show what would be done\n"
+		"\t-v, --verbose {error, warn, message, info, debug}"
+		" [default: %s]\n"
+		"\t-h, --help\n"
+		"\nIBM API library version: %d.%d.%d.%d, "
+		"IBM API application client version: %d.%d.%d.%d\n"
+		"version: %s © 2026 by GSI Helmholtz Centre for Heavy Ion Research\n",
+		cmd_name, opt.o_fsname, opt.o_archive_id, SYNC_NUM_THREADS,
+		SYNC_DAYS_AGO, LOG_LEVEL_HUMAN_STR(opt.o_verbose),
+		libapi_ver.version, libapi_ver.release, libapi_ver.level,
+		libapi_ver.subLevel,
+		appapi_ver.applicationVersion, appapi_ver.applicationRelease,
+		appapi_ver.applicationLevel, appapi_ver.applicationSubLevel,
+		PACKAGE_VERSION);
+	exit(rc);
+}
+
+static int parse_int(const char *arg, const int lower_bound,
+		     const int upper_bound, int *val)
+{
+	char *end = NULL;
+	long l = strtol(arg, &end, 10);
+
+	if (*end != '\0' || l < lower_bound || l > upper_bound) {
+		CT_ERROR(-EINVAL, "invalid argument: '%s'", arg);
+		return -EINVAL;
+	}
+	*val = (int)l;
+
+	return 0;
+}
+
+static int parseopts(int argc, char *argv[])
+{
+	struct option long_opts[] = {
+		{.name = "filespace",     .has_arg = required_argument, .flag = NULL,                  .val = 'f'},
+		{.name = "servername",    .has_arg = required_argument, .flag = NULL,                  .val = 's'},
+		{.name = "node",          .has_arg = required_argument, .flag = NULL,                  .val = 'n'},
+		{.name = "password",      .has_arg = required_argument, .flag = NULL,                  .val = 'p'},
+		{.name = "owner",         .has_arg = required_argument, .flag = NULL,                  .val = 'o'},
+		{.name = "archive-id",    .has_arg = required_argument, .flag = NULL,                  .val = 'a'},
+		{.name = "threads",       .has_arg = required_argument, .flag = NULL,                  .val = 't'},
+		{.name = "jobs",          .has_arg = required_argument, .flag = NULL,                  .val = 't'},
+		{.name = "days-ago",      .has_arg = required_argument, .flag = NULL,                  .val = 'y'},
+		{.name = "crc32-verify",  .has_arg = no_argument,       .flag = &opt.o_crc32_verify,   .val =   1},
+		{.name = "omit-copytool", .has_arg = required_argument, .flag = NULL,                  .val = 'x'},
+		{.name = "no-restore",    .has_arg = no_argument,       .flag = &opt.o_no_restore,     .val =   1},
+		{.name = "dry-run",       .has_arg = no_argument,       .flag = &opt.o_dry_run,        .val =   1},
+		{.name = "verbose",       .has_arg = required_argument, .flag = NULL,                  .val = 'v'},
+		{.name = "help",          .has_arg = no_argument,       .flag = NULL,                  .val = 'h'},
+		{.name = NULL}
+	};
+
+	int c, rc;
+	optind = 0;
+
+	while ((c = getopt_long(argc, argv, "f:s:n:p:o:a:t:j:y:cx:rdv:h",
+				long_opts, NULL)) != -1) {
+		switch (c) {
+		case 'f': {
+			strncpy(opt.o_fsname, optarg, DSM_MAX_FSNAME_LENGTH);
+			break;
+		}
+		case 's': {
+			strncpy(opt.o_servername, optarg,
+				DSM_MAX_SERVERNAME_LENGTH);
+			break;
+		}
+		case 'n': {
+			strncpy(opt.o_node, optarg, DSM_MAX_NODE_LENGTH);
+			break;
+		}
+		case 'p': {
+			strncpy(opt.o_password, optarg,
+				DSM_MAX_VERIFIER_LENGTH);
+			break;
+		}
+		case 'o': {
+			strncpy(opt.o_owner, optarg, DSM_MAX_OWNER_LENGTH);
+			break;
+		}
+		case 'a': {
+			rc = parse_int(optarg, 0, UINT16_MAX, &opt.o_archive_id);
+			if (rc)
+				return rc;
+			break;
+		}
+		case 't':
+		case 'j': {
+			rc = parse_int(optarg, 1, UINT16_MAX, &opt.o_nthreads);
+			if (rc)
+				return rc;
+			break;
+		}
+		case 'y': {
+			rc = parse_int(optarg, 0, 0xFFFF * 366, &opt.o_days_ago);
+			if (rc)
+				return rc;
+			break;
+		}
+		case 'c': {
+			opt.o_crc32_verify = 1;
+			break;
+		}
+		case 'x': {
+			if (OPTNCMP("yes", optarg))
+				opt.o_omit_copytool = 1;
+			else if (OPTNCMP("no", optarg))
+				opt.o_omit_copytool = 0;
+			else {
+				CT_ERROR(0, "wrong argument for -x, "
+					 "--omit-copytool '%s'", optarg);
+				return -EINVAL;
+			}
+			break;
+		}
+		case 'r': {
+			opt.o_no_restore = 1;
+			break;
+		}
+		case 'd': {
+			opt.o_dry_run = 1;
+			break;
+		}
+		case 'v': {
+			rc = parse_verbose(optarg, &opt.o_verbose);
+			if (rc) {
+				CT_ERROR(0, "wrong argument for -v, "
+					 "--verbose '%s'", optarg);
+				return rc;
+			}
+			api_msg_set_level(opt.o_verbose);
+			break;
+		}
+		case 'h': {
+			usage(argv[0], 0);
+			break;
+		}
+		case 0: {
+			break;
+		}
+		default:
+			return -EINVAL;
+		}
+	}
+
+	if (optind != argc - 1) {
+		CT_ERROR(0, "missing argument <lustre_directory>");
+		return -EINVAL;
+	}
+	if (!realpath(argv[optind], opt.o_dir)) {
+		strncpy(opt.o_dir, argv[optind], PATH_MAX);
+		/* Trailing '/' confuses the hl/ll wildcards below. */
+		for (size_t l = strlen(opt.o_dir); l > 1 &&
+			     opt.o_dir[l - 1] == '/'; l--)
+			opt.o_dir[l - 1] = '\0';
+	}
+
+	if (opt.o_servername[0] == '\0') {
+		CT_ERROR(0, "missing argument -s, --servername");
+		return -EINVAL;
+	}
+	if (opt.o_node[0] == '\0') {
+		CT_ERROR(0, "missing argument -n, --node");
+		return -EINVAL;
+	}
+	if (opt.o_password[0] == '\0') {
+		CT_ERROR(0, "missing argument -p, --password");
+		return -EINVAL;
+	}
+	if (strncmp(opt.o_dir, opt.o_fsname, strlen(opt.o_fsname))) {
+		CT_ERROR(0, "filespace '%s' is not prefix of Lustre "
+			 "directory '%s'", opt.o_fsname, opt.o_dir);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static void days_ago_to_date(const int days_ago, dsmDate *date)
+{
+	struct tm tm;
+	const time_t t = time(NULL) - (time_t)days_ago * 24 * 60 * 60;
+
+	if (days_ago == 0) {
+		*date = (dsmDate){DATE_MINUS_INFINITE, 1, 1, 0, 0, 0};
+		return;
+	}
+	localtime_r(&t, &tm);
+	date->year = tm.tm_year + 1900;
+	date->month = tm.tm_mon + 1;
+	date->day = tm.tm_mday;
+	date->hour = tm.tm_hour;
+	date->minute = tm.tm_min;
+	date->second = tm.tm_sec;
+}
+
+static int qra_fpath(const qryRespArchiveData *qra, char *fpath)
+{
+	int len = snprintf(fpath, PATH_MAX + 1, "%s%s%s",
+			   qra->objName.fs, qra->objName.hl, qra->objName.ll);
+
+	if (len < 0 || len > PATH_MAX) {
+		CT_ERROR(ENAMETOOLONG, "fpath name too long (> PATH_MAX)");
+		return -ENAMETOOLONG;
+	}
+
+	return 0;
+}
+
+static void qra_obj_info(const qryRespArchiveData *qra,
+			 struct obj_info_t *obj_info)
+{
+	memset(obj_info, 0, sizeof(*obj_info));
+	memcpy(obj_info, qra->objInfo,
+	       MIN((size_t)qra->objInfolen, sizeof(*obj_info)));
+}
+
+static uint64_t obj_size(const struct obj_info_t *obj_info)
+{
+	return (uint64_t)obj_info->size.hi << 32 |
+		(uint64_t)obj_info->size.lo;
+}
+
+/**
+ * @brief Create an empty archived file to be restored by the copytool.
+ *
+ * Create file fpath with the size and mode of the archived object, mark
+ * it as existing and archived in archive id, and return its FID for the
+ * subsequent HSM release and restore requests.
+ *
+ * @param[in]  fpath    Path of file to create.
+ * @param[in]  obj_info Object information stored on the TSM server.
+ * @param[out] fid      FID of created file.
+ * @return 0 on success, otherwise negative errno.
+ */
+static int sync_stub(const char *fpath, const struct obj_info_t *obj_info,
+		     lustre_fid *fid)
+{
+	int rc;
+	int fd;
+	char dir[PATH_MAX + 1];
+
+	strncpy(dir, fpath, PATH_MAX);
+	dir[PATH_MAX] = '\0';
+	rc = mkdir_p(dirname(dir), S_IRWXU | S_IRGRP | S_IXGRP |
+		     S_IROTH | S_IXOTH);
+	if (rc) {
+		CT_ERROR(rc, "mkdir_p '%s'", dir);
+		return rc;
+	}
+
+	fd = open(fpath, O_WRONLY | O_CREAT | O_EXCL,
+		  obj_info->st_mode & 07777);
+	if (fd < 0) {
+		rc = -errno;
+		CT_ERROR(rc, "open '%s'", fpath);
+		return rc;
+	}
+
+	rc = ftruncate(fd, obj_size(obj_info));
+	if (rc) {
+		rc = -errno;
+		CT_ERROR(rc, "ftruncate '%s'", fpath);
+		goto cleanup;
+	}
+
+	rc = llapi_hsm_state_set_fd(fd, HS_EXISTS | HS_ARCHIVED, 0,
+				    opt.o_archive_id);
+	if (rc) {
+		CT_ERROR(rc, "llapi_hsm_state_set_fd '%s'", fpath);
+		goto cleanup;
+	}
+
+	rc = llapi_fd2fid(fd, fid);
+	if (rc)
+		CT_ERROR(rc, "llapi_fd2fid '%s'", fpath);
+
+cleanup:
+	close(fd);
+	if (rc)
+		unlink(fpath);
+
+	return rc;
+}
+
+/**
+ * @brief Classify object n of the query array and create it if missing.
+ *
+ * Directories are created, existing files are checked by size resp. crc32
+ * and missing files are either created as HSM stubs or marked for the
+ * retrieve engine.
+ */
+static void sync_obj(const uint32_t n)
+{
+	int rc;
+	struct stat st;
+	struct obj_info_t obj_info;
+	char fpath[PATH_MAX + 1];
+	const qryRespArchiveData *qra = &qarray->data[n];
+
+	if (qra_fpath(qra, fpath)) {
+		__atomic_fetch_add(&stats.failed, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	qra_obj_info(qra, &obj_info);
+
+	if (qra->objName.objType == DSM_OBJ_DIRECTORY) {
+		__atomic_fetch_add(&stats.dirs, 1, __ATOMIC_RELAXED);
+		if (opt.o_dry_run)
+			return;
+		rc = mkdir_p(fpath, obj_info.st_mode);
+		if (rc) {
+			CT_ERROR(rc, "mkdir_p '%s'", fpath);
+			__atomic_fetch_add(&stats.failed, 1, __ATOMIC_RELAXED);
+		}
+		return;
+	} else if (qra->objName.objType != DSM_OBJ_FILE) {
+		CT_WARN("skip object '%s' due to unknown type %d", fpath,
+			qra->objName.objType);
+		return;
+	}
+	__atomic_fetch_add(&stats.files, 1, __ATOMIC_RELAXED);
+
+	if (stat(fpath, &st) == 0) {
+		__atomic_fetch_add(&stats.exist, 1, __ATOMIC_RELAXED);
+		if (opt.o_crc32_verify) {
+			uint32_t crc32sum = 0;
+
+			rc = crc32file(fpath, &crc32sum);
+			if (rc || crc32sum != obj_info.crc32) {
+				CT_WARN("crc32 mismatch of file '%s' "
+					"(0x%08x,0x%08x)", fpath,
+					obj_info.crc32, crc32sum);
+				__atomic_fetch_add(&stats.mismatch, 1,
+						   __ATOMIC_RELAXED);
+			} else
+				CT_INFO("file '%s' already exists and has "
+					"valid crc32 0x%08x", fpath, crc32sum);
+		} else if (st.st_size == 0 && obj_size(&obj_info) > 0) {
+			CT_WARN("file '%s' already exists and has size 0",
+				fpath);
+			__atomic_fetch_add(&stats.mismatch, 1,
+					   __ATOMIC_RELAXED);
+		} else
+			CT_INFO("file '%s' already exists and has size %zd",
+				fpath, (ssize_t)st.st_size);
+		return;
+	} else if (errno != ENOENT) {
+		CT_ERROR(-errno, "stat '%s'", fpath);
+		__atomic_fetch_add(&stats.failed, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	if (opt.o_dry_run) {
+		CT_MESSAGE("%s '%s', size %" PRIu64 ", archive id %d",
+			   opt.o_omit_copytool ? "retrieve" : "create stub",
+			   fpath, obj_size(&obj_info), opt.o_archive_id);
+		__atomic_fetch_add(&stats.pending, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	if (!opt.o_omit_copytool) {
+		rc = sync_stub(fpath, &obj_info, &fids[n]);
+		if (rc) {
+			__atomic_fetch_add(&stats.failed, 1, __ATOMIC_RELAXED);
+			return;
+		}
+	}
+	state[n] = SYNC_PENDING;
+	__atomic_fetch_add(&stats.pending, 1, __ATOMIC_RELAXED);
+}
+
+static void *sync_obj_thread(void *arg)
+{
+	uint32_t n;
+
+	(void)arg;
+	while ((n = __atomic_fetch_add(&next_idx, 1, __ATOMIC_RELAXED)) <
+	       qarray->size)
+		sync_obj(n);
+
+	return NULL;
+}
+
+/**
+ * @brief Retrieve contiguous chunks of pending objects in restore order.
+ *
+ * Each thread owns a TSM session and retrieves chunks of the (compacted)
+ * query array, such that objects located on the same volume are read by
+ * a single dsmBeginGetData call. Successfully retrieved files are marked
+ * as existing and archived.
+ */
+static void *sync_retrieve_thread(void *arg)
+{
+	int rc;
+	uint32_t begin;
+	struct session_t session;
+
+	(void)arg;
+	memset(&session, 0, sizeof(session));
+	rc = tsm_connect(&login, &session);
+	if (rc) {
+		CT_ERROR(rc, "tsm_connect");
+		return NULL;
+	}
+
+	while ((begin = __atomic_fetch_add(&next_idx, chunk,
+					   __ATOMIC_RELAXED)) < npending) {
+		const uint32_t n = MIN(chunk, npending - begin);
+
+		rc = tsm_retrieve_qra(&qarray->data[begin], n, -1, &session);
+		if (rc) {
+			CT_ERROR(EFAILED, "tsm_retrieve_qra of %u objects "
+				 "failed", n);
+			__atomic_fetch_add(&stats.failed, n, __ATOMIC_RELAXED);
+			continue;
+		}
+
+		for (uint32_t i = begin; i < begin + n; i++) {
+			char fpath[PATH_MAX + 1];
+			struct obj_info_t obj_info;
+
+			if (qra_fpath(&qarray->data[i], fpath))
+				continue;
+			qra_obj_info(&qarray->data[i], &obj_info);
+			rc = llapi_hsm_state_set(fpath, HS_EXISTS | HS_ARCHIVED,
+						 0, opt.o_archive_id);
+			if (rc) {
+				CT_ERROR(rc, "llapi_hsm_state_set '%s'", fpath);
+				__atomic_fetch_add(&stats.failed, 1,
+						   __ATOMIC_RELAXED);
+				continue;
+			}
+			CT_MESSAGE("successfully retrieved file '%s'", fpath);
+			__atomic_fetch_add(&stats.done, 1, __ATOMIC_RELAXED);
+			__atomic_fetch_add(&stats.bytes, obj_size(&obj_info),
+					   __ATOMIC_RELAXED);
+		}
+	}
+
+	tsm_disconnect(&session);
+
+	return NULL;
+}
+
+static int sync_threads(void *(*fn)(void *), const uint32_t nthreads)
+{
+	int rc = 0;
+	uint32_t n;
+	pthread_t threads[nthreads];
+
+	next_idx = 0;
+	for (n = 0; n < nthreads; n++) {
+		rc = pthread_create(&threads[n], NULL, fn, NULL);
+		if (rc) {
+			CT_ERROR(-rc, "pthread_create");
+			rc = -rc;
+			break;
+		}
+	}
+	for (uint32_t i = 0; i < n; i++)
+		pthread_join(threads[i], NULL);
+
+	return rc;
+}
+
+static int sync_hsm_send(struct hsm_user_request *hur,
+			 const enum hsm_user_action action)
+{
+	int rc;
+
+	hur->hur_request.hr_action = action;
+	rc = llapi_hsm_request(opt.o_dir, hur);
+	if (rc)
+		CT_ERROR(rc, "llapi_hsm_request %s of %u files",
+			 action == HUA_RELEASE ? "release" : "restore",
+			 hur->hur_request.hr_itemcount);
+
+	return rc;
+}
+
+static void sync_hsm_flush(struct hsm_user_request *hur)
+{
+	int rc;
+	const uint32_t count = hur->hur_request.hr_itemcount;
+
+	if (count == 0)
+		return;
+
+	rc = sync_hsm_send(hur, HUA_RELEASE);
+	if (!rc && !opt.o_no_restore)
+		rc = sync_hsm_send(hur, HUA_RESTORE);
+	__atomic_fetch_add(rc ? &stats.failed : &stats.done, count,
+			   __ATOMIC_RELAXED);
+	hur->hur_request.hr_itemcount = 0;
+}
+
+/**
+ * @brief Release the created stubs and request their restore.
+ *
+ * FIDs are sent in batches of SYNC_HSM_BATCH in restore order, such
+ * that the copytool receives the restore actions in the order of the
+ * data on the TSM storage.
+ */
+static int sync_hsm_requests(void)
+{
+	struct hsm_user_request *hur;
+
+	hur = llapi_hsm_user_request_alloc(SYNC_HSM_BATCH, 0);
+	if (!hur) {
+		CT_ERROR(-ENOMEM, "llapi_hsm_user_request_alloc");
+		return -ENOMEM;
+	}
+	hur->hur_request.hr_archive_id = opt.o_archive_id;
+	hur->hur_request.hr_flags = 0;
+	hur->hur_request.hr_data_len = 0;
+	hur->hur_request.hr_itemcount = 0;
+
+	for (uint32_t n = 0; n < qarray->size; n++) {
+		if (state[n] != SYNC_PENDING)
+			continue;
+
+		struct hsm_user_item *hui =
+			&hur->hur_user_item[hur->hur_request.hr_itemcount++];
+		hui->hui_fid = fids[n];
+		hui->hui_extent.offset = 0;
+		hui->hui_extent.length = -1;
+
+		if (hur->hur_request.hr_itemcount == SYNC_HSM_BATCH)
+			sync_hsm_flush(hur);
+	}
+	sync_hsm_flush(hur);
+	free(hur);
+
+	return 0;
+}
+
+/**
+ * @brief Move pending objects to the front of the query array.
+ *
+ * The relative restore order of the pending objects is preserved.
+ */
+static uint32_t sync_compact(void)
+{
+	uint32_t m = 0;
+
+	for (uint32_t n = 0; n < qarray->size; n++) {
+		if (state[n] != SYNC_PENDING)
+			continue;
+		if (m != n)
+			qarray->data[m] = qarray->data[n];
+		m++;
+	}
+
+	return m;
+}
+
+int main(int argc, char *argv[])
+{
+	int rc;
+	struct session_t session;
+	dsmDate date_lower_bound;
+	dsmDate date_upper_bound = {DATE_PLUS_INFINITE, 12, 31, 23, 59, 59};
+	char fpath[PATH_MAX + 1];
+	struct timespec ts_begin, ts_end;
+
+	api_msg_set_level(opt.o_verbose);
+	rc = parseopts(argc, argv);
+	if (rc) {
+		CT_WARN("try '%s --help' for more information", argv[0]);
+		return 1;
+	}
+	days_ago_to_date(opt.o_days_ago, &date_lower_bound);
+	clock_gettime(CLOCK_MONOTONIC, &ts_begin);
+
+	login_init(&login, opt.o_servername,
+		   opt.o_node, opt.o_password,
+		   opt.o_owner, LINUX_PLATFORM,
+		   opt.o_fsname, DEFAULT_FSTYPE);
+
+	memset(&session, 0, sizeof(session));
+	session.qtable.multiple = bFalse;
+
+	rc = tsm_init(DSM_MULTITHREAD);
+	if (rc)
+		return 1;
+
+	rc = tsm_connect(&login, &session);
+	if (rc)
+		goto cleanup_tsm;
+
+	rc = init_qtable(&session.qtable);
+	if (rc) {
+		CT_ERROR(EFAILED, "init_qtable failed");
+		tsm_disconnect(&session);
+		goto cleanup_tsm;
+	}
+
+	/* Query the objects directly in and below the directory. As the
+	   query table keeps the latest version of each fs/hl/ll only, the
+	   two queries cannot produce duplicates. */
+	const char *patterns[] = {"%s/*", "%s/*/*"};
+	for (size_t i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++) {
+		snprintf(fpath, sizeof(fpath), patterns[i],
+			 strcmp(opt.o_dir, "/") ? opt.o_dir : "");
+		rc = tsm_query_fpath_qtable(opt.o_fsname, fpath, NULL,
+					    &date_lower_bound,
+					    &date_upper_bound, &session);
+		if (rc)
+			break;
+	}
+	if (!rc) {
+		rc = create_array(&session.qtable, SORT_RESTORE_ORDER);
+		if (rc)
+			CT_ERROR(EFAILED, "create_array failed");
+	}
+	/* The retrieve threads open their own sessions. */
+	tsm_disconnect(&session);
+	if (rc)
+		goto cleanup_qtable;
+
+	qarray = &session.qtable.qarray;
+	if (qarray->size == 0) {
+		CT_MESSAGE("no objects found on tsm server");
+		rc = 1;
+		goto cleanup_qtable;
+	}
+
+	state = calloc(qarray->size, sizeof(*state));
+	fids = opt.o_omit_copytool ? NULL :
+		calloc(qarray->size, sizeof(*fids));
+	if (!state || (!opt.o_omit_copytool && !fids)) {
+		rc = -ENOMEM;
+		CT_ERROR(rc, "calloc");
+		goto cleanup_state;
+	}
+
+	rc = sync_threads(sync_obj_thread,
+			  MIN((uint32_t)opt.o_nthreads, qarray->size));
+	if (rc || opt.o_dry_run)
+		goto cleanup_state;
+
+	if (!opt.o_omit_copytool)
+		rc = sync_hsm_requests();
+	else {
+		npending = sync_compact();
+		if (npending > 0) {
+			/* Contiguous chunks keep the restore order per
+			   session and balance the sessions. */
+			chunk = MIN((npending + opt.o_nthreads - 1) /
+				    opt.o_nthreads, DSM_MAX_GET_OBJ);
+			rc = sync_threads(sync_retrieve_thread,
+					  MIN((uint32_t)opt.o_nthreads,
+					      (npending + chunk - 1) / chunk));
+			/* Chunks not claimed by any session, e.g. when
+			   all sessions failed to connect. */
+			if (next_idx < npending)
+				stats.failed += npending - next_idx;
+		}
+	}
+
+cleanup_state:
+	clock_gettime(CLOCK_MONOTONIC, &ts_end);
+	CT_MESSAGE("objects %u, files %u, directories %u, existing %u, "
+		   "mismatching %u, %s %u, %s %u, failed %u, "
+		   "bytes %" PRIu64 ", elapsed %.3f sec",
+		   qarray->size, stats.files, stats.dirs, stats.exist,
+		   stats.mismatch,
+		   opt.o_omit_copytool ? "to retrieve" : "stubs", stats.pending,
+		   opt.o_omit_copytool ? "retrieved" : "requested", stats.done,
+		   stats.failed, stats.bytes,
+		   (ts_end.tv_sec - ts_begin.tv_sec) +
+		   (ts_end.tv_nsec - ts_begin.tv_nsec) / 1e9);
+	if (!rc && stats.failed)
+		rc = 1;
+	free(fids);
+	free(state);
+
+cleanup_qtable:
+	destroy_qtable(&session.qtable);
+
+cleanup_tsm:
+	tsm_cleanup(DSM_MULTITHREAD);
+
+	return rc ? 1 : 0;
+}
@@ -0,0 +1,578 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Copyright (c) 2026, GSI Helmholtz Centre for Heavy Ion Research
+ */
+
+/*
+ * Micro benchmarks of libltsmapi hot paths: log macros, list, queue,
+ * chashtable, qtable, extract_hl_ll and crc32file. Each benchmark
+ * reports ns/op, ops/s, throughput where applicable and the number of
+ * allocations per op, which are counted by interposing the glibc
+ * allocator. With option --scale all benchmarks run for 10^3, 10^4, ...
+ * entries up to --number, such that the asymptotic behaviour becomes
+ * visible.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/time.h>
+#include "log.h"
+#include "list.h"
+#include "queue.h"
+#include "chashtable.h"
+#include "qtable.h"
+
+#define NUM_ENTRIES_DEFAULT	100000
+#define CRC32_SIZE_DEFAULT	67108864
+#define CRC32_REPS		4
+#define LEN_KEY			48
+
+/* Emulates the CT_DEBUG macro before level checks were hoisted into the
+   macro, that is time and thread id are queried on each invocation. */
+#define CT_DEBUG_EAGER(_format, ...)					\
+	api_error(API_MSG_DEBUG | API_MSG_NO_ERRNO, 0,			\
+		  BLU "[D] " RESET "%f [%ld] %s:%d "_format,		\
+		  time_gtod(), syscall(SYS_gettid), __FILE__, __LINE__,	\
+		  ## __VA_ARGS__)
+
+enum bench_e {BENCH_LOG, BENCH_LIST, BENCH_QUEUE, BENCH_CHASHTABLE,
+	      BENCH_QTABLE, BENCH_EXTRACT_HL_LL, BENCH_CRC32, BENCH_NUM};
+
+static const char *bench_names[BENCH_NUM] = {
+	"log", "list", "queue", "chashtable", "qtable", "extract_hl_ll",
+	"crc32"
+};
+
+struct options {
+	uint64_t o_nentries;
+	uint32_t o_nbuckets;
+	size_t o_crc32_size;
+	bool o_scale;
+	bool o_bench[BENCH_NUM];
+};
+
+static struct options opt = {
+	.o_nentries = NUM_ENTRIES_DEFAULT,
+	.o_nbuckets = DEFAULT_NUM_BUCKETS,
+	.o_crc32_size = CRC32_SIZE_DEFAULT,
+	.o_scale = false,
+	.o_bench = {true, true, true, true, true, true, true},
+};
+
+struct timing_t {
+	uint64_t ns;
+	uint64_t nallocs;
+};
+
+/* Count allocations by interposing the glibc allocator, calls from
+   libltsmapi and libc resolve to these definitions as well. */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static uint64_t nallocs = 0;
+
+void *malloc(size_t size)
+{
+	__atomic_fetch_add(&nallocs, 1, __ATOMIC_RELAXED);
+
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+	__atomic_fetch_add(&nallocs, 1, __ATOMIC_RELAXED);
+
+	return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	__atomic_fetch_add(&nallocs, 1, __ATOMIC_RELAXED);
+
+	return __libc_realloc(ptr, size);
+}
+
+static double time_gtod(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+
+	return tv.tv_sec + 0.000001 * tv.tv_usec;
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void timing_start(struct timing_t *timing)
+{
+	timing->nallocs = __atomic_load_n(&nallocs, __ATOMIC_RELAXED);
+	timing->ns = now_ns();
+}
+
+/* Print ns/op, ops/s, Mbytes/s if bytes is not zero and allocations/op
+   of the n operations timed since timing_start. */
+static void report(const char *name, const struct timing_t *timing,
+		   const uint64_t n, const uint64_t bytes)
+{
+	const uint64_t ns = now_ns() - timing->ns;
+	const uint64_t allocs = __atomic_load_n(&nallocs, __ATOMIC_RELAXED) -
+		timing->nallocs;
+
+	fprintf(stdout, "%-32s %10.2f ns/op %14.0f ops/s %8.3f allocs/op",
+		name, (double)ns / n, n * 1e9 / (ns ? ns : 1),
+		(double)allocs / n);
+	if (bytes)
+		fprintf(stdout, " %10.1f Mbytes/s", bytes * 1e3 / (ns ? ns : 1));
+	fprintf(stdout, "\n");
+}
+
+static void bench_log(const uint64_t n)
+{
+	struct timing_t t;
+	volatile uint64_t sink = 0;
+
+	api_msg_set_level(API_MSG_NORMAL);
+
+	timing_start(&t);
+	for (uint64_t i = 0; i < n; i++)
+		CT_DEBUG_EAGER("cur_read: %zu, total_read: %zu", i, i);
+	report("CT_DEBUG eager (disabled)", &t, n, 0);
+
+	timing_start(&t);
+	for (uint64_t i = 0; i < n; i++)
+		CT_DEBUG("cur_read: %zu, total_read: %zu", i, i);
+	report("CT_DEBUG (disabled)", &t, n, 0);
+
+	timing_start(&t);
+	for (uint64_t i = 0; i < n; i++)
+		CT_INFO("cur_read: %zu, total_read: %zu", i, i);
+	report("CT_INFO (disabled)", &t, n, 0);
+
+	timing_start(&t);
+	for (uint64_t i = 0; i < n; i++)
+		sink += time_gtod();
+	report("gettimeofday", &t, n, 0);
+
+	timing_start(&t);
+	for (uint64_t i = 0; i < n; i++)
+		sink += time_now();
+	report("time_now", &t, n, 0);
+
+	timing_start(&t);
+	for (uint64_t i = 0; i < n; i++)
+		sink += syscall(SYS_gettid);
+	report("syscall(SYS_gettid)", &t, n, 0);
+
+	timing_start(&t);
+	for (uint64_t i = 0; i < n; i++)
+		sink += api_gettid();
+	report("api_gettid", &t, n, 0);
+
+	UNUSED(sink);
+}
+
+static void bench_list(const uint64_t n)
+{
+	struct timing_t t;
+	list_t list;
+	void *data;
+	volatile uintptr_t sink = 0;
+
+	list_init(&list, NULL);
+
+	timing_start(&t);
+	for (uint64_t i = 0; i < n; i++)
+		list_ins_next(&list, list_tail(&list), (void *)(uintptr_t)i);
+	report("list_ins_next (tail)", &t, n, 0);
+
+	timing_start(&t);
+	for (list_node_t *node = list_head(&list); node;
+	     node = list_next(node))
+		sink += (uintptr_t)list_data(node);
+	report("list traverse", &t, n, 0);
+
+	timing_start(&t);
+	for (uint64_t i = 0; i < n; i++)
+		list_rem_next(&list, NULL, &data);
+	report("list_rem_next (head)", &t, n, 0);
+
+	list_destroy(&list);
+	UNUSED(sink);
+}
+
+static void bench_queue(const uint64_t n)
+{
+	struct timing_t t;
+	queue_t queue;
+	void *data;
+
+	queue_init(&queue, NULL);
+
+	timing_start(&t);
+	for (uint64_t i = 0; i < n; i++)
+		queue_enqueue(&queue, (void *)(uintptr_t)i);
+	report("queue_enqueue", &t, n, 0);
+
+	timing_start(&t);
+	for (uint64_t i = 0; i < n; i++)
+		queue_dequeue(&queue, &data);
+	report("queue_dequeue", &t, n, 0);
+
+	queue_destroy(&queue);
+}
+
+static int match_str(const void *key1, const void *key2)
+{
+	return strcmp(key1, key2);
+}
+
+static void bench_chashtable(const uint64_t n)
+{
+	struct timing_t t;
+	chashtable_t chashtable = {0};
+	char *keys;
+	char miss[LEN_KEY];
+	void *data;
+	int rc;
+
+	keys = malloc(n * LEN_KEY);
+	if (!keys) {
+		CT_ERROR(-ENOMEM, "malloc");
+		return;
+	}
+	for (uint64_t i = 0; i < n; i++)
+		snprintf(&keys[i * LEN_KEY], LEN_KEY, "/lustre/dir%lu/file%lu",
+			 (unsigned long)(i % 1000), (unsigned long)i);
+
+	rc = chashtable_init(&chashtable, opt.o_nbuckets, hash_djb_str,
+			     match_str, NULL);
+	if (rc) {
+		CT_ERROR(rc, "chashtable_init");
+		free(keys);
+		return;
+	}
+
+	timing_start(&t);
+	for (uint64_t i = 0; i < n; i++)
+		chashtable_insert(&chashtable, &keys[i * LEN_KEY]);
+	report("chashtable_insert", &t, n, 0);
+
+	timing_start(&t);
+	for (uint64_t i = 0; i < n; i++)
+		chashtable_lookup(&chashtable, &keys[i * LEN_KEY], &data);
+	report("chashtable_lookup (hit)", &t, n, 0);
+
+	timing_start(&t);
+	for (uint64_t i = 0; i < n; i++) {
+		snprintf(miss, sizeof(miss), "/lustre/miss%lu",
+			 (unsigned long)i);
+		chashtable_lookup(&chashtable, miss, &data);
+	}
+	report("chashtable_lookup (miss)", &t, n, 0);
+
+	timing_start(&t);
+	for (uint64_t i = 0; i < n; i++)
+		chashtable_remove(&chashtable, &keys[i * LEN_KEY], &data);
+	report("chashtable_remove", &t, n, 0);
+
+	chashtable_destroy(&chashtable);
+	free(keys);
+}
+
+static void bench_qtable(const uint64_t n)
+{
+	struct timing_t t;
+	struct qtable_t qtable;
+	qryRespArchiveData qra_data;
+	dsInt16_t rc;
+	const struct {
+		enum sort_by_t sort_by;
+		const char *name;
+	} sorts[] = {
+		{SORT_NONE,		"create_array (none)"},
+		{SORT_DATE_ASCENDING,	"create_array (date asc)"},
+		{SORT_DATE_DESCENDING,	"create_array (date desc)"},
+		{SORT_RESTORE_ORDER,	"create_array (restore order)"},
+	};
+
+	memset(&qtable, 0, sizeof(qtable));
+	qtable.nbuckets = opt.o_nbuckets;
+	rc = init_qtable(&qtable);
+	if (rc) {
+		CT_ERROR(rc, "init_qtable");
+		return;
+	}
+
+	memset(&qra_data, 0, sizeof(qra_data));
+	strncpy(qra_data.objName.fs, "/lustre", DSM_MAX_FSNAME_LENGTH);
+	timing_start(&t);
+	for (uint64_t i = 0; i < n; i++) {
+		snprintf(qra_data.objName.hl, DSM_MAX_HL_LENGTH + 1, "/dir%lu",
+			 (unsigned long)(i % 1000));
+		snprintf(qra_data.objName.ll, DSM_MAX_LL_LENGTH + 1, "/file%lu",
+			 (unsigned long)i);
+		qra_data.insDate.year = 2000 + rand() % 30;
+		qra_data.insDate.day = 1 + rand() % 28;
+		qra_data.insDate.second = rand() % 60;
+		qra_data.restoreOrderExt.top = rand();
+		qra_data.restoreOrderExt.hi_hi = rand();
+		qra_data.restoreOrderExt.lo_lo = rand();
+		insert_qtable(&qtable, &qra_data);
+	}
+	report("insert_qtable", &t, n, 0);
+
+	for (size_t s = 0; s < sizeof(sorts) / sizeof(sorts[0]); s++) {
+		free(qtable.qarray.data);
+		qtable.qarray.data = NULL;
+		qtable.qarray.size = 0;
+
+		timing_start(&t);
+		rc = create_array(&qtable, sorts[s].sort_by);
+		report(sorts[s].name, &t, n, 0);
+		if (rc)
+			CT_ERROR(rc, "create_array");
+	}
+
+	timing_start(&t);
+	for (uint32_t i = 0; i < qtable.qarray.size; i++)
+		get_qra(&qtable, &qra_data, i);
+	report("get_qra", &t, n, 0);
+
+	destroy_qtable(&qtable);
+}
+
+static void bench_extract_hl_ll(const uint64_t n)
+{
+	struct timing_t t;
+	char fpath[PATH_MAX];
+	char hl[DSM_MAX_HL_LENGTH + 1];
+	char ll[DSM_MAX_LL_LENGTH + 1];
+	uint64_t bytes = 0;
+
+	timing_start(&t);
+	for (uint64_t i = 0; i < n; i++) {
+		bytes += snprintf(fpath, sizeof(fpath),
+				  "/lustre/dir%lu/sub%lu/file%lu",
+				  (unsigned long)(i % 1000),
+				  (unsigned long)(i % 100), (unsigned long)i);
+		extract_hl_ll(fpath, "/lustre", hl, ll);
+	}
+	report("extract_hl_ll", &t, n, bytes);
+}
+
+static void bench_crc32(void)
+{
+	struct timing_t t;
+	char fpath[] = "/tmp/ltsm_microbench.XXXXXX";
+	unsigned char *buf;
+	uint32_t crc32 = 0;
+	int fd;
+
+	buf = malloc(opt.o_crc32_size);
+	if (!buf) {
+		CT_ERROR(-ENOMEM, "malloc");
+		return;
+	}
+	for (size_t r = 0; r < opt.o_crc32_size; r++)
+		buf[r] = rand() % 256;
+
+	fd = mkstemp(fpath);
+	if (fd < 0) {
+		CT_ERROR(-errno, "mkstemp '%s'", fpath);
+		free(buf);
+		return;
+	}
+	if (write(fd, buf, opt.o_crc32_size) !=
+	    (ssize_t)opt.o_crc32_size) {
+		CT_ERROR(-EIO, "write '%s'", fpath);
+		goto cleanup;
+	}
+
+	/* Populate page cache, the file is read from memory. */
+	crc32file(fpath, &crc32);
+
+	timing_start(&t);
+	for (int r = 0; r < CRC32_REPS; r++)
+		crc32file(fpath, &crc32);
+	report("crc32file (page cache)", &t, CRC32_REPS,
+	       (uint64_t)CRC32_REPS * opt.o_crc32_size);
+
+cleanup:
+	close(fd);
+	unlink(fpath);
+	free(buf);
+}
+
+static void run(const uint64_t n)
+{
+	fprintf(stdout, "[entries: %lu]\n", (unsigned long)n);
+
+	if (opt.o_bench[BENCH_LOG])
+		bench_log(n);
+	if (opt.o_bench[BENCH_LIST])
+		bench_list(n);
+	if (opt.o_bench[BENCH_QUEUE])
+		bench_queue(n);
+	if (opt.o_bench[BENCH_CHASHTABLE])
+		bench_chashtable(n);
+	if (opt.o_bench[BENCH_QTABLE])
+		bench_qtable(n);
+	if (opt.o_bench[BENCH_EXTRACT_HL_LL])
+		bench_extract_hl_ll(n);
+	fflush(stdout);
+}
+
+static void usage(const char *cmd_name, const int rc)
+{
+	fprintf(stdout, "usage: %s [options]\n"
+		"\t-n, --number <long> [default: %d entries or iterations]\n"
+		"\t-s, --scale [run with 10^3, 10^4, ... entries up to number]\n"
+		"\t-B, --buckets <int> [default: %d hashtable buckets]\n"
+		"\t-z, --size <long> [default: %d bytes of crc32 file]\n"
+		"\t-b, --bench <name,...> {log, list, queue, chashtable, qtable, "
+		"extract_hl_ll, crc32} [default: all]\n"
+		"\t-h, --help\n",
+		cmd_name, NUM_ENTRIES_DEFAULT, DEFAULT_NUM_BUCKETS,
+		CRC32_SIZE_DEFAULT);
+	exit(rc);
+}
+
+static int parse_bench(const char *names)
+{
+	char buf[256] = {0};
+	char *saveptr = NULL;
+	char *token;
+
+	strncpy(buf, names, sizeof(buf) - 1);
+	memset(opt.o_bench, 0, sizeof(opt.o_bench));
+	for (token = strtok_r(buf, ",", &saveptr); token;
+	     token = strtok_r(NULL, ",", &saveptr)) {
+		int b;
+
+		for (b = 0; b < BENCH_NUM; b++)
+			if (OPTNCMP(bench_names[b], token))
+				break;
+		if (b == BENCH_NUM)
+			return -EINVAL;
+		opt.o_bench[b] = true;
+	}
+
+	return 0;
+}
+
+static int parseopts(int argc, char *argv[])
+{
+	struct option long_opts[] = {
+		{"number",	required_argument, 0, 'n'},
+		{"scale",	      no_argument, 0, 's'},
+		{"buckets",	required_argument, 0, 'B'},
+		{"size",	required_argument, 0, 'z'},
+		{"bench",	required_argument, 0, 'b'},
+		{"help",	      no_argument, 0, 'h'},
+		{0, 0, 0, 0}
+	};
+	int c;
+
+	while ((c = getopt_long(argc, argv, "n:sB:z:b:h",
+				long_opts, NULL)) != -1) {
+		switch (c) {
+		case 'n': {
+			opt.o_nentries = strtoull(optarg, NULL, 10);
+			break;
+		}
+		case 's': {
+			opt.o_scale = true;
+			break;
+		}
+		case 'B': {
+			opt.o_nbuckets = strtoul(optarg, NULL, 10);
+			break;
+		}
+		case 'z': {
+			opt.o_crc32_size = strtoull(optarg, NULL, 10);
+			break;
+		}
+		case 'b': {
+			if (parse_bench(optarg)) {
+				fprintf(stdout, "wrong argument for -b, "
+					"--bench '%s'\n", optarg);
+				usage(argv[0], 1);
+			}
+			break;
+		}
+		case 'h': {
+			usage(argv[0], 0);
+			break;
+		}
+		default:
+			return -EINVAL;
+		}
+	}
+
+	/* Number of iterations as single argument for compatibility. */
+	if (optind < argc)
+		opt.o_nentries = strtoull(argv[optind], NULL, 10);
+
+	if (opt.o_nentries == 0 || opt.o_nbuckets == 0 ||
+	    opt.o_crc32_size == 0) {
+		fprintf(stdout, "number, buckets and size must be positive\n\n");
+		usage(argv[0], 1);
+	}
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int rc;
+
+	rc = parseopts(argc, argv);
+	if (rc) {
+		fprintf(stderr, "try '%s --help' for more information\n",
+			argv[0]);
+		return 1;
+	}
+
+	srand(0);
+	if (opt.o_scale) {
+		uint64_t n;
+
+		for (n = 1000; n < opt.o_nentries; n *= 10)
+			run(n);
+	}
+	run(opt.o_nentries);
+
+	if (opt.o_bench[BENCH_CRC32])
+		bench_crc32();
+
+	return 0;
+}
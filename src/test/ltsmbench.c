@@ -16,31 +16,87 @@
  * Copyright (c) 2017-2023, GSI Helmholtz Centre for Heavy Ion Research
  */
 
+/*
+ * Benchmark driver for threaded archive, retrieve, query and delete
+ * workloads. A workload is a comma separated list of phases, each phase
+ * performs one operation on every file of the file set. The phase mixed
+ * retrieves or archives each file according to the read ratio. Objects
+ * are archived with description DESC_BENCH in phase archive and with
+ * DESC_MIXED in phase mixed, such that retrieve and query always match
+ * exactly one object per file.
+ */
+
 #define _GNU_SOURCE
 
 #include <getopt.h>
 #include <pthread.h>
+#include <math.h>
 #include "ltsmapi.h"
 #include "test_utils.h"
-#include "measurement.h"
-
-#define LEN_FILENAME_RND 32
+#include "metrics.h"
+
+#define LEN_FILENAME_RND	32
+#define LEN_FPATH		(5 + LEN_FILENAME_RND)
+#define MAX_PHASES		16
+#define DESC_BENCH		"ltsmbench"
+#define DESC_MIXED		"ltsmbench mixed"
+#define SIZE_SMALL_MAX		65536	/* Upper size of small files. */
+#define SMALL_PERCENT		90	/* Percentage of small files. */
+#define LOGNORMAL_SIGMA		1.0
+#define LOGNORMAL_MAX		16	/* Cap size at 16 times median. */
+
+enum op_e {OP_ARCHIVE, OP_RETRIEVE, OP_QUERY, OP_DELETE, OP_NUM};
+enum phase_e {PHASE_ARCHIVE, PHASE_RETRIEVE, PHASE_QUERY, PHASE_DELETE,
+	      PHASE_MIXED, PHASE_NUM};
+enum dist_e {DIST_FIXED, DIST_LOGNORMAL, DIST_SMALL, DIST_NUM};
+enum output_e {OUTPUT_TEXT, OUTPUT_CSV, OUTPUT_JSON, OUTPUT_NUM};
+
+static const char *op_names[OP_NUM] = {
+	"archive", "retrieve", "query", "delete"
+};
+static const char *phase_names[PHASE_NUM] = {
+	"archive", "retrieve", "query", "delete", "mixed"
+};
+static const char *dist_names[DIST_NUM] = {
+	"fixed", "lognormal", "small"
+};
+static const char *output_names[OUTPUT_NUM] = {
+	"text", "csv", "json"
+};
 
-MSRT_DECLARE(tsm_archive_fpath);
-MSRT_DECLARE(tsm_retrieve_fpath);
+struct result_t {
+	enum phase_e phase;
+	double sec;
+	struct metric_hist_t hist[OP_NUM];
+};
 
 static char **fpaths = NULL;
+static size_t *fsizes = NULL;
+static enum op_e *ops = NULL;
 static struct session_t *sessions = NULL;
 static pthread_t *threads = NULL;
 static pthread_mutex_t mutex;
-static uint16_t next_idx = 0;
-static enum task_e {ARCHIVE, RETRIEVE} task;
+static int next_idx = 0;
+static int end_idx = 0;
+static int phase_rc = 0;
+static enum phase_e phase_cur = PHASE_ARCHIVE;
+static struct metric_hist_t *op_hist = NULL;
+static struct result_t results[MAX_PHASES];
+static const dsmDate date_lower_bound = {DATE_MINUS_INFINITE, 1, 1, 0, 0, 0};
+static const dsmDate date_upper_bound = {DATE_PLUS_INFINITE, 12, 31, 23, 59, 59};
 
 struct options {
 	int o_verbose;
 	int o_nfiles;
 	size_t o_filesize;
 	int o_nthreads;
+	enum phase_e o_phases[MAX_PHASES];
+	int o_nphases;
+	int o_read_ratio;
+	enum dist_e o_dist;
+	int o_warmup;
+	enum output_e o_output;
+	unsigned int o_seed;
 	char o_servername[DSM_MAX_SERVERNAME_LENGTH + 1];
 	char o_node[DSM_MAX_NODE_LENGTH + 1];
 	char o_password[DSM_MAX_VERIFIER_LENGTH + 1];
@@ -52,6 +108,13 @@ struct options opt = {
 	.o_nfiles = 16,
 	.o_filesize = 16777216,
 	.o_nthreads = 1,
+	.o_phases = {PHASE_ARCHIVE, PHASE_RETRIEVE},
+	.o_nphases = 2,
+	.o_read_ratio = 50,
+	.o_dist = DIST_FIXED,
+	.o_warmup = 0,
+	.o_output = OUTPUT_TEXT,
+	.o_seed = 0,
 	.o_servername = {0},
 	.o_node = {0},
 	.o_password = {0},
@@ -67,6 +130,12 @@ static void usage(const char *cmd_name, const int rc)
 		"\t-z, --size <long> [default: 16777216 bytes]\n"
 		"\t-b, --number <int> [default: 16]\n"
 		"\t-t, --threads <int> [default: 1]\n"
+		"\t-w, --workload <phase,...> {archive, retrieve, query, delete, mixed} [default: archive,retrieve]\n"
+		"\t-r, --read-ratio <int> [default: 50 percent retrieves in phase mixed]\n"
+		"\t-d, --distribution {fixed, lognormal, small} [default: fixed]\n"
+		"\t-W, --warmup <int> [default: 0 files per phase not measured]\n"
+		"\t-o, --output {text, csv, json} [default: text]\n"
+		"\t-S, --seed <int> [default: time]\n"
 		"\t-f, --fsname <string> [default: '/']\n"
 		"\t-n, --node <string>\n"
 		"\t-p, --password <string>\n"
@@ -85,6 +154,55 @@ static void usage(const char *cmd_name, const int rc)
 	exit(rc);
 }
 
+static int name_idx(const char *name, const char **names, const int num)
+{
+	for (int n = 0; n < num; n++)
+		if (OPTNCMP(names[n], name))
+			return n;
+
+	return -EINVAL;
+}
+
+static int parse_workload(const char *workload)
+{
+	char buf[256] = {0};
+	char *saveptr = NULL;
+	char *token;
+
+	strncpy(buf, workload, sizeof(buf) - 1);
+	opt.o_nphases = 0;
+	for (token = strtok_r(buf, ",", &saveptr); token;
+	     token = strtok_r(NULL, ",", &saveptr)) {
+		const int phase = name_idx(token, phase_names, PHASE_NUM);
+
+		if (phase < 0 || opt.o_nphases == MAX_PHASES)
+			return -EINVAL;
+		opt.o_phases[opt.o_nphases++] = phase;
+	}
+
+	return opt.o_nphases ? 0 : -EINVAL;
+}
+
+/* Objects must be archived before they are retrieved, queried or deleted,
+   and may be archived only once with description DESC_BENCH. */
+static int check_workload(void)
+{
+	bool archived = false;
+
+	for (int n = 0; n < opt.o_nphases; n++) {
+		if (opt.o_phases[n] == PHASE_ARCHIVE) {
+			if (archived)
+				return -EINVAL;
+			archived = true;
+		} else if (!archived)
+			return -EINVAL;
+		else if (opt.o_phases[n] == PHASE_DELETE)
+			archived = false;
+	}
+
+	return 0;
+}
+
 static void sanity_arg_check(const char *argv)
 {
 	/* Required arguments. */
@@ -97,24 +215,52 @@ static void sanity_arg_check(const char *argv)
 		usage(argv, 1);
 	} else if (!opt.o_fsname[0])
 		strncpy(opt.o_fsname, DEFAULT_FSNAME, DSM_MAX_FSNAME_LENGTH);
+
+	if (opt.o_nfiles <= 0 || opt.o_nthreads <= 0) {
+		fprintf(stdout, "number of files and threads must be "
+			"positive\n\n");
+		usage(argv, 1);
+	}
+	if (opt.o_warmup < 0 || opt.o_warmup >= opt.o_nfiles) {
+		fprintf(stdout, "number of warmup files must be less than "
+			"number of files\n\n");
+		usage(argv, 1);
+	}
+	if (opt.o_read_ratio < 0 || opt.o_read_ratio > 100) {
+		fprintf(stdout, "read ratio must be in range [0, 100]\n\n");
+		usage(argv, 1);
+	}
+	if (check_workload()) {
+		fprintf(stdout, "workload must archive objects once before "
+			"retrieving, querying, deleting or mixing them\n\n");
+		usage(argv, 1);
+	}
 }
 
 static int parseopts(int argc, char *argv[])
 {
 	struct option long_opts[] = {
-		{"size",	required_argument, 0, 'z'},
-		{"number",	required_argument, 0, 'b'},
-		{"threads",	required_argument, 0, 't'},
-		{"fsname",	required_argument, 0, 'f'},
-		{"node",	required_argument, 0, 'n'},
-		{"password",	required_argument, 0, 'p'},
-		{"servername",	required_argument, 0, 's'},
-		{"verbose",	required_argument, 0, 'v'},
-		{"help",	      no_argument, 0, 'h'},
+		{"size",	 required_argument, 0, 'z'},
+		{"number",	 required_argument, 0, 'b'},
+		{"threads",	 required_argument, 0, 't'},
+		{"workload",	 required_argument, 0, 'w'},
+		{"read-ratio",	 required_argument, 0, 'r'},
+		{"distribution", required_argument, 0, 'd'},
+		{"warmup",	 required_argument, 0, 'W'},
+		{"output",	 required_argument, 0, 'o'},
+		{"seed",	 required_argument, 0, 'S'},
+		{"fsname",	 required_argument, 0, 'f'},
+		{"node",	 required_argument, 0, 'n'},
+		{"password",	 required_argument, 0, 'p'},
+		{"servername",	 required_argument, 0, 's'},
+		{"verbose",	 required_argument, 0, 'v'},
+		{"help",	       no_argument, 0, 'h'},
 		{0, 0, 0, 0}
 	};
 	int c;
-	while ((c = getopt_long(argc, argv, "z:b:t:f:n:p:s:v:h",
+	bool seed = false;
+
+	while ((c = getopt_long(argc, argv, "z:b:t:w:r:d:W:o:S:f:n:p:s:v:h",
 				long_opts, NULL)) != -1) {
 		switch (c) {
 		case 'z': {
@@ -129,6 +275,50 @@ static int parseopts(int argc, char *argv[])
 			opt.o_nthreads = atoi(optarg);
 			break;
 		}
+		case 'w': {
+			if (parse_workload(optarg)) {
+				fprintf(stdout, "wrong argument for -w, "
+					"--workload '%s'\n", optarg);
+				usage(argv[0], 1);
+			}
+			break;
+		}
+		case 'r': {
+			opt.o_read_ratio = atoi(optarg);
+			break;
+		}
+		case 'd': {
+			const int dist = name_idx(optarg, dist_names, DIST_NUM);
+
+			if (dist < 0) {
+				fprintf(stdout, "wrong argument for -d, "
+					"--distribution '%s'\n", optarg);
+				usage(argv[0], 1);
+			}
+			opt.o_dist = dist;
+			break;
+		}
+		case 'W': {
+			opt.o_warmup = atoi(optarg);
+			break;
+		}
+		case 'o': {
+			const int output = name_idx(optarg, output_names,
+						    OUTPUT_NUM);
+
+			if (output < 0) {
+				fprintf(stdout, "wrong argument for -o, "
+					"--output '%s'\n", optarg);
+				usage(argv[0], 1);
+			}
+			opt.o_output = output;
+			break;
+		}
+		case 'S': {
+			opt.o_seed = strtoul(optarg, NULL, 10);
+			seed = true;
+			break;
+		}
 		case 'f': {
 			strncpy(opt.o_fsname, optarg, DSM_MAX_FSNAME_LENGTH);
 			break;
@@ -178,38 +368,112 @@ static int parseopts(int argc, char *argv[])
 		}
 	}
 
+	if (!seed)
+		opt.o_seed = time(NULL);
+
 	sanity_arg_check(argv[0]);
 
 	return 0;
 }
 
-static void *perform_task(void *thread_data)
+static int perform_op(const int n, struct session_t *session)
 {
-	struct session_t *session = (struct session_t *)thread_data;;
-	char _fpath[6 + LEN_FILENAME_RND + 1] = {0};
+	int rc;
+	uint64_t bytes = 0;
+	const enum op_e op = ops[n];
+	const uint64_t start = metrics_now();
+
+	switch (op) {
+	case OP_ARCHIVE:
+		rc = tsm_archive_fpath(DEFAULT_FSNAME, fpaths[n],
+				       phase_cur == PHASE_MIXED ?
+				       DESC_MIXED : DESC_BENCH,
+				       -1, NULL, session);
+		bytes = fsizes[n];
+		break;
+	case OP_RETRIEVE:
+		rc = tsm_retrieve_fpath(DEFAULT_FSNAME, fpaths[n],
+					DESC_BENCH, -1, session);
+		bytes = fsizes[n];
+		break;
+	case OP_QUERY:
+		rc = tsm_query_fpath(DEFAULT_FSNAME, fpaths[n], DESC_BENCH,
+				     &date_lower_bound, &date_upper_bound,
+				     session);
+		break;
+	case OP_DELETE:
+		rc = tsm_delete_fpath(DEFAULT_FSNAME, fpaths[n], session);
+		break;
+	default:
+		rc = -EINVAL;
+	}
 
-	int rc = 0;
+	if (rc)
+		CT_ERROR(rc, "%s '%s'", op_names[op], fpaths[n]);
+	else if (op_hist)
+		metrics_hist_add(&op_hist[op], metrics_now() - start, bytes);
 
-	do {
+	return rc;
+}
+
+static void *perform_task(void *thread_data)
+{
+	struct session_t *session = (struct session_t *)thread_data;
+	int n;
+	int rc;
+
+	for (;;) {
 		pthread_mutex_lock(&mutex);
-		strncpy(_fpath, fpaths[next_idx++], 5 + LEN_FILENAME_RND + 1);
+		if (phase_rc || next_idx >= end_idx) {
+			pthread_mutex_unlock(&mutex);
+			break;
+		}
+		n = next_idx++;
 		pthread_mutex_unlock(&mutex);
 
-		if (task == ARCHIVE)
-			rc = tsm_archive_fpath(DEFAULT_FSNAME, _fpath,
-					       NULL, -1, NULL,
-					       session);
-		else
-			rc = tsm_retrieve_fpath(DEFAULT_FSNAME, _fpath,
-						NULL, -1, session);
-
-		if (rc)
-			pthread_exit((void *)&rc);
-	} while (next_idx < opt.o_nfiles);
+		rc = perform_op(n, session);
+		if (rc) {
+			pthread_mutex_lock(&mutex);
+			if (!phase_rc)
+				phase_rc = rc;
+			pthread_mutex_unlock(&mutex);
+			break;
+		}
+	}
 
 	return NULL;
 }
 
+/* Draw file size from the selected distribution, opt.o_filesize is the
+   fixed size, the median size (lognormal) or the size of large files
+   (small). */
+static size_t draw_size(void)
+{
+	switch (opt.o_dist) {
+	case DIST_LOGNORMAL: {
+		/* Box-Muller transform, u1 in (0, 1] such that log is
+		   finite. */
+		const double u1 = (rand() + 1.0) / (RAND_MAX + 1.0);
+		const double u2 = rand() / (RAND_MAX + 1.0);
+		const double z = sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+		const double size = opt.o_filesize * exp(LOGNORMAL_SIGMA * z);
+
+		return size < (double)LOGNORMAL_MAX * opt.o_filesize ?
+			(size_t)size : LOGNORMAL_MAX * opt.o_filesize;
+	}
+	case DIST_SMALL: {
+		const size_t small = opt.o_filesize < SIZE_SMALL_MAX ?
+			opt.o_filesize : SIZE_SMALL_MAX;
+
+		if (rand() % 100 < SMALL_PERCENT)
+			return rand() % (small + 1);
+		return opt.o_filesize;
+	}
+	default:
+		return opt.o_filesize;
+	}
+}
+
 static int create_rnd_fnames(void)
 {
 	int rc = 0;
@@ -218,12 +482,15 @@ static int create_rnd_fnames(void)
 		return -EINVAL;
 
 	fpaths = calloc(opt.o_nfiles, sizeof(char *));
-	if (!fpaths) {
-		CT_ERROR(errno, "malloc");
-		return -ENOMEM;
+	fsizes = calloc(opt.o_nfiles, sizeof(size_t));
+	ops = calloc(opt.o_nfiles, sizeof(enum op_e));
+	if (!fpaths || !fsizes || !ops) {
+		rc = -ENOMEM;
+		CT_ERROR(rc, "calloc");
+		goto cleanup;
 	}
 	for (int n = 0; n < opt.o_nfiles; n++) {
-		fpaths[n] = calloc(5 + LEN_FILENAME_RND + 1, sizeof(char));
+		fpaths[n] = calloc(LEN_FPATH + 1, sizeof(char));
 		if (!fpaths[n]) {
 			rc = -ENOMEM;
 			goto cleanup;
@@ -231,7 +498,8 @@ static int create_rnd_fnames(void)
 
 		char rnd_s[LEN_FILENAME_RND + 1] = {0};
 		rnd_str(rnd_s, LEN_FILENAME_RND);
-		snprintf(fpaths[n], 5 + LEN_FILENAME_RND + 1, "/tmp/%s", rnd_s);
+		snprintf(fpaths[n], LEN_FPATH + 1, "/tmp/%s", rnd_s);
+		fsizes[n] = draw_size();
 	}
 
 	return rc;
@@ -243,6 +511,10 @@ cleanup:
 		free(fpaths);
 		fpaths = NULL;
 	}
+	free(fsizes);
+	fsizes = NULL;
+	free(ops);
+	ops = NULL;
 
 	return rc;
 }
@@ -252,15 +524,20 @@ static int fill_fnames(void)
 	int rc = 0;
 	FILE *file = NULL;
 	unsigned char *buf;
+	size_t size_max = 0;
+
+	for (int n = 0; n < opt.o_nfiles; n++)
+		if (fsizes[n] > size_max)
+			size_max = fsizes[n];
 
-	buf = malloc(sizeof(unsigned char) * opt.o_filesize);
+	buf = malloc(sizeof(unsigned char) * (size_max ? size_max : 1));
 	if (!buf) {
 		rc = -ENOMEM;
 		CT_ERROR(rc, "malloc");
 		return rc;
 	}
 
-	for (size_t r = 0; r < opt.o_filesize; r++)
+	for (size_t r = 0; r < size_max; r++)
 		buf[r] = rand() % 256;
 
 	for (int n = 0; n < opt.o_nfiles; n++) {
@@ -272,8 +549,8 @@ static int fill_fnames(void)
 		}
 
 		size_t written = 0;
-		written = fwrite(buf, 1, opt.o_filesize, file);
-		if (written != opt.o_filesize) {
+		written = fwrite(buf, 1, fsizes[n], file);
+		if (written != fsizes[n]) {
 			rc = -EIO;
 			CT_ERROR(rc, "fwrite '%s'", fpaths[n]);
 			fclose(file);
@@ -295,30 +572,41 @@ static int remove_fnames(void)
 {
 	int rc = 0;
 
+	if (!fpaths)
+		return rc;
+
 	for (int n = 0; n < opt.o_nfiles; n++) {
+		if (!fpaths[n])
+			continue;
 		rc = unlink(fpaths[n]);
 		if (rc)
 			CT_WARN("[rc=%d] unlink '%s'", rc, fpaths[n]);
+		free(fpaths[n]);
 	}
-
-	if (fpaths) {
-		for (int n = 0; n < opt.o_nfiles; n++)
-			if (fpaths[n])
-				free(fpaths[n]);
-		free(fpaths);
-		fpaths = NULL;
-	}
+	free(fpaths);
+	fpaths = NULL;
+	free(fsizes);
+	fsizes = NULL;
+	free(ops);
+	ops = NULL;
 
 	return rc;
 }
 
-static int run_threads(void)
+/* Process files [begin, end) with opt.o_nthreads threads. */
+static int run_threads(const int begin, const int end)
 {
 	int rc;
 	pthread_attr_t attr;
 	char thread_name[32] = {0};
+	const int nthreads = opt.o_nthreads < end - begin ?
+		opt.o_nthreads : end - begin;
 
-	threads = calloc(opt.o_nthreads, sizeof(pthread_t));
+	next_idx = begin;
+	end_idx = end;
+	phase_rc = 0;
+
+	threads = calloc(nthreads, sizeof(pthread_t));
 	if (threads == NULL) {
 		rc = -errno;
 		CT_ERROR(rc, "malloc");
@@ -333,15 +621,18 @@ static int run_threads(void)
 
 	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
 
-	for (int n = 0; n < opt.o_nthreads; n++) {
-		rc = pthread_create(&threads[n], &attr, perform_task, &sessions[n]);
+	int ncreated = 0;
+	for (int n = 0; n < nthreads; n++) {
+		rc = pthread_create(&threads[ncreated], &attr, perform_task,
+				    &sessions[n]);
 
 		if (rc)
 			CT_WARN("[rc=%d] pthread_create failed thread '%d'", rc, n);
 		else {
 			snprintf(thread_name, sizeof(thread_name),
 				 "ltsmbench/%d", n);
-			pthread_setname_np(threads[n], thread_name);
+			pthread_setname_np(threads[ncreated], thread_name);
+			ncreated++;
 		}
 	}
 
@@ -349,14 +640,13 @@ static int run_threads(void)
 	if (rc)
 		CT_ERROR(rc, "pthread_attr_destroy");
 
-	void *status = NULL;
-	for (int n = 0; n < opt.o_nthreads; n++) {
-		rc = pthread_join(threads[n], &status);
+	for (int n = 0; n < ncreated; n++) {
+		rc = pthread_join(threads[n], NULL);
 		if (rc)
 			CT_WARN("[rc=%d] pthread_join failed thread '%d'", rc, n);
 	}
 
-	return rc;
+	rc = ncreated ? phase_rc : -EAGAIN;
 
 cleanup:
 	if (threads) {
@@ -367,9 +657,188 @@ cleanup:
 	return rc;
 }
 
+/* Sum histograms of all operations. */
+static void hist_total(struct metric_hist_t *total,
+		       const struct metric_hist_t *hist)
+{
+	memset(total, 0, sizeof(*total));
+	for (uint16_t o = 0; o < OP_NUM; o++) {
+		total->count += hist[o].count;
+		total->bytes += hist[o].bytes;
+		total->sum_ns += hist[o].sum_ns;
+		if (hist[o].max_ns > total->max_ns)
+			total->max_ns = hist[o].max_ns;
+		for (uint16_t b = 0; b < METRIC_BUCKETS; b++)
+			total->buckets[b] += hist[o].buckets[b];
+	}
+}
+
+static void print_text_op(const char *phase, const char *op,
+			  const struct metric_hist_t *h, const double sec)
+{
+	fprintf(stdout, "[measurement]\t'%s' %-8s ops: %lu, bytes: %lu, "
+		"%.1f ops / sec, %.3f Mbytes / sec, latency usec mean: %.1f, "
+		"p50: %.1f, p99: %.1f, p999: %.1f, max: %.1f\n", phase, op,
+		(unsigned long)h->count, (unsigned long)h->bytes,
+		sec > 0 ? h->count / sec : 0.0,
+		sec > 0 ? h->bytes / sec / 1e6 : 0.0,
+		h->sum_ns / 1e3 / h->count,
+		metrics_percentile(h, 50.0) / 1e3,
+		metrics_percentile(h, 99.0) / 1e3,
+		metrics_percentile(h, 99.9) / 1e3,
+		h->max_ns / 1e3);
+}
+
+static void print_csv_op(const char *phase, const char *op,
+			 const struct metric_hist_t *h, const double sec)
+{
+	fprintf(stdout, "%s,%s,%d,%lu,%lu,%.6f,%.3f,%.6f,%.3f,%.3f,%.3f,%.3f,"
+		"%.3f\n", phase, op, opt.o_nthreads,
+		(unsigned long)h->count, (unsigned long)h->bytes, sec,
+		sec > 0 ? h->count / sec : 0.0,
+		sec > 0 ? h->bytes / sec / 1e6 : 0.0,
+		h->sum_ns / 1e3 / h->count,
+		metrics_percentile(h, 50.0) / 1e3,
+		metrics_percentile(h, 99.0) / 1e3,
+		metrics_percentile(h, 99.9) / 1e3,
+		h->max_ns / 1e3);
+}
+
+static void print_json_op(const char *op, const struct metric_hist_t *h,
+			  const double sec, const bool first)
+{
+	fprintf(stdout, "%s\n{\"op\":\"%s\",\"count\":%lu,\"bytes\":%lu,"
+		"\"ops_per_sec\":%.3f,\"mbytes_per_sec\":%.6f,"
+		"\"latency_usec\":{\"mean\":%.3f,\"p50\":%.3f,\"p99\":%.3f,"
+		"\"p999\":%.3f,\"max\":%.3f}}", first ? "" : ",", op,
+		(unsigned long)h->count, (unsigned long)h->bytes,
+		sec > 0 ? h->count / sec : 0.0,
+		sec > 0 ? h->bytes / sec / 1e6 : 0.0,
+		h->sum_ns / 1e3 / h->count,
+		metrics_percentile(h, 50.0) / 1e3,
+		metrics_percentile(h, 99.0) / 1e3,
+		metrics_percentile(h, 99.9) / 1e3,
+		h->max_ns / 1e3);
+}
+
+static void print_results(const int nresults)
+{
+	struct metric_hist_t total;
+
+	if (opt.o_output == OUTPUT_CSV) {
+		fprintf(stdout, "phase,op,threads,ops,bytes,secs,ops_per_sec,"
+			"mbytes_per_sec,lat_mean_usec,lat_p50_usec,"
+			"lat_p99_usec,lat_p999_usec,lat_max_usec\n");
+		for (int r = 0; r < nresults; r++) {
+			const char *phase = phase_names[results[r].phase];
+
+			for (uint16_t o = 0; o < OP_NUM; o++)
+				if (results[r].hist[o].count)
+					print_csv_op(phase, op_names[o],
+						     &results[r].hist[o],
+						     results[r].sec);
+			hist_total(&total, results[r].hist);
+			if (total.count)
+				print_csv_op(phase, "total", &total,
+					     results[r].sec);
+		}
+	} else if (opt.o_output == OUTPUT_JSON) {
+		fprintf(stdout, "{\"threads\":%d,\"files\":%d,\"size\":%zu,"
+			"\"distribution\":\"%s\",\"read_ratio\":%d,"
+			"\"warmup\":%d,\"seed\":%u,\"phases\":[",
+			opt.o_nthreads, opt.o_nfiles, opt.o_filesize,
+			dist_names[opt.o_dist], opt.o_read_ratio,
+			opt.o_warmup, opt.o_seed);
+		for (int r = 0; r < nresults; r++) {
+			bool first = true;
+
+			fprintf(stdout, "%s\n{\"phase\":\"%s\",\"secs\":%.6f,"
+				"\"ops\":[", r ? "," : "",
+				phase_names[results[r].phase], results[r].sec);
+			for (uint16_t o = 0; o < OP_NUM; o++) {
+				if (!results[r].hist[o].count)
+					continue;
+				print_json_op(op_names[o], &results[r].hist[o],
+					      results[r].sec, first);
+				first = false;
+			}
+			hist_total(&total, results[r].hist);
+			if (total.count)
+				print_json_op("total", &total, results[r].sec,
+					      first);
+			fprintf(stdout, "]}");
+		}
+		fprintf(stdout, "\n]}\n");
+	}
+	fflush(stdout);
+}
+
+/* Run phase on all files, the first opt.o_warmup files are processed
+   before the measurement starts. Display wall clock throughput, per
+   operation latencies and per call latencies of the data path. */
+static int run_phase(enum phase_e phase, struct result_t *result)
+{
+	int rc;
+	struct metrics_snapshot_t start;
+	struct metrics_snapshot_t end;
+	struct metrics_snapshot_t diff;
+	const char *name = phase_names[phase];
+
+	for (int n = 0; n < opt.o_nfiles; n++) {
+		if (phase == PHASE_MIXED)
+			ops[n] = rand() % 100 < opt.o_read_ratio ?
+				OP_RETRIEVE : OP_ARCHIVE;
+		else
+			ops[n] = (enum op_e)phase;
+	}
+	phase_cur = phase;
+
+	memset(result, 0, sizeof(*result));
+	result->phase = phase;
+
+	if (opt.o_warmup) {
+		op_hist = NULL;
+		rc = run_threads(0, opt.o_warmup);
+		if (rc)
+			return rc;
+	}
+
+	op_hist = result->hist;
+	metrics_snapshot(&start);
+	rc = run_threads(opt.o_warmup, opt.o_nfiles);
+	if (rc)
+		return rc;
+	metrics_snapshot(&end);
+	metrics_diff(&diff, &start, &end);
+
+	result->sec = diff.ts / 1e9;
+	if (opt.o_output != OUTPUT_TEXT)
+		return rc;
+
+	struct metric_hist_t total;
+
+	hist_total(&total, result->hist);
+	fprintf(stdout, "[measurement]\t'%s' processed %lu ops, %lu bytes in "
+		"%3.3f secs (%3.3f ops / sec, %3.3f Mbytes / sec)\n", name,
+		(unsigned long)total.count, (unsigned long)total.bytes,
+		result->sec,
+		result->sec > 0 ? total.count / result->sec : 0.0,
+		result->sec > 0 ? total.bytes / result->sec / 1e6 : 0.0);
+	for (uint16_t o = 0; o < OP_NUM; o++)
+		if (result->hist[o].count)
+			print_text_op(name, op_names[o], &result->hist[o],
+				      result->sec);
+	metrics_print(stdout, name, &diff);
+
+	return rc;
+}
+
 int main(int argc, char *argv[])
 {
 	int rc;
+	int nresults = 0;
+	bool archived = false;
+
 	api_msg_set_level(opt.o_verbose);
 	rc = parseopts(argc, argv);
 	if (rc) {
@@ -377,7 +846,7 @@ int main(int argc, char *argv[])
 		return -EINVAL;
 	}
 
-	srand(time(NULL));
+	srand(opt.o_seed);
 	rc = create_rnd_fnames();
 	if (rc)
 		goto cleanup;
@@ -387,7 +856,7 @@ int main(int argc, char *argv[])
 		goto cleanup;
 
 	if (opt.o_nthreads > opt.o_nfiles) {
-		CT_WARN("number of threads > num of files, reduce number of"
+		CT_WARN("number of threads > num of files, reduce number of "
 			"threads to '%d'", opt.o_nfiles);
 		opt.o_nthreads = opt.o_nfiles;
 	}
@@ -413,39 +882,39 @@ int main(int argc, char *argv[])
 		rc = tsm_fconnect(&login, &sessions[n]);
 		if (rc)
 			goto cleanup;
+		/* Delete all versions of objects archived in phase mixed. */
+		sessions[n].qtable.multiple = bTrue;
 	}
 
 	pthread_mutex_init(&mutex, NULL);
 
-	task = ARCHIVE;
-	/* Run archive threads and measure threaded archive performance. */
-	MSRT_START(tsm_archive_fpath);
-	MSRT_DATA(tsm_archive_fpath, opt.o_nfiles * opt.o_filesize);
-	rc = run_threads();
-	if (rc)
-		goto cleanup;
-	MSRT_STOP(tsm_archive_fpath);
-	MSRT_DISPLAY_RESULT(tsm_archive_fpath);
-
-	next_idx = 0;
-	task = RETRIEVE;
-	/* Run retrieve threads and measure threaded retrieve performance. */
-	MSRT_START(tsm_retrieve_fpath);
-	MSRT_DATA(tsm_retrieve_fpath, opt.o_nfiles * opt.o_filesize);
-	rc = run_threads();
-	if (rc)
-		goto cleanup;
-	MSRT_STOP(tsm_retrieve_fpath);
-	MSRT_DISPLAY_RESULT(tsm_retrieve_fpath);
+	for (int p = 0; p < opt.o_nphases; p++) {
+		const enum phase_e phase = opt.o_phases[p];
+
+		/* Delete also objects of an incomplete archive phase. */
+		archived = phase != PHASE_DELETE;
+		rc = run_phase(phase, &results[nresults]);
+		if (rc)
+			goto cleanup;
+		nresults++;
+	}
+	print_results(nresults);
 
 cleanup:
 	pthread_mutex_destroy(&mutex);
 
 	if (sessions) {
-		for (int n = 0; n < opt.o_nfiles; n++) {
-			rc = tsm_delete_fpath(DEFAULT_FSNAME, fpaths[n], &sessions[0]);
-			if (rc)
-				CT_WARN("[rc=%d] tsm_delete_fpath '%s'", rc, fpaths[n]);
+		if (archived) {
+			for (int n = 0; n < opt.o_nfiles; n++) {
+				int rc_minor;
+
+				rc_minor = tsm_delete_fpath(DEFAULT_FSNAME,
+							    fpaths[n],
+							    &sessions[0]);
+				if (rc_minor)
+					CT_WARN("[rc=%d] tsm_delete_fpath '%s'",
+						rc_minor, fpaths[n]);
+			}
 		}
 
 		for (int n = 0; n < opt.o_nthreads; n++)
@@ -0,0 +1,171 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Copyright (c) 2026, GSI Helmholtz Centre for Heavy Ion Research
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+#include "bufpool.h"
+#include "common.h"
+#include "CuTest.h"
+
+#define NUM_BUFS	(3 * BUFPOOL_TCACHE)
+#define NUM_THREADS	4
+#define NUM_ITER	1000
+
+static void *bufpool_worker(void *data)
+{
+	struct bufpool_t *pool = data;
+	char *buf[BUFPOOL_TCACHE + 1];
+	uintptr_t rc = 0;
+
+	for (size_t i = 0; i < NUM_ITER; i++) {
+		/* Exceed thread cache, such that buffers move between
+		   threads via the pool. */
+		for (size_t b = 0; b <= BUFPOOL_TCACHE; b++) {
+			buf[b] = bufpool_get(pool);
+			if (!buf[b])
+				return (void *)1;
+			memset(buf[b], (int)b, pool->size);
+		}
+		for (size_t b = 0; b <= BUFPOOL_TCACHE; b++) {
+			if (buf[b][0] != (char)b ||
+			    buf[b][pool->size - 1] != (char)b)
+				rc = 1;
+			bufpool_put(pool, buf[b]);
+		}
+	}
+
+	return (void *)rc;
+}
+
+void test_bufpool(CuTest *tc)
+{
+	struct bufpool_t pool;
+	struct bufpool_stats_t stats;
+	char *buf[NUM_BUFS];
+	char *reused;
+	int rc;
+
+	rc = bufpool_init(&pool, 0, 0);
+	CuAssertIntEquals(tc, -EINVAL, rc);
+
+	/* Size is rounded up to page size. */
+	rc = bufpool_init(&pool, BUFPOOL_PAGE_SIZE + 1, BUFPOOL_NUMA);
+	CuAssertIntEquals(tc, 0, rc);
+	CuAssertTrue(tc, pool.size == 2 * BUFPOOL_PAGE_SIZE);
+
+	for (size_t b = 0; b < NUM_BUFS; b++) {
+		buf[b] = bufpool_get(&pool);
+		CuAssertPtrNotNull(tc, buf[b]);
+		CuAssertTrue(tc, (uintptr_t)buf[b] % BUFPOOL_PAGE_SIZE == 0);
+		for (size_t c = 0; c < b; c++)
+			CuAssertTrue(tc, buf[b] != buf[c]);
+		memset(buf[b], 0xff, pool.size);
+	}
+	bufpool_stats(&pool, &stats);
+	CuAssertTrue(tc, stats.gets == NUM_BUFS);
+	CuAssertTrue(tc, stats.in_use == NUM_BUFS);
+	CuAssertTrue(tc, stats.peak == NUM_BUFS);
+	CuAssertTrue(tc, stats.buffers >= NUM_BUFS);
+
+	/* Recently freed buffer is handed out first. */
+	bufpool_put(&pool, buf[0]);
+	reused = bufpool_get(&pool);
+	CuAssertPtrEquals(tc, buf[0], reused);
+
+	for (size_t b = 0; b < NUM_BUFS; b++)
+		bufpool_put(&pool, buf[b]);
+	bufpool_put(&pool, NULL);
+
+	bufpool_stats(&pool, &stats);
+	CuAssertTrue(tc, stats.gets == NUM_BUFS + 1);
+	CuAssertTrue(tc, stats.reuses >= 1);
+	CuAssertTrue(tc, stats.in_use == 0);
+	CuAssertTrue(tc, stats.peak == NUM_BUFS);
+
+	bufpool_destroy(&pool);
+}
+
+void test_bufpool_hugepage(CuTest *tc)
+{
+	struct bufpool_t pool;
+	char *buf;
+	int rc;
+
+	rc = bufpool_init(&pool, TSM_BUF_LENGTH, BUFPOOL_HUGEPAGE);
+	CuAssertIntEquals(tc, 0, rc);
+	CuAssertTrue(tc, pool.chunk_size == BUFPOOL_HUGEPAGE_SIZE);
+
+	buf = bufpool_get(&pool);
+	CuAssertPtrNotNull(tc, buf);
+	CuAssertTrue(tc, (uintptr_t)buf % BUFPOOL_PAGE_SIZE == 0);
+	bufpool_put(&pool, buf);
+
+	bufpool_destroy(&pool);
+
+	/* Shared pool is created once. */
+	CuAssertPtrNotNull(tc, bufpool_default());
+	CuAssertPtrEquals(tc, bufpool_default(), bufpool_default());
+	CuAssertTrue(tc, bufpool_default()->size == TSM_BUF_LENGTH);
+}
+
+void test_bufpool_threads(CuTest *tc)
+{
+	struct bufpool_t pool;
+	struct bufpool_stats_t stats;
+	pthread_t threads[NUM_THREADS];
+	void *res;
+	int rc;
+
+	rc = bufpool_init(&pool, BUFPOOL_PAGE_SIZE, 0);
+	CuAssertIntEquals(tc, 0, rc);
+
+	for (size_t t = 0; t < NUM_THREADS; t++) {
+		rc = pthread_create(&threads[t], NULL, bufpool_worker, &pool);
+		CuAssertIntEquals(tc, 0, rc);
+	}
+	for (size_t t = 0; t < NUM_THREADS; t++) {
+		rc = pthread_join(threads[t], &res);
+		CuAssertIntEquals(tc, 0, rc);
+		CuAssertPtrEquals(tc, NULL, res);
+	}
+
+	bufpool_stats(&pool, &stats);
+	CuAssertTrue(tc, stats.gets ==
+		     (uint64_t)NUM_THREADS * NUM_ITER * (BUFPOOL_TCACHE + 1));
+	CuAssertTrue(tc, stats.in_use == 0);
+	CuAssertTrue(tc, stats.peak <= NUM_THREADS * (BUFPOOL_TCACHE + 1));
+	/* Buffers are reused, not allocated per get. */
+	CuAssertTrue(tc, stats.buffers == pool.chunk_size / pool.size);
+	CuAssertTrue(tc, stats.gets - stats.reuses == 1);
+
+	bufpool_destroy(&pool);
+}
+
+CuSuite* bufpool_get_suite()
+{
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, test_bufpool);
+    SUITE_ADD_TEST(suite, test_bufpool_hugepage);
+    SUITE_ADD_TEST(suite, test_bufpool_threads);
+
+    return suite;
+}
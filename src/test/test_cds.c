@@ -24,6 +24,11 @@ CuSuite* dsstruct64_off64_t_get_suite();
 CuSuite* list_get_suite();
 CuSuite* chashtable_get_suite();
 CuSuite* qtable_get_suite();
+CuSuite* slab_get_suite();
+CuSuite* lru_get_suite();
+CuSuite* prefetch_get_suite();
+CuSuite* bufpool_get_suite();
+CuSuite* compress_get_suite();
 
 void run_all_tests(void) {
 	CuString *output = CuStringNew();
@@ -32,17 +37,32 @@ void run_all_tests(void) {
 	CuSuite* list_suite = list_get_suite();
 	CuSuite* chashtable_suite = chashtable_get_suite();
 	CuSuite* qtable_suite = qtable_get_suite();
+	CuSuite* slab_suite = slab_get_suite();
+	CuSuite* lru_suite = lru_get_suite();
+	CuSuite* prefetch_suite = prefetch_get_suite();
+	CuSuite* bufpool_suite = bufpool_get_suite();
+	CuSuite* compress_suite = compress_get_suite();
 
 	CuSuiteAddSuite(suite, dsstruct64_off64_t_suite);
 	CuSuiteAddSuite(suite, list_suite);
 	CuSuiteAddSuite(suite, chashtable_suite);
 	CuSuiteAddSuite(suite, qtable_suite);
+	CuSuiteAddSuite(suite, slab_suite);
+	CuSuiteAddSuite(suite, lru_suite);
+	CuSuiteAddSuite(suite, prefetch_suite);
+	CuSuiteAddSuite(suite, bufpool_suite);
+	CuSuiteAddSuite(suite, compress_suite);
 
 	CuSuiteRun(suite);
 	CuSuiteSummary(suite, output);
 	CuSuiteDetails(suite, output);
 	printf("%s\n", output->buffer);
 
+	CuSuiteDelete(compress_suite);
+	CuSuiteDelete(bufpool_suite);
+	CuSuiteDelete(prefetch_suite);
+	CuSuiteDelete(lru_suite);
+	CuSuiteDelete(slab_suite);
 	CuSuiteDelete(qtable_suite);
 	CuSuiteDelete(chashtable_suite);
 	CuSuiteDelete(list_suite);
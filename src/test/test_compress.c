@@ -0,0 +1,208 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Copyright (c) 2026, GSI Helmholtz Centre for Heavy Ion Research
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <sys/param.h>
+#include "compress.h"
+#include "common.h"
+#include "CuTest.h"
+
+#define NUM_BLOCKS	9
+#define NUM_THREADS	3
+#define FEED_LEN	7
+
+/* Compress data with the given number of threads and decompress the
+   frames in pieces of FEED_LEN bytes. Returns number of frame bytes. */
+static size_t round_trip(CuTest *tc, const char *data, const size_t len,
+			 const uint16_t nthreads)
+{
+	struct compress_t compress;
+	struct decompress_t decompress;
+	struct compress_job_t *job;
+	char *frames;
+	char *out;
+	size_t frames_len = 0;
+	size_t out_len = 0;
+	size_t off = 0;
+	int rc;
+
+	frames = malloc(NUM_BLOCKS * COMPRESS_FRAME_MAX);
+	out = malloc(len);
+	CuAssertPtrNotNull(tc, frames);
+	CuAssertPtrNotNull(tc, out);
+
+	rc = compress_init(&compress, COMPRESS_ZLIB, 0, nthreads);
+	CuAssertIntEquals(tc, 0, rc);
+
+	while (off < len || compress.count > 0) {
+		/* Keep the ring full, then drain the oldest job. */
+		while (off < len && (job = compress_job(&compress))) {
+			job->len = MIN(len - off, COMPRESS_BLOCK);
+			/* Both copied and external data. */
+			if ((off / COMPRESS_BLOCK) % 2)
+				memcpy(job->in, data + off, job->len);
+			else
+				job->data = data + off;
+			off += job->len;
+			compress_submit(&compress, job);
+		}
+		job = compress_wait(&compress);
+		CuAssertPtrNotNull(tc, job);
+		CuAssertIntEquals(tc, 0, job->rc);
+		CuAssertTrue(tc, job->frame_len <= COMPRESS_FRAME_MAX);
+		memcpy(frames + frames_len, job->frame, job->frame_len);
+		frames_len += job->frame_len;
+		compress_release(&compress);
+	}
+	CuAssertPtrEquals(tc, NULL, compress_wait(&compress));
+	CuAssertTrue(tc, compress.bytes_in == len);
+	CuAssertTrue(tc, compress.bytes_out == frames_len);
+	compress_destroy(&compress);
+
+	rc = decompress_init(&decompress, COMPRESS_ZLIB);
+	CuAssertIntEquals(tc, 0, rc);
+	for (size_t pos = 0; pos < frames_len; ) {
+		const char *raw;
+		size_t raw_len;
+		ssize_t n;
+
+		n = decompress_feed(&decompress, frames + pos,
+				    MIN(FEED_LEN, frames_len - pos),
+				    &raw, &raw_len);
+		CuAssertTrue(tc, n > 0);
+		pos += n;
+		if (raw) {
+			CuAssertTrue(tc, out_len + raw_len <= len);
+			memcpy(out + out_len, raw, raw_len);
+			out_len += raw_len;
+		}
+	}
+	CuAssertTrue(tc, decompress_idle(&decompress));
+	decompress_destroy(&decompress);
+
+	CuAssertTrue(tc, out_len == len);
+	CuAssertTrue(tc, memcmp(data, out, len) == 0);
+
+	free(out);
+	free(frames);
+
+	return frames_len;
+}
+
+void test_compress(CuTest *tc)
+{
+	const size_t len = (NUM_BLOCKS - 1) * COMPRESS_BLOCK + 4711;
+	char *data;
+	size_t frames_len;
+
+	data = malloc(len);
+	CuAssertPtrNotNull(tc, data);
+
+	/* Compressible data shrinks. */
+	for (size_t n = 0; n < len; n++)
+		data[n] = "ltsm"[n % 4];
+	frames_len = round_trip(tc, data, len, 0);
+	CuAssertTrue(tc, frames_len < len / 10);
+
+	/* Random data is stored, each frame adds only its header. */
+	for (size_t n = 0; n < len; n++)
+		data[n] = rand() % 256;
+	frames_len = round_trip(tc, data, len, 0);
+	CuAssertTrue(tc, frames_len ==
+		     len + NUM_BLOCKS * sizeof(struct compress_frame_t));
+
+	free(data);
+}
+
+void test_compress_threads(CuTest *tc)
+{
+	const size_t len = (NUM_BLOCKS - 1) * COMPRESS_BLOCK + 42;
+	char *data;
+
+	data = malloc(len);
+	CuAssertPtrNotNull(tc, data);
+
+	/* Blocks of differing compressibility finish out of order, frames
+	   are nevertheless handed back in submission order. */
+	for (size_t n = 0; n < len; n++)
+		data[n] = (n / COMPRESS_BLOCK) % 2 ? rand() % 256 : n % 13;
+	round_trip(tc, data, len, NUM_THREADS);
+
+	free(data);
+}
+
+void test_compress_parse(CuTest *tc)
+{
+	struct decompress_t decompress;
+	const char *raw;
+	size_t raw_len;
+	struct compress_frame_t hdr = {.len = 2, .raw_len = 1};
+	uint32_t codec = COMPRESS_NONE;
+	int level = -1;
+	int rc;
+
+	rc = compress_parse("zlib", &codec, &level);
+	CuAssertIntEquals(tc, 0, rc);
+	CuAssertIntEquals(tc, COMPRESS_ZLIB, codec);
+	CuAssertIntEquals(tc, 0, level);
+
+	rc = compress_parse("ZLIB:9", &codec, &level);
+	CuAssertIntEquals(tc, 0, rc);
+	CuAssertIntEquals(tc, COMPRESS_ZLIB, codec);
+	CuAssertIntEquals(tc, 9, level);
+
+	rc = compress_parse("none", &codec, &level);
+	CuAssertIntEquals(tc, 0, rc);
+	CuAssertIntEquals(tc, COMPRESS_NONE, codec);
+
+	CuAssertIntEquals(tc, -EINVAL, compress_parse("zlibx", &codec, &level));
+	CuAssertIntEquals(tc, -EINVAL, compress_parse("zlib:", &codec, &level));
+	CuAssertIntEquals(tc, -EINVAL, compress_parse("zlib:-1", &codec,
+						      &level));
+	CuAssertIntEquals(tc, -EINVAL, compress_parse("", &codec, &level));
+	if (!compress_supported(COMPRESS_ZSTD))
+		CuAssertIntEquals(tc, -EOPNOTSUPP,
+				  compress_parse("zstd", &codec, &level));
+	CuAssertStrEquals(tc, "lz4", compress_name(COMPRESS_LZ4));
+	CuAssertStrEquals(tc, "unknown", compress_name(42));
+
+	rc = decompress_init(&decompress, COMPRESS_NONE);
+	CuAssertIntEquals(tc, -EOPNOTSUPP, rc);
+
+	/* Frame whose payload exceeds its uncompressed size is corrupt. */
+	rc = decompress_init(&decompress, COMPRESS_ZLIB);
+	CuAssertIntEquals(tc, 0, rc);
+	CuAssertIntEquals(tc, -EINVAL,
+			  (int)decompress_feed(&decompress, (const char *)&hdr,
+					       sizeof(hdr), &raw, &raw_len));
+	decompress_destroy(&decompress);
+}
+
+CuSuite* compress_get_suite()
+{
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, test_compress);
+    SUITE_ADD_TEST(suite, test_compress_threads);
+    SUITE_ADD_TEST(suite, test_compress_parse);
+
+    return suite;
+}
@@ -16,6 +16,10 @@
  * Copyright (c) 2016, GSI Helmholtz Centre for Heavy Ion Research
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <stdlib.h>
 #include <strings.h>
 #include "ltsmapi.c"
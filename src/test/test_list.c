@@ -18,6 +18,7 @@
 
 #include <stdint.h>
 #include "list.h"
+#include "queue.h"
 #include "CuTest.h"
 
 void test_list_1(CuTest *tc)
@@ -100,11 +101,53 @@ void test_list_2(CuTest *tc)
 	CuAssertIntEquals(tc, 0, list_size(&list));
 }
 
+void test_list_node(CuTest *tc)
+{
+	queue_t queue;
+	list_node_t nodes[4];
+	list_node_t *node;
+	int rc;
+
+	queue_init(&queue, NULL);
+
+	/* We expect: head->0->1->2->3<-tail */
+	for (uintptr_t i = 0; i < 4; i++) {
+		nodes[i].data = (void *)i;
+		rc = queue_enqueue_node(&queue, &nodes[i]);
+		CuAssertIntEquals(tc, RC_SUCCESS, rc);
+	}
+	CuAssertIntEquals(tc, 4, queue_size(&queue));
+	CuAssertPtrEquals(tc, &nodes[0], list_head(&queue));
+	CuAssertPtrEquals(tc, &nodes[3], list_tail(&queue));
+
+	/* Remove 2 from the middle, then 3 is the tail: head->0->1->3. */
+	rc = list_rem_next_node(&queue, &nodes[1], &node);
+	CuAssertIntEquals(tc, RC_SUCCESS, rc);
+	CuAssertPtrEquals(tc, &nodes[2], node);
+	CuAssertPtrEquals(tc, &nodes[3], list_tail(&queue));
+
+	for (uintptr_t i = 0; i < 4; i++) {
+		if (i == 2)
+			continue;
+		rc = queue_dequeue_node(&queue, &node);
+		CuAssertIntEquals(tc, RC_SUCCESS, rc);
+		CuAssertPtrEquals(tc, &nodes[i], node);
+		CuAssertIntEquals(tc, i, (uintptr_t)list_data(node));
+	}
+	CuAssertIntEquals(tc, 0, queue_size(&queue));
+	CuAssertPtrEquals(tc, NULL, list_head(&queue));
+	CuAssertPtrEquals(tc, NULL, list_tail(&queue));
+
+	rc = queue_dequeue_node(&queue, &node);
+	CuAssertIntEquals(tc, RC_ERROR, rc);
+}
+
 CuSuite* list_get_suite()
 {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, test_list_1);
     SUITE_ADD_TEST(suite, test_list_2);
+    SUITE_ADD_TEST(suite, test_list_node);
 
     return suite;
 }
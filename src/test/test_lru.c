@@ -0,0 +1,106 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Copyright (c) 2026, GSI Helmholtz Centre for Heavy Ion Research
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include "lru.h"
+#include "CuTest.h"
+
+#define N 64
+
+void test_lru(CuTest *tc)
+{
+	struct lru_t lru;
+	char key[32];
+	char val[64];
+	int rc;
+
+	rc = lru_init(&lru, 0);
+	CuAssertIntEquals(tc, -EINVAL, rc);
+
+	rc = lru_init(&lru, N);
+	CuAssertIntEquals(tc, 0, rc);
+
+	rc = lru_get(&lru, "[0x1:0x1:0x0]", val, sizeof(val));
+	CuAssertIntEquals(tc, -ENOENT, rc);
+
+	for (uint16_t n = 0; n < N; n++) {
+		snprintf(key, sizeof(key), "[0x%x:0x1:0x0]", n);
+		snprintf(val, sizeof(val), "/lustre/dir/file%d", n);
+		rc = lru_put(&lru, key, val);
+		CuAssertIntEquals(tc, 0, rc);
+	}
+	CuAssertIntEquals(tc, N, lru_size(&lru));
+
+	/* Touch oldest entry, such that the second oldest is evicted. */
+	rc = lru_get(&lru, "[0x0:0x1:0x0]", val, sizeof(val));
+	CuAssertIntEquals(tc, 0, rc);
+	CuAssertStrEquals(tc, "/lustre/dir/file0", val);
+
+	rc = lru_put(&lru, "[0xffff:0x1:0x0]", "/lustre/dir/new");
+	CuAssertIntEquals(tc, 0, rc);
+	CuAssertIntEquals(tc, N, lru_size(&lru));
+	rc = lru_get(&lru, "[0x1:0x1:0x0]", val, sizeof(val));
+	CuAssertIntEquals(tc, -ENOENT, rc);
+	rc = lru_get(&lru, "[0x0:0x1:0x0]", val, sizeof(val));
+	CuAssertIntEquals(tc, 0, rc);
+	rc = lru_get(&lru, "[0xffff:0x1:0x0]", val, sizeof(val));
+	CuAssertIntEquals(tc, 0, rc);
+	CuAssertStrEquals(tc, "/lustre/dir/new", val);
+
+	/* Replace value, e.g. after rename. */
+	rc = lru_put(&lru, "[0x2:0x1:0x0]", "/lustre/renamed");
+	CuAssertIntEquals(tc, 0, rc);
+	CuAssertIntEquals(tc, N, lru_size(&lru));
+	rc = lru_get(&lru, "[0x2:0x1:0x0]", val, sizeof(val));
+	CuAssertIntEquals(tc, 0, rc);
+	CuAssertStrEquals(tc, "/lustre/renamed", val);
+
+	rc = lru_get(&lru, "[0x2:0x1:0x0]", val, 4);
+	CuAssertIntEquals(tc, -ENAMETOOLONG, rc);
+
+	lru_remove(&lru, "[0x2:0x1:0x0]");
+	lru_remove(&lru, "[0x2:0x1:0x0]");
+	CuAssertIntEquals(tc, N - 1, lru_size(&lru));
+	rc = lru_get(&lru, "[0x2:0x1:0x0]", val, sizeof(val));
+	CuAssertIntEquals(tc, -ENOENT, rc);
+
+	CuAssertTrue(tc, lru.hits == 5);
+	CuAssertTrue(tc, lru.misses == 3);
+
+	/* Evict everything. */
+	for (uint16_t n = 0; n < 2 * N; n++) {
+		snprintf(key, sizeof(key), "[0x%x:0x2:0x0]", n);
+		rc = lru_put(&lru, key, "/lustre/x");
+		CuAssertIntEquals(tc, 0, rc);
+	}
+	CuAssertIntEquals(tc, N, lru_size(&lru));
+	rc = lru_get(&lru, "[0x0:0x1:0x0]", val, sizeof(val));
+	CuAssertIntEquals(tc, -ENOENT, rc);
+
+	lru_destroy(&lru);
+}
+
+CuSuite* lru_get_suite()
+{
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, test_lru);
+
+    return suite;
+}
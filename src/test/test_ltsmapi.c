@@ -16,14 +16,23 @@
  * Copyright (c) 2017-2023, GSI Helmholtz Centre for Heavy Ion Research
  */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <time.h>
 #include <unistd.h>
+#include <sched.h>
 #include "CuTest.h"
 #include "ltsmapi.c"
+#include "spool.h"
+#include "alog.h"
+#include "metrics.h"
+#include "trace.h"
 #include "test_utils.h"
 
 #define SERVERNAME	"tsmserver-8"
@@ -127,6 +136,668 @@ void test_tsm_fcalls(CuTest *tc)
 	tsm_cleanup(DSM_SINGLETHREAD);
 }
 
+void test_tsm_fwritev(CuTest *tc)
+{
+	int rc;
+	struct login_t login;
+	char fpath[PATH_MAX] = {0};
+	char rnd_s[LEN_RND_STR + 1] = {0};
+
+	rnd_str(rnd_s, LEN_RND_STR);
+	snprintf(fpath, PATH_MAX, "/tmp/%s", rnd_s);
+
+	login_init(&login, SERVERNAME, NODE, PASSWORD,
+		   OWNER, LINUX_PLATFORM, DEFAULT_FSNAME,
+		   DEFAULT_FSTYPE);
+
+	struct session_t session;
+	memset(&session, 0, sizeof(struct session_t));
+
+	rc = tsm_init(DSM_SINGLETHREAD);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	rc = tsm_fconnect(&login, &session);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	rc = tsm_fopen(DEFAULT_FSNAME, fpath, "written by cutest",
+		       &session);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	uint32_t crc32sum = 0;
+	size_t total = 0;
+	for (uint8_t b = 0; b < 16; b++) {
+		struct iovec iov[4];
+		int iovcnt = 1 + (rand() % 4);
+		size_t to_write = 0;
+
+		for (int i = 0; i < iovcnt; i++) {
+			/* Mix small header like segments with larger payload. */
+			size_t len = i == 0 ? 1 + (rand() % 64) :
+				1 + (rand() % 1048576);
+			unsigned char *buf = malloc(len);
+			CuAssertPtrNotNull(tc, buf);
+			for (size_t l = 0; l < len; l++)
+				buf[l] = rand() % 256;
+
+			crc32sum = crc32(crc32sum, buf, len);
+			iov[i].iov_base = buf;
+			iov[i].iov_len = len;
+			to_write += len;
+		}
+
+		ssize_t written = tsm_fwritev(iov, iovcnt, &session);
+		CuAssertIntEquals(tc, to_write, written);
+		total += written;
+
+		for (int i = 0; i < iovcnt; i++)
+			free(iov[i].iov_base);
+	}
+
+	CuAssertIntEquals(tc, total, session.tsm_file->bytes_processed);
+	CuAssertIntEquals(tc, crc32sum,
+			  session.tsm_file->archive_info.obj_info.crc32);
+
+	rc = tsm_fclose(&session);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	rc = tsm_delete_fpath(DEFAULT_FSNAME, fpath, &session);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	tsm_fdisconnect(&session);
+	tsm_cleanup(DSM_SINGLETHREAD);
+}
+
+void test_tsm_archive_retrieve(CuTest *tc)
+{
+	int rc;
+	struct login_t login;
+	struct session_t session;
+	char fpath[PATH_MAX] = {0};
+	char rnd_s[LEN_RND_STR + 1] = {0};
+	uint32_t crc32_archived = 0;
+	uint32_t crc32_retrieved = 0;
+	FILE *file;
+
+	rnd_str(rnd_s, LEN_RND_STR);
+	snprintf(fpath, PATH_MAX, "/tmp/%s", rnd_s);
+
+	/* Data spans several TSM_BUF_LENGTH blocks. */
+	file = fopen(fpath, "w");
+	CuAssertPtrNotNull(tc, file);
+	for (size_t n = 0; n < 3 * TSM_BUF_LENGTH + 4711; n++)
+		fputc(rand() % 256, file);
+	fclose(file);
+	rc = crc32file(fpath, &crc32_archived);
+	CuAssertIntEquals(tc, 0, rc);
+
+	login_init(&login, SERVERNAME, NODE, PASSWORD,
+		   OWNER, LINUX_PLATFORM, DEFAULT_FSNAME,
+		   DEFAULT_FSTYPE);
+	memset(&session, 0, sizeof(struct session_t));
+
+	rc = tsm_init(DSM_SINGLETHREAD);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	rc = tsm_connect(&login, &session);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	rc = tsm_archive_fpath(DEFAULT_FSNAME, fpath, "written by cutest", -1,
+			       NULL, &session);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	rc = unlink(fpath);
+	CuAssertIntEquals(tc, 0, rc);
+
+	rc = tsm_retrieve_fpath(DEFAULT_FSNAME, fpath, NULL, -1, &session);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	rc = crc32file(fpath, &crc32_retrieved);
+	CuAssertIntEquals(tc, 0, rc);
+	CuAssertIntEquals(tc, crc32_archived, crc32_retrieved);
+
+	/* Restore with O_DIRECT writes and unaligned tail. */
+	rc = unlink(fpath);
+	CuAssertIntEquals(tc, 0, rc);
+	set_restore_direct(1);
+	rc = tsm_retrieve_fpath(DEFAULT_FSNAME, fpath, NULL, -1, &session);
+	set_restore_direct(0);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	crc32_retrieved = 0;
+	rc = crc32file(fpath, &crc32_retrieved);
+	CuAssertIntEquals(tc, 0, rc);
+	CuAssertIntEquals(tc, crc32_archived, crc32_retrieved);
+
+	rc = tsm_delete_fpath(DEFAULT_FSNAME, fpath, &session);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	/* Deleted object cannot be retrieved. */
+	rc = unlink(fpath);
+	CuAssertIntEquals(tc, 0, rc);
+	rc = tsm_retrieve_fpath(DEFAULT_FSNAME, fpath, NULL, -1, &session);
+	CuAssertIntEquals(tc, DSM_RC_UNSUCCESSFUL, rc);
+	CuAssertIntEquals(tc, -1, access(fpath, F_OK));
+
+	unlink(fpath);
+	tsm_disconnect(&session);
+	tsm_cleanup(DSM_SINGLETHREAD);
+}
+
+void test_tsm_archive_crc32(CuTest *tc)
+{
+	int rc;
+	struct login_t login;
+	struct session_t session;
+	char dpath[32] = {0};
+	char fpath[PATH_MAX] = {0};
+	char rnd_s[LEN_RND_STR + 1] = {0};
+	/* Empty, inline checksummed and deferred updated file. */
+	const size_t sizes[] = {0, 4711, CRC32_INLINE_BYTES + 4711};
+	const size_t num_sizes = sizeof(sizes) / sizeof(sizes[0]);
+	uint32_t crc32sum[num_sizes];
+	FILE *file;
+
+	rnd_str(rnd_s, LEN_RND_STR);
+	snprintf(dpath, sizeof(dpath), "/tmp/%s", rnd_s);
+	rc = mkdir(dpath, S_IRWXU);
+	CuAssertIntEquals(tc, 0, rc);
+
+	for (size_t s = 0; s < num_sizes; s++) {
+		snprintf(fpath, PATH_MAX, "%s/f%zu", dpath, s);
+		file = fopen(fpath, "w");
+		CuAssertPtrNotNull(tc, file);
+		for (size_t n = 0; n < sizes[s]; n++)
+			fputc(rand() % 256, file);
+		fclose(file);
+		rc = crc32file(fpath, &crc32sum[s]);
+		CuAssertIntEquals(tc, 0, rc);
+	}
+
+	login_init(&login, SERVERNAME, NODE, PASSWORD,
+		   OWNER, LINUX_PLATFORM, DEFAULT_FSNAME,
+		   DEFAULT_FSTYPE);
+	memset(&session, 0, sizeof(struct session_t));
+
+	rc = tsm_init(DSM_SINGLETHREAD);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	rc = tsm_connect(&login, &session);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	/* Without read ahead the large file is checksummed while sent and
+	   its crc32 is updated deferred. */
+	set_prefetch(0, 0, 0);
+	rc = tsm_archive_fpath(DEFAULT_FSNAME, dpath, "written by cutest", -1,
+			       NULL, &session);
+	set_prefetch(PREFETCH_FILES, PREFETCH_BYTES, PREFETCH_THREADS);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+	CuAssertPtrEquals(tc, NULL, session.crc32_update);
+
+	rc = init_qtable(&session.qtable);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+	snprintf(fpath, PATH_MAX, "%s/*", dpath);
+	rc = tsm_query_fpath_qtable(DEFAULT_FSNAME, fpath, NULL,
+				    &(dsmDate){DATE_MINUS_INFINITE, 1, 1, 0, 0, 0},
+				    &(dsmDate){DATE_PLUS_INFINITE, 12, 31, 23, 59, 59},
+				    &session);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+	rc = create_array(&session.qtable, SORT_NONE);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+	CuAssertIntEquals(tc, num_sizes, session.qtable.qarray.size);
+
+	for (uint32_t n = 0; n < session.qtable.qarray.size; n++) {
+		const qryRespArchiveData *qra = &session.qtable.qarray.data[n];
+		struct obj_info_t obj_info;
+		size_t s;
+
+		memcpy(&obj_info, qra->objInfo, sizeof(obj_info));
+		s = strtoul(qra->objName.ll + strlen("/f"), NULL, 10);
+		CuAssertTrue(tc, s < num_sizes);
+		CuAssertIntEquals(tc, crc32sum[s], obj_info.crc32);
+	}
+	destroy_qtable(&session.qtable);
+
+	rc = tsm_delete_fpath(DEFAULT_FSNAME, fpath, &session);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	for (size_t s = 0; s < num_sizes; s++) {
+		snprintf(fpath, PATH_MAX, "%s/f%zu", dpath, s);
+		unlink(fpath);
+	}
+	rmdir(dpath);
+	tsm_disconnect(&session);
+	tsm_cleanup(DSM_SINGLETHREAD);
+}
+
+void test_tsm_archive_prefetch(CuTest *tc)
+{
+	int rc;
+	struct login_t login;
+	struct session_t session;
+	char dpath[32] = {0};
+	char fpath[PATH_MAX] = {0};
+	char rnd_s[LEN_RND_STR + 1] = {0};
+	/* Files of directory and subdirectory, inline checksummed and
+	   exceeding inline checksum size. */
+	const char *names[] = {"f0", "f1", "f2", "sub/f3", "sub/f4"};
+	const size_t sizes[] = {17, 4711, CRC32_INLINE_BYTES + 4711,
+				3 * TSM_BUF_LENGTH, 0};
+	const size_t num_files = sizeof(sizes) / sizeof(sizes[0]);
+	uint32_t crc32sum[num_files];
+	uint32_t crc32_retrieved;
+	FILE *file;
+
+	rnd_str(rnd_s, LEN_RND_STR);
+	snprintf(dpath, sizeof(dpath), "/tmp/%s", rnd_s);
+	rc = mkdir(dpath, S_IRWXU);
+	CuAssertIntEquals(tc, 0, rc);
+	snprintf(fpath, PATH_MAX, "%s/sub", dpath);
+	rc = mkdir(fpath, S_IRWXU);
+	CuAssertIntEquals(tc, 0, rc);
+
+	for (size_t f = 0; f < num_files; f++) {
+		snprintf(fpath, PATH_MAX, "%s/%s", dpath, names[f]);
+		file = fopen(fpath, "w");
+		CuAssertPtrNotNull(tc, file);
+		for (size_t n = 0; n < sizes[f]; n++)
+			fputc(rand() % 256, file);
+		fclose(file);
+		rc = crc32file(fpath, &crc32sum[f]);
+		CuAssertIntEquals(tc, 0, rc);
+	}
+
+	login_init(&login, SERVERNAME, NODE, PASSWORD,
+		   OWNER, LINUX_PLATFORM, DEFAULT_FSNAME,
+		   DEFAULT_FSTYPE);
+	memset(&session, 0, sizeof(struct session_t));
+
+	rc = tsm_init(DSM_SINGLETHREAD);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	rc = tsm_connect(&login, &session);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	/* Files are read ahead with the default prefetch settings. */
+	set_recursive(bTrue);
+	rc = tsm_archive_fpath(DEFAULT_FSNAME, dpath, "written by cutest", -1,
+			       NULL, &session);
+	set_recursive(bFalse);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+	CuAssertPtrEquals(tc, NULL, session.prefetch);
+
+	for (size_t f = 0; f < num_files; f++) {
+		snprintf(fpath, PATH_MAX, "%s/%s", dpath, names[f]);
+		rc = unlink(fpath);
+		CuAssertIntEquals(tc, 0, rc);
+
+		rc = tsm_retrieve_fpath(DEFAULT_FSNAME, fpath, NULL, -1,
+					&session);
+		CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+		crc32_retrieved = 0;
+		rc = crc32file(fpath, &crc32_retrieved);
+		CuAssertIntEquals(tc, 0, rc);
+		CuAssertIntEquals(tc, crc32sum[f], crc32_retrieved);
+
+		rc = tsm_delete_fpath(DEFAULT_FSNAME, fpath, &session);
+		CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+		unlink(fpath);
+	}
+
+	snprintf(fpath, PATH_MAX, "%s/sub", dpath);
+	rmdir(fpath);
+	rmdir(dpath);
+	tsm_disconnect(&session);
+	tsm_cleanup(DSM_SINGLETHREAD);
+}
+
+void test_tsm_archive_direct(CuTest *tc)
+{
+	int rc;
+	struct login_t login;
+	struct session_t session;
+	struct obj_info_t obj_info;
+	char fpath[PATH_MAX] = {0};
+	char rnd_s[LEN_RND_STR + 1] = {0};
+	uint32_t crc32_archived = 0;
+	uint32_t crc32_retrieved = 0;
+	FILE *file;
+
+	rnd_str(rnd_s, LEN_RND_STR);
+	snprintf(fpath, PATH_MAX, "/tmp/%s", rnd_s);
+
+	/* Exceeds inline checksumming and has an unaligned tail. */
+	file = fopen(fpath, "w");
+	CuAssertPtrNotNull(tc, file);
+	for (size_t n = 0; n < CRC32_INLINE_BYTES + 4711; n++)
+		fputc(rand() % 256, file);
+	fclose(file);
+	rc = crc32file(fpath, &crc32_archived);
+	CuAssertIntEquals(tc, 0, rc);
+
+	login_init(&login, SERVERNAME, NODE, PASSWORD,
+		   OWNER, LINUX_PLATFORM, DEFAULT_FSNAME,
+		   DEFAULT_FSTYPE);
+	memset(&session, 0, sizeof(struct session_t));
+
+	rc = tsm_init(DSM_SINGLETHREAD);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	rc = tsm_connect(&login, &session);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	/* File is read with O_DIRECT, falls back to buffered reads if the
+	   file system does not support O_DIRECT. */
+	session.archive_direct = bTrue;
+	rc = tsm_archive_fpath(DEFAULT_FSNAME, fpath, "written by cutest", -1,
+			       NULL, &session);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	rc = init_qtable(&session.qtable);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+	rc = tsm_query_fpath_qtable(DEFAULT_FSNAME, fpath, NULL,
+				    &(dsmDate){DATE_MINUS_INFINITE, 1, 1, 0, 0, 0},
+				    &(dsmDate){DATE_PLUS_INFINITE, 12, 31, 23, 59, 59},
+				    &session);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+	rc = create_array(&session.qtable, SORT_NONE);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+	CuAssertIntEquals(tc, 1, session.qtable.qarray.size);
+	memcpy(&obj_info, session.qtable.qarray.data[0].objInfo,
+	       sizeof(obj_info));
+	CuAssertIntEquals(tc, crc32_archived, obj_info.crc32);
+	destroy_qtable(&session.qtable);
+
+	rc = unlink(fpath);
+	CuAssertIntEquals(tc, 0, rc);
+
+	rc = tsm_retrieve_fpath(DEFAULT_FSNAME, fpath, NULL, -1, &session);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	rc = crc32file(fpath, &crc32_retrieved);
+	CuAssertIntEquals(tc, 0, rc);
+	CuAssertIntEquals(tc, crc32_archived, crc32_retrieved);
+
+	rc = tsm_delete_fpath(DEFAULT_FSNAME, fpath, &session);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	unlink(fpath);
+	tsm_disconnect(&session);
+	tsm_cleanup(DSM_SINGLETHREAD);
+}
+
+void test_tsm_archive_sparse(CuTest *tc)
+{
+	int rc;
+	int fd;
+	struct login_t login;
+	struct session_t session;
+	struct stat st_archived;
+	struct stat st_retrieved;
+	char fpath[PATH_MAX] = {0};
+	char rnd_s[LEN_RND_STR + 1] = {0};
+	char buf[4711];
+	uint32_t crc32_archived = 0;
+	uint32_t crc32_retrieved = 0;
+	/* Leading hole, data extents and a trailing hole. */
+	const off64_t offsets[] = {3 * SPARSE_HOLE_BYTES,
+				   5 * SPARSE_HOLE_BYTES + 17,
+				   5 * SPARSE_HOLE_BYTES + TSM_BUF_LENGTH};
+	const off64_t size = 9 * SPARSE_HOLE_BYTES + 42;
+
+	rnd_str(rnd_s, LEN_RND_STR);
+	snprintf(fpath, PATH_MAX, "/tmp/%s", rnd_s);
+
+	fd = open(fpath, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+	CuAssertTrue(tc, fd >= 0);
+	rc = ftruncate(fd, size);
+	CuAssertIntEquals(tc, 0, rc);
+	for (size_t o = 0; o < sizeof(offsets) / sizeof(offsets[0]); o++) {
+		for (size_t n = 0; n < sizeof(buf); n++)
+			buf[n] = rand() % 256;
+		CuAssertIntEquals(tc, sizeof(buf),
+				  pwrite(fd, buf, sizeof(buf), offsets[o]));
+	}
+	close(fd);
+	rc = crc32file(fpath, &crc32_archived);
+	CuAssertIntEquals(tc, 0, rc);
+	rc = stat(fpath, &st_archived);
+	CuAssertIntEquals(tc, 0, rc);
+
+	login_init(&login, SERVERNAME, NODE, PASSWORD,
+		   OWNER, LINUX_PLATFORM, DEFAULT_FSNAME,
+		   DEFAULT_FSTYPE);
+	memset(&session, 0, sizeof(struct session_t));
+
+	rc = tsm_init(DSM_SINGLETHREAD);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	rc = tsm_connect(&login, &session);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	rc = tsm_archive_fpath(DEFAULT_FSNAME, fpath, "written by cutest", -1,
+			       NULL, &session);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	rc = unlink(fpath);
+	CuAssertIntEquals(tc, 0, rc);
+
+	rc = tsm_retrieve_fpath(DEFAULT_FSNAME, fpath, NULL, -1, &session);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	rc = crc32file(fpath, &crc32_retrieved);
+	CuAssertIntEquals(tc, 0, rc);
+	CuAssertIntEquals(tc, crc32_archived, crc32_retrieved);
+
+	rc = stat(fpath, &st_retrieved);
+	CuAssertIntEquals(tc, 0, rc);
+	CuAssertIntEquals(tc, size, st_retrieved.st_size);
+	/* Holes are only recreated if the file system supports them. */
+	if (st_archived.st_blocks * 512 < size)
+		CuAssertTrue(tc, st_retrieved.st_blocks * 512 < size);
+
+	rc = tsm_delete_fpath(DEFAULT_FSNAME, fpath, &session);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	unlink(fpath);
+	tsm_disconnect(&session);
+	tsm_cleanup(DSM_SINGLETHREAD);
+}
+
+void test_tsm_archive_compress(CuTest *tc)
+{
+	int rc;
+	int fd;
+	struct login_t login;
+	struct session_t session;
+	struct obj_info_t obj_info;
+	char fpath[PATH_MAX] = {0};
+	char rnd_s[LEN_RND_STR + 1] = {0};
+	char buf[4711];
+	uint32_t crc32_archived = 0;
+	uint32_t crc32_retrieved = 0;
+	/* Compressible and random blocks, last frame is partial. */
+	const size_t num_bufs = 3 * COMPRESS_BLOCK / sizeof(buf) + 1;
+
+	rnd_str(rnd_s, LEN_RND_STR);
+	snprintf(fpath, PATH_MAX, "/tmp/%s", rnd_s);
+
+	fd = open(fpath, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+	CuAssertTrue(tc, fd >= 0);
+	for (size_t b = 0; b < num_bufs; b++) {
+		for (size_t n = 0; n < sizeof(buf); n++)
+			buf[n] = b % 2 ? rand() % 256 : n % 42;
+		CuAssertIntEquals(tc, sizeof(buf),
+				  write(fd, buf, sizeof(buf)));
+	}
+	close(fd);
+	rc = crc32file(fpath, &crc32_archived);
+	CuAssertIntEquals(tc, 0, rc);
+
+	login_init(&login, SERVERNAME, NODE, PASSWORD,
+		   OWNER, LINUX_PLATFORM, DEFAULT_FSNAME,
+		   DEFAULT_FSTYPE);
+	memset(&session, 0, sizeof(struct session_t));
+
+	rc = tsm_init(DSM_SINGLETHREAD);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	rc = tsm_connect(&login, &session);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	session.compress_codec = COMPRESS_ZLIB;
+	rc = tsm_archive_fpath(DEFAULT_FSNAME, fpath, "written by cutest", -1,
+			       NULL, &session);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+	CuAssertPtrNotNull(tc, session.compress);
+	CuAssertTrue(tc, session.compress->bytes_out <
+		     session.compress->bytes_in);
+
+	/* Codec and uncompressed size are recorded in the object. */
+	rc = init_qtable(&session.qtable);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+	rc = tsm_query_fpath_qtable(DEFAULT_FSNAME, fpath, NULL,
+				    &(dsmDate){DATE_MINUS_INFINITE, 1, 1, 0, 0, 0},
+				    &(dsmDate){DATE_PLUS_INFINITE, 12, 31, 23, 59, 59},
+				    &session);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+	rc = create_array(&session.qtable, SORT_NONE);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+	CuAssertIntEquals(tc, 1, session.qtable.qarray.size);
+	memcpy(&obj_info, session.qtable.qarray.data[0].objInfo,
+	       sizeof(obj_info));
+	CuAssertIntEquals(tc, MAGIC_ID_V3, obj_info.magic);
+	CuAssertIntEquals(tc, COMPRESS_ZLIB, obj_info.codec);
+	CuAssertTrue(tc, to_off64_t(obj_info.raw_size) ==
+		     (off64_t)(num_bufs * sizeof(buf)));
+	CuAssertIntEquals(tc, crc32_archived, obj_info.crc32);
+
+	rc = unlink(fpath);
+	CuAssertIntEquals(tc, 0, rc);
+
+	/* Objects of unknown format are not restored. */
+	obj_info.magic = MAGIC_ID_V3 + 1;
+	memcpy(session.qtable.qarray.data[0].objInfo, &obj_info,
+	       sizeof(obj_info));
+	rc = tsm_retrieve_qra(session.qtable.qarray.data, 1, -1, &session);
+	CuAssertIntEquals(tc, DSM_RC_UNSUCCESSFUL, rc);
+	CuAssertIntEquals(tc, -1, access(fpath, F_OK));
+	destroy_qtable(&session.qtable);
+
+	/* Decompressed transparently, also without session codec. */
+	session.compress_codec = COMPRESS_NONE;
+	rc = tsm_retrieve_fpath(DEFAULT_FSNAME, fpath, NULL, -1, &session);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	rc = crc32file(fpath, &crc32_retrieved);
+	CuAssertIntEquals(tc, 0, rc);
+	CuAssertIntEquals(tc, crc32_archived, crc32_retrieved);
+
+	rc = tsm_delete_fpath(DEFAULT_FSNAME, fpath, &session);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	unlink(fpath);
+	tsm_disconnect(&session);
+	tsm_cleanup(DSM_SINGLETHREAD);
+}
+
+void test_spool(CuTest *tc)
+{
+	int rc;
+	struct login_t login;
+	struct spool_t spool;
+	struct session_t *session[3];
+	char fpath[] = "/tmp/ltsm-spool-XXXXXX";
+	int fd;
+	FILE *file;
+
+	login_init(&login, SERVERNAME, NODE, PASSWORD,
+		   OWNER, LINUX_PLATFORM, DEFAULT_FSNAME,
+		   DEFAULT_FSTYPE);
+
+	fd = mkstemp(fpath);
+	CuAssertTrue(tc, fd >= 0);
+	file = fdopen(fd, "w");
+	CuAssertPtrNotNull(tc, file);
+	for (size_t n = 0; n < TSM_BUF_LENGTH + 4711; n++)
+		fputc(rand() % 256, file);
+	fclose(file);
+
+	/* First data block sent by any session loses the connection, and
+	   only one session can archive at a time. */
+	setenv("DSMMOCK_CONN_LOSS", "1", 1);
+	setenv("DSMMOCK_MAX_MOUNTS", "1", 1);
+	rc = tsm_init(DSM_MULTITHREAD);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	rc = spool_init(&spool, &login, 2, NULL);
+	CuAssertIntEquals(tc, 0, rc);
+	CuAssertIntEquals(tc, 2, spool_size(&spool));
+
+	session[0] = spool_checkout(&spool);
+	session[1] = spool_checkout(&spool);
+	CuAssertPtrNotNull(tc, session[0]);
+	CuAssertPtrNotNull(tc, session[1]);
+	CuAssertTrue(tc, session[0] != session[1]);
+
+	rc = tsm_check_session(session[0]);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+	CuAssertIntEquals(tc, bFalse, tsm_conn_lost(session[0]));
+
+	/* Grow, new session is connected lazily on checkout. */
+	rc = spool_resize(&spool, 3);
+	CuAssertIntEquals(tc, 0, rc);
+	CuAssertIntEquals(tc, 3, spool_size(&spool));
+	session[2] = spool_checkout(&spool);
+	CuAssertPtrNotNull(tc, session[2]);
+	rc = tsm_check_session(session[2]);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	/* Connection is lost while sending, the failed abort of the
+	   transaction must not hide it. Broken session is reconnected on
+	   checkout. */
+	tsm_archive_fpath(DEFAULT_FSNAME, fpath, "written by cutest", -1,
+			  NULL, session[1]);
+	CuAssertIntEquals(tc, DSM_RC_TCPIP_FAILURE, session[1]->rc_tsm);
+	CuAssertIntEquals(tc, bTrue, tsm_conn_lost(session[1]));
+	CuAssertIntEquals(tc, DSM_RC_TCPIP_FAILURE,
+			  tsm_check_session(session[1]));
+	spool_checkin(&spool, session[1]);
+	session[1] = spool_checkout(&spool);
+	CuAssertPtrNotNull(tc, session[1]);
+	CuAssertIntEquals(tc, bFalse, tsm_conn_lost(session[1]));
+	rc = tsm_check_session(session[1]);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+
+	/* Session without mount point fails with a reason code, which is
+	   not mistaken for a lost connection. */
+	rc = tsm_archive_fpath(DEFAULT_FSNAME, fpath, "written by cutest", -1,
+			       NULL, session[1]);
+	CuAssertIntEquals(tc, DSM_RC_SUCCESSFUL, rc);
+	tsm_archive_fpath(DEFAULT_FSNAME, fpath, "written by cutest", -1,
+			  NULL, session[0]);
+	CuAssertIntEquals(tc, DSM_RS_ABORT_EXCEED_MAX_MP,
+			  session[0]->reason_tsm);
+	CuAssertIntEquals(tc, bFalse, tsm_conn_lost(session[0]));
+
+	/* Shrink, checked out sessions are retired on checkin. */
+	rc = spool_resize(&spool, 1);
+	CuAssertIntEquals(tc, 0, rc);
+	for (uint8_t n = 0; n < 3; n++)
+		spool_checkin(&spool, session[n]);
+	CuAssertIntEquals(tc, 1, spool_size(&spool));
+
+	spool_shutdown(&spool);
+	CuAssertPtrEquals(tc, NULL, spool_checkout(&spool));
+
+	spool_destroy(&spool);
+	tsm_cleanup(DSM_MULTITHREAD);
+	unsetenv("DSMMOCK_CONN_LOSS");
+	unsetenv("DSMMOCK_MAX_MOUNTS");
+	rc = unlink(fpath);
+	CuAssertIntEquals(tc, 0, rc);
+}
+
 void test_extract_hl_ll(CuTest *tc)
 {
 	const char *fpath = "/fs/hl/ll";
@@ -213,15 +884,419 @@ void test_set_prefix(CuTest *tc)
 	free(_prefix);
 }
 
+static uint32_t progress_calls;
+static uint64_t progress_cur;
+
+static int count_progress(struct progress_size_t *pg_size,
+			  struct session_t *session)
+{
+	progress_calls++;
+	progress_cur += pg_size->cur;
+
+	return 0;
+}
+
+void test_progress_dispatch(CuTest *tc)
+{
+	int rc;
+	struct session_t session;
+	const uint64_t blk = 262144;
+
+	memset(&session, 0, sizeof(struct session_t));
+	session.progress = count_progress;
+	progress_calls = 0;
+	progress_cur = 0;
+
+	/* Byte threshold only, time threshold never expires. */
+	set_progress_throttle(3600 * 1000, 4 * blk);
+	progress_reset(&session);
+	for (uint64_t n = 1; n <= 16; n++) {
+		rc = progress_dispatch(&session, blk, n * blk, 16 * blk + 100,
+				       bFalse);
+		CuAssertIntEquals(tc, 0, rc);
+	}
+	CuAssertIntEquals(tc, 4, progress_calls);
+	CuAssertIntEquals(tc, 16 * blk, progress_cur);
+
+	/* Nothing pending, forced final update is skipped. */
+	rc = progress_dispatch(&session, 0, 16 * blk, 16 * blk + 100, bTrue);
+	CuAssertIntEquals(tc, 4, progress_calls);
+
+	rc = progress_dispatch(&session, 100, 16 * blk + 100, 16 * blk + 100,
+			       bFalse);
+	CuAssertIntEquals(tc, 4, progress_calls);
+	rc = progress_dispatch(&session, 0, 16 * blk + 100, 16 * blk + 100,
+			       bTrue);
+	CuAssertIntEquals(tc, 5, progress_calls);
+	CuAssertIntEquals(tc, 16 * blk + 100, progress_cur);
+
+	/* No throttling, report each buffer. */
+	set_progress_throttle(0, 0);
+	progress_reset(&session);
+	for (uint64_t n = 1; n <= 16; n++)
+		progress_dispatch(&session, blk, n * blk, 16 * blk, bFalse);
+	CuAssertIntEquals(tc, 21, progress_calls);
+
+	set_progress_throttle(PROGRESS_INTERVAL_MS, PROGRESS_BYTES);
+}
+
+void test_mountp_cache(CuTest *tc)
+{
+	int rc;
+	uint16_t nmountp = 0;
+	dsBool_t limited = bFalse;
+	char node[LEN_RND_STR + 1] = {0};
+	char dpath[] = "/tmp/ltsm-mountp-XXXXXX";
+	char fpath[PATH_MAX] = {0};
+	char *long_node;
+
+	CuAssertPtrNotNull(tc, mkdtemp(dpath));
+	set_mountp_cache_dir(dpath);
+
+	rnd_str(node, LEN_RND_STR);
+	snprintf(fpath, sizeof(fpath), "%s/ltsm-maxnummp-%s-%s",
+		 dpath, "server/x", node);
+	for (char *c = fpath + strlen(dpath) + 1; *c; c++)
+		if (*c == '/')
+			*c = '_';
+
+	rc = tsm_mountp_cache_load("server/x", node, MOUNTP_CACHE_TTL,
+				   &nmountp, &limited);
+	CuAssertIntEquals(tc, -ENOENT, rc);
+
+	/* Cache file path must fit into PATH_MAX. */
+	long_node = calloc(1, PATH_MAX + 1);
+	CuAssertPtrNotNull(tc, long_node);
+	memset(long_node, 'n', PATH_MAX);
+	rc = tsm_mountp_cache_load("server/x", long_node, MOUNTP_CACHE_TTL,
+				   &nmountp, &limited);
+	CuAssertIntEquals(tc, -ENAMETOOLONG, rc);
+	rc = tsm_mountp_cache_store("server/x", long_node, 7, bTrue);
+	CuAssertIntEquals(tc, -ENAMETOOLONG, rc);
+	free(long_node);
+
+	rc = tsm_mountp_cache_store("server/x", node, 7, bTrue);
+	CuAssertIntEquals(tc, 0, rc);
+
+	rc = tsm_mountp_cache_load("server/x", node, MOUNTP_CACHE_TTL,
+				   &nmountp, &limited);
+	CuAssertIntEquals(tc, 0, rc);
+	CuAssertIntEquals(tc, 7, nmountp);
+	CuAssertIntEquals(tc, bTrue, limited);
+
+	rc = tsm_mountp_cache_load("server/x", node, -1, &nmountp, &limited);
+	CuAssertIntEquals(tc, -ESTALE, rc);
+
+	/* Cache file writable by others is not trusted. */
+	rc = chmod(fpath, S_IRUSR | S_IWUSR | S_IWOTH);
+	CuAssertIntEquals(tc, 0, rc);
+	rc = tsm_mountp_cache_load("server/x", node, MOUNTP_CACHE_TTL,
+				   &nmountp, &limited);
+	CuAssertIntEquals(tc, -EPERM, rc);
+
+	/* Neither are cache directories writable by others. */
+	rc = chmod(dpath, S_IRWXU | S_IRWXO);
+	CuAssertIntEquals(tc, 0, rc);
+	rc = tsm_mountp_cache_store("server/x", node, 7, bTrue);
+	CuAssertIntEquals(tc, -EPERM, rc);
+
+	rc = unlink(fpath);
+	CuAssertIntEquals(tc, 0, rc);
+	rc = rmdir(dpath);
+	CuAssertIntEquals(tc, 0, rc);
+	set_mountp_cache_dir(MOUNTP_CACHE_DIR);
+}
+
+void test_alog(CuTest *tc)
+{
+	int rc;
+	char fpath[PATH_MAX] = {0};
+	char fpath_rot[PATH_MAX + 8] = {0};
+	struct stat st;
+
+	snprintf(fpath, sizeof(fpath), "/tmp/ltsm-alog-%d.log", getpid());
+
+	rc = alog_start(fpath, 4096, 2);
+	CuAssertIntEquals(tc, 0, rc);
+
+	rc = alog_start(fpath, 4096, 2);
+	CuAssertIntEquals(tc, -EALREADY, rc);
+
+	for (uint16_t n = 0; n < 256; n++)
+		CT_MESSAGE("alog test message %d", n);
+	alog_stop();
+
+	CuAssertIntEquals(tc, 0, (int)alog_dropped());
+
+	rc = stat(fpath, &st);
+	CuAssertIntEquals(tc, 0, rc);
+	CuAssertTrue(tc, st.st_size <= 4096);
+	rc = unlink(fpath);
+	CuAssertIntEquals(tc, 0, rc);
+
+	for (uint16_t n = 1; n <= 2; n++) {
+		snprintf(fpath_rot, sizeof(fpath_rot), "%s.%d", fpath, n);
+		rc = stat(fpath_rot, &st);
+		CuAssertIntEquals(tc, 0, rc);
+		CuAssertTrue(tc, st.st_size > 0 && st.st_size <= 4096);
+		rc = unlink(fpath_rot);
+		CuAssertIntEquals(tc, 0, rc);
+	}
+
+	snprintf(fpath_rot, sizeof(fpath_rot), "%s.3", fpath);
+	rc = stat(fpath_rot, &st);
+	CuAssertIntEquals(tc, -1, rc);
+}
+
+static void *metrics_thread(void *data)
+{
+	UNUSED(data);
+
+	for (uint16_t n = 0; n < 10000; n++)
+		metrics_record(METRIC_WRITE, metrics_now(), 1);
+
+	return NULL;
+}
+
+void test_metrics(CuTest *tc)
+{
+	int rc;
+	uint64_t p50;
+	uint64_t p99;
+	pthread_t threads[4];
+	struct metrics_snapshot_t *start;
+	struct metrics_snapshot_t *end;
+	struct metrics_snapshot_t *diff;
+
+	start = calloc(3, sizeof(struct metrics_snapshot_t));
+	CuAssertPtrNotNull(tc, start);
+	end = start + 1;
+	diff = start + 2;
+
+	metrics_snapshot(start);
+
+	/* Latencies 1 usec ... 1000 usec. */
+	for (uint16_t n = 1; n <= 1000; n++)
+		metrics_record(METRIC_QUERY, metrics_now() - n * 1000ULL, n);
+
+	for (uint16_t n = 0; n < 4; n++) {
+		rc = pthread_create(&threads[n], NULL, metrics_thread, NULL);
+		CuAssertIntEquals(tc, 0, rc);
+	}
+	for (uint16_t n = 0; n < 4; n++)
+		pthread_join(threads[n], NULL);
+
+	metrics_snapshot(end);
+	metrics_diff(diff, start, end);
+
+	CuAssertIntEquals(tc, 1000, (int)diff->hist[METRIC_QUERY].count);
+	CuAssertIntEquals(tc, 500500, (int)diff->hist[METRIC_QUERY].bytes);
+	CuAssertTrue(tc, diff->hist[METRIC_QUERY].max_ns >= 1000000);
+	CuAssertIntEquals(tc, 40000, (int)diff->hist[METRIC_WRITE].count);
+	CuAssertIntEquals(tc, 40000, (int)diff->hist[METRIC_WRITE].bytes);
+
+	/* Bucket upper bounds are at most 12.5% above the recorded value. */
+	p50 = metrics_percentile(&diff->hist[METRIC_QUERY], 50.0);
+	p99 = metrics_percentile(&diff->hist[METRIC_QUERY], 99.0);
+	CuAssertTrue(tc, p50 >= 500000 && p50 <= 500000 * 1.125 + 1000);
+	CuAssertTrue(tc, p99 >= 990000 && p99 <= 990000 * 1.125 + 1000);
+
+	CuAssertStrEquals(tc, "dsmSendData", metrics_name(METRIC_SEND_DATA));
+
+	free(start);
+}
+
+void test_metrics_prometheus(CuTest *tc)
+{
+	char *buf = NULL;
+	size_t len = 0;
+	FILE *file;
+	struct metric_hist_t *hist;
+
+	hist = calloc(1, sizeof(struct metric_hist_t));
+	CuAssertPtrNotNull(tc, hist);
+
+	file = open_memstream(&buf, &len);
+	CuAssertPtrNotNull(tc, file);
+	metrics_prometheus_summary(file, "ltsm_test_seconds", "", hist);
+	metrics_hist_add(hist, 2000000000ULL, 0);
+	metrics_prometheus_summary(file, "ltsm_test_seconds", "action=\"x\"",
+				   hist);
+	fclose(file);
+
+	CuAssertPtrNotNull(tc, strstr(buf, "ltsm_test_seconds{quantile=\"0.5\"}"
+				      " NaN\n"));
+	CuAssertPtrNotNull(tc, strstr(buf, "ltsm_test_seconds_count 0\n"));
+	CuAssertPtrNotNull(tc, strstr(buf, "ltsm_test_seconds{action=\"x\","
+				      "quantile=\"0.99\"} 2.000000000\n"));
+	CuAssertPtrNotNull(tc, strstr(buf, "ltsm_test_seconds_sum{action="
+				      "\"x\"} 2.000000000\n"));
+	CuAssertPtrNotNull(tc, strstr(buf, "ltsm_test_seconds_count{action="
+				      "\"x\"} 1\n"));
+
+	free(buf);
+	free(hist);
+}
+
+void test_trace(CuTest *tc)
+{
+	int rc;
+	char fpath[PATH_MAX];
+	char *buf;
+	FILE *file;
+	long len;
+
+	snprintf(fpath, sizeof(fpath), "/tmp/ltsm-trace-%d.json", getpid());
+
+	rc = trace_enable(0);
+	CuAssertIntEquals(tc, -EINVAL, rc);
+	rc = trace_enable(4);
+	CuAssertIntEquals(tc, 0, rc);
+
+	trace_context_set(0xabc, "[0x200000401:0x1:0x0]");
+	TRACE_BEGIN("outer");
+	TRACE_BEGIN("inner");
+	TRACE_END("inner");
+	TRACE_END("outer");
+	trace_context_clear();
+	TRACE_BEGIN("last");
+	TRACE_END("last");
+	trace_disable();
+	TRACE_BEGIN("disabled");
+
+	rc = trace_dump(fpath);
+	CuAssertIntEquals(tc, 0, rc);
+
+	file = fopen(fpath, "r");
+	CuAssertPtrNotNull(tc, file);
+	fseek(file, 0, SEEK_END);
+	len = ftell(file);
+	rewind(file);
+	buf = calloc(1, len + 1);
+	CuAssertPtrNotNull(tc, buf);
+	CuAssertIntEquals(tc, 1, fread(buf, len, 1, file));
+	fclose(file);
+
+	/* Ring keeps the 4 most recent events only. */
+	CuAssertPtrEquals(tc, NULL, strstr(buf, "\"name\":\"outer\","
+					   "\"ph\":\"B\""));
+	CuAssertPtrEquals(tc, NULL, strstr(buf, "disabled"));
+	CuAssertPtrNotNull(tc, strstr(buf, "\"traceEvents\":["));
+	CuAssertPtrNotNull(tc, strstr(buf, "\"name\":\"inner\","
+				      "\"ph\":\"E\""));
+	CuAssertPtrNotNull(tc, strstr(buf, "\"name\":\"last\","
+				      "\"ph\":\"B\""));
+	CuAssertPtrNotNull(tc, strstr(buf, "\"name\":\"outer\","
+				      "\"ph\":\"E\""));
+
+	free(buf);
+	rc = unlink(fpath);
+	CuAssertIntEquals(tc, 0, rc);
+}
+
+#define NUM_TRACE_THREADS 4
+
+static int trace_stop = 0;
+static int trace_started = 0;
+
+static void *trace_writer(void *arg)
+{
+	char ctx[32];
+
+	(void)arg;
+	for (uint64_t n = 1; !__atomic_load_n(&trace_stop, __ATOMIC_ACQUIRE);
+	     n++) {
+		snprintf(ctx, sizeof(ctx), "%#jx", (uintmax_t)n);
+		trace_context_set(n, ctx);
+		TRACE_BEGIN("writer");
+		TRACE_END("writer");
+		if (n == 1)
+			__atomic_add_fetch(&trace_started, 1, __ATOMIC_RELEASE);
+	}
+
+	return NULL;
+}
+
+void test_trace_threads(CuTest *tc)
+{
+	int rc;
+	char fpath[PATH_MAX];
+	char line[256];
+	pthread_t threads[NUM_TRACE_THREADS];
+	FILE *file;
+	size_t nargs = 0;
+
+	snprintf(fpath, sizeof(fpath), "/tmp/ltsm-trace-%d.json", getpid());
+
+	rc = trace_enable(64);
+	CuAssertIntEquals(tc, 0, rc);
+	__atomic_store_n(&trace_stop, 0, __ATOMIC_RELEASE);
+	for (uint8_t t = 0; t < NUM_TRACE_THREADS; t++) {
+		rc = pthread_create(&threads[t], NULL, trace_writer, NULL);
+		CuAssertIntEquals(tc, 0, rc);
+	}
+	while (__atomic_load_n(&trace_started, __ATOMIC_ACQUIRE) <
+	       NUM_TRACE_THREADS)
+		sched_yield();
+
+	/* Dumps race with writers which passed the enabled check, events
+	   written meanwhile are skipped and never dumped torn. */
+	for (uint8_t d = 0; d < 16; d++) {
+		rc = trace_dump(fpath);
+		CuAssertIntEquals(tc, 0, rc);
+
+		file = fopen(fpath, "r");
+		CuAssertPtrNotNull(tc, file);
+		while (fgets(line, sizeof(line), file)) {
+			char cookie[32];
+			char ctx[32];
+			const char *args = strstr(line, "\"args\":{\"cookie\"");
+
+			if (!args)
+				continue;
+			rc = sscanf(args, "\"args\":{\"cookie\":\"%31[^\"]\","
+				    "\"ctx\":\"%31[^\"]\"}", cookie, ctx);
+			CuAssertIntEquals(tc, 2, rc);
+			CuAssertStrEquals(tc, cookie, ctx);
+			nargs++;
+		}
+		fclose(file);
+	}
+
+	__atomic_store_n(&trace_stop, 1, __ATOMIC_RELEASE);
+	for (uint8_t t = 0; t < NUM_TRACE_THREADS; t++)
+		pthread_join(threads[t], NULL);
+	trace_disable();
+
+	CuAssertTrue(tc, nargs > 0);
+	rc = unlink(fpath);
+	CuAssertIntEquals(tc, 0, rc);
+}
+
 CuSuite* ltsmapi_get_suite()
 {
     CuSuite* suite = CuSuiteNew();
 #ifdef TEST_TSM_CALLS
     SUITE_ADD_TEST(suite, test_tsm_fcalls);
+    SUITE_ADD_TEST(suite, test_tsm_fwritev);
+    SUITE_ADD_TEST(suite, test_tsm_archive_retrieve);
+    SUITE_ADD_TEST(suite, test_tsm_archive_crc32);
+    SUITE_ADD_TEST(suite, test_tsm_archive_prefetch);
+    SUITE_ADD_TEST(suite, test_tsm_archive_direct);
+    SUITE_ADD_TEST(suite, test_tsm_archive_sparse);
+    SUITE_ADD_TEST(suite, test_tsm_archive_compress);
+    SUITE_ADD_TEST(suite, test_spool);
 #endif
     SUITE_ADD_TEST(suite, test_extract_hl_ll);
     SUITE_ADD_TEST(suite, test_login_init);
     SUITE_ADD_TEST(suite, test_set_prefix);
+    SUITE_ADD_TEST(suite, test_mountp_cache);
+    SUITE_ADD_TEST(suite, test_progress_dispatch);
+    SUITE_ADD_TEST(suite, test_alog);
+    SUITE_ADD_TEST(suite, test_metrics);
+    SUITE_ADD_TEST(suite, test_metrics_prometheus);
+    SUITE_ADD_TEST(suite, test_trace);
+    SUITE_ADD_TEST(suite, test_trace_threads);
 
     return suite;
 }
@@ -0,0 +1,122 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Copyright (c) 2026, GSI Helmholtz Centre for Heavy Ion Research
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "prefetch.h"
+#include "common.h"
+#include "test_utils.h"
+#include "CuTest.h"
+
+#define CHUNK	4096
+#define BUDGET	(16 * CHUNK)
+#define LEN_RND_STR 6
+
+void test_prefetch(CuTest *tc)
+{
+	struct prefetch_t prefetch;
+	struct prefetch_file_t *file[3];
+	/* Single chunk, several chunks with tail and chunk aligned. */
+	const size_t sizes[] = {17, 3 * CHUNK + 4711, 4 * CHUNK};
+	char fpath[3][PATH_MAX];
+	char rnd_s[LEN_RND_STR + 1] = {0};
+	uint32_t crc32sum;
+	struct stat st;
+	FILE *f;
+	int rc;
+
+	rc = prefetch_init(&prefetch, 0, BUDGET, CHUNK, false);
+	CuAssertIntEquals(tc, -EINVAL, rc);
+
+	rc = prefetch_init(&prefetch, 3, BUDGET, CHUNK, false);
+	CuAssertIntEquals(tc, 0, rc);
+
+	for (size_t s = 0; s < 3; s++) {
+		rnd_str(rnd_s, LEN_RND_STR);
+		snprintf(fpath[s], PATH_MAX, "/tmp/%s", rnd_s);
+		f = fopen(fpath[s], "w");
+		CuAssertPtrNotNull(tc, f);
+		for (size_t n = 0; n < sizes[s]; n++)
+			fputc(rand() % 256, f);
+		fclose(f);
+
+		rc = prefetch_add(&prefetch, fpath[s], sizes[s], &file[s]);
+		CuAssertIntEquals(tc, 0, rc);
+	}
+
+	/* Budget is exhausted. */
+	rc = prefetch_add(&prefetch, fpath[0], BUDGET, &file[0]);
+	CuAssertIntEquals(tc, -ENOSPC, rc);
+	rc = prefetch_add(&prefetch, fpath[0], 0, &file[0]);
+	CuAssertIntEquals(tc, -EINVAL, rc);
+
+	for (size_t s = 0; s < 3; s++) {
+		rc = prefetch_wait(&prefetch, file[s]);
+		CuAssertIntEquals(tc, 0, rc);
+		rc = crc32file(fpath[s], &crc32sum);
+		CuAssertIntEquals(tc, 0, rc);
+		CuAssertIntEquals(tc, crc32sum, file[s]->crc32);
+		rc = lstat(fpath[s], &st);
+		CuAssertIntEquals(tc, 0, rc);
+		CuAssertTrue(tc, !prefetch_modified(&file[s]->st, &st));
+
+		/* In place rewrite of same size is detected. */
+		rc = utimensat(AT_FDCWD, fpath[s],
+			       (struct timespec[2]){{0, UTIME_OMIT}, {1, 0}}, 0);
+		CuAssertIntEquals(tc, 0, rc);
+		rc = lstat(fpath[s], &st);
+		CuAssertIntEquals(tc, 0, rc);
+		CuAssertTrue(tc, prefetch_modified(&file[s]->st, &st));
+		prefetch_release(&prefetch, file[s]);
+	}
+	CuAssertIntEquals(tc, 0, prefetch.used);
+
+	/* File truncated after it was added. */
+	rc = prefetch_add(&prefetch, fpath[1], sizes[1] + 1, &file[1]);
+	CuAssertIntEquals(tc, 0, rc);
+	rc = prefetch_wait(&prefetch, file[1]);
+	CuAssertIntEquals(tc, -ESTALE, rc);
+	prefetch_release(&prefetch, file[1]);
+	CuAssertIntEquals(tc, 0, prefetch.used);
+	for (size_t s = 0; s < 3; s++)
+		unlink(fpath[s]);
+
+	/* Missing file is reported, budget is returned on release. */
+	rc = prefetch_add(&prefetch, fpath[0], BUDGET, &file[0]);
+	CuAssertIntEquals(tc, 0, rc);
+	rc = prefetch_wait(&prefetch, file[0]);
+	CuAssertIntEquals(tc, -ENOENT, rc);
+	prefetch_release(&prefetch, file[0]);
+	CuAssertIntEquals(tc, 0, prefetch.used);
+
+	prefetch_destroy(&prefetch);
+}
+
+CuSuite* prefetch_get_suite()
+{
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, test_prefetch);
+
+    return suite;
+}
@@ -0,0 +1,79 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Copyright (c) 2026, GSI Helmholtz Centre for Heavy Ion Research
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include "slab.h"
+#include "CuTest.h"
+
+#define N 100
+
+void test_slab(CuTest *tc)
+{
+	struct slab_t slab;
+	uint8_t *objs[N];
+	void *obj;
+	int rc;
+
+	rc = slab_init(&slab, 0, 8);
+	CuAssertIntEquals(tc, -EINVAL, rc);
+
+	/* Objects smaller than a pointer are enlarged and all objects are
+	   aligned. */
+	rc = slab_init(&slab, 3, 8);
+	CuAssertIntEquals(tc, 0, rc);
+
+	for (uint16_t n = 0; n < N; n++) {
+		objs[n] = slab_alloc(&slab);
+		CuAssertPtrNotNull(tc, objs[n]);
+		CuAssertIntEquals(tc, 0, (uintptr_t)objs[n] %
+				  _Alignof(max_align_t));
+		memset(objs[n], n, 3);
+	}
+	CuAssertIntEquals(tc, (N + 7) / 8, slab.nchunks);
+	CuAssertIntEquals(tc, N, slab.nused);
+
+	/* Objects do not overlap. */
+	for (uint16_t n = 0; n < N; n++)
+		for (uint16_t b = 0; b < 3; b++)
+			CuAssertIntEquals(tc, n, objs[n][b]);
+
+	/* Freed objects are recycled without allocating chunks. */
+	for (uint16_t n = 0; n < N; n++)
+		slab_free(&slab, objs[n]);
+	CuAssertIntEquals(tc, 0, slab.nused);
+
+	obj = slab_alloc(&slab);
+	CuAssertPtrEquals(tc, objs[N - 1], obj);
+	for (uint16_t n = 1; n < N; n++)
+		CuAssertPtrNotNull(tc, slab_alloc(&slab));
+	CuAssertIntEquals(tc, (N + 7) / 8, slab.nchunks);
+
+	slab_free(&slab, NULL);
+	slab_destroy(&slab);
+	CuAssertPtrEquals(tc, NULL, slab.chunks);
+}
+
+CuSuite* slab_get_suite()
+{
+    CuSuite* suite = CuSuiteNew();
+    SUITE_ADD_TEST(suite, test_slab);
+
+    return suite;
+}